@@ -0,0 +1,103 @@
+#pragma once
+#include "Bench.h"
+#include "AssetPack.h"
+#include <memory>
+
+// The files startup reads, SPIR-V, models and textures, each opened, mapped and copied out as
+// into staging memory, against one pack mapped once with its entries copied or decompressed
+// from there, and against that pack linked in by embedfiles. The files stay in the page cache
+// between runs, so what differs is the cost per file: the opens, the mappings and their page
+// faults.
+inline void AssetPackBench()
+{
+    std::vector<std::string> Paths;
+    for( const char *Directory : { "bin/shaders", "models", "textures" } )
+    {
+        std::error_code Error;
+        for( const auto &Entry : std::filesystem::directory_iterator( BenchPath( Directory ), Error ) )
+            if( Entry.is_regular_file() ) Paths.push_back( std::format( "{}/{}", Directory, Entry.path().filename().string() ) );
+    }
+    std::sort( Paths.begin(), Paths.end() );
+    if( Paths.empty() )
+    {
+        spdlog::info( "No assets, skipped." );
+        return;
+    }
+
+    AssetPackWriter Writer;
+    size_t Largest{ 0 };
+    for( const auto &Path : Paths )
+    {
+        MappedFile File{ BenchPath( Path.c_str() ).c_str() };
+        Writer.Add( Path, { File.Data(), File.Size() }, true );
+        Largest = std::max( Largest, File.Size() );
+    }
+    std::filesystem::create_directories( BenchPath( "cache/bench" ) );
+    std::string PackPath{ BenchPath( "cache/bench/assets.pack" ) };
+    double WriteMs{ TimeMs( [ & ] { Writer.Write( PackPath ); } ) };
+    AssetPackStatistics Packed{ Writer.Stat() };
+    spdlog::info( "  {} files, {:.2f} MB packed into {:.2f} MB in {:.3f} ms, {} LZ4 compressed", Packed.Entries, Packed.RawBytes / double( 1 << 20 ), Packed.StoredBytes / double( 1 << 20 ), WriteMs,
+                  Packed.Compressed );
+
+    const uint32_t Runs{ 5 };
+    std::vector<uint8_t> Staging( Largest );
+    FileStatistics Before{ MappedFile::Stat() };
+    double LooseMs{ BestOfMs( Runs, [ & ]
+                              {
+                                  for( const auto &Path : Paths )
+                                  {
+                                      MappedFile File{ BenchPath( Path.c_str() ).c_str() };
+                                      memcpy( Staging.data(), File.Data(), File.Size() );
+                                  } } ) };
+    FileStatistics LooseFiles{ MappedFile::Stat() };
+    bool Same{ true };
+    auto ReadAll{ [ & ]( const AssetPack &pack )
+                  {
+                      for( const auto &Path : Paths )
+                      {
+                          const AssetPackEntry *Entry{ pack.Find( Path ) };
+                          Same = Same && Entry && pack.Read( *Entry, Staging.data() ) && Hash64( Staging.data(), Entry->RawSize ) == Entry->Hash;
+                      }
+                  } };
+    double PackMs{ BestOfMs( Runs, [ & ]
+                             {
+                                 AssetPack Pack{ PackPath.c_str() };
+                                 ReadAll( Pack ); } ) };
+    FileStatistics PackFiles{ MappedFile::Stat() };
+    spdlog::info( "  loose  {:8.3f} ms, {} files opened, {:.3f} ms of it opening and mapping", LooseMs, ( LooseFiles.Opens - Before.Opens ) / Runs, ( LooseFiles.Milliseconds - Before.Milliseconds ) / Runs );
+    spdlog::info( "  packed {:8.3f} ms, {} files opened, {:.3f} ms of it opening and mapping, x{:.1f}{}", PackMs, ( PackFiles.Opens - LooseFiles.Opens ) / Runs, ( PackFiles.Milliseconds - LooseFiles.Milliseconds ) / Runs,
+                  LooseMs / PackMs, Same ? "" : " MISMATCH" );
+
+    // The pack as an EMBED_ASSETS build has it, already in memory and 64-byte aligned.
+    const size_t PackSize{ std::filesystem::file_size( PackPath ) };
+    std::vector<uint8_t> Memory( PackSize + AssetPackAlignment );
+    void *Aligned{ Memory.data() };
+    size_t Space{ Memory.size() };
+    std::align( AssetPackAlignment, PackSize, Aligned, Space );
+    std::span<const uint8_t> Linked{ static_cast<const uint8_t *>( Aligned ), PackSize };
+    {
+        MappedFile File{ PackPath.c_str() };
+        memcpy( Aligned, File.Data(), File.Size() );
+    }
+    FileStatistics BeforeLinked{ MappedFile::Stat() };
+    double LinkedMs{ BestOfMs( Runs, [ & ]
+                               {
+                                   AssetPack Pack;
+                                   Same = Pack.Open( Linked ) && Same;
+                                   ReadAll( Pack ); } ) };
+    spdlog::info( "  linked {:8.3f} ms, {} files opened, x{:.1f}{}", LinkedMs, ( MappedFile::Stat().Opens - BeforeLinked.Opens ) / Runs, LooseMs / LinkedMs, Same ? "" : " MISMATCH" );
+
+    // LZ4 alone, over the entries it was kept for.
+    AssetPack Opened{ PackPath.c_str() };
+    uint64_t Decoded{ 0 };
+    double DecodeMs{ BestOfMs( Runs, [ & ]
+                               {
+                                   Decoded = 0;
+                                   for( const AssetPackEntry &Entry : Opened.Entries() )
+                                       if( Entry.Compression == AssetCompression::Lz4 )
+                                       {
+                                           Opened.Read( Entry, Staging.data() );
+                                           Decoded += Entry.RawSize;
+                                       } } ) };
+    if( Decoded ) spdlog::info( "  LZ4 decode {:.2f} MB in {:.3f} ms, {:.0f} MB/s", Decoded / double( 1 << 20 ), DecodeMs, Decoded / double( 1 << 20 ) / DecodeMs * 1000.0 );
+}
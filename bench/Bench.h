@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include "vulkan.h"
+
+#ifndef BENCH_ROOT
+#    define BENCH_ROOT ""
+#endif
+
+// Subsystem chatter goes to debug so only the benchmark results are printed.
+const LoggerCallbacks BenchLoggers{ []( const char *data )
+                                   { spdlog::trace( data ); },
+                                   []( const char *data )
+                                   { spdlog::debug( data ); },
+                                   []( const char *data )
+                                   { spdlog::debug( data ); },
+                                   []( const char *data )
+                                   { spdlog::warn( data ); },
+                                   []( const char *data )
+                                   { spdlog::error( data ); },
+                                   []( const char *data )
+                                   { spdlog::critical( data ); throw std::runtime_error( data ); } };
+
+inline std::string BenchPath( const char *relative )
+{
+    return std::string{ BENCH_ROOT } + relative;
+}
+
+// Every *.obj under models/, sorted so runs are comparable.
+inline std::vector<std::string> BenchModels()
+{
+    std::vector<std::string> Paths;
+    for( const auto &Entry : std::filesystem::directory_iterator( BenchPath( "models" ) ) )
+        if( Entry.path().extension() == ".obj" ) Paths.push_back( Entry.path().string() );
+    std::sort( Paths.begin(), Paths.end() );
+    return Paths;
+}
+
+template <typename F>
+double TimeMs( F &&job )
+{
+    auto Start{ std::chrono::steady_clock::now() };
+    job();
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+}
+
+template <typename F>
+double BestOfMs( uint32_t runs, F &&job )
+{
+    double Best{ std::numeric_limits<double>::max() };
+    for( uint32_t i{ 0 }; i < runs; i++ )
+        Best = std::min( Best, TimeMs( job ) );
+    return Best;
+}
+
+// Grid of quads roughly the size of a production mesh, so the thread scaling is visible.
+inline std::string SyntheticObj( uint32_t side )
+{
+    std::string Obj;
+    Obj.reserve( static_cast<size_t>( side ) * side * 90 );
+    char Line[ 96 ];
+    for( uint32_t y{ 0 }; y <= side; y++ )
+        for( uint32_t x{ 0 }; x <= side; x++ )
+        {
+            Obj.append( Line, snprintf( Line, sizeof( Line ), "v %f %f %f\n", x * 0.01f, y * 0.01f, 0.001f * ( ( x * 7 + y * 13 ) % 17 ) ) );
+            Obj.append( Line, snprintf( Line, sizeof( Line ), "vt %f %f\n", x / float( side ), y / float( side ) ) );
+        }
+    for( uint32_t y{ 0 }; y < side; y++ )
+        for( uint32_t x{ 0 }; x < side; x++ )
+        {
+            uint32_t a{ y * ( side + 1 ) + x + 1 }, b{ a + 1 }, c{ a + side + 2 }, d{ a + side + 1 };
+            Obj.append( Line, snprintf( Line, sizeof( Line ), "f %u/%u %u/%u %u/%u %u/%u\n", a, a, b, b, c, c, d, d ) );
+        }
+    return Obj;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "Bench.h"
+
+// Surface-less device for GPU benchmarks; runs on the lavapipe software ICD as well.
+// Valid() is false when no Vulkan 1.2 device with timeline semaphores is present.
+class BenchDevice
+{
+  public:
+    BenchDevice()
+    {
+        VkApplicationInfo ApplicationInfo{};
+        ApplicationInfo.sType            = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        ApplicationInfo.pApplicationName = "bench";
+        ApplicationInfo.apiVersion       = VK_API_VERSION_1_2;
+        VkInstanceCreateInfo InstanceCreateInfo{};
+        InstanceCreateInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        InstanceCreateInfo.pApplicationInfo = &ApplicationInfo;
+        if( vkCreateInstance( &InstanceCreateInfo, nullptr, &Instance ) != VK_SUCCESS )
+        {
+            Instance = VK_NULL_HANDLE;
+            return;
+        }
+
+        uint32_t Count{ 0 };
+        vkEnumeratePhysicalDevices( Instance, &Count, nullptr );
+        std::vector<VkPhysicalDevice> Devices( Count );
+        vkEnumeratePhysicalDevices( Instance, &Count, Devices.data() );
+        for( auto Device : Devices )
+        {
+            VkPhysicalDeviceVulkan12Features Features12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+            VkPhysicalDeviceFeatures2 Features2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &Features12 };
+            vkGetPhysicalDeviceProperties( Device, &Properties );
+            vkGetPhysicalDeviceFeatures2( Device, &Features2 );
+            if( Properties.apiVersion < VK_API_VERSION_1_2 || !Features12.timelineSemaphore ) continue;
+            PhysicalDevice = Device;
+            break;
+        }
+        if( !PhysicalDevice ) return;
+
+        uint32_t FamiliesCount{ 0 };
+        vkGetPhysicalDeviceQueueFamilyProperties( PhysicalDevice, &FamiliesCount, nullptr );
+        std::vector<VkQueueFamilyProperties> Families( FamiliesCount );
+        vkGetPhysicalDeviceQueueFamilyProperties( PhysicalDevice, &FamiliesCount, Families.data() );
+        for( uint32_t Family{ FamiliesCount }; Family-- > 0; )
+        {
+            if( Families[ Family ].queueFlags & VK_QUEUE_GRAPHICS_BIT ) GraphicFamily = Family;
+            if( ( Families[ Family ].queueFlags & VK_QUEUE_TRANSFER_BIT ) && !( Families[ Family ].queueFlags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) ) TransferFamily = Family;
+        }
+        if( GraphicFamily == ~0u ) return;
+        if( TransferFamily == ~0u ) TransferFamily = GraphicFamily;
+
+        float Priority{ 1.f };
+        std::vector<VkDeviceQueueCreateInfo> QueueCreateInfos;
+        for( uint32_t Family : std::set<uint32_t>{ GraphicFamily, TransferFamily } )
+            QueueCreateInfos.push_back( { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO, nullptr, 0, Family, 1, &Priority } );
+        VkPhysicalDeviceVulkan12Features Features12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+        Features12.timelineSemaphore = VK_TRUE;
+        VkDeviceCreateInfo DeviceCreateInfo{};
+        DeviceCreateInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        DeviceCreateInfo.pNext                = &Features12;
+        DeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>( QueueCreateInfos.size() );
+        DeviceCreateInfo.pQueueCreateInfos    = QueueCreateInfos.data();
+        if( vkCreateDevice( PhysicalDevice, &DeviceCreateInfo, nullptr, &Device ) != VK_SUCCESS )
+        {
+            Device = VK_NULL_HANDLE;
+            return;
+        }
+        vkGetDeviceQueue( Device, GraphicFamily, 0, &GraphicQueue );
+        vkGetDeviceQueue( Device, TransferFamily, 0, &TransferQueue );
+        Memory.emplace( PhysicalDevice, Device );
+    }
+    BenchDevice( const BenchDevice & )            = delete;
+    BenchDevice &operator=( const BenchDevice & ) = delete;
+
+    ~BenchDevice()
+    {
+        if( Device ) vkDeviceWaitIdle( Device );
+        Memory.reset();
+        if( Device ) vkDestroyDevice( Device, nullptr );
+        if( Instance ) vkDestroyInstance( Instance, nullptr );
+    }
+
+    bool Valid() const
+    {
+        return Device != VK_NULL_HANDLE;
+    }
+
+    VkInstance Instance{ VK_NULL_HANDLE };
+    VkPhysicalDevice PhysicalDevice{ VK_NULL_HANDLE };
+    VkPhysicalDeviceProperties Properties{};
+    VkDevice Device{ VK_NULL_HANDLE };
+    uint32_t GraphicFamily{ ~0u };
+    uint32_t TransferFamily{ ~0u };
+    VkQueue GraphicQueue{ VK_NULL_HANDLE };
+    VkQueue TransferQueue{ VK_NULL_HANDLE };
+    std::optional<DeviceMemoryAllocator> Memory;
+};
@@ -0,0 +1,442 @@
+// Deterministic frame benchmark: renders a fixed scene headless along a scripted CameraPath
+// and writes frame time percentiles, draw calls and allocation counts as JSON, so runs on the
+// same machine can be compared commit to commit. Runs on the lavapipe CPU driver too:
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json framebench --json frame.json
+//
+//   --frames N       measured frames, 300
+//   --warmup N       frames rendered first and not measured, 30
+//   --instances N    N instances of the models in a grid instead of one of each
+//   --textures M     M generated 256x256 textures besides textures/img.png
+//   --width, --height  target size, 1280x720
+//   --json path      output, stdout if missing
+//   --trace path     Chrome trace of the profiler zones, with ENABLE_PROFILER
+//   --threads 1,2,4  after the run, the same frames recorded on that many threads each, to see
+//                    recording time scale with cores
+//   --no-bindless    a descriptor set per texture even where descriptor indexing exists
+//   --culling off|indirect-count|multi-draw-indirect
+//                    instances culled by cull.comp into indirect draws, indirect-count by
+//                    default; the last frame's visibility is checked against the CPU reference,
+//                    failing the run on a mismatch
+//   --occlusion      culled in two phases against a depth pyramid by occlusion.comp as well; a
+//                    frame after the run keeps its depth, and any instance culled that the CPU
+//                    finds in the frustum and in front of that depth fails the run
+#include "Bench.h"
+#include "GpuScene.h"
+#include "CameraPath.h"
+#include "SceneRenderer.h"
+#include "CommandRecorder.h"
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+std::atomic<uint64_t> HostAllocations{ 0 };
+}
+
+// Every heap allocation of the process is counted, so per frame allocations show up in the
+// report; the steady state should need none.
+void *operator new( size_t size )
+{
+    HostAllocations.fetch_add( 1, std::memory_order_relaxed );
+    if( void *Memory{ std::malloc( size ? size : 1 ) } ) return Memory;
+    throw std::bad_alloc{};
+}
+void operator delete( void *memory ) noexcept
+{
+    std::free( memory );
+}
+void operator delete( void *memory, size_t ) noexcept
+{
+    std::free( memory );
+}
+
+struct FrameBenchOptions
+{
+    uint32_t Frames{ 300 };
+    uint32_t Warmup{ 30 };
+    uint32_t Instances{ 0 };
+    uint32_t Textures{ 0 };
+    VkExtent2D Extent{ 1280, 720 };
+    const char *Json{ nullptr };
+    const char *Trace{ nullptr };
+    std::vector<uint32_t> Threads;
+    bool Bindless{ true };
+    CullingMode Culling{ CullingMode::IndirectCount };
+    bool Occlusion{ false };
+};
+
+struct FrameTimeSummary
+{
+    double Mean{ 0.0 };
+    double P50{ 0.0 };
+    double P95{ 0.0 };
+    double P99{ 0.0 };
+    double Max{ 0.0 };
+};
+
+// Nearest rank percentiles.
+FrameTimeSummary Summarize( std::vector<double> samples )
+{
+    FrameTimeSummary Summary;
+    if( samples.empty() ) return Summary;
+    std::sort( samples.begin(), samples.end() );
+    auto Rank{ [ & ]( double percent )
+               { return samples[ std::min( samples.size() - 1, static_cast<size_t>( std::ceil( percent / 100.0 * samples.size() ) ) - 1 ) ]; } };
+    for( double Sample : samples ) Summary.Mean += Sample / samples.size();
+    Summary.P50 = Rank( 50.0 );
+    Summary.P95 = Rank( 95.0 );
+    Summary.P99 = Rank( 99.0 );
+    Summary.Max = samples.back();
+    return Summary;
+}
+
+std::string JsonSummary( const FrameTimeSummary &summary )
+{
+    return std::format( "{{ \"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f} }}", summary.Mean, summary.P50, summary.P95, summary.P99, summary.Max );
+}
+
+std::string JsonString( const char *text )
+{
+    std::string Result{ "\"" };
+    for( const char *Char{ text }; *Char; Char++ )
+    {
+        if( *Char == '"' || *Char == '\\' ) Result += '\\';
+        if( static_cast<unsigned char>( *Char ) >= 0x20 ) Result += *Char;
+    }
+    return Result + "\"";
+}
+
+// A colour per texture over a checkerboard, so neighbouring instances are told apart.
+TextureLevel FrameBenchTexture( uint32_t index )
+{
+    const uint32_t Side{ 256 };
+    TextureLevel Level{ Side, Side, std::vector<uint8_t>( Side * Side * 4 ) };
+    uint32_t Hash{ ( index + 1 ) * 2654435761u };
+    for( uint32_t y{ 0 }; y < Side; y++ )
+        for( uint32_t x{ 0 }; x < Side; x++ )
+        {
+            bool Dark{ ( ( ( x >> 5 ) ^ ( y >> 5 ) ) & 1 ) != 0 };
+            uint8_t *Texel{ &Level.Pixels[ ( size_t( y ) * Side + x ) * 4 ] };
+            for( uint32_t Channel{ 0 }; Channel < 3; Channel++ ) Texel[ Channel ] = static_cast<uint8_t>( ( Hash >> ( Channel * 8 ) & 0xFF ) >> ( Dark ? 1 : 0 ) );
+            Texel[ 3 ] = 255;
+        }
+    return Level;
+}
+
+FrameBenchOptions ParseOptions( int argc, char *argv[] )
+{
+    FrameBenchOptions Options;
+    auto Number{ [ & ]( int &i )
+                 { return static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) ); } };
+    for( int i{ 1 }; i < argc; i++ )
+    {
+        bool Value{ i + 1 < argc };
+        if( !strcmp( argv[ i ], "--frames" ) && Value ) Options.Frames = Number( i );
+        else if( !strcmp( argv[ i ], "--warmup" ) && Value ) Options.Warmup = Number( i );
+        else if( !strcmp( argv[ i ], "--instances" ) && Value ) Options.Instances = Number( i );
+        else if( !strcmp( argv[ i ], "--textures" ) && Value ) Options.Textures = Number( i );
+        else if( !strcmp( argv[ i ], "--width" ) && Value ) Options.Extent.width = std::max( Number( i ), 1u );
+        else if( !strcmp( argv[ i ], "--height" ) && Value ) Options.Extent.height = std::max( Number( i ), 1u );
+        else if( !strcmp( argv[ i ], "--json" ) && Value ) Options.Json = argv[ ++i ];
+        else if( !strcmp( argv[ i ], "--trace" ) && Value ) Options.Trace = argv[ ++i ];
+        else if( !strcmp( argv[ i ], "--no-bindless" ) ) Options.Bindless = false;
+        else if( !strcmp( argv[ i ], "--occlusion" ) ) Options.Occlusion = true;
+        else if( !strcmp( argv[ i ], "--culling" ) && Value )
+        {
+            if( !ParseCullingMode( argv[ ++i ], Options.Culling ) ) throw std::runtime_error( std::format( "Unknown culling mode {}.", argv[ i ] ) );
+        }
+        else if( !strcmp( argv[ i ], "--threads" ) && Value )
+        {
+            for( char *Next{ argv[ ++i ] }; *Next; )
+            {
+                char *End{ nullptr };
+                Options.Threads.push_back( std::max( static_cast<uint32_t>( std::strtoul( Next, &End, 10 ) ), 1u ) );
+                if( End == Next ) throw std::runtime_error( std::format( "Bad thread counts {}.", argv[ i ] ) );
+                Next = *End == ',' ? End + 1 : End;
+            }
+        }
+        else throw std::runtime_error( std::format( "Unknown argument {}.", argv[ i ] ) );
+    }
+    return Options;
+}
+
+// Without instances one of each model side by side, as the app shows them; with instances a
+// square grid cycling through models and textures, every mesh scaled to a unit sphere. Grouped
+// either way, so every model is one instanced draw per texture.
+void PlaceInstances( GpuScene &scene, uint32_t instances )
+{
+    auto Meshes{ scene.Meshes() };
+    uint32_t Textures{ static_cast<uint32_t>( scene.Textures().size() ) };
+    if( !instances )
+    {
+        float X{ 0.f };
+        for( uint32_t Index{ 0 }; Index < Meshes.size(); Index++ )
+        {
+            scene.AddInstance( Index, 0, glm::vec3{ X + Meshes[ Index ].Radius, 0.f, 0.f } - Meshes[ Index ].Center );
+            X += Meshes[ Index ].Radius * 2.2f;
+        }
+        scene.Group();
+        return;
+    }
+    uint32_t Side{ static_cast<uint32_t>( std::ceil( std::sqrt( double( instances ) ) ) ) };
+    for( uint32_t Index{ 0 }; Index < instances; Index++ )
+    {
+        uint32_t Mesh{ Index % static_cast<uint32_t>( Meshes.size() ) };
+        float Scale{ 1.f / std::max( Meshes[ Mesh ].Radius, 1e-6f ) };
+        glm::vec3 Cell{ ( Index % Side ) * 2.5f, 0.f, ( Index / Side ) * 2.5f };
+        scene.AddInstance( Mesh, Index % Textures, Cell - Scale * Meshes[ Mesh ].Center, glm::quat{ 1.f, 0.f, 0.f, 0.f }, glm::vec3{ Scale } );
+    }
+    scene.Group();
+}
+
+int main( int argc, char *argv[] )
+{
+    spdlog::set_default_logger( spdlog::stderr_logger_mt( "framebench" ) );
+    spdlog::set_level( spdlog::level::info );
+    PROFILE_THREAD( "main" );
+    spdlog::set_pattern( "%v" );
+    try
+    {
+        FrameBenchOptions Options{ ParseOptions( argc, argv ) };
+        VulkanInstance Vulkan{ "FrameBench", VK_MAKE_VERSION( 0, 0, 0 ), Options.Extent, BenchLoggers };
+        OffscreenTarget &Target{ Vulkan.Offscreen() };
+
+        std::vector<std::string> Models{ BenchModels() };
+        if( Models.empty() ) throw std::runtime_error( "No models." );
+        MeshCache Meshes{ BenchPath( "cache/bench" ).c_str(), BenchLoggers };
+        TextureCache Textures{ BenchPath( "cache/bench" ).c_str(), BenchLoggers };
+        TextureFormat Format{ Vulkan.TextureCompression() ? TextureFormat::Bc7 : TextureFormat::Rgba8 };
+        std::string Image{ BenchPath( "textures/img.png" ) };
+        bool HasImage{ std::filesystem::exists( Image ) };
+        uint32_t TextureCount{ Options.Textures + ( HasImage || !Options.Textures ? 1u : 0u ) };
+
+        GpuScene Scene{ Vulkan, Models.size(), TextureCount, Options.Bindless };
+        uint64_t Triangles{ 0 };
+        for( size_t Index{ 0 }; Index < Models.size(); Index++ )
+        {
+            CachedMesh Mesh{ Meshes.Load( Models[ Index ].c_str() ) };
+            Scene.UploadMesh( Index, Mesh );
+        }
+        uint32_t Slot{ 0 };
+        if( HasImage ) Scene.UploadTexture( Slot++, Textures.Load( Image.c_str(), Format ) );
+        for( uint32_t Index{ 0 }; Slot < TextureCount; Index++ )
+            Scene.UploadTexture( Slot++, TextureCache::Compress( GenerateMips( FrameBenchTexture( Index ) ), Format, true ) );
+        PlaceInstances( Scene, Options.Instances );
+        for( const auto &Instance : Scene.Instances ) Triangles += Scene.Meshes()[ Instance.Mesh ].Lods.front().IndicesCount / 3;
+        Vulkan.Uploads().Wait( Scene.Flush() );
+
+        DepthSource Depth{ Target.Depth(), Options.Extent };
+        SceneRenderer Renderer{ Vulkan, Scene, Target.RenderPass(), 1, BenchPath( "bin/shaders/shader.vert.spv" ).c_str(), nullptr, Options.Culling, Options.Occlusion ? &Depth : nullptr };
+        glm::vec4 Bounds{ Scene.Bounds() };
+        CameraPath Camera{ glm::vec3{ Bounds }, std::max( Bounds.w, 1e-3f ), std::max( Options.Frames, 1u ) };
+        glm::mat4 Projection{ Camera.Projection( Options.Extent ) };
+        const float Clear[ 4 ]{ 0.1f, 0.1f, 0.1f, 1.f };
+        double RecordMs{ 0.0 };
+        // Inline on this thread, or cut across the threads of recorder; culling, when on, is
+        // recorded before the render pass and counted as recording, as are the pyramid and the
+        // late phase between the passes and the late pass itself with occlusion.
+        auto Frame{ [ & ]( uint32_t index, CommandRecorder *recorder = nullptr )
+                    {
+                        auto Draw{ [ & ]( VkCommandBuffer commandBuffer )
+                                   {
+                                       auto Start{ std::chrono::steady_clock::now() };
+                                       if( recorder ) Renderer.Record( *recorder, commandBuffer, Target.Framebuffer(), Options.Extent, Camera.View( index ), Projection );
+                                       else Renderer.Record( commandBuffer, Options.Extent, Camera.View( index ), Projection );
+                                       RecordMs += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+                                   } };
+                        auto Occlude{ [ & ]( VkCommandBuffer commandBuffer )
+                                      {
+                                          auto Start{ std::chrono::steady_clock::now() };
+                                          Renderer.Occlude( commandBuffer );
+                                          RecordMs += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+                                      } };
+                        Target.Render(
+                            [ & ]( VkCommandBuffer commandBuffer )
+                            {
+                                if( recorder ) recorder->Begin( 0 );
+                                Vulkan.Uploads().Acquire( commandBuffer );
+                                auto Start{ std::chrono::steady_clock::now() };
+                                Renderer.Cull( commandBuffer, Camera.View( index ), Projection, 0, recorder ? &recorder->Workers() : nullptr );
+                                RecordMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+                            },
+                            Draw, Clear, Vulkan.Uploads().Semaphore(), Scene.Uploaded(), recorder ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE,
+                            Occlude, Renderer.Occlusion() ? std::function<void( VkCommandBuffer )>{ Draw } : std::function<void( VkCommandBuffer )>{} );
+                    } };
+        for( uint32_t Index{ 0 }; Index < Options.Warmup; Index++ ) Frame( Index % Camera.Frames );
+
+        std::vector<double> Cpu, Whole, Gpu, Recording;
+        Cpu.reserve( Options.Frames );
+        Whole.reserve( Options.Frames );
+        Gpu.reserve( Options.Frames );
+        Recording.reserve( Options.Frames );
+        MemoryStatistics DeviceBefore{ Vulkan.DeviceMemory().Stat() };
+        uint64_t HostBefore{ HostAllocations.load() };
+        uint64_t DescriptorUpdates{ 0 }, PushConstants{ 0 }, UniformBytes{ 0 };
+        double TransformMs{ 0.0 };
+        OcclusionCounters Occlusion;
+        for( uint32_t Index{ 0 }; Index < Options.Frames; Index++ )
+        {
+            Frame( Index );
+            if( const IndirectCuller *Culler{ Renderer.Culler() } )
+            {
+                OcclusionCounters Counted{ Culler->Counters( 0 ) };
+                Occlusion.Tested += Counted.Tested;
+                Occlusion.Occluded += Counted.Occluded;
+                Occlusion.DrawnEarly += Counted.DrawnEarly;
+                Occlusion.DrawnLate += Counted.DrawnLate;
+            }
+            RenderStatistics Recorded{ Renderer.Stat() };
+            DescriptorUpdates += Recorded.DescriptorUpdates;
+            PushConstants += Recorded.PushConstants;
+            UniformBytes += Recorded.UniformBytes;
+            TransformMs += Recorded.TransformMs;
+            const OffscreenFrameTimes &Times{ Target.LastFrame() };
+            Cpu.push_back( Times.CpuMs );
+            Whole.push_back( Times.FrameMs );
+            Recording.push_back( RecordMs );
+            if( Times.GpuMs > 0.0 ) Gpu.push_back( Times.GpuMs );
+        }
+        uint64_t HostDuring{ HostAllocations.load() - HostBefore };
+        MemoryStatistics DeviceAfter{ Vulkan.DeviceMemory().Stat() };
+        RenderStatistics Draws{ Renderer.Stat() };
+        // Summaries allocate, so they come after the counters are read.
+        FrameTimeSummary CpuSummary{ Summarize( Cpu ) }, FrameSummary{ Summarize( Whole ) }, GpuSummary{ Summarize( Gpu ) }, RecordSummary{ Summarize( Recording ) };
+
+        // The last frame is complete, so what the GPU found visible in it can be held against
+        // the CPU reference of the same view; spheres touching a plane within Epsilon may go
+        // either way.
+        uint32_t Visible{ static_cast<uint32_t>( Scene.Instances.size() ) }, Expected{ Visible }, Mismatches{ 0 };
+        double CpuCullMs{ 0.0 };
+        if( const IndirectCuller *Culler{ Renderer.Culler() }; Culler && Options.Frames )
+        {
+            CullView View{ MakeCullView( { glm::mat4{ 1.f }, Camera.View( Options.Frames - 1 ), Projection } ) };
+            std::vector<float> Margins;
+            CpuCullMs = BestOfMs( 5, [ & ]
+                                  { Margins = CullReference( Scene, View ); } );
+            std::span<const uint32_t> Flags{ Culler->Visibility( 0 ) };
+            const float Epsilon{ 1e-4f * std::max( Bounds.w, 1.f ) };
+            Visible  = Culler->Visible( 0 );
+            Expected = 0;
+            uint32_t Flagged{ 0 };
+            for( size_t Index{ 0 }; Index < Margins.size(); Index++ )
+            {
+                Expected += Margins[ Index ] >= 0.f;
+                Flagged += Flags[ Index ];
+                if( ( Flags[ Index ] != 0 ) != ( Margins[ Index ] >= 0.f ) && std::abs( Margins[ Index ] ) > Epsilon ) Mismatches++;
+            }
+            // The counts the draws read must agree with the flags they were compacted from; with
+            // occlusion they count both phases' draws instead.
+            if( !Renderer.Occlusion() && Visible != Flagged ) Mismatches += std::max( Visible, Flagged ) - std::min( Visible, Flagged );
+        }
+
+        // The last view once more, keeping the depth its late phase tested against. The pyramid
+        // only holds farther depths than the brute force reference, so an instance may be kept
+        // that the reference finds occluded, counted as conservative, but one culled while in
+        // the frustum and in front of the depth by more than DepthEpsilon is a mismatch.
+        uint32_t OcclusionMismatches{ 0 }, Conservative{ 0 };
+        double CpuOcclusionMs{ 0.0 };
+        if( const IndirectCuller *Culler{ Renderer.Culler() }; Culler && Renderer.Occlusion() && Options.Frames )
+        {
+            Renderer.CaptureDepth( true );
+            Frame( Options.Frames - 1 );
+            Renderer.CaptureDepth( false );
+            glm::mat4 View{ Camera.View( Options.Frames - 1 ) };
+            std::vector<float> Frustum{ CullReference( Scene, MakeCullView( { glm::mat4{ 1.f }, View, Projection } ) ) }, Margins;
+            CpuOcclusionMs = BestOfMs( 5, [ & ]
+                                       { Margins = OcclusionReference( Scene, Projection * View, Renderer.Pyramid()->Depth(), Options.Extent ); } );
+            std::span<const uint32_t> Flags{ Culler->Visibility( 0 ) };
+            const float Epsilon{ 1e-4f * std::max( Bounds.w, 1.f ) }, DepthEpsilon{ 1e-5f };
+            for( size_t Index{ 0 }; Index < Margins.size(); Index++ )
+            {
+                if( Flags[ Index ] && Margins[ Index ] > DepthEpsilon ) Conservative++;
+                if( !Flags[ Index ] && Frustum[ Index ] > Epsilon && Margins[ Index ] < -DepthEpsilon ) OcclusionMismatches++;
+            }
+        }
+
+        // The caller of JobSystem::Wait records too, so n threads are n - 1 workers.
+        std::vector<std::pair<uint32_t, FrameTimeSummary>> Scaling;
+        for( uint32_t Threads : Options.Threads )
+        {
+            JobSystem Workers{ Threads - 1 };
+            CommandRecorder Recorder{ Vulkan.Device(), Vulkan.GraphicFamily(), Workers };
+            for( uint32_t Index{ 0 }; Index < Options.Warmup; Index++ ) Frame( Index % Camera.Frames, &Recorder );
+            Recording.clear();
+            for( uint32_t Index{ 0 }; Index < Options.Frames; Index++ )
+            {
+                Frame( Index, &Recorder );
+                Recording.push_back( RecordMs );
+            }
+            Scaling.emplace_back( Threads, Summarize( Recording ) );
+        }
+
+        std::string Json;
+        Json += "{\n";
+        Json += std::format( "  \"device\": {},\n", JsonString( Vulkan.Properties().deviceName ) );
+        Json += std::format( "  \"extent\": [ {}, {} ],\n", Options.Extent.width, Options.Extent.height );
+        Json += std::format( "  \"frames\": {},\n  \"warmup\": {},\n", Options.Frames, Options.Warmup );
+        Json += std::format( "  \"scene\": {{ \"models\": {}, \"textures\": {}, \"instances\": {}, \"triangles\": {} }},\n", Models.size(), TextureCount, Scene.Instances.size(), Triangles );
+        Json += std::format( "  \"cpu_ms\": {},\n", JsonSummary( CpuSummary ) );
+        Json += std::format( "  \"frame_ms\": {},\n", JsonSummary( FrameSummary ) );
+        Json += std::format( "  \"gpu_ms\": {},\n", Gpu.empty() ? "null" : JsonSummary( GpuSummary ) );
+        Json += std::format( "  \"record_ms\": {},\n", JsonSummary( RecordSummary ) );
+        Json += "  \"record_scaling\": [";
+        for( size_t Index{ 0 }; Index < Scaling.size(); Index++ )
+            Json += std::format( "{}\n    {{ \"threads\": {}, \"record_ms\": {} }}", Index ? "," : "", Scaling[ Index ].first, JsonSummary( Scaling[ Index ].second ) );
+        Json += Scaling.empty() ? "],\n" : "\n  ],\n";
+        Json += std::format( "  \"bindless\": {},\n", Renderer.Bindless() );
+        Json += std::format( "  \"culling\": {{ \"mode\": {}, \"dispatches\": {}, \"visible\": {}, \"expected\": {}, \"mismatches\": {}, \"cpu_cull_ms\": {:.4f} }},\n",
+                             JsonString( CullingModeName( Renderer.Culling() ) ), Draws.Dispatches, Visible, Expected, Mismatches, CpuCullMs );
+        if( Renderer.Occlusion() && Options.Frames )
+            Json += std::format( "  \"occlusion\": {{ \"levels\": {}, \"tested_per_frame\": {:.2f}, \"occluded_per_frame\": {:.2f}, \"drawn_early_per_frame\": {:.2f}, \"drawn_late_per_frame\": {:.2f}, "
+                                 "\"mismatches\": {}, \"conservative\": {}, \"cpu_reference_ms\": {:.4f} }},\n",
+                                 Renderer.Pyramid()->Levels(), double( Occlusion.Tested ) / Options.Frames, double( Occlusion.Occluded ) / Options.Frames, double( Occlusion.DrawnEarly ) / Options.Frames,
+                                 double( Occlusion.DrawnLate ) / Options.Frames, OcclusionMismatches, Conservative, CpuOcclusionMs );
+        else
+            Json += "  \"occlusion\": null,\n";
+        Json += std::format( "  \"draw_calls\": {},\n  \"pipeline_binds\": {},\n  \"descriptor_binds\": {},\n  \"buffer_binds\": {},\n", Draws.Draws, Draws.PipelineBinds, Draws.DescriptorBinds, Draws.BufferBinds );
+        Json += std::format( "  \"instances_drawn\": {},\n  \"instances_per_draw\": {:.2f},\n", Draws.Instances, Draws.Draws ? double( Draws.Instances ) / Draws.Draws : 0.0 );
+        Json += std::format( "  \"transform_ms_per_frame\": {:.4f},\n", Options.Frames ? TransformMs / Options.Frames : 0.0 );
+        Json += std::format( "  \"descriptor_updates_per_frame\": {:.2f},\n  \"descriptor_updates_total\": {},\n", Options.Frames ? double( DescriptorUpdates ) / Options.Frames : 0.0,
+                             Renderer.DescriptorUpdates() );
+        Json += std::format( "  \"push_constants_per_frame\": {:.2f},\n  \"uniform_bytes_per_frame\": {:.0f},\n", Options.Frames ? double( PushConstants ) / Options.Frames : 0.0,
+                             Options.Frames ? double( UniformBytes ) / Options.Frames : 0.0 );
+        Json += std::format( "  \"host_allocations_per_frame\": {:.2f},\n", Options.Frames ? double( HostDuring ) / Options.Frames : 0.0 );
+        Json += std::format( "  \"device_allocations\": {},\n  \"device_allocations_during_frames\": {},\n  \"device_memory_objects\": {}\n", DeviceAfter.Allocations,
+                             int64_t( DeviceAfter.Allocations ) - int64_t( DeviceBefore.Allocations ), Vulkan.DeviceMemory().MemoryObjects() );
+        Json += "}\n";
+        if( Options.Json )
+        {
+            std::ofstream Out{ Options.Json, std::ios::binary };
+            Out << Json;
+            if( !Out ) throw std::runtime_error( std::format( "Failed to write {}.", Options.Json ) );
+        }
+        else
+            std::cout << Json;
+        spdlog::info( "{}: {} frames at {}x{}, {} draws of {} instances, {} descriptor binds{}, {} descriptor updates, cpu p50 {:.3f} ms p99 {:.3f} ms, frame p50 {:.3f} ms p99 {:.3f} ms{}", Vulkan.Properties().deviceName, Options.Frames, Options.Extent.width,
+                      Options.Extent.height, Draws.Draws, Draws.Instances, Draws.DescriptorBinds, Renderer.Bindless() ? " (bindless)" : "", DescriptorUpdates, CpuSummary.P50, CpuSummary.P99, FrameSummary.P50, FrameSummary.P99, Gpu.empty() ? ", no timestamps" : std::format( ", gpu p50 {:.3f} ms", GpuSummary.P50 ) );
+        for( const auto &[ Threads, Summary ] : Scaling ) spdlog::info( "  recorded on {} threads: p50 {:.3f} ms, p99 {:.3f} ms", Threads, Summary.P50, Summary.P99 );
+        if( Renderer.Culler() )
+            spdlog::info( "  culling ({}): {} of {} instances visible, reference {} ({:.3f} ms on the CPU), {} mismatches", CullingModeName( Renderer.Culling() ), Visible, Scene.Instances.size(), Expected,
+                          CpuCullMs, Mismatches );
+        if( Renderer.Occlusion() )
+            spdlog::info( "  occlusion: {} of {} instances tested occluded over the run, {} drawn early, {} late; {} mismatches, {} kept conservatively ({:.3f} ms on the CPU)", Occlusion.Occluded,
+                          Occlusion.Tested, Occlusion.DrawnEarly, Occlusion.DrawnLate, OcclusionMismatches, Conservative, CpuOcclusionMs );
+        if( Options.Trace )
+        {
+            if( !ProfilerEnabled ) spdlog::warn( "--trace needs a build with ENABLE_PROFILER, nothing written." );
+            else if( !Profiler::Get().WriteChromeTrace( Options.Trace ) ) throw std::runtime_error( std::format( "Failed to write {}.", Options.Trace ) );
+        }
+        if( Mismatches ) throw std::runtime_error( std::format( "GPU culling disagrees with the CPU reference on {} instances.", Mismatches ) );
+        if( OcclusionMismatches ) throw std::runtime_error( std::format( "GPU occlusion culling dropped {} instances the CPU reference finds visible.", OcclusionMismatches ) );
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Bench.h"
+#include "BenchDevice.h"
+#include "JobSystem.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+
+// Submit, run and wait cost of a job with no work: independent jobs, then a dependency chain
+// where every job is pushed by the one before it.
+inline void JobSystemBenchOverhead( JobSystem &jobs )
+{
+    const uint32_t Count{ 100000 };
+    std::vector<Job> Submitted;
+    Submitted.reserve( Count );
+    double IndependentMs{ BestOfMs( 3, [ & ]
+                                    {
+                                        Submitted.clear();
+                                        for( uint32_t i{ 0 }; i < Count; i++ ) Submitted.push_back( jobs.Submit( {}, [] {} ) );
+                                        jobs.Wait( Submitted ); } ) };
+    double ChainMs{ BestOfMs( 3, [ & ]
+                              {
+                                  Job Last{ jobs.Submit( {}, [] {} ) };
+                                  for( uint32_t i{ 1 }; i < Count; i++ ) Last = jobs.Submit( {}, [] {}, { Last } );
+                                  jobs.Wait( Last ); } ) };
+    spdlog::info( "  empty jobs  {:8.1f} ns/job independent, {:8.1f} ns/job chained", IndependentMs * 1e6 / Count, ChainMs * 1e6 / Count );
+}
+
+// Mip chains of many small images, the shape of a texture heavy scene.
+inline void JobSystemBenchScaling( JobSystem &jobs )
+{
+    const uint32_t Count{ 64 }, Side{ 256 };
+    TextureLevel Base{ Side, Side, std::vector<uint8_t>( Side * Side * 4 ) };
+    for( size_t i{ 0 }; i < Base.Pixels.size(); i++ ) Base.Pixels[ i ] = static_cast<uint8_t>( i * 2654435761u >> 24 );
+    std::vector<std::vector<TextureLevel>> Chains( Count );
+    double SerialMs{ BestOfMs( 3, [ & ]
+                               { for( auto &Chain : Chains ) Chain = GenerateMips( Base ); } ) };
+    std::vector<Job> Submitted;
+    double ParallelMs{ BestOfMs( 3, [ & ]
+                                 {
+                                     Submitted.clear();
+                                     for( auto &Chain : Chains ) Submitted.push_back( jobs.Submit( {}, [ & ]
+                                                                                                  { Chain = GenerateMips( Base ); } ) );
+                                     jobs.Wait( Submitted ); } ) };
+    spdlog::info( "  {} mip chains {:8.3f} ms serial, {:8.3f} ms on {} workers x{:.1f}", Count, SerialMs, ParallelMs, jobs.Threads() + 1, SerialMs / ParallelMs );
+}
+
+// The part of app startup that overlaps, without a window: device bring-up followed by asset
+// loading, against asset loading on the workers while the device comes up on the calling
+// thread. Swapchain, pipelines and uploads come after either and are not timed.
+inline void JobSystemBenchStartup( bool cold )
+{
+    std::vector<std::string> Models{ BenchModels() };
+    std::string Texture{ BenchPath( "textures/img.png" ) };
+    MeshCache Meshes{ BenchPath( "cache/bench" ).c_str(), BenchLoggers };
+    TextureCache Textures{ BenchPath( "cache/bench" ).c_str(), BenchLoggers };
+    auto Clear{ [ & ]
+                {
+                    std::error_code Error;
+                    if( !cold ) return;
+                    for( const auto &Path : Models ) std::filesystem::remove( Meshes.CacheFile( Path.c_str() ), Error );
+                    std::filesystem::remove( Textures.CacheFile( Texture.c_str(), TextureFormat::Bc7, true ), Error );
+                } };
+    auto LoadTexture{ [ & ]
+                      {
+                          if( std::filesystem::exists( Texture ) ) Textures.Load( Texture.c_str(), TextureFormat::Bc7 );
+                      } };
+
+    Clear();
+    double SerialMs{ TimeMs( [ & ]
+                             {
+                                 BenchDevice Gpu;
+                                 for( const auto &Path : Models ) Meshes.Load( Path.c_str() );
+                                 LoadTexture(); } ) };
+    Clear();
+    Timeline Lanes;
+    double OverlappedMs{ TimeMs( [ & ]
+                                 {
+                                     JobSystem Jobs{ JobSystem::DefaultThreads(), &Lanes };
+                                     std::vector<Job> Loaded;
+                                     for( const auto &Path : Models ) Loaded.push_back( Jobs.Submit( std::format( "load {}", std::filesystem::path( Path ).filename().string() ), [ &, Path ]
+                                                                                                      { Meshes.Load( Path.c_str() ); } ) );
+                                     Loaded.push_back( Jobs.Submit( "load texture", LoadTexture ) );
+                                     {
+                                         Timeline::Scope Span{ Lanes, "instance and device" };
+                                         BenchDevice Gpu;
+                                     }
+                                     Jobs.Wait( Loaded ); } ) };
+    spdlog::info( "  device bring-up and asset load, {} caches: {:8.3f} ms serial, {:8.3f} ms overlapped, {:.0f}% less", cold ? "cold" : "warm", SerialMs, OverlappedMs, 100.0 * ( 1.0 - OverlappedMs / SerialMs ) );
+    LoggerCallbacks Printed{ BenchLoggers };
+    Printed.info = []( const char *data )
+    { spdlog::info( data ); };
+    Lanes.Log( Printed, "  timeline" );
+}
+
+inline void JobSystemBench()
+{
+    JobSystem Jobs;
+    spdlog::info( "{} workers", Jobs.Threads() );
+    JobSystemBenchOverhead( Jobs );
+    JobSystemBenchScaling( Jobs );
+    JobStatistics Statistics{ Jobs.Stat() };
+    spdlog::info( "  {} jobs, {} stolen", Statistics.Jobs, Statistics.Steals );
+    JobSystemBenchStartup( true );
+    JobSystemBenchStartup( false );
+}
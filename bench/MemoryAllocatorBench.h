@@ -0,0 +1,202 @@
+#pragma once
+#include "Bench.h"
+#include "MemoryAllocator.h"
+#include <map>
+#include <random>
+
+// First fit over an offset-ordered free list: the usual hand-rolled sub-allocator, used as
+// the baseline for TLSF.
+class FirstFitAllocator
+{
+  public:
+    FirstFitAllocator( uint64_t size )
+    {
+        FreeRanges[ 0 ] = size;
+    }
+
+    uint64_t Allocate( uint64_t size, uint64_t alignment )
+    {
+        for( auto Range{ FreeRanges.begin() }; Range != FreeRanges.end(); Range++ )
+        {
+            uint64_t Offset{ AlignUp( Range->first, alignment ) };
+            if( Offset + size > Range->first + Range->second ) continue;
+            uint64_t Begin{ Range->first }, End{ Range->first + Range->second };
+            FreeRanges.erase( Range );
+            if( Offset > Begin ) FreeRanges[ Begin ] = Offset - Begin;
+            if( End > Offset + size ) FreeRanges[ Offset + size ] = End - Offset - size;
+            return Offset;
+        }
+        return LinearAllocator::Invalid;
+    }
+
+    void Free( uint64_t offset, uint64_t size )
+    {
+        auto Next{ FreeRanges.lower_bound( offset ) };
+        if( Next != FreeRanges.end() && Next->first == offset + size )
+        {
+            size += Next->second;
+            Next = FreeRanges.erase( Next );
+        }
+        if( Next != FreeRanges.begin() )
+        {
+            auto Previous{ std::prev( Next ) };
+            if( Previous->first + Previous->second == offset )
+            {
+                Previous->second += size;
+                return;
+            }
+        }
+        FreeRanges[ offset ] = size;
+    }
+
+    size_t Ranges() const
+    {
+        return FreeRanges.size();
+    }
+
+  private:
+    std::map<uint64_t, uint64_t> FreeRanges;
+};
+
+// Resource-like requests: mostly small buffers, some textures, power of two alignments.
+struct MemoryBenchRequest
+{
+    bool Allocate;
+    uint64_t Size;
+    uint64_t Alignment;
+    uint32_t Slot;
+};
+
+inline std::vector<MemoryBenchRequest> MemoryBenchWorkload( uint32_t operations, uint32_t live )
+{
+    std::mt19937_64 Random{ 7 };
+    std::vector<MemoryBenchRequest> Requests;
+    std::vector<uint32_t> Used, Unused( live );
+    for( uint32_t Slot{ 0 }; Slot < live; Slot++ ) Unused[ Slot ] = live - 1 - Slot;
+    for( uint32_t Operation{ 0 }; Operation < operations; Operation++ )
+    {
+        bool Allocate{ Used.empty() || ( !Unused.empty() && Random() % 2 ) };
+        if( Allocate )
+        {
+            uint32_t Slot{ Unused.back() };
+            Unused.pop_back();
+            Used.push_back( Slot );
+            uint64_t Size{ Random() % 8 ? 256 + Random() % ( 64 << 10 ) : ( 256 << 10 ) + Random() % ( 4 << 20 ) };
+            Requests.push_back( { true, Size, uint64_t{ 256 } << ( Random() % 5 ), Slot } );
+        }
+        else
+        {
+            size_t Index{ Random() % Used.size() };
+            Requests.push_back( { false, 0, 0, Used[ Index ] } );
+            Unused.push_back( Used[ Index ] );
+            Used[ Index ] = Used.back();
+            Used.pop_back();
+        }
+    }
+    return Requests;
+}
+
+inline void MemoryAllocatorBench()
+{
+    const uint64_t BlockSize{ 256ull << 20 };
+    const uint32_t Live{ 2048 };
+    std::vector<MemoryBenchRequest> Requests{ MemoryBenchWorkload( 1 << 20, Live ) };
+    spdlog::info( "{} operations, up to {} live allocations, {} MB blocks", Requests.size(), Live, BlockSize >> 20 );
+
+    // Single block, so both allocators see the same pressure.
+    {
+        std::vector<TlsfAllocation> Slots( Live );
+        size_t Failed{ 0 };
+        TlsfAllocator Tlsf{ BlockSize };
+        double Ms{ TimeMs( [ & ]
+                           {
+                               for( const auto &Request : Requests )
+                               {
+                                   auto &Slot{ Slots[ Request.Slot ] };
+                                   if( Request.Allocate )
+                                       Failed += !( Slot = Tlsf.Allocate( Request.Size, Request.Alignment ) ).Valid();
+                                   else if( Slot.Valid() )
+                                       Tlsf.Free( Slot );
+                               } } ) };
+        size_t Ranges{ 0 };
+        Tlsf.ForEachFree( [ & ]( uint64_t, uint64_t )
+                          { Ranges++; } );
+        spdlog::info( "  {:<12} {:8.0f} ops/ms, {} failed, {} free ranges at the end", "TLSF", Requests.size() / Ms, Failed, Ranges );
+    }
+    {
+        std::vector<std::pair<uint64_t, uint64_t>> Slots( Live, { LinearAllocator::Invalid, 0 } );
+        size_t Failed{ 0 };
+        FirstFitAllocator FirstFit{ BlockSize };
+        double Ms{ TimeMs( [ & ]
+                           {
+                               for( const auto &Request : Requests )
+                               {
+                                   auto &Slot{ Slots[ Request.Slot ] };
+                                   if( Request.Allocate )
+                                   {
+                                       Slot = { FirstFit.Allocate( Request.Size, Request.Alignment ), Request.Size };
+                                       Failed += Slot.first == LinearAllocator::Invalid;
+                                   }
+                                   else if( Slot.first != LinearAllocator::Invalid )
+                                       FirstFit.Free( Slot.first, Slot.second );
+                               } } ) };
+        spdlog::info( "  {:<12} {:8.0f} ops/ms, {} failed, {} free ranges at the end", "first fit", Requests.size() / Ms, Failed, FirstFit.Ranges() );
+    }
+
+    // Growing pool with the block policy the device allocator uses.
+    {
+        MemoryPool Pool{ 64ull << 20 };
+        std::vector<PoolAllocation> Slots( Live );
+        uint32_t Added{ 0 }, Released{ 0 }, PeakBlocks{ 0 };
+        double Ms{ TimeMs( [ & ]
+                           {
+                               for( const auto &Request : Requests )
+                               {
+                                   auto &Slot{ Slots[ Request.Slot ] };
+                                   if( Request.Allocate )
+                                   {
+                                       Slot = Pool.Allocate( Request.Size, Request.Alignment );
+                                       if( !Slot.Valid() )
+                                       {
+                                           Pool.AddBlock();
+                                           PeakBlocks = std::max( PeakBlocks, ++Added - Released );
+                                           Slot       = Pool.Allocate( Request.Size, Request.Alignment );
+                                       }
+                                   }
+                                   else
+                                       Released += Pool.Free( Slot ) != PoolAllocation::Invalid;
+                               } } ) };
+        MemoryStatistics Statistics{ Pool.Stat() };
+        DefragmentationStatistics Defragmentation{ Pool.Defragmentation() };
+        spdlog::info( "  {:<12} {:8.0f} ops/ms, {} blocks ({} peak, {} released), {:.1f}% used, fragmentation {:.2f}, "
+                      "compaction could release {} blocks moving {:.1f} MB",
+                      "pool", Requests.size() / Ms, Statistics.Blocks, PeakBlocks, Released, 100.0 * Statistics.Used / Statistics.Reserved,
+                      Statistics.Fragmentation(), Defragmentation.ReleasableBlocks, Defragmentation.BytesToMove / double( 1 << 20 ) );
+    }
+
+    // Per-frame strategies: 4096 small uniform-sized allocations per frame, 3 frames in flight.
+    {
+        const uint32_t Frames{ 1024 }, PerFrame{ 4096 };
+        RingAllocator Ring{ 16ull << 20 };
+        size_t Failed{ 0 };
+        double RingMs{ TimeMs( [ & ]
+                               {
+                                   for( uint32_t Frame{ 0 }; Frame < Frames; Frame++ )
+                                   {
+                                       if( Ring.FramesInFlight() == 3 ) Ring.ReleaseFrame();
+                                       for( uint32_t Allocation{ 0 }; Allocation < PerFrame; Allocation++ ) Failed += Ring.Allocate( 192 + ( Allocation & 63 ), 256 ) == RingAllocator::Invalid;
+                                       Ring.FinishFrame();
+                                   } } ) };
+        LinearAllocator Linear{ 4ull << 20 };
+        double LinearMs{ TimeMs( [ & ]
+                                 {
+                                     for( uint32_t Frame{ 0 }; Frame < Frames; Frame++ )
+                                     {
+                                         Linear.Reset();
+                                         for( uint32_t Allocation{ 0 }; Allocation < PerFrame; Allocation++ ) Failed += Linear.Allocate( 192 + ( Allocation & 63 ), 256 ) == LinearAllocator::Invalid;
+                                     } } ) };
+        double Count{ double( Frames ) * PerFrame };
+        spdlog::info( "  {:<12} {:8.0f} ops/ms", "ring", Count / RingMs );
+        spdlog::info( "  {:<12} {:8.0f} ops/ms{}", "linear", Count / LinearMs, Failed ? std::format( ", {} failed", Failed ) : "" );
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "Bench.h"
+#include "MeshCache.h"
+#include <fstream>
+
+inline void MeshCacheBenchCase( MeshCache &cache, const std::string &path )
+{
+    const uint32_t Runs{ 5 };
+    std::error_code Error;
+    double ColdMs{ BestOfMs( Runs, [ & ]
+                             { std::filesystem::remove( cache.CacheFile( path.c_str() ), Error ); cache.Load( path.c_str() ); } ) };
+    CachedMesh Mesh;
+    double WarmMs{ BestOfMs( Runs, [ & ]
+                             { Mesh = cache.Load( path.c_str() ); } ) };
+    // Same processing as the cold path.
+    Model Parsed;
+    ObjLoader{}.Load( path.c_str(), Parsed );
+    OptimizeMesh( Parsed );
+    LodChain Reference{ GenerateLods( Parsed ) };
+    bool Same{ Mesh.Mapped() && Mesh.Vertecies().size() == Reference.Mesh.ModelVertecies.size() &&
+               Mesh.Indices().size() == Reference.Mesh.ModelVerteciesIndices.size() && Mesh.Lods().size() == Reference.Levels.size() &&
+               !memcmp( Mesh.Vertecies().data(), Reference.Mesh.ModelVertecies.data(), Mesh.Vertecies().size_bytes() ) &&
+               !memcmp( Mesh.Indices().data(), Reference.Mesh.ModelVerteciesIndices.data(), Mesh.Indices().size_bytes() ) &&
+               !memcmp( Mesh.Lods().data(), Reference.Levels.data(), Mesh.Lods().size_bytes() ) };
+    spdlog::info( "{}: {} vertecies, {} indices, {} LODs", path, Mesh.Vertecies().size(), Mesh.Indices().size(), Mesh.Lods().size() );
+    spdlog::info( "  cold (build + write) {:8.3f} ms", ColdMs );
+    spdlog::info( "  warm (mapped)        {:8.3f} ms x{:.1f}{}", WarmMs, ColdMs / WarmMs, Same ? "" : " MISMATCH" );
+}
+
+inline void MeshCacheBench()
+{
+    MeshCache Cache{ BenchPath( "cache/bench" ).c_str(), BenchLoggers };
+    for( const auto &Path : BenchModels() )
+        MeshCacheBenchCase( Cache, Path );
+    std::string Synthetic{ BenchPath( "cache/bench/synthetic.obj" ) };
+    std::ofstream{ Synthetic, std::ios::binary } << SyntheticObj( 1024 );
+    MeshCacheBenchCase( Cache, Synthetic );
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Bench.h"
+#include "ObjLoader.h"
+#include "MeshOptimizer.h"
+
+inline void MeshOptimizerBenchStep( const char *name, const Model &mesh, double ms )
+{
+    VertexCacheStatistics Cache{ AnalyzeVertexCache( mesh.ModelVerteciesIndices, mesh.ModelVertecies.size() ) };
+    float Fetch{ AnalyzeVertexFetch( mesh.ModelVerteciesIndices, mesh.ModelVertecies.size(), sizeof( Vertex ) ) };
+    spdlog::info( "  {:<18} ACMR {:.3f}, ATVR {:.3f}, overfetch {:.3f}, {:8.2f} ms", name, Cache.Acmr, Cache.Atvr, Fetch, ms );
+}
+
+// Each pass is applied on top of the previous one, in the order OptimizeMesh runs them.
+inline void MeshOptimizerBenchCase( const std::string &name, const Model &source )
+{
+    spdlog::info( "{}: {} vertecies, {} triangles", name, source.ModelVertecies.size(), source.ModelVerteciesIndices.size() / 3 );
+    MeshOptimizerBenchStep( "source", source, 0.0 );
+
+    Model Mesh{ source };
+    std::vector<uint32_t> Boundaries;
+    double CacheMs{ TimeMs( [ & ]
+                            { Boundaries = OptimizeVertexCache( Mesh.ModelVerteciesIndices, Mesh.ModelVertecies.size() ); } ) };
+    MeshOptimizerBenchStep( "vertex cache", Mesh, CacheMs );
+    double OverdrawMs{ TimeMs( [ & ]
+                               { OptimizeOverdraw( Mesh.ModelVerteciesIndices, Mesh.ModelVertecies, Boundaries ); } ) };
+    MeshOptimizerBenchStep( "+ overdraw", Mesh, OverdrawMs );
+    double FetchMs{ TimeMs( [ & ]
+                            { OptimizeVertexFetch( Mesh ); } ) };
+    MeshOptimizerBenchStep( "+ vertex fetch", Mesh, FetchMs );
+}
+
+inline void MeshOptimizerBench()
+{
+    for( const auto &Path : BenchModels() )
+    {
+        Model Source;
+        ObjLoader{}.Load( Path.c_str(), Source );
+        MeshOptimizerBenchCase( Path, Source );
+    }
+    std::string Grid{ SyntheticObj( 1024 ) };
+    Model Source;
+    ObjLoader{}.Parse( Grid.data(), Grid.size(), Source );
+    MeshOptimizerBenchCase( "synthetic 1024x1024 grid", Source );
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Bench.h"
+#include "ObjLoader.h"
+#include "MeshQuantizer.h"
+
+template <typename Layout>
+void MeshQuantizerBenchLayout( const char *name, const Model &source, float diagonal )
+{
+    QuantizedMesh<Layout> Mesh;
+    double Ms{ TimeMs( [ & ]
+                       { Mesh = QuantizeMesh<Layout>( source.ModelVertecies, source.ModelVerteciesIndices ); } ) };
+    spdlog::info( "  {:<8} stride {:2} B, {:8.1f} KB, {:7.2f} ms | position max {:.2e} rms {:.2e} ({:.4f}% of bounds), color max {:.2e}, uv max {:.2e}",
+                  name, Layout::Stride, Mesh.Vertecies.size() / 1024.0, Ms, Mesh.Error.MaxPosition, Mesh.Error.RmsPosition,
+                  100.f * Mesh.Error.MaxPosition / diagonal, Mesh.Error.MaxColor, Mesh.Error.MaxTexture );
+}
+
+inline void MeshQuantizerBenchCase( const std::string &name, const Model &source )
+{
+    glm::vec3 Min{ std::numeric_limits<float>::max() }, Max{ std::numeric_limits<float>::lowest() };
+    for( const auto &Point : source.ModelVertecies )
+    {
+        Min = glm::min( Min, Point.coordinate );
+        Max = glm::max( Max, Point.coordinate );
+    }
+    spdlog::info( "{}: {} vertecies", name, source.ModelVertecies.size() );
+    float Diagonal{ std::max( glm::length( Max - Min ), std::numeric_limits<float>::min() ) };
+    MeshQuantizerBenchLayout<FullVertexLayout>( "Full", source, Diagonal );
+    MeshQuantizerBenchLayout<HalfVertexLayout>( "Half", source, Diagonal );
+    MeshQuantizerBenchLayout<PackedVertexLayout>( "Packed", source, Diagonal );
+}
+
+inline void MeshQuantizerBench()
+{
+    for( const auto &Path : BenchModels() )
+    {
+        Model Source;
+        ObjLoader{}.Load( Path.c_str(), Source );
+        MeshQuantizerBenchCase( Path, Source );
+    }
+    std::string Grid{ SyntheticObj( 1024 ) };
+    Model Source;
+    ObjLoader{}.Parse( Grid.data(), Grid.size(), Source );
+    MeshQuantizerBenchCase( "synthetic 1024x1024 grid", Source );
+}
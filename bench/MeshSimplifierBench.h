@@ -0,0 +1,98 @@
+#pragma once
+#include "Bench.h"
+#include "ObjLoader.h"
+#include "MeshSimplifier.h"
+#include <format>
+
+inline float PointTriangleDistance( const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c )
+{
+    glm::vec3 Normal{ glm::cross( b - a, c - a ) };
+    float Area{ glm::dot( Normal, Normal ) };
+    if( Area > 0.f )
+    {
+        // Inside the prism over the triangle the plane distance is the answer.
+        glm::vec3 Projected{ p - Normal * ( glm::dot( p - a, Normal ) / Area ) };
+        if( glm::dot( glm::cross( b - a, Projected - a ), Normal ) >= 0.f && glm::dot( glm::cross( c - b, Projected - b ), Normal ) >= 0.f &&
+            glm::dot( glm::cross( a - c, Projected - c ), Normal ) >= 0.f )
+            return glm::length( p - Projected );
+    }
+    auto Segment{ [ & ]( const glm::vec3 &s, const glm::vec3 &e )
+                  {
+                      glm::vec3 Direction{ e - s };
+                      float Length{ glm::dot( Direction, Direction ) };
+                      float t{ Length > 0.f ? std::clamp( glm::dot( p - s, Direction ) / Length, 0.f, 1.f ) : 0.f };
+                      return glm::length( p - ( s + Direction * t ) );
+                  } };
+    return std::min( { Segment( a, b ), Segment( b, c ), Segment( c, a ) } );
+}
+
+// Largest distance from a source vertex to the simplified surface; brute force, so only run
+// on small meshes.
+inline float MeasuredError( const Model &mesh, std::span<const uint32_t> indices )
+{
+    float Result{ 0.f };
+    for( const auto &Point : mesh.ModelVertecies )
+    {
+        float Nearest{ std::numeric_limits<float>::max() };
+        for( size_t i{ 0 }; i < indices.size(); i += 3 )
+            Nearest = std::min( Nearest, PointTriangleDistance( Point.coordinate, mesh.ModelVertecies[ indices[ i ] ].coordinate,
+                                                                mesh.ModelVertecies[ indices[ i + 1 ] ].coordinate, mesh.ModelVertecies[ indices[ i + 2 ] ].coordinate ) );
+        Result = std::max( Result, Nearest );
+    }
+    return Result;
+}
+
+// Walks the same chain as GenerateLods, timing the simplification of every level; the vertex
+// cache reorder between levels is left out of the time but not of the chain, since it changes
+// the order the next level collapses in.
+inline void MeshSimplifierBenchCase( const std::string &name, const Model &source )
+{
+    const LodOptions Options;
+    const size_t MaxMeasuredWork{ 400'000'000 };
+    spdlog::info( "{}: {} vertecies, {} triangles", name, source.ModelVertecies.size(), source.ModelVerteciesIndices.size() / 3 );
+    MeshSimplifier Simplifier{ source.ModelVertecies };
+    std::vector<uint32_t> Indices{ source.ModelVerteciesIndices };
+    float Error{ 0.f };
+    for( float Ratio : Options.Ratios )
+    {
+        size_t Previous{ Indices.size() };
+        size_t Target{ static_cast<size_t>( source.ModelVerteciesIndices.size() / 3 * Ratio ) * 3 };
+        if( Target >= Previous ) continue;
+        double Ms{ TimeMs( [ & ]
+                           { Error += Simplifier.Simplify( Indices, Target, Options.MaxError - Error ); } ) };
+        std::string Measured{ "-" };
+        if( source.ModelVertecies.size() * Indices.size() / 3 <= MaxMeasuredWork )
+            Measured = std::format( "{:.5f}", MeasuredError( source, Indices ) / Simplifier.Extent() );
+        spdlog::info( "  ratio {:<7} {:8} triangles ({:5.1f}%), error {:.5f} estimated, {} measured, {:8.2f} ms", Ratio, Indices.size() / 3,
+                      100.0 * Indices.size() / std::max<size_t>( source.ModelVerteciesIndices.size(), 1 ), Error, Measured, Ms );
+        if( Indices.empty() || Indices.size() > Previous * Options.MinReduction )
+        {
+            // Short of the target, Simplify ran into the error bound or out of valid collapses;
+            // otherwise the target itself kept too much of the previous level.
+            if( Indices.empty() ) spdlog::info( "  chain ends: simplified to nothing" );
+            else if( Indices.size() > Target )
+                spdlog::info( "  chain ends: stopped short of the target at error {:.5f}, bound {}", Error, Options.MaxError );
+            else
+                spdlog::info( "  chain ends: {:.1f}% of the previous level kept, above MinReduction {}", 100.0 * Indices.size() / Previous, Options.MinReduction );
+            break;
+        }
+        OptimizeVertexCache( Indices, source.ModelVertecies.size() );
+    }
+}
+
+inline void MeshSimplifierBench()
+{
+    for( const auto &Path : BenchModels() )
+    {
+        Model Source;
+        ObjLoader{}.Load( Path.c_str(), Source );
+        MeshSimplifierBenchCase( Path, Source );
+    }
+    for( uint32_t Side : { 128u, 1024u } )
+    {
+        std::string Grid{ SyntheticObj( Side ) };
+        Model Source;
+        ObjLoader{}.Parse( Grid.data(), Grid.size(), Source );
+        MeshSimplifierBenchCase( std::format( "synthetic {0}x{0} grid", Side ), Source );
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "Bench.h"
+#include "ObjLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshletCulling.h"
+#include <random>
+#include <numbers>
+
+inline void MeshletBuildBenchCase( const std::string &name, Model &source )
+{
+    OptimizeMesh( source );
+    MeshletMesh Mesh;
+    double Ms{ TimeMs( [ & ]
+                       { Mesh = BuildMeshlets( source.ModelVertecies, source.ModelVerteciesIndices ); } ) };
+    size_t Cones{ 0 };
+    for( const auto &Bounds : Mesh.Bounds ) Cones += Bounds.ConeCutoff < 1.f;
+    size_t Count{ std::max<size_t>( Mesh.Meshlets.size(), 1 ) };
+    spdlog::info( "{}: {} meshlets, {:.1f} vertecies and {:.1f} triangles on average, {:.1f}% with a usable cone, {:.2f} ms", name,
+                  Mesh.Meshlets.size(), Mesh.Vertecies.size() / double( Count ), Mesh.Triangles.size() / 3.0 / Count, 100.0 * Cones / Count, Ms );
+}
+
+// Scripted orbit around the origin so every run sees the same views.
+inline DemensionsUniformrObject MeshletBenchCamera( uint32_t frame, float distance )
+{
+    float Angle{ frame * 0.1f };
+    DemensionsUniformrObject Uniform;
+    Uniform.model = glm::mat4{ 1.f };
+    Uniform.view  = glm::lookAt( glm::vec3{ std::cos( Angle ) * distance, distance * 0.3f, std::sin( Angle ) * distance }, glm::vec3{ 0.f }, glm::vec3{ 0.f, 1.f, 0.f } );
+    Uniform.proj  = glm::perspective( glm::radians( 60.f ), 16.f / 9.f, 0.1f, distance * 4.f );
+    return Uniform;
+}
+
+template <typename Kernel>
+void MeshletCullBenchKernel( const char *name, const MeshletCullData &data, const std::vector<CullView> &views, const std::vector<std::vector<uint32_t>> &reference, Kernel &&kernel )
+{
+    std::vector<uint32_t> Visible;
+    size_t Mismatches{ 0 };
+    double Ms{ BestOfMs( 3, [ & ]
+                         {
+                             Mismatches = 0;
+                             for( size_t v{ 0 }; v < views.size(); v++ )
+                             {
+                                 kernel( views[ v ], Visible );
+                                 std::vector<uint32_t> Difference;
+                                 std::set_symmetric_difference( Visible.begin(), Visible.end(), reference[ v ].begin(), reference[ v ].end(), std::back_inserter( Difference ) );
+                                 Mismatches += Difference.size();
+                             } } ) };
+    double Clusters{ static_cast<double>( data.Size() ) * views.size() };
+    spdlog::info( "  {:<24} {:10.0f} clusters/ms{}", name, Clusters / Ms, Mismatches ? std::format( ", {} results differ from scalar", Mismatches ) : "" );
+}
+
+inline void MeshletCullBench()
+{
+    // Meshlet-sized spheres scattered through a cube, with random cones.
+    const uint32_t Count{ 1 << 20 };
+    const float Side{ 100.f };
+    std::mt19937 Random{ 42 };
+    std::uniform_real_distribution<float> Unit{ -1.f, 1.f };
+    std::vector<MeshletBounds> Bounds( Count );
+    for( auto &Entry : Bounds )
+    {
+        Entry.Center   = glm::vec3{ Unit( Random ), Unit( Random ), Unit( Random ) } * Side;
+        Entry.Radius   = 0.2f + 0.1f * Unit( Random );
+        Entry.ConeAxis = glm::normalize( glm::vec3{ Unit( Random ), Unit( Random ), Unit( Random ) } + glm::vec3{ 0.f, 0.f, 1e-3f } );
+        float Spread{ 0.5f + 0.5f * Unit( Random ) };
+        Entry.ConeCutoff = Spread <= 0.1f ? 1.f : std::sqrt( 1.f - Spread * Spread );
+    }
+    MeshletCullData Data{ Bounds };
+
+    std::vector<CullView> Views;
+    std::vector<std::vector<uint32_t>> Reference;
+    size_t VisibleTotal{ 0 };
+    for( uint32_t Frame{ 0 }; Frame < 16; Frame++ )
+    {
+        Views.push_back( MakeCullView( MeshletBenchCamera( Frame, Side * 1.5f ) ) );
+        Reference.emplace_back( Data.PaddedSize() );
+        Reference.back().resize( CullMeshletsScalar( Data, Views.back(), 0, Data.PaddedSize(), Reference.back().data() ) );
+        VisibleTotal += Reference.back().size();
+    }
+    spdlog::info( "{} clusters x {} views, {:.1f}% visible, widest kernel {}, {} threads", Count, Views.size(),
+                  100.0 * VisibleTotal / ( double( Count ) * Views.size() ), CullMeshletsKernel(), std::thread::hardware_concurrency() );
+
+    auto Serial{ [ & ]( auto cull )
+                 {
+                     return [ &, cull ]( const CullView &view, std::vector<uint32_t> &visible )
+                     {
+                         visible.resize( Data.PaddedSize() );
+                         visible.resize( cull( Data, view, 0, Data.PaddedSize(), visible.data() ) );
+                     };
+                 } };
+    MeshletCullBenchKernel( "scalar, one core", Data, Views, Reference, Serial( CullMeshletsScalar ) );
+#if defined( __SSE2__ ) || defined( _M_X64 )
+    MeshletCullBenchKernel( "SSE, one core", Data, Views, Reference, Serial( CullMeshletsSse ) );
+#endif
+#if defined( __AVX2__ )
+    MeshletCullBenchKernel( "AVX2, one core", Data, Views, Reference, Serial( CullMeshletsAvx2 ) );
+#endif
+    MeshletCullBenchKernel( std::format( "{}, all cores", CullMeshletsKernel() ).c_str(), Data, Views, Reference, [ & ]( const CullView &view, std::vector<uint32_t> &visible )
+                            { CullMeshletsParallel( Data, view, visible ); } );
+}
+
+inline void MeshletBench()
+{
+    for( const auto &Path : BenchModels() )
+    {
+        Model Source;
+        ObjLoader{}.Load( Path.c_str(), Source );
+        MeshletBuildBenchCase( Path, Source );
+    }
+    std::string Grid{ SyntheticObj( 1024 ) };
+    Model Source;
+    ObjLoader{}.Parse( Grid.data(), Grid.size(), Source );
+    MeshletBuildBenchCase( "synthetic 1024x1024 grid", Source );
+    MeshletCullBench();
+}
@@ -0,0 +1,96 @@
+#pragma once
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#include "Bench.h"
+#include "ObjLoader.h"
+#include <sstream>
+#include <unordered_map>
+
+// The startup path ObjLoader replaces: tinyobjloader followed by the usual Vertex dedup.
+inline void TinyObjToModel( const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes, Model &model )
+{
+    model.ModelVertecies.clear();
+    model.ModelVerteciesIndices.clear();
+    std::unordered_map<Vertex, uint32_t> UniqueVertecies;
+    for( const auto &Shape : shapes )
+    {
+        for( const auto &Index : Shape.mesh.indices )
+        {
+            Vertex Point{};
+            Point.coordinate = { attrib.vertices[ 3 * Index.vertex_index + 0 ],
+                                 attrib.vertices[ 3 * Index.vertex_index + 1 ],
+                                 attrib.vertices[ 3 * Index.vertex_index + 2 ] };
+            Point.color      = { 1.f, 1.f, 1.f, 1.f };
+            if( attrib.colors.size() >= 3 * static_cast<size_t>( Index.vertex_index + 1 ) )
+                Point.color = { attrib.colors[ 3 * Index.vertex_index + 0 ],
+                                attrib.colors[ 3 * Index.vertex_index + 1 ],
+                                attrib.colors[ 3 * Index.vertex_index + 2 ], 1.f };
+            if( Index.texcoord_index >= 0 )
+                Point.texture = { attrib.texcoords[ 2 * Index.texcoord_index + 0 ],
+                                  1.f - attrib.texcoords[ 2 * Index.texcoord_index + 1 ] };
+            auto Inserted{ UniqueVertecies.try_emplace( Point, static_cast<uint32_t>( model.ModelVertecies.size() ) ) };
+            if( Inserted.second ) model.ModelVertecies.push_back( Point );
+            model.ModelVerteciesIndices.push_back( Inserted.first->second );
+        }
+    }
+}
+
+inline void TinyObjLoad( std::istream &stream, Model &model )
+{
+    tinyobj::attrib_t Attrib;
+    std::vector<tinyobj::shape_t> Shapes;
+    std::vector<tinyobj::material_t> Materials;
+    std::string Warn, Err;
+    if( !tinyobj::LoadObj( &Attrib, &Shapes, &Materials, &Warn, &Err, &stream ) )
+        throw std::runtime_error( Warn + Err );
+    TinyObjToModel( Attrib, Shapes, model );
+}
+
+// The vertex behind every index, hashed in index order, so two meshes that only number their
+// unique vertecies differently hash the same.
+inline uint64_t CornersHash( const Model &model )
+{
+    uint64_t Hash{ 0 };
+    for( uint32_t Index : model.ModelVerteciesIndices ) Hash = Hash64( &model.ModelVertecies[ Index ], sizeof( Vertex ), Hash );
+    return Hash;
+}
+
+inline uint64_t BuffersHash( const Model &model )
+{
+    return Hash64( model.ModelVerteciesIndices.data(), model.ModelVerteciesIndices.size() * sizeof( uint32_t ),
+                   Hash64( model.ModelVertecies.data(), model.ModelVertecies.size() * sizeof( Vertex ) ) );
+}
+
+inline void ObjLoaderBenchCase( const std::string &name, const std::string &text )
+{
+    const uint32_t Runs{ 5 };
+    Model Reference, Single, Parallel;
+    double TinyMs{ BestOfMs( Runs, [ & ]
+                             { std::istringstream Stream{ text }; TinyObjLoad( Stream, Reference ); } ) };
+    double SingleMs{ BestOfMs( Runs, [ & ]
+                               { ObjLoader{ 1 }.Parse( text.data(), text.size(), Single ); } ) };
+    double ParallelMs{ BestOfMs( Runs, [ & ]
+                                 { ObjLoader{}.Parse( text.data(), text.size(), Parallel ); } ) };
+    double Megabytes{ text.size() / ( 1024.0 * 1024.0 ) };
+    spdlog::info( "{}: {:.2f} MB, {} triangles", name, Megabytes, Parallel.ModelVerteciesIndices.size() / 3 );
+    spdlog::info( "  tinyobjloader      {:8.2f} ms {:8.1f} MB/s", TinyMs, Megabytes / TinyMs * 1000.0 );
+    spdlog::info( "  ObjLoader 1 thread {:8.2f} ms {:8.1f} MB/s x{:.2f}", SingleMs, Megabytes / SingleMs * 1000.0, TinyMs / SingleMs );
+    spdlog::info( "  ObjLoader {:2} thr.  {:8.2f} ms {:8.1f} MB/s x{:.2f}", std::thread::hardware_concurrency(), ParallelMs, Megabytes / ParallelMs * 1000.0, TinyMs / ParallelMs );
+    // Threads must not change the buffers at all; against tinyobjloader the triangles must hold
+    // the same vertecies, however the unique ones are numbered.
+    if( Reference.ModelVertecies.size() != Parallel.ModelVertecies.size() || Reference.ModelVerteciesIndices.size() != Parallel.ModelVerteciesIndices.size() ||
+        CornersHash( Reference ) != CornersHash( Parallel ) )
+        spdlog::warn( "  Mismatch: tinyobjloader {} vertecies/{} indices, ObjLoader {}/{}, corners hash {:016x} against {:016x}.", Reference.ModelVertecies.size(),
+                      Reference.ModelVerteciesIndices.size(), Parallel.ModelVertecies.size(), Parallel.ModelVerteciesIndices.size(), CornersHash( Reference ), CornersHash( Parallel ) );
+    if( BuffersHash( Single ) != BuffersHash( Parallel ) ) spdlog::warn( "  Mismatch: ObjLoader on 1 and {} threads built different buffers.", std::thread::hardware_concurrency() );
+}
+
+inline void ObjLoaderBench()
+{
+    for( const auto &Path : BenchModels() )
+    {
+        MappedFile File{ Path.c_str() };
+        ObjLoaderBenchCase( Path, std::string{ reinterpret_cast<const char *>( File.Data() ), File.Size() } );
+    }
+    ObjLoaderBenchCase( "synthetic 1024x1024 grid", SyntheticObj( 1024 ) );
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Bench.h"
+#include "BenchDevice.h"
+#include "OffscreenTarget.h"
+#include <cmath>
+
+// Headless frame cost: clear, copy out and wait, which bounds any offscreen frame rate, and
+// a check that the read back pixels hold the clear color.
+inline void OffscreenBench()
+{
+    BenchDevice Gpu;
+    if( !Gpu.Valid() )
+    {
+        spdlog::info( "No Vulkan 1.2 device, skipped." );
+        return;
+    }
+    spdlog::info( "{}", Gpu.Properties.deviceName );
+    for( VkExtent2D Extent : { VkExtent2D{ 640, 480 }, VkExtent2D{ 1920, 1080 } } )
+    {
+        OffscreenTarget Target{ Gpu.Device, *Gpu.Memory, Gpu.GraphicQueue, Gpu.GraphicFamily, Extent };
+        const float Clear[ 4 ]{ 0.25f, 0.5f, 0.75f, 1.f };
+        const uint32_t Frames{ 20 };
+        double Ms{ BestOfMs( 3, [ & ]
+                             { for( uint32_t Frame{ 0 }; Frame < Frames; Frame++ ) Target.Render( nullptr, nullptr, Clear ); } ) };
+        std::vector<uint8_t> Pixels;
+        double ReadMs{ BestOfMs( 3, [ & ]
+                                 { Pixels = Target.ReadBack(); } ) };
+        // UNORM conversion may round either way.
+        bool Same{ true };
+        for( size_t Byte{ 0 }; Byte < Pixels.size(); Byte++ )
+            Same = Same && std::abs( Pixels[ Byte ] - Clear[ Byte % 4 ] * 255.f ) <= 1.f;
+        spdlog::info( "  {}x{}: {:8.3f} ms per frame, read back {:.3f} ms{}", Extent.width, Extent.height, Ms / Frames, ReadMs, Same ? "" : " MISMATCH" );
+    }
+}
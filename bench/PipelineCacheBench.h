@@ -0,0 +1,259 @@
+#pragma once
+#include "Bench.h"
+#include "BenchDevice.h"
+#include "PipelineCache.h"
+#include <thread>
+
+// The app's shader pair over every vertex layout and the fixed-function states a material
+// system would vary, so the driver has something to compile.
+class PipelineBenchVariants
+{
+  public:
+    PipelineBenchVariants( VkDevice device ) : Device{ device }
+    {
+        Vertex   = CreateShaderModule( Device, BenchPath( "bin/shaders/shader.vert.spv" ).c_str() );
+        Fragment = CreateShaderModule( Device, BenchPath( "bin/shaders/shader.frag.spv" ).c_str() );
+
+        VkAttachmentDescription ColorAttachment{};
+        ColorAttachment.format         = VK_FORMAT_R8G8B8A8_UNORM;
+        ColorAttachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+        ColorAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        ColorAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        ColorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        ColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        ColorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        ColorAttachment.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkAttachmentReference ColorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkSubpassDescription Subpass{};
+        Subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        Subpass.colorAttachmentCount = 1;
+        Subpass.pColorAttachments    = &ColorReference;
+        VkRenderPassCreateInfo RenderPassCreateInfo{};
+        RenderPassCreateInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        RenderPassCreateInfo.attachmentCount = 1;
+        RenderPassCreateInfo.pAttachments    = &ColorAttachment;
+        RenderPassCreateInfo.subpassCount    = 1;
+        RenderPassCreateInfo.pSubpasses      = &Subpass;
+        vkCreateRenderPass( Device, &RenderPassCreateInfo, nullptr, &RenderPass );
+
+        // shader.vert and shader.frag: the frame uniform in set 0, the texture in set 1.
+        VkDescriptorSetLayoutBinding UniformBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+        VkDescriptorSetLayoutBinding TextureBinding{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+        VkDescriptorSetLayoutCreateInfo DescriptorSetLayoutCreateInfo{};
+        DescriptorSetLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        DescriptorSetLayoutCreateInfo.bindingCount = 1;
+        DescriptorSetLayoutCreateInfo.pBindings    = &UniformBinding;
+        vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayouts[ 0 ] );
+        DescriptorSetLayoutCreateInfo.pBindings = &TextureBinding;
+        vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayouts[ 1 ] );
+        VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo{};
+        PipelineLayoutCreateInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        PipelineLayoutCreateInfo.setLayoutCount = 2;
+        PipelineLayoutCreateInfo.pSetLayouts    = SetLayouts;
+        vkCreatePipelineLayout( Device, &PipelineLayoutCreateInfo, nullptr, &Layout );
+
+        Stages[ 0 ]                      = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_VERTEX_BIT, Vertex, "main", nullptr };
+        Stages[ 1 ]                      = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_FRAGMENT_BIT, Fragment, "main", nullptr };
+        Viewport.sType                   = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        Viewport.viewportCount           = 1;
+        Viewport.scissorCount            = 1;
+        Multisample.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        Multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        Dynamic.sType                    = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        Dynamic.dynamicStateCount        = 2;
+        Dynamic.pDynamicStates           = DynamicStates;
+
+        AddLayout<FullVertexLayout>();
+        AddLayout<HalfVertexLayout>();
+        AddLayout<PackedVertexLayout>();
+        for( uint32_t Variant{ 0 }; Variant < Count(); Variant++ ) Infos.push_back( Info( Variant ) );
+    }
+    PipelineBenchVariants( const PipelineBenchVariants & )            = delete;
+    PipelineBenchVariants &operator=( const PipelineBenchVariants & ) = delete;
+
+    ~PipelineBenchVariants()
+    {
+        vkDestroyPipelineLayout( Device, Layout, nullptr );
+        for( auto SetLayout : SetLayouts ) vkDestroyDescriptorSetLayout( Device, SetLayout, nullptr );
+        vkDestroyRenderPass( Device, RenderPass, nullptr );
+        vkDestroyShaderModule( Device, Fragment, nullptr );
+        vkDestroyShaderModule( Device, Vertex, nullptr );
+    }
+
+    uint32_t Count() const
+    {
+        return static_cast<uint32_t>( Inputs.size() ) * 8;
+    }
+
+    std::span<const VkGraphicsPipelineCreateInfo> Range( uint32_t first, uint32_t count ) const
+    {
+        return { Infos.data() + first, count };
+    }
+
+  private:
+    struct VertexInput
+    {
+        VkVertexInputBindingDescription Bindings[ 2 ];
+        std::vector<VkVertexInputAttributeDescription> Attributes;
+        VkPipelineVertexInputStateCreateInfo State;
+    };
+    struct FixedFunction
+    {
+        VkPipelineInputAssemblyStateCreateInfo InputAssembly{};
+        VkPipelineRasterizationStateCreateInfo Rasterization{};
+        VkPipelineColorBlendAttachmentState Blend{};
+        VkPipelineColorBlendStateCreateInfo ColorBlend{};
+    };
+
+    VkDevice Device;
+    VkShaderModule Vertex{ VK_NULL_HANDLE };
+    VkShaderModule Fragment{ VK_NULL_HANDLE };
+    VkRenderPass RenderPass{ VK_NULL_HANDLE };
+    VkDescriptorSetLayout SetLayouts[ 2 ]{};
+    VkPipelineLayout Layout{ VK_NULL_HANDLE };
+    std::vector<VertexInput> Inputs;
+    std::array<FixedFunction, 24> States;
+    VkPipelineShaderStageCreateInfo Stages[ 2 ]{};
+    VkPipelineViewportStateCreateInfo Viewport{};
+    VkPipelineMultisampleStateCreateInfo Multisample{};
+    VkPipelineDynamicStateCreateInfo Dynamic{};
+    VkDynamicState DynamicStates[ 2 ]{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    std::vector<VkGraphicsPipelineCreateInfo> Infos;
+
+    // The layout at binding 0, the instance matrices after it at binding 1.
+    template <typename Layout>
+    void AddLayout()
+    {
+        auto Attributes{ Layout::AttributeDescriptions() };
+        auto Instance{ InstanceLayout::AttributeDescriptions( 1, Layout::Count ) };
+        VertexInput &Input{ Inputs.emplace_back() };
+        Input.Bindings[ 0 ] = Layout::BindingDescription();
+        Input.Bindings[ 1 ] = InstanceLayout::BindingDescription( 1, VK_VERTEX_INPUT_RATE_INSTANCE );
+        Input.Attributes.assign( Attributes.begin(), Attributes.end() );
+        Input.Attributes.insert( Input.Attributes.end(), Instance.begin(), Instance.end() );
+    }
+
+    // Bit 0 picks the topology, bit 1 culling, bit 2 blending; the rest the vertex layout.
+    VkGraphicsPipelineCreateInfo Info( uint32_t variant )
+    {
+        VertexInput &Input{ Inputs[ variant / 8 ] };
+        Input.State = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO, nullptr, 0, 2, Input.Bindings, static_cast<uint32_t>( Input.Attributes.size() ), Input.Attributes.data() };
+        FixedFunction &State{ States[ variant ] };
+        State.InputAssembly.sType        = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        State.InputAssembly.topology     = variant & 1 ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        State.Rasterization.sType        = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        State.Rasterization.polygonMode  = VK_POLYGON_MODE_FILL;
+        State.Rasterization.cullMode     = variant & 2 ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
+        State.Rasterization.frontFace    = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        State.Rasterization.lineWidth    = 1.f;
+        State.Blend.blendEnable          = variant & 4 ? VK_TRUE : VK_FALSE;
+        State.Blend.srcColorBlendFactor  = VK_BLEND_FACTOR_SRC_ALPHA;
+        State.Blend.dstColorBlendFactor  = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        State.Blend.colorBlendOp         = VK_BLEND_OP_ADD;
+        State.Blend.srcAlphaBlendFactor  = VK_BLEND_FACTOR_ONE;
+        State.Blend.dstAlphaBlendFactor  = VK_BLEND_FACTOR_ZERO;
+        State.Blend.alphaBlendOp         = VK_BLEND_OP_ADD;
+        State.Blend.colorWriteMask       = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        State.ColorBlend.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        State.ColorBlend.attachmentCount = 1;
+        State.ColorBlend.pAttachments    = &State.Blend;
+
+        VkGraphicsPipelineCreateInfo GraphicsPipelineCreateInfo{};
+        GraphicsPipelineCreateInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        GraphicsPipelineCreateInfo.stageCount          = 2;
+        GraphicsPipelineCreateInfo.pStages             = Stages;
+        GraphicsPipelineCreateInfo.pVertexInputState   = &Input.State;
+        GraphicsPipelineCreateInfo.pInputAssemblyState = &State.InputAssembly;
+        GraphicsPipelineCreateInfo.pViewportState      = &Viewport;
+        GraphicsPipelineCreateInfo.pRasterizationState = &State.Rasterization;
+        GraphicsPipelineCreateInfo.pMultisampleState   = &Multisample;
+        GraphicsPipelineCreateInfo.pColorBlendState    = &State.ColorBlend;
+        GraphicsPipelineCreateInfo.pDynamicState       = &Dynamic;
+        GraphicsPipelineCreateInfo.layout              = Layout;
+        GraphicsPipelineCreateInfo.renderPass          = RenderPass;
+        return GraphicsPipelineCreateInfo;
+    }
+};
+
+// Compiles every variant through cache, on threads workers when non-zero, and destroys the result.
+inline PipelineCacheStatistics PipelineCacheBenchRun( VkDevice device, const PipelineBenchVariants &variants, PipelineCache &cache, uint32_t threads )
+{
+    std::vector<VkPipeline> Pipelines( variants.Count() );
+    if( !threads )
+        cache.CreateGraphicsPipelines( variants.Range( 0, variants.Count() ), Pipelines.data() );
+    else
+    {
+        std::vector<std::thread> Workers;
+        uint32_t PerThread{ ( variants.Count() + threads - 1 ) / threads };
+        for( uint32_t First{ 0 }; First < variants.Count(); First += PerThread )
+        {
+            VkPipelineCache Worker{ cache.WorkerCache() };
+            uint32_t Count{ std::min( PerThread, variants.Count() - First ) };
+            Workers.emplace_back( [ &, Worker, First, Count ]
+                                  { cache.CreateGraphicsPipelines( variants.Range( First, Count ), Pipelines.data() + First, Worker ); } );
+        }
+        for( auto &Worker : Workers ) Worker.join();
+    }
+    for( auto Pipeline : Pipelines ) vkDestroyPipeline( device, Pipeline, nullptr );
+    return cache.Stat();
+}
+
+inline void PipelineCacheBench()
+{
+    if( !std::filesystem::exists( BenchPath( "bin/shaders/shader.vert.spv" ) ) )
+    {
+        spdlog::info( "Shaders are not built, skipped." );
+        return;
+    }
+    BenchDevice Gpu;
+    if( !Gpu.Valid() )
+    {
+        spdlog::info( "No Vulkan 1.2 device with timeline semaphores, skipped." );
+        return;
+    }
+    PipelineBenchVariants Variants{ Gpu.Device };
+    std::string Path{ BenchPath( "cache/bench_pipelines.bin" ) };
+    std::filesystem::remove( Path );
+    spdlog::info( "{}, {} graphics pipelines", Gpu.Properties.deviceName, Variants.Count() );
+
+    auto Report{ [ & ]( const char *name, PipelineCache &cache, PipelineCacheStatistics statistics )
+                 {
+                     spdlog::info( "  {:<18} {:8.3f} ms, {:.3f} ms per pipeline, {} cache", name, statistics.Milliseconds, statistics.Milliseconds / statistics.Pipelines, PipelineCacheStateName( cache.State() ) );
+                 } };
+    {
+        PipelineCache Cache{ Gpu.Device, Gpu.Properties, Path.c_str() };
+        Report( "cold", Cache, PipelineCacheBenchRun( Gpu.Device, Variants, Cache, 0 ) );
+        Cache.Save();
+    }
+    {
+        PipelineCache Cache{ Gpu.Device, Gpu.Properties, Path.c_str() };
+        Report( "warm", Cache, PipelineCacheBenchRun( Gpu.Device, Variants, Cache, 0 ) );
+    }
+
+    // Per-thread caches merged on save must warm the next run just the same.
+    std::filesystem::remove( Path );
+    uint32_t Threads{ std::clamp( std::thread::hardware_concurrency(), 1u, 4u ) };
+    {
+        PipelineCache Cache{ Gpu.Device, Gpu.Properties, Path.c_str() };
+        Report( std::format( "cold, {} threads", Threads ).c_str(), Cache, PipelineCacheBenchRun( Gpu.Device, Variants, Cache, Threads ) );
+        Cache.Save();
+    }
+    {
+        PipelineCache Cache{ Gpu.Device, Gpu.Properties, Path.c_str() };
+        Report( "warm after merge", Cache, PipelineCacheBenchRun( Gpu.Device, Variants, Cache, 0 ) );
+    }
+
+    // A blob from another driver and a torn write must both fall back to a cold cache.
+    VkPhysicalDeviceProperties Foreign{ Gpu.Properties };
+    Foreign.pipelineCacheUUID[ 0 ] ^= 0xff;
+    {
+        PipelineCache Cache{ Gpu.Device, Foreign, Path.c_str() };
+        Report( "other driver", Cache, PipelineCacheBenchRun( Gpu.Device, Variants, Cache, 0 ) );
+    }
+    std::filesystem::resize_file( Path, std::filesystem::file_size( Path ) / 2 );
+    {
+        PipelineCache Cache{ Gpu.Device, Gpu.Properties, Path.c_str() };
+        Report( "truncated", Cache, PipelineCacheBenchRun( Gpu.Device, Variants, Cache, 0 ) );
+    }
+    std::filesystem::remove( Path );
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include "Bench.h"
+#include "BenchDevice.h"
+#include "RenderGraph.h"
+#include <bit>
+
+// The frame a deferred renderer grows into, as a RenderGraph: shadows and a depth prepass, a
+// depth pyramid and ambient occlusion from that depth, culling, the main pass, a bloom chain
+// and tonemapping into the imported color, plus a debug overlay nothing reads, which is culled.
+// The passes record no work, so the frame time is what their barriers cost, batched a call per
+// level or a call per barrier as passes recording their own would issue them.
+inline void RenderGraphBench()
+{
+    BenchDevice Gpu;
+    if( !Gpu.Valid() )
+    {
+        spdlog::info( "No Vulkan 1.2 device, skipped." );
+        return;
+    }
+    spdlog::info( "{}", Gpu.Properties.deviceName );
+    const VkExtent2D Extent{ 1920, 1080 }, Half{ 960, 540 }, Quarter{ 480, 270 };
+    // D16 is the only depth format every device samples.
+    VkFormatProperties FormatProperties;
+    vkGetPhysicalDeviceFormatProperties( Gpu.PhysicalDevice, VK_FORMAT_D32_SFLOAT, &FormatProperties );
+    const VkFormatFeatureFlags DepthFeatures{ VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT };
+    VkFormat DepthFormat{ ( FormatProperties.optimalTilingFeatures & DepthFeatures ) == DepthFeatures ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_D16_UNORM };
+
+    VkImageCreateInfo ImageCreateInfo{};
+    ImageCreateInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ImageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+    ImageCreateInfo.format        = VK_FORMAT_R8G8B8A8_UNORM;
+    ImageCreateInfo.extent        = { Extent.width, Extent.height, 1 };
+    ImageCreateInfo.mipLevels     = 1;
+    ImageCreateInfo.arrayLayers   = 1;
+    ImageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    ImageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    ImageCreateInfo.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    DeviceAllocation ColorMemory, DrawsMemory;
+    VkImage ColorImage{ Gpu.Memory->CreateImage( ImageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ColorMemory ) };
+    VkBuffer DrawsBuffer{ Gpu.Memory->CreateBuffer( 64 << 10, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, DrawsMemory ) };
+
+    const VkImageUsageFlags Sampled{ VK_IMAGE_USAGE_SAMPLED_BIT }, Storage{ VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+    const VkImageUsageFlags DepthUsage{ VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | Sampled };
+    // Full chain down to 1x1 with sizes rounded down, as HiZPyramid builds it.
+    const uint32_t PyramidLevels{ static_cast<uint32_t>( std::bit_width( std::max( Extent.width, Extent.height ) ) ) };
+    {
+        RenderGraph Graph{ Gpu.Device, *Gpu.Memory };
+        GraphResource Color{ Graph.Import( "color", ColorImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ) };
+        GraphResource Draws{ Graph.Import( "draws", DrawsBuffer ) };
+        GraphResource Shadow{ Graph.Transient( "shadow", { DepthFormat, { 2048, 2048 }, DepthUsage, VK_IMAGE_ASPECT_DEPTH_BIT } ) };
+        GraphResource Depth{ Graph.Transient( "depth", { DepthFormat, Extent, DepthUsage, VK_IMAGE_ASPECT_DEPTH_BIT } ) };
+        GraphResource Pyramid{ Graph.Transient( "hi-z", { VK_FORMAT_R32_SFLOAT, Extent, Storage, VK_IMAGE_ASPECT_COLOR_BIT, PyramidLevels } ) };
+        GraphResource Occlusion{ Graph.Transient( "ao", { VK_FORMAT_R32_SFLOAT, Extent, Storage } ) };
+        GraphResource Hdr{ Graph.Transient( "hdr", { VK_FORMAT_R16G16B16A16_SFLOAT, Extent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | Sampled } ) };
+        GraphResource BloomHalf{ Graph.Transient( "bloom half", { VK_FORMAT_R16G16B16A16_SFLOAT, Half, Storage } ) };
+        GraphResource BloomQuarter{ Graph.Transient( "bloom quarter", { VK_FORMAT_R16G16B16A16_SFLOAT, Quarter, Storage } ) };
+        GraphResource Overlay{ Graph.Transient( "overlay", { VK_FORMAT_R8G8B8A8_UNORM, Extent, Storage } ) };
+
+        uint32_t Pass{ Graph.AddPass( "shadows", nullptr ) };
+        Graph.Write( Pass, Shadow, GraphAccess::DepthAttachment );
+        Pass = Graph.AddPass( "prepass", nullptr );
+        Graph.Write( Pass, Depth, GraphAccess::DepthAttachment );
+        Pass = Graph.AddPass( "hi-z", nullptr );
+        Graph.Read( Pass, Depth, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, Pyramid, GraphAccess::ComputeStorage );
+        Pass = Graph.AddPass( "ao", nullptr );
+        Graph.Read( Pass, Depth, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, Occlusion, GraphAccess::ComputeStorage );
+        Pass = Graph.AddPass( "cull", nullptr );
+        Graph.Read( Pass, Pyramid, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, Draws, GraphAccess::ComputeBuffer );
+        Pass = Graph.AddPass( "main", nullptr );
+        Graph.Read( Pass, Draws, GraphAccess::IndirectBuffer );
+        Graph.Read( Pass, Shadow, GraphAccess::FragmentSampled );
+        Graph.Read( Pass, Occlusion, GraphAccess::FragmentSampled );
+        Graph.Read( Pass, Depth, GraphAccess::DepthRead );
+        Graph.Write( Pass, Hdr, GraphAccess::ColorAttachment );
+        Pass = Graph.AddPass( "bloom down", nullptr );
+        Graph.Read( Pass, Hdr, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, BloomHalf, GraphAccess::ComputeStorage );
+        Pass = Graph.AddPass( "bloom down again", nullptr );
+        Graph.Read( Pass, BloomHalf, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, BloomQuarter, GraphAccess::ComputeStorage );
+        Pass = Graph.AddPass( "bloom up", nullptr );
+        Graph.Read( Pass, BloomQuarter, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, BloomHalf, GraphAccess::ComputeStorage );
+        Pass = Graph.AddPass( "tonemap", nullptr );
+        Graph.Read( Pass, Hdr, GraphAccess::ComputeSampled );
+        Graph.Read( Pass, BloomHalf, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, Color, GraphAccess::ComputeStorage );
+        Pass = Graph.AddPass( "debug overlay", nullptr );
+        Graph.Read( Pass, Occlusion, GraphAccess::ComputeSampled );
+        Graph.Write( Pass, Overlay, GraphAccess::ComputeStorage );
+
+        double CompileMs{ BestOfMs( 5, [ & ] { Graph.Compile(); } ) };
+        RenderGraphStatistics Statistics{ Graph.Stat() };
+        spdlog::info( "  compile {:.3f} ms: {} passes in {} levels, {} culled; {}", CompileMs, Statistics.Passes, Statistics.Levels, Statistics.Culled, Graph.Order() );
+        spdlog::info( "  barriers per frame: {} calls for {} image barriers and {} buffer hazards, {} unbatched; {} uses needed none", Statistics.BarrierCalls, Statistics.ImageBarriers,
+                      Statistics.BufferHazards, Statistics.UnbatchedCalls, Statistics.Elided );
+        spdlog::info( "  transient memory per frame: {:.1f} MB aliased into {:.1f} MB, {:.1f} MB saved", Statistics.TransientBytes / double( 1 << 20 ), Statistics.AliasedBytes / double( 1 << 20 ),
+                      ( Statistics.TransientBytes - Statistics.AliasedBytes ) / double( 1 << 20 ) );
+
+        VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+        CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        CommandPoolCreateInfo.queueFamilyIndex = Gpu.GraphicFamily;
+        VkCommandPool CommandPool;
+        vkCreateCommandPool( Gpu.Device, &CommandPoolCreateInfo, nullptr, &CommandPool );
+        VkCommandBufferAllocateInfo CommandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr, CommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1 };
+        VkCommandBuffer CommandBuffer;
+        vkAllocateCommandBuffers( Gpu.Device, &CommandBufferAllocateInfo, &CommandBuffer );
+        VkFenceCreateInfo FenceCreateInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        VkFence Fence;
+        vkCreateFence( Gpu.Device, &FenceCreateInfo, nullptr, &Fence );
+
+        // The color starts undefined; the graph expects it as the last frame left it.
+        bool First{ true };
+        double RecordMs{ 0.0 };
+        auto Frame{ [ & ]( bool batched )
+                    {
+                        VkCommandBufferBeginInfo CommandBufferBeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+                        vkBeginCommandBuffer( CommandBuffer, &CommandBufferBeginInfo );
+                        if( First )
+                        {
+                            VkImageMemoryBarrier Barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+                            Barrier.oldLayout                   = VK_IMAGE_LAYOUT_UNDEFINED;
+                            Barrier.newLayout                   = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                            Barrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+                            Barrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+                            Barrier.image                       = ColorImage;
+                            Barrier.subresourceRange            = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+                            vkCmdPipelineBarrier( CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier );
+                            First = false;
+                        }
+                        RecordMs += TimeMs( [ & ] { Graph.Execute( CommandBuffer, batched ); } );
+                        vkEndCommandBuffer( CommandBuffer );
+                        VkSubmitInfo SubmitInfo{};
+                        SubmitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                        SubmitInfo.commandBufferCount = 1;
+                        SubmitInfo.pCommandBuffers    = &CommandBuffer;
+                        vkQueueSubmit( Gpu.GraphicQueue, 1, &SubmitInfo, Fence );
+                        vkWaitForFences( Gpu.Device, 1, &Fence, VK_TRUE, ~uint64_t{ 0 } );
+                        vkResetFences( Gpu.Device, 1, &Fence );
+                    } };
+        const uint32_t Frames{ 200 };
+        for( bool Batched : { false, true } )
+        {
+            for( uint32_t Index{ 0 }; Index < 10; Index++ ) Frame( Batched );
+            RecordMs = 0.0;
+            double Ms{ TimeMs( [ & ]
+                               { for( uint32_t Index{ 0 }; Index < Frames; Index++ ) Frame( Batched ); } ) };
+            spdlog::info( "  {:<9} {:8.4f} ms per frame, {:.4f} ms recording, {} barrier calls", Batched ? "batched" : "unbatched", Ms / Frames, RecordMs / Frames,
+                          Batched ? Statistics.BarrierCalls : Statistics.UnbatchedCalls );
+        }
+
+        vkDestroyFence( Gpu.Device, Fence, nullptr );
+        vkDestroyCommandPool( Gpu.Device, CommandPool, nullptr );
+    }
+    Gpu.Memory->DestroyBuffer( DrawsBuffer, DrawsMemory );
+    Gpu.Memory->DestroyImage( ColorImage, ColorMemory );
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Bench.h"
+#include "TextureCache.h"
+#include <thread>
+
+// Encode throughput over the whole mip chain and PSNR against the uncompressed levels, on one
+// thread and on all of them.
+inline void TextureBenchFormat( const std::vector<TextureLevel> &levels, TextureFormat format )
+{
+    const uint32_t Runs{ 3 };
+    size_t Texels{ 0 };
+    for( const auto &Level : levels ) Texels += size_t( Level.Width ) * Level.Height;
+    std::vector<std::vector<uint8_t>> Compressed( levels.size() );
+    for( uint32_t Threads : { 1u, std::max( 1u, std::thread::hardware_concurrency() ) } )
+    {
+        double Ms{ BestOfMs( Runs, [ & ]
+                             {
+                                 for( size_t Level{ 0 }; Level < levels.size(); Level++ ) Compressed[ Level ] = CompressLevel( levels[ Level ], format, Threads ); } ) };
+        spdlog::info( "  {:<6} {:>2} threads {:8.1f} MPix/s, {:.3f} ms", TextureFormatName( format ), Threads, Texels / Ms / 1000.0, Ms );
+    }
+    // Colour only, so Bc1 and Bc7 compare alike; the mean weights small levels as much as level 0.
+    double Base{ 0.0 }, Mean{ 0.0 };
+    size_t Bytes{ 0 };
+    for( size_t Level{ 0 }; Level < levels.size(); Level++ )
+    {
+        TextureLevel Decoded{ DecompressLevel( Compressed[ Level ], format, levels[ Level ].Width, levels[ Level ].Height ) };
+        double Psnr{ std::min( TexturePsnr( levels[ Level ], Decoded, 3 ), 99.0 ) };
+        if( !Level ) Base = Psnr;
+        Mean += Psnr / levels.size();
+        Bytes += Compressed[ Level ].size();
+    }
+    spdlog::info( "  {:<6} PSNR {:.2f} dB level 0, {:.2f} dB mean, {:.2f} MB", TextureFormatName( format ), Base, Mean, Bytes / double( 1 << 20 ) );
+}
+
+inline void TextureBench()
+{
+    std::string Path{ BenchPath( "textures/img.png" ) };
+    int Width, Height, Channels;
+    stbi_uc *Pixels{ nullptr };
+    double DecodeMs{ BestOfMs( 3, [ & ]
+                               { stbi_image_free( Pixels ); Pixels = stbi_load( Path.c_str(), &Width, &Height, &Channels, STBI_rgb_alpha ); } ) };
+    if( !Pixels )
+    {
+        spdlog::info( "{} not found, skipped.", Path );
+        return;
+    }
+    TextureLevel Base{ static_cast<uint32_t>( Width ), static_cast<uint32_t>( Height ), { Pixels, Pixels + size_t( Width ) * Height * 4 } };
+    stbi_image_free( Pixels );
+    spdlog::info( "{}: {}x{}, PNG decode {:.3f} ms", Path, Width, Height, DecodeMs );
+
+    std::vector<TextureLevel> Levels;
+    double MipsMs{ BestOfMs( 5, [ & ]
+                             { Levels = GenerateMips( Base, true ); } ) };
+    double LinearMs{ BestOfMs( 5, [ & ]
+                               { GenerateMips( Base, false ); } ) };
+    spdlog::info( "  mips   {} levels, {} {:.3f} ms sRGB, {:.3f} ms linear", Levels.size(), MipKernel(), MipsMs, LinearMs );
+
+    TextureBenchFormat( Levels, TextureFormat::Bc1 );
+    TextureBenchFormat( Levels, TextureFormat::Bc7 );
+
+    // Startup cost with and without the KTX2 cache.
+    TextureCache Cache{ BenchPath( "cache/bench" ).c_str(), BenchLoggers };
+    std::error_code Error;
+    std::filesystem::remove( Cache.CacheFile( Path.c_str(), TextureFormat::Bc7, true ), Error );
+    double ColdMs{ TimeMs( [ & ]
+                           { Cache.Load( Path.c_str(), TextureFormat::Bc7 ); } ) };
+    CachedTexture Texture;
+    double WarmMs{ BestOfMs( 5, [ & ]
+                             { Texture = Cache.Load( Path.c_str(), TextureFormat::Bc7 ); } ) };
+    spdlog::info( "  cache  cold (decode + mips + BC7 + write) {:.3f} ms, warm (mapped) {:.3f} ms x{:.1f}{}", ColdMs, WarmMs, ColdMs / WarmMs, Texture.Mapped() ? "" : " NOT MAPPED" );
+}
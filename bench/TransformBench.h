@@ -0,0 +1,69 @@
+#pragma once
+#include "Bench.h"
+#include "JobSystem.h"
+#include "SceneTransforms.h"
+#include <random>
+#include <thread>
+#include <format>
+#include <glm/gtc/matrix_transform.hpp>
+
+// World matrices of many random instances a frame would compose: glm matrix products from an
+// array of structures against the SoA kernels, then the widest kernel spread over workers.
+inline void TransformBench()
+{
+    const uint32_t Count{ 100000 };
+    std::mt19937 Random{ 7 };
+    std::uniform_real_distribution<float> Unit{ -1.f, 1.f };
+    struct Aos
+    {
+        glm::vec3 Translation;
+        glm::quat Rotation;
+        glm::vec3 Scale;
+    };
+    std::vector<Aos> Instances( Count );
+    SceneTransforms Transforms;
+    for( auto &Instance : Instances )
+    {
+        Instance.Translation = glm::vec3{ Unit( Random ), Unit( Random ), Unit( Random ) } * 100.f;
+        Instance.Rotation    = glm::normalize( glm::quat{ Unit( Random ), Unit( Random ), Unit( Random ), Unit( Random ) } );
+        Instance.Scale       = glm::vec3{ 1.5f + Unit( Random ), 1.5f + Unit( Random ), 1.5f + Unit( Random ) };
+        Transforms.Add( Instance.Translation, Instance.Rotation, Instance.Scale );
+    }
+    std::vector<glm::mat4> Matrices( Transforms.PaddedSize() );
+    std::byte *Out{ reinterpret_cast<std::byte *>( Matrices.data() ) };
+
+    double AosMs{ BestOfMs( 5, [ & ]
+                            {
+                                for( uint32_t i{ 0 }; i < Count; i++ )
+                                    Matrices[ i ] = glm::translate( glm::mat4{ 1.f }, Instances[ i ].Translation ) * glm::mat4_cast( Instances[ i ].Rotation ) *
+                                                    glm::scale( glm::mat4{ 1.f }, Instances[ i ].Scale ); } ) };
+    auto Report{ [ & ]( const char *name, double ms )
+                 {
+                     float Error{ 0.f };
+                     for( uint32_t i{ 0 }; i < Count; i += 97 )
+                     {
+                         glm::mat4 Expected{ Transforms.Matrix( i ) };
+                         for( uint32_t Column{ 0 }; Column < 4; Column++ )
+                             for( uint32_t Row{ 0 }; Row < 4; Row++ ) Error = std::max( Error, std::abs( Matrices[ i ][ Column ][ Row ] - Expected[ Column ][ Row ] ) );
+                     }
+                     spdlog::info( "  {:<14} {:8.3f} ms {:10.0f} instances/ms, max error {:.2g}", name, ms, Count / ms, Error );
+                 } };
+    Report( "glm aos", AosMs );
+    Report( "scalar soa", BestOfMs( 5, [ & ]
+                                    { ComposeTransformsScalar( Transforms, 0, Transforms.PaddedSize(), Out, sizeof( glm::mat4 ) ); } ) );
+#if defined( __SSE2__ ) || defined( _M_X64 )
+    Report( "sse soa", BestOfMs( 5, [ & ]
+                                 { ComposeTransformsSse( Transforms, 0, Transforms.PaddedSize(), Out, sizeof( glm::mat4 ) ); } ) );
+#endif
+#if defined( __AVX2__ )
+    Report( "avx2 soa", BestOfMs( 5, [ & ]
+                                  { ComposeTransformsAvx2( Transforms, 0, Transforms.PaddedSize(), Out, sizeof( glm::mat4 ) ); } ) );
+#endif
+    for( uint32_t Threads : { 2u, 4u, std::max( std::thread::hardware_concurrency(), 1u ) } )
+    {
+        // The caller of JobSystem::Wait composes too, so n threads are n - 1 workers.
+        JobSystem Workers{ Threads - 1 };
+        Report( std::format( "{} x{}", ComposeTransformsKernel(), Threads ).c_str(), BestOfMs( 5, [ & ]
+                                                                                             { ComposeTransformsParallel( Workers, Transforms, Out, sizeof( glm::mat4 ) ); } ) );
+    }
+}
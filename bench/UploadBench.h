@@ -0,0 +1,153 @@
+#pragma once
+#include "Bench.h"
+#include "BenchDevice.h"
+#include "UploadQueue.h"
+#include <random>
+
+// The straightforward loader: a staging buffer, a submit and a wait per resource.
+inline void UploadBenchSerial( BenchDevice &gpu, const std::vector<VkBuffer> &buffers, const std::vector<VkDeviceSize> &sizes, const std::vector<char> &data )
+{
+    VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+    CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    CommandPoolCreateInfo.queueFamilyIndex = gpu.TransferFamily;
+    VkCommandPool CommandPool;
+    vkCreateCommandPool( gpu.Device, &CommandPoolCreateInfo, nullptr, &CommandPool );
+    VkCommandBufferAllocateInfo CommandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr, CommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1 };
+    VkCommandBuffer CommandBuffer;
+    vkAllocateCommandBuffers( gpu.Device, &CommandBufferAllocateInfo, &CommandBuffer );
+    VkFenceCreateInfo FenceCreateInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    VkFence Fence;
+    vkCreateFence( gpu.Device, &FenceCreateInfo, nullptr, &Fence );
+
+    double Ms{ TimeMs( [ & ]
+                       {
+                           for( size_t Resource{ 0 }; Resource < buffers.size(); Resource++ )
+                           {
+                               DeviceAllocation StagingMemory;
+                               VkBuffer Staging{ gpu.Memory->CreateBuffer( sizes[ Resource ], VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, StagingMemory ) };
+                               memcpy( StagingMemory.Mapped, data.data(), sizes[ Resource ] );
+                               VkCommandBufferBeginInfo CommandBufferBeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+                               vkBeginCommandBuffer( CommandBuffer, &CommandBufferBeginInfo );
+                               VkBufferCopy Copy{ 0, 0, sizes[ Resource ] };
+                               vkCmdCopyBuffer( CommandBuffer, Staging, buffers[ Resource ], 1, &Copy );
+                               vkEndCommandBuffer( CommandBuffer );
+                               VkSubmitInfo SubmitInfo{};
+                               SubmitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                               SubmitInfo.commandBufferCount = 1;
+                               SubmitInfo.pCommandBuffers    = &CommandBuffer;
+                               vkQueueSubmit( gpu.TransferQueue, 1, &SubmitInfo, Fence );
+                               vkWaitForFences( gpu.Device, 1, &Fence, VK_TRUE, ~uint64_t{ 0 } );
+                               vkResetFences( gpu.Device, 1, &Fence );
+                               gpu.Memory->DestroyBuffer( Staging, StagingMemory );
+                           } } ) };
+    VkDeviceSize Bytes{ 0 };
+    for( auto Size : sizes ) Bytes += Size;
+    spdlog::info( "  {:<10} {:8.1f} MB/s, {} submits, {:.1f} ms", "serial", Bytes / double( 1 << 20 ) / ( Ms / 1000.0 ), buffers.size(), Ms );
+
+    vkDestroyFence( gpu.Device, Fence, nullptr );
+    vkDestroyCommandPool( gpu.Device, CommandPool, nullptr );
+}
+
+// Copies the first and the last 4 KB of every eighth buffer back to host memory on the graphics
+// queue, which takes ownership of them first, and compares them with what was uploaded.
+inline bool UploadBenchReadBack( BenchDevice &gpu, UploadQueue &uploads, const std::vector<VkBuffer> &buffers, const std::vector<VkDeviceSize> &sizes, const std::vector<char> &data )
+{
+    const VkDeviceSize Window{ 4096 };
+    const size_t Step{ 8 };
+    const size_t Samples{ ( buffers.size() + Step - 1 ) / Step };
+    DeviceAllocation ReadBackMemory;
+    VkBuffer ReadBack{ gpu.Memory->CreateBuffer( Samples * Window * 2, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, ReadBackMemory ) };
+    VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+    CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    CommandPoolCreateInfo.queueFamilyIndex = gpu.GraphicFamily;
+    VkCommandPool CommandPool;
+    vkCreateCommandPool( gpu.Device, &CommandPoolCreateInfo, nullptr, &CommandPool );
+    VkCommandBufferAllocateInfo CommandBufferAllocateInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr, CommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1 };
+    VkCommandBuffer CommandBuffer;
+    vkAllocateCommandBuffers( gpu.Device, &CommandBufferAllocateInfo, &CommandBuffer );
+    VkFenceCreateInfo FenceCreateInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    VkFence Fence;
+    vkCreateFence( gpu.Device, &FenceCreateInfo, nullptr, &Fence );
+
+    VkCommandBufferBeginInfo CommandBufferBeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+    vkBeginCommandBuffer( CommandBuffer, &CommandBufferBeginInfo );
+    uint64_t Uploaded{ uploads.Acquire( CommandBuffer ) };
+    for( size_t Sample{ 0 }; Sample < Samples; Sample++ )
+    {
+        size_t Resource{ Sample * Step };
+        VkBufferCopy Copies[ 2 ]{ { 0, Sample * Window * 2, Window }, { sizes[ Resource ] - Window, Sample * Window * 2 + Window, Window } };
+        vkCmdCopyBuffer( CommandBuffer, buffers[ Resource ], ReadBack, 2, Copies );
+    }
+    VkMemoryBarrier Barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+    vkCmdPipelineBarrier( CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &Barrier, 0, nullptr, 0, nullptr );
+    vkEndCommandBuffer( CommandBuffer );
+    VkSemaphore Wait{ uploads.Semaphore() };
+    VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo{};
+    TimelineSubmitInfo.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    TimelineSubmitInfo.waitSemaphoreValueCount = 1;
+    TimelineSubmitInfo.pWaitSemaphoreValues    = &Uploaded;
+    VkPipelineStageFlags WaitStage{ VK_PIPELINE_STAGE_TRANSFER_BIT };
+    VkSubmitInfo SubmitInfo{};
+    SubmitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInfo.pNext              = &TimelineSubmitInfo;
+    SubmitInfo.waitSemaphoreCount = 1;
+    SubmitInfo.pWaitSemaphores    = &Wait;
+    SubmitInfo.pWaitDstStageMask  = &WaitStage;
+    SubmitInfo.commandBufferCount = 1;
+    SubmitInfo.pCommandBuffers    = &CommandBuffer;
+    vkQueueSubmit( gpu.GraphicQueue, 1, &SubmitInfo, Fence );
+    vkWaitForFences( gpu.Device, 1, &Fence, VK_TRUE, ~uint64_t{ 0 } );
+
+    bool Same{ true };
+    const char *Read{ static_cast<const char *>( ReadBackMemory.Mapped ) };
+    for( size_t Sample{ 0 }; Sample < Samples; Sample++ )
+    {
+        VkDeviceSize Size{ sizes[ Sample * Step ] };
+        Same &= !memcmp( Read + Sample * Window * 2, data.data(), Window ) && !memcmp( Read + Sample * Window * 2 + Window, data.data() + Size - Window, Window );
+    }
+
+    vkDestroyFence( gpu.Device, Fence, nullptr );
+    vkDestroyCommandPool( gpu.Device, CommandPool, nullptr );
+    gpu.Memory->DestroyBuffer( ReadBack, ReadBackMemory );
+    return Same;
+}
+
+inline void UploadBench()
+{
+    BenchDevice Gpu;
+    if( !Gpu.Valid() )
+    {
+        spdlog::info( "No Vulkan 1.2 device with timeline semaphores, skipped." );
+        return;
+    }
+    spdlog::info( "{}, {}", Gpu.Properties.deviceName, Gpu.TransferFamily != Gpu.GraphicFamily ? std::format( "dedicated transfer family {}", Gpu.TransferFamily ) : "uploads share the graphics family" );
+
+    // Mesh-sized resources with a few texture-sized ones.
+    std::mt19937 Random{ 11 };
+    std::vector<VkDeviceSize> Sizes( 2048 );
+    VkDeviceSize Bytes{ 0 };
+    for( auto &Size : Sizes ) Bytes += Size = Random() % 16 ? 4096 + Random() % ( 60 << 10 ) : ( 1 << 20 ) + Random() % ( 3 << 20 );
+    std::vector<char> Data( *std::max_element( Sizes.begin(), Sizes.end() ) );
+    for( auto &Byte : Data ) Byte = static_cast<char>( Random() );
+    std::vector<VkBuffer> Buffers( Sizes.size() );
+    std::vector<DeviceAllocation> Allocations( Sizes.size() );
+    for( size_t Resource{ 0 }; Resource < Sizes.size(); Resource++ )
+        Buffers[ Resource ] = Gpu.Memory->CreateBuffer( Sizes[ Resource ], VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, Allocations[ Resource ] );
+    spdlog::info( "{} buffers, {:.1f} MB", Sizes.size(), Bytes / double( 1 << 20 ) );
+
+    UploadBenchSerial( Gpu, Buffers, Sizes, Data );
+    {
+        UploadQueue Uploads{ Gpu.Device, *Gpu.Memory, Gpu.TransferQueue, Gpu.TransferFamily, Gpu.GraphicFamily };
+        double Ms{ TimeMs( [ & ]
+                           {
+                               for( size_t Resource{ 0 }; Resource < Sizes.size(); Resource++ ) Uploads.UploadBuffer( Buffers[ Resource ], 0, Data.data(), Sizes[ Resource ] );
+                               Uploads.Wait( Uploads.Flush() ); } ) };
+        UploadStatistics Statistics{ Uploads.Stat() };
+        bool Same{ UploadBenchReadBack( Gpu, Uploads, Buffers, Sizes, Data ) };
+        spdlog::info( "  {:<10} {:8.1f} MB/s, {} submits, {} copies, {} ring stalls, {:.1f} ms{}", "batched", Bytes / double( 1 << 20 ) / ( Ms / 1000.0 ), Statistics.Submits, Statistics.Copies,
+                      Statistics.Stalls, Ms, Same ? "" : " MISMATCH" );
+    }
+
+    for( size_t Resource{ 0 }; Resource < Sizes.size(); Resource++ ) Gpu.Memory->DestroyBuffer( Buffers[ Resource ], Allocations[ Resource ] );
+}
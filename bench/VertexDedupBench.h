@@ -0,0 +1,93 @@
+#pragma once
+#include "Bench.h"
+#include "ObjLoader.h"
+#include "VertexDedup.h"
+#include <unordered_set>
+#include <unordered_map>
+
+// The std::hash<Vertex> this repo used before VertexHash, kept for comparison.
+struct LegacyVertexHash
+{
+    size_t operator()( Vertex const &vertex ) const
+    {
+        return ( ( std::hash<glm::vec3>()( vertex.coordinate ) ^
+                   ( std::hash<glm::vec3>()( vertex.color ) << 1 ) ) >>
+                 1 ) ^
+               ( std::hash<glm::vec2>()( vertex.texture ) << 1 );
+    }
+};
+
+template <typename Hasher>
+void HashCollisions( const char *name, const std::vector<Vertex> &unique )
+{
+    std::unordered_set<uint64_t> Values;
+    size_t Buckets{ 1 };
+    while( Buckets < unique.size() * 2 ) Buckets <<= 1;
+    std::vector<uint8_t> Occupied( Buckets, 0 );
+    size_t BucketCollisions{ 0 };
+    for( const auto &Point : unique )
+    {
+        uint64_t Value{ static_cast<uint64_t>( Hasher{}( Point ) ) };
+        Values.insert( Value );
+        BucketCollisions += Occupied[ Value & ( Buckets - 1 ) ]++ != 0;
+    }
+    spdlog::info( "  {:<16} full-width collisions {:6.2f}%, bucket collisions (2n, low bits) {:6.2f}%", name,
+                  100.0 * ( unique.size() - Values.size() ) / unique.size(), 100.0 * BucketCollisions / unique.size() );
+}
+
+template <typename Hasher>
+double UnorderedMapDedup( const std::vector<Vertex> &corners, Model &model )
+{
+    return TimeMs( [ & ]
+                   {
+                       std::unordered_map<Vertex, uint32_t, Hasher> UniqueVertecies;
+                       UniqueVertecies.reserve( corners.size() / 2 );
+                       model.ModelVertecies.clear();
+                       model.ModelVerteciesIndices.resize( corners.size() );
+                       for( size_t i{ 0 }; i < corners.size(); i++ )
+                       {
+                           auto Inserted{ UniqueVertecies.try_emplace( corners[ i ], static_cast<uint32_t>( model.ModelVertecies.size() ) ) };
+                           if( Inserted.second ) model.ModelVertecies.push_back( corners[ i ] );
+                           model.ModelVerteciesIndices[ i ] = Inserted.first->second;
+                       } } );
+}
+
+inline void VertexDedupBenchCase( const std::string &name, const Model &source )
+{
+    std::vector<Vertex> Corners( source.ModelVerteciesIndices.size() );
+    for( size_t i{ 0 }; i < Corners.size(); i++ ) Corners[ i ] = source.ModelVertecies[ source.ModelVerteciesIndices[ i ] ];
+    double Count{ static_cast<double>( Corners.size() ) };
+
+    Model Legacy, Std, Single, Parallel;
+    double LegacyMs{ UnorderedMapDedup<LegacyVertexHash>( Corners, Legacy ) };
+    double StdMs{ UnorderedMapDedup<std::hash<Vertex>>( Corners, Std ) };
+    VertexDedup SingleDedup{ 1 }, ParallelDedup{};
+    double SingleMs{ TimeMs( [ & ]
+                             { SingleDedup.Run( Corners, Single ); } ) };
+    double ParallelMs{ TimeMs( [ & ]
+                               { ParallelDedup.Run( Corners, Parallel ); } ) };
+    bool Same{ Single.ModelVertecies.size() == Legacy.ModelVertecies.size() && Single.ModelVerteciesIndices == Legacy.ModelVerteciesIndices &&
+               Parallel.ModelVerteciesIndices == Legacy.ModelVerteciesIndices };
+
+    spdlog::info( "{}: {} corners, {} unique{}", name, Corners.size(), Single.ModelVertecies.size(), Same ? "" : " MISMATCH" );
+    spdlog::info( "  unordered_map legacy hash {:9.2f} ms {:8.2f} Mvert/s", LegacyMs, Count / LegacyMs / 1000.0 );
+    spdlog::info( "  unordered_map VertexHash  {:9.2f} ms {:8.2f} Mvert/s", StdMs, Count / StdMs / 1000.0 );
+    spdlog::info( "  VertexDedup 1 thread      {:9.2f} ms {:8.2f} Mvert/s, {:.3f} probes/lookup", SingleMs, Count / SingleMs / 1000.0, double( SingleDedup.Stat().Probes ) / SingleDedup.Stat().Lookups );
+    spdlog::info( "  VertexDedup {} shards     {:9.2f} ms {:8.2f} Mvert/s, {:.3f} probes/lookup", ParallelDedup.Stat().Shards, ParallelMs, Count / ParallelMs / 1000.0, double( ParallelDedup.Stat().Probes ) / ParallelDedup.Stat().Lookups );
+    HashCollisions<LegacyVertexHash>( "legacy hash", Single.ModelVertecies );
+    HashCollisions<std::hash<Vertex>>( "VertexHash", Single.ModelVertecies );
+}
+
+inline void VertexDedupBench()
+{
+    for( const auto &Path : BenchModels() )
+    {
+        Model Source;
+        ObjLoader{}.Load( Path.c_str(), Source );
+        VertexDedupBenchCase( Path, Source );
+    }
+    std::string Grid{ SyntheticObj( 1024 ) };
+    Model Source;
+    ObjLoader{}.Parse( Grid.data(), Grid.size(), Source );
+    VertexDedupBenchCase( "synthetic 1024x1024 grid", Source );
+}
@@ -0,0 +1,57 @@
+#include "Bench.h"
+#include "ObjLoaderBench.h"
+#include "MeshCacheBench.h"
+#include "VertexDedupBench.h"
+#include "MeshQuantizerBench.h"
+#include "MeshOptimizerBench.h"
+#include "MeshSimplifierBench.h"
+#include "MeshletBench.h"
+#include "MemoryAllocatorBench.h"
+#include "UploadBench.h"
+#include "PipelineCacheBench.h"
+#include "TextureBench.h"
+#include "JobSystemBench.h"
+#include "TransformBench.h"
+#include "OffscreenBench.h"
+#include "RenderGraphBench.h"
+#include "AssetPackBench.h"
+#include <cstring>
+#include <iostream>
+
+int main( int argc, char *argv[] )
+{
+    spdlog::set_level( spdlog::level::info );
+    spdlog::set_pattern( "%v" );
+    std::vector<std::pair<const char *, void ( * )()>> Benchmarks{
+        { "ObjLoader", ObjLoaderBench },
+        { "MeshCache", MeshCacheBench },
+        { "VertexDedup", VertexDedupBench },
+        { "MeshQuantizer", MeshQuantizerBench },
+        { "MeshOptimizer", MeshOptimizerBench },
+        { "MeshSimplifier", MeshSimplifierBench },
+        { "Meshlet", MeshletBench },
+        { "MemoryAllocator", MemoryAllocatorBench },
+        { "Upload", UploadBench },
+        { "PipelineCache", PipelineCacheBench },
+        { "Texture", TextureBench },
+        { "JobSystem", JobSystemBench },
+        { "Transform", TransformBench },
+        { "Offscreen", OffscreenBench },
+        { "RenderGraph", RenderGraphBench },
+        { "AssetPack", AssetPackBench } };
+    try
+    {
+        for( const auto &Benchmark : Benchmarks )
+        {
+            if( argc > 1 && strcmp( argv[ 1 ], Benchmark.first ) ) continue;
+            spdlog::info( "--- {} ---", Benchmark.first );
+            Benchmark.second();
+        }
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
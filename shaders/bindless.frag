@@ -0,0 +1,21 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Every texture of the scene; the draw picks one by index, the same for the whole draw.
+layout( set = 1, binding = 0 ) uniform sampler2D Textures[];
+
+layout( push_constant ) uniform DrawPushConstants
+{
+    uint texture;
+}
+draw;
+
+layout( location = 0 ) in vec4 fragColor;
+layout( location = 1 ) in vec2 TextureCord;
+
+layout( location = 0 ) out vec4 outColor;
+
+void main()
+{
+    outColor = texture( Textures[ draw.texture ], TextureCord );
+}
\ No newline at end of file
@@ -1,17 +1,19 @@
 #version 450
 // #extension GL_EXT_debug_printf : enable
 
-layout( set = 0, binding = 0 ) uniform UniformBufferObject
+// Once per frame.
+layout( set = 0, binding = 0 ) uniform FrameUniformObject
 {
-    mat4 model;
     mat4 view;
     mat4 proj;
 }
-ubo;
+frame;
 
 layout( location = 0 ) in vec4 inPosition;
 layout( location = 1 ) in vec4 inColor;
 layout( location = 2 ) in vec2 inTexture;
+// Per instance, from the instance buffer at binding 1.
+layout( location = 3 ) in mat4 inModel;
 
 layout( location = 0 ) out vec4 fragColor;
 layout( location = 1 ) out vec2 fragTexture;
@@ -19,7 +21,7 @@ layout( location = 1 ) out vec2 fragTexture;
 void main()
 {
     // debugPrintfEXT( "%i", gl_Position );
-    gl_Position = ubo.proj * ubo.view * ubo.model * inPosition;
+    gl_Position = frame.proj * frame.view * inModel * inPosition;
     fragColor   = inColor;
     fragTexture = inTexture;
 }
\ No newline at end of file
@@ -23,6 +23,13 @@ const bool APP_DEBUG = false;
 #include <utility>
 #include <spdlog/spdlog.h>
 #include "vulkan.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "JobSystem.h"
+#include "CommandRecorder.h"
+#include "GpuScene.h"
+#include "CameraPath.h"
+#include "SceneRenderer.h"
 
 const uint16_t DEFAULT_WIDTH{ 800 };
 const uint16_t DEFAULT_HEIGHT{ 600 };
@@ -48,6 +55,8 @@ void CriticalLogsCatch( const T &msg )
 
 namespace
 {
+bool GlfwInitialized{ false }; // false on machines without a display; only headless runs there
+
 struct _initialize
 {
     _initialize()
@@ -68,22 +77,17 @@ struct _initialize
         }
 #endif
 
-        if( glfwInit() )
-        {
+        glfwSetErrorCallback( []( int code, const char *data )
+                              { ERROR_CALLBACK( "GLFW ERROR {}: {}", code, data ); } );
+        GlfwInitialized = glfwInit();
+        if( GlfwInitialized )
             DEBUG_CALLBACK( "GLFW{} inititialized.", glfwGetVersionString() );
-            glfwSetErrorCallback( []( int code, const char *data )
-                                  { ERROR_CALLBACK( "GLFW ERROR {}: {}", code, data ); } );
-        }
         else
-        {
-            CRITICAL_CALLBACK( "GLFW not initialized." );
-            INFO_CALLBACK( "Exit with code {}.", EXIT_FAILURE );
-            exit( EXIT_FAILURE );
-        }
+            WARN_CALLBACK( "GLFW not initialized, only headless mode is available." );
     }
     ~_initialize()
     {
-        glfwTerminate();
+        if( GlfwInitialized ) glfwTerminate();
         DEBUG_CALLBACK( "App closed." );
         DEBUG_CALLBACK( "--- Log finish. ---" );
         spdlog::shutdown();
@@ -91,8 +95,24 @@ struct _initialize
 } _;
 } // namespace
 
+const LoggerCallbacks AppLoggers{ []( const char *data )
+                                 { TRACE_CALLBACK( data ); },
+                                 []( const char *data )
+                                 { DEBUG_CALLBACK( data ); },
+                                 []( const char *data )
+                                 { INFO_CALLBACK( data ); },
+                                 []( const char *data )
+                                 { WARN_CALLBACK( data ); },
+                                 []( const char *data )
+                                 { ERROR_CALLBACK( data ); },
+                                 []( const char *data )
+                                 { CRITICAL_CALLBACK( data ); } };
+
 static void FramebufferResizeCallback( GLFWwindow *, int, int );
 static void WindwoResizeCallback( GLFWwindow *, int, int );
+static void KeyCallback( GLFWwindow *, int, int, int, int );
+static void CursorPosCallback( GLFWwindow *, double, double );
+static void MouseButtonCallback( GLFWwindow *, int, int, int );
 
 class App
 {
@@ -103,41 +123,208 @@ class App
     uint16_t DISPLAY_HEIGHT;
     std::string TITLE;
     std::vector<std::pair<const char *, const char *>> &Models;
-    App( uint16_t width, uint16_t height, const char *title, std::vector<std::pair<const char *, const char *>> &models ) : WIDTH{ width }, HEIGHT{ height }, TITLE{ title }, Models{ models }
+    std::vector<CachedMesh> Meshes;
+    std::vector<const char *> &Textures;
+    std::vector<CachedTexture> TexturesData;
+    std::optional<GpuScene> Scene;
+    // headless renders into an offscreen target of width x height instead of a window; a
+    // window gets framesInFlight frames recorded ahead and a present mode picked by policy.
+    // bindless puts every texture in one descriptor set where the device allows it; culling
+    // picks how the GPU culls instances into indirect draws, falling back where unsupported, and
+    // occlusion also culls them against the frame's own depth, headless only. Assets and shaders
+    // in the AssetPack at pack are read from it, the rest from loose files; a pack linked in by
+    // EMBED_ASSETS under that path is read without opening a file.
+    App( uint16_t width, uint16_t height, const char *title, std::vector<std::pair<const char *, const char *>> &models, std::vector<const char *> &textures, bool headless = false,
+         uint32_t framesInFlight = 2, PresentPolicy policy = PresentPolicy::LowLatency, bool bindless = true, CullingMode culling = CullingMode::IndirectCount, bool occlusion = false,
+         const char *pack = nullptr )
+        : WIDTH{ width }, HEIGHT{ height }, TITLE{ title }, Models{ models }, Textures{ textures }, Bindless{ bindless }, Culling{ culling }, Occlusion{ occlusion }, Pack{ pack },
+          MeshesCache{ "cache/meshes", AppLoggers, Packed() },
+          TexturesCache{ "cache/textures", AppLoggers, Packed() }, Jobs{ JobSystem::DefaultThreads(), &Startup }
     {
-        glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
-        GetScreenResolution( DISPLAY_WIDTH, DISPLAY_HEIGHT );
-        glfwWindowHint( GLFW_RESIZABLE, GLFW_TRUE );
-        if( !( WIDTH | HEIGHT ) )
+        PROFILE_THREAD( "main" );
+        PROFILE_ZONE( "startup" );
+        if( pack && !Pack.Valid() ) WARN_CALLBACK( "No asset pack at {}, loading loose files.", pack );
+        // Assets load on the workers while this thread brings up the window and the device;
+        // each upload is queued as soon as both its asset and the device are ready.
+        std::vector<Job> Loaded{ LoadAssets() };
+        if( headless )
+        {
+            if( !WIDTH ) WIDTH = DEFAULT_WIDTH;
+            if( !HEIGHT ) HEIGHT = DEFAULT_HEIGHT;
+            DISPLAY_WIDTH  = WIDTH;
+            DISPLAY_HEIGHT = HEIGHT;
+            Timeline::Scope Span{ Startup, "instance and device" };
+            static VulkanInstance VkApi{ "HelloVulkan", VK_MAKE_VERSION( 0, 0, 0 ), VkExtent2D{ WIDTH, HEIGHT }, AppLoggers };
+            Vulkan = &VkApi;
+        }
+        else
         {
-            glfwWindowHint( GLFW_RESIZABLE, GLFW_FALSE );
-            glfwWindowHint( GLFW_DECORATED, GLFW_FALSE );
+            if( !GlfwInitialized ) CRITICAL_CALLBACK( "No window without GLFW; run headless instead." );
+            {
+                Timeline::Scope Span{ Startup, "window" };
+                glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
+                GetScreenResolution( DISPLAY_WIDTH, DISPLAY_HEIGHT );
+                glfwWindowHint( GLFW_RESIZABLE, GLFW_TRUE );
+                if( !( WIDTH | HEIGHT ) )
+                {
+                    glfwWindowHint( GLFW_RESIZABLE, GLFW_FALSE );
+                    glfwWindowHint( GLFW_DECORATED, GLFW_FALSE );
+                }
+
+                if( !WIDTH ) WIDTH = DISPLAY_WIDTH;
+                if( !HEIGHT ) HEIGHT = DISPLAY_HEIGHT;
+                window = glfwCreateWindow( WIDTH, HEIGHT, TITLE.data(), nullptr, nullptr );
+                glfwSetWindowUserPointer( window, this );
+                glfwSetFramebufferSizeCallback( window, FramebufferResizeCallback );
+                glfwSetWindowSizeCallback( window, WindwoResizeCallback );
+                glfwSetKeyCallback( window, KeyCallback );
+                glfwSetCursorPosCallback( window, CursorPosCallback );
+                glfwSetMouseButtonCallback( window, MouseButtonCallback );
+            }
+            Timeline::Scope Span{ Startup, "instance and device" };
+            VkExtent2D Framebuffer{ FramebufferExtent() };
+#if defined( _WIN32 )
+            static VulkanInstance VkApi{ "HelloVulkan", VK_MAKE_VERSION( 0, 0, 0 ), glfwGetWin32Window( window ), GetModuleHandle( nullptr ), AppLoggers, Framebuffer, framesInFlight, policy };
+#elif defined( __linux__ )
+            static VulkanInstance VkApi{ "HelloVulkan", VK_MAKE_VERSION( 0, 0, 0 ), glfwGetX11Display(), glfwGetX11Window( window ), AppLoggers, Framebuffer, framesInFlight, policy };
+#endif
+            Vulkan = &VkApi;
         }
 
-        if( !WIDTH ) WIDTH = DISPLAY_WIDTH;
-        if( !HEIGHT ) HEIGHT = DISPLAY_HEIGHT;
-        window = glfwCreateWindow( WIDTH, HEIGHT, TITLE.data(), nullptr, nullptr );
-        glfwSetWindowUserPointer( window, this );
-        glfwSetFramebufferSizeCallback( window, FramebufferResizeCallback );
-        glfwSetWindowSizeCallback( window, WindwoResizeCallback );
-        static VulkanInstance VkApi{ "HelloVulkan", VK_MAKE_VERSION( 0, 0, 0 ), glfwGetWin32Window( window ), GetModuleHandle( nullptr ), { []( const char *data )
-                                                                                                                                            { TRACE_CALLBACK( data ); },
-                                                                                                                                            []( const char *data )
-                                                                                                                                            { DEBUG_CALLBACK( data ); },
-                                                                                                                                            []( const char *data )
-                                                                                                                                            { INFO_CALLBACK( data ); },
-                                                                                                                                            []( const char *data )
-                                                                                                                                            { WARN_CALLBACK( data ); },
-                                                                                                                                            []( const char *data )
-                                                                                                                                            { ERROR_CALLBACK( data ); },
-                                                                                                                                            []( const char *data )
-                                                                                                                                            { CRITICAL_CALLBACK( data ); } } };
-
-        Vulkan = &VkApi;
+        Jobs.Wait( UploadAssets( Loaded ) );
+        PlaceModels();
+        AssetsUploaded = Scene->Flush();
+        UploadStatistics Statistics{ Vulkan->Uploads().Stat() };
+        JobStatistics JobsStatistics{ Jobs.Stat() };
+        DEBUG_CALLBACK( "Assets queued for upload: {:.2f} MB in {} copies, {} submits, {} stalls.", Statistics.Bytes / double( 1 << 20 ), Statistics.Copies, Statistics.Submits, Statistics.Stalls );
+        DEBUG_CALLBACK( "{} jobs on {} workers, {} stolen.", JobsStatistics.Jobs, Jobs.Threads(), JobsStatistics.Steals );
+        Startup.Log( AppLoggers, "Startup" );
     };
     ~App()
     {
-        glfwDestroyWindow( window );
+        Scene.reset();
+        if( window ) glfwDestroyWindow( window );
+    }
+
+    // Headless only: renders the models along a CameraPath of frames frames, logs the time per
+    // frame and writes the last one to capture as PPM when given.
+    void RenderOffscreen( uint32_t frames, const char *capture )
+    {
+        OffscreenTarget &Target{ Vulkan->Offscreen() };
+        CommandRecorder Recorder{ Vulkan->Device(), Vulkan->GraphicFamily(), Jobs };
+        std::optional<SceneRenderer> Renderer;
+        DepthSource Depth{ Target.Depth(), Target.Extent() };
+        if( !Scene->Textures().empty() ) Renderer.emplace( *Vulkan, *Scene, Target.RenderPass(), 1, "bin/shaders/shader.vert.spv", nullptr, Culling, Occlusion ? &Depth : nullptr, Packed() );
+        LogFiles();
+        glm::vec4 Bounds{ Scene->Bounds() };
+        CameraPath Camera{ glm::vec3{ Bounds }, std::max( Bounds.w, 1e-3f ), std::max( frames, 1u ) };
+        glm::mat4 Projection{ Camera.Projection( Target.Extent() ) };
+        const float Clear[ 4 ]{ 0.1f, 0.1f, 0.1f, 1.f };
+        auto Start{ std::chrono::steady_clock::now() };
+        uint32_t Frame{ 0 };
+        // With occlusion, the instances visible last frame are drawn first and the rest tested
+        // against their depth between the passes.
+        std::function<void( VkCommandBuffer )> Occlude, Late;
+        if( Renderer && Renderer->Occlusion() )
+        {
+            Occlude = [ & ]( VkCommandBuffer commandBuffer ) { Renderer->Occlude( commandBuffer ); };
+            Late    = [ & ]( VkCommandBuffer commandBuffer ) { Renderer->Record( Recorder, commandBuffer, Target.Framebuffer(), Target.Extent(), Camera.View( Frame ), Projection ); };
+        }
+        for( ; Frame < frames; Frame++ )
+            Target.Render(
+                [ & ]( VkCommandBuffer commandBuffer )
+                {
+                    Recorder.Begin( 0 );
+                    Vulkan->Uploads().Acquire( commandBuffer );
+                    if( Renderer ) Renderer->Cull( commandBuffer, Camera.View( Frame ), Projection, 0, &Jobs );
+                },
+                [ & ]( VkCommandBuffer commandBuffer )
+                {
+                    if( Renderer ) Renderer->Record( Recorder, commandBuffer, Target.Framebuffer(), Target.Extent(), Camera.View( Frame ), Projection );
+                },
+                Clear, Vulkan->Uploads().Semaphore(), AssetsUploaded, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, Occlude, Late );
+        double Ms{ std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count() };
+        INFO_CALLBACK( "{} offscreen frames at {}x{}: {:.3f} ms per frame.", frames, WIDTH, HEIGHT, frames ? Ms / frames : 0.0 );
+        if( Renderer ) LogDraws( *Renderer );
+        if( capture && frames )
+        {
+            if( Target.WritePpm( capture ) ) INFO_CALLBACK( "Frame written to {}.", capture );
+            else ERROR_CALLBACK( "Failed to write frame to {}.", capture );
+        }
+    }
+
+    // Windowed only: draws the models along a CameraPath until the window is closed, recording
+    // on the workers while earlier frames are still on the GPU. Logs input to present latency.
+    void Run()
+    {
+        FrameLoop &Presenter{ Vulkan->Frames() };
+        CommandRecorder Recorder{ Vulkan->Device(), Vulkan->GraphicFamily(), Jobs, Presenter.FramesInFlight() };
+        std::optional<SceneRenderer> Renderer;
+        if( !Scene->Textures().empty() ) Renderer.emplace( *Vulkan, *Scene, Presenter.RenderPass(), Presenter.FramesInFlight(), "bin/shaders/shader.vert.spv", nullptr, Culling, nullptr, Packed() );
+        LogFiles();
+        glm::vec4 Bounds{ Scene->Bounds() };
+        CameraPath Camera{ glm::vec3{ Bounds }, std::max( Bounds.w, 1e-3f ) };
+        const float Clear[ 4 ]{ 0.1f, 0.1f, 0.1f, 1.f };
+        uint32_t Frame{ 0 };
+        std::chrono::steady_clock::time_point Consumed{};
+        std::vector<double> Latencies;
+        while( !glfwWindowShouldClose( window ) )
+        {
+            glfwPollEvents();
+            // Only a frame built from new input has an input to present latency.
+            std::chrono::steady_clock::time_point Input{ LastInput > Consumed ? LastInput : std::chrono::steady_clock::time_point{} };
+            bool Drawn{ Presenter.Render(
+                [ & ]( VkCommandBuffer commandBuffer )
+                {
+                    Recorder.Begin( Presenter.Frame() );
+                    Vulkan->Uploads().Acquire( commandBuffer );
+                    if( Renderer ) Renderer->Cull( commandBuffer, Camera.View( Frame ), Camera.Projection( Presenter.Extent() ), Presenter.Frame(), &Jobs );
+                },
+                [ & ]( VkCommandBuffer commandBuffer )
+                {
+                    if( Renderer ) Renderer->Record( Recorder, commandBuffer, Presenter.Framebuffer(), Presenter.Extent(), Camera.View( Frame ), Camera.Projection( Presenter.Extent() ), Presenter.Frame() );
+                },
+                Clear, Vulkan->Uploads().Semaphore(), AssetsUploaded, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, Input ) };
+            if( !Drawn )
+            {
+                // Minimized: sleep until the window changes instead of spinning.
+                glfwWaitEventsTimeout( 0.1 );
+                continue;
+            }
+            Frame++;
+            if( Input != std::chrono::steady_clock::time_point{} )
+            {
+                Consumed = Input;
+                Latencies.push_back( Presenter.LastFrame().InputToPresentMs );
+            }
+        }
+        // The renderer and the recorder's command buffers go away with this scope.
+        Presenter.Wait();
+        FrameLoopStatistics Statistics{ Presenter.Stat() };
+        INFO_CALLBACK( "{} frames presented, {} skipped, {} swapchains created, {} retired.", Statistics.Frames, Statistics.Skipped, Statistics.Recreations, Statistics.Retired );
+        if( Renderer )
+        {
+            INFO_CALLBACK( "{} descriptor set updates, {:.2f} per frame.", Renderer->DescriptorUpdates(), Statistics.Frames ? double( Renderer->DescriptorUpdates() ) / Statistics.Frames : 0.0 );
+            LogDraws( *Renderer );
+        }
+        if( !Latencies.empty() )
+        {
+            std::sort( Latencies.begin(), Latencies.end() );
+            INFO_CALLBACK( "Input to present over {} frames: p50 {:.2f} ms, p99 {:.2f} ms.", Latencies.size(), Latencies[ Latencies.size() / 2 ], Latencies[ Latencies.size() * 99 / 100 ] );
+        }
+    }
+
+    // GLFW gives no event timestamps; the time its callback runs, inside glfwPollEvents, is
+    // the closest there is.
+    void Input()
+    {
+        LastInput = std::chrono::steady_clock::now();
+    }
+
+    // The window's framebuffer changed; the swapchain follows on the next frame.
+    void FramebufferResized()
+    {
+        if( Vulkan && !Vulkan->Headless() ) Vulkan->Frames().Resize( FramebufferExtent() );
     }
 
     void CentralizeWindow()
@@ -153,12 +340,139 @@ class App
             HEIGHT = height;
             glfwSetWindowSize( window, WIDTH, HEIGHT );
         }
-        // ReCreateSwapChain();
+        FramebufferResized();
     }
 
   private:
-    GLFWwindow *window;
-    VulkanInstance *Vulkan;
+    const AssetPack *Packed() const
+    {
+        return Pack.Valid() ? &Pack : nullptr;
+    }
+
+    // Files opened from startup until the first frame, assets and shaders included.
+    void LogFiles()
+    {
+        FileStatistics Files{ MappedFile::Stat() };
+        INFO_CALLBACK( "{} files opened before the first frame, {:.2f} MB mapped, {:.3f} ms opening and mapping them.", Files.Opens, Files.Bytes / double( 1 << 20 ), Files.Milliseconds );
+        if( Pack.Valid() )
+        {
+            AssetPackStatistics Statistics{ Pack.Stat() };
+            INFO_CALLBACK( "{} pack: {} of {} lookups found, {} entries, {:.2f} MB stored for {:.2f} MB, {} LZ4 compressed.", Pack.Embedded() ? "Embedded asset" : "Asset", Statistics.Hits,
+                           Statistics.Hits + Statistics.Misses, Statistics.Entries, Statistics.StoredBytes / double( 1 << 20 ), Statistics.RawBytes / double( 1 << 20 ), Statistics.Compressed );
+        }
+    }
+
+    // The last frame's binds, and how many instances its draws covered.
+    void LogDraws( const SceneRenderer &renderer )
+    {
+        RenderStatistics Draws{ renderer.Stat() };
+        INFO_CALLBACK( "{}: {} instanced draws of {} instances, {} descriptor binds, {} buffer binds per frame, transforms in {:.3f} ms.",
+                       renderer.Bindless() ? "Bindless textures" : "A descriptor set per texture", Draws.Draws, Draws.Instances, Draws.DescriptorBinds, Draws.BufferBinds, Draws.TransformMs );
+        if( const BindlessTable *Table{ Scene->Bindless() } )
+        {
+            BindlessStatistics Statistics{ Table->Stat() };
+            DEBUG_CALLBACK( "Bindless table: {} of {} textures, {} of {} buffers, {} updates.", Statistics.Textures, Table->Textures(), Statistics.Buffers, Table->Buffers(), Statistics.Updates );
+        }
+        if( const IndirectCuller *Culler{ renderer.Culler() } )
+        {
+            INFO_CALLBACK( "GPU culling ({}): {} of {} instances visible, {} culling passes rebuilt.", CullingModeName( Culler->Mode() ), Culler->Visible( 0 ), Draws.Instances, Culler->Stat().Rebuilds );
+            if( Culler->Occlusion() )
+            {
+                OcclusionCounters Counted{ Culler->Counters( 0 ) };
+                INFO_CALLBACK( "Occlusion culling: {} of {} instances in the frustum occluded, {} drawn early, {} late.", Counted.Occluded, Counted.Tested, Counted.DrawnEarly, Counted.DrawnLate );
+            }
+        }
+        else INFO_CALLBACK( "GPU culling off." );
+    }
+
+    GLFWwindow *window{ nullptr };
+    VulkanInstance *Vulkan{ nullptr };
+    std::chrono::steady_clock::time_point LastInput{};
+    bool Bindless;
+    CullingMode Culling;
+    bool Occlusion; // two phase occlusion culling, offscreen only
+    uint64_t AssetsUploaded{ 0 }; // Vulkan->Uploads() timeline value
+    Timeline Startup;
+    AssetPack Pack; // before the caches, which look assets up in it
+    MeshCache MeshesCache;
+    TextureCache TexturesCache;
+    std::vector<DecodedTexture> TexturesDecoded;
+    JobSystem Jobs;         // last, so its workers stop before anything they write to goes away
+
+    // One job per model and texture, needing no device. A texture cached in any format is
+    // mapped here; otherwise it is decoded and its mips built, leaving only compression for later.
+    std::vector<Job> LoadAssets()
+    {
+        std::vector<Job> Loaded;
+        Meshes.resize( Models.size() );
+        for( size_t Index{ 0 }; Index < Models.size(); Index++ )
+            Loaded.push_back( Jobs.Submit( std::format( "load {}", Models[ Index ].first ), [ this, Index ]
+                                           {
+                                               Meshes[ Index ] = MeshesCache.Load( Models[ Index ].first );
+                                               DEBUG_CALLBACK( "Model {} loaded: {} vertecies, {} indices, {} LODs.", Models[ Index ].second, Meshes[ Index ].Vertecies().size(), Meshes[ Index ].Indices().size(), Meshes[ Index ].Lods().size() ); } ) );
+        TexturesData.resize( Textures.size() );
+        TexturesDecoded.resize( Textures.size() );
+        for( size_t Index{ 0 }; Index < Textures.size(); Index++ )
+            Loaded.push_back( Jobs.Submit( std::format( "load {}", Textures[ Index ] ), [ this, Index ]
+                                           {
+                                               const char *Path{ Textures[ Index ] };
+                                               if( !TexturesCache.Find( Path, TextureFormat::Bc7, true, TexturesData[ Index ] ) && !TexturesCache.Find( Path, TextureFormat::Rgba8, true, TexturesData[ Index ] ) )
+                                                   TexturesDecoded[ Index ] = TexturesCache.Decode( Path ); } ) );
+        return Loaded;
+    }
+
+    // Called once the device exists; loaded holds the jobs from LoadAssets, in the same order.
+    std::vector<Job> UploadAssets( const std::vector<Job> &loaded )
+    {
+        std::vector<Job> Uploaded;
+        Scene.emplace( *Vulkan, Meshes.size(), Textures.size(), Bindless );
+        for( size_t Index{ 0 }; Index < Meshes.size(); Index++ )
+            Uploaded.push_back( Jobs.Submit( std::format( "upload {}", Models[ Index ].first ), [ this, Index ]
+                                             { Scene->UploadMesh( Index, Meshes[ Index ] ); }, { loaded[ Index ] } ) );
+        // Encoded once into the KTX2 cache; later runs map it and skip PNG decoding entirely.
+        TextureFormat Format{ Vulkan->TextureCompression() ? TextureFormat::Bc7 : TextureFormat::Rgba8 };
+        for( size_t Index{ 0 }; Index < Textures.size(); Index++ )
+        {
+            Job Encoded{ Jobs.Submit( std::format( "encode {}", Textures[ Index ] ), [ this, Index, Format ]
+                                      {
+                                          const char *Path{ Textures[ Index ] };
+                                          if( ( TexturesData[ Index ].Regions().empty() || TexturesData[ Index ].Format() != TextureVkFormat( Format, true ) ) && !TexturesCache.Find( Path, Format, true, TexturesData[ Index ] ) )
+                                          {
+                                              if( TexturesDecoded[ Index ].Levels.empty() ) TexturesDecoded[ Index ] = TexturesCache.Decode( Path );
+                                              // This worker plus its share of the idle ones; more would
+                                              // oversubscribe the workers busy with other assets.
+                                              uint32_t Threads{ 1 + Jobs.Idle() / static_cast<uint32_t>( Textures.size() ) };
+                                              TexturesData[ Index ] = TexturesCache.Encode( Path, TexturesDecoded[ Index ], Format, Threads );
+                                          }
+                                          TexturesDecoded[ Index ] = {};
+                                          DEBUG_CALLBACK( "Texture {} loaded: {}x{}, {} levels, {}.", Path, TexturesData[ Index ].Width(), TexturesData[ Index ].Height(), TexturesData[ Index ].Regions().size(), TextureFormatName( Format ) ); },
+                                      { loaded[ Meshes.size() + Index ] } ) };
+            Uploaded.push_back( Jobs.Submit( std::format( "upload {}", Textures[ Index ] ), [ this, Index ]
+                                             { Scene->UploadTexture( Index, TexturesData[ Index ] ); }, { Encoded } ) );
+        }
+        return Uploaded;
+    }
+
+    // One instance per model, side by side along x; model i uses texture i, or the last one.
+    void PlaceModels()
+    {
+        auto SceneMeshes{ Scene->Meshes() };
+        float X{ 0.f };
+        for( size_t Index{ 0 }; Index < SceneMeshes.size(); Index++ )
+        {
+            const SceneMesh &Mesh{ SceneMeshes[ Index ] };
+            uint32_t Texture{ static_cast<uint32_t>( std::min( Index, std::max<size_t>( Textures.size(), 1 ) - 1 ) ) };
+            Scene->AddInstance( static_cast<uint32_t>( Index ), Texture, glm::vec3{ X + Mesh.Radius, 0.f, 0.f } - Mesh.Center );
+            X += Mesh.Radius * 2.2f;
+        }
+        Scene->Group();
+    }
+    VkExtent2D FramebufferExtent()
+    {
+        int Width{ 0 }, Height{ 0 };
+        glfwGetFramebufferSize( window, &Width, &Height );
+        return { static_cast<uint32_t>( Width ), static_cast<uint32_t>( Height ) };
+    }
     void GetScreenResolution( uint16_t &width, uint16_t &height )
     {
         auto Monitor = glfwGetPrimaryMonitor();
@@ -172,7 +486,7 @@ class App
 static void FramebufferResizeCallback( GLFWwindow *AppPointer, int width, int height )
 {
     auto app = reinterpret_cast<App *>( glfwGetWindowUserPointer( AppPointer ) );
-    app->SetWindowSize( app->WIDTH, app->HEIGHT );
+    app->FramebufferResized();
 }
 static void WindwoResizeCallback( GLFWwindow *AppPointer, int width, int height )
 {
@@ -181,3 +495,15 @@ static void WindwoResizeCallback( GLFWwindow *AppPointer, int width, int height
     app->HEIGHT = height;
     app->SetWindowSize( width, height );
 }
+static void KeyCallback( GLFWwindow *AppPointer, int, int, int, int )
+{
+    reinterpret_cast<App *>( glfwGetWindowUserPointer( AppPointer ) )->Input();
+}
+static void CursorPosCallback( GLFWwindow *AppPointer, double, double )
+{
+    reinterpret_cast<App *>( glfwGetWindowUserPointer( AppPointer ) )->Input();
+}
+static void MouseButtonCallback( GLFWwindow *AppPointer, int, int, int )
+{
+    reinterpret_cast<App *>( glfwGetWindowUserPointer( AppPointer ) )->Input();
+}
@@ -0,0 +1,326 @@
+#pragma once
+#include "Hash.h"
+#include "Lz4.h"
+#include "MappedFile.h"
+#include "EmbeddedFiles.h"
+#include <span>
+#include <atomic>
+#include <format>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <string_view>
+
+// On-disk layout: AssetPackHeader, the AssetPackEntry index sorted by path hash, the paths,
+// then every entry's bytes at an AssetPackAlignment-aligned offset. Paths are relative to the
+// project root with / separators, as the app names its assets. An entry is stored raw or LZ4
+// compressed; raw entries are used in place from the mapping, compressed ones decode into
+// cached memory, as matches read back what was written.
+struct AssetPackHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t EntriesCount;
+    uint64_t PathsOffset;
+    uint64_t PathsSize;
+};
+
+enum class AssetCompression : uint32_t
+{
+    None,
+    Lz4
+};
+
+struct AssetPackEntry
+{
+    uint64_t PathHash;
+    uint64_t Offset;
+    uint64_t Size;    // as stored
+    uint64_t RawSize; // once decompressed
+    uint64_t Hash;    // of the raw bytes
+    uint32_t PathOffset;
+    uint32_t PathLength;
+    AssetCompression Compression;
+    uint32_t Reserved;
+};
+
+const uint32_t AssetPackMagic{ 0x4B415041 }; // "APAK"
+const uint32_t AssetPackVersion{ 1 };
+const uint64_t AssetPackAlignment{ 64 };
+
+struct AssetPackStatistics
+{
+    uint32_t Entries{ 0 };
+    uint32_t Compressed{ 0 };
+    uint64_t RawBytes{ 0 };
+    uint64_t StoredBytes{ 0 };
+    uint32_t Hits{ 0 };   // lookups that found their entry
+    uint32_t Misses{ 0 }; // and those that fell back to loose files
+};
+
+// The key an asset is packed under: / separators and no leading "./".
+inline std::string AssetPackPath( std::string_view path )
+{
+    std::string Path{ path };
+    std::replace( Path.begin(), Path.end(), '\\', '/' );
+    while( Path.starts_with( "./" ) ) Path.erase( 0, 2 );
+    return Path;
+}
+
+// One mapped pack, or one linked into the executable by embedfiles; lookups are a binary
+// search of the index and never touch the file system, so any thread may make them.
+class AssetPack
+{
+  public:
+    AssetPack() = default;
+    // Stays closed when path is null, missing or not a pack of this version. A path among
+    // EmbeddedFiles() opens the linked copy without touching the file system.
+    explicit AssetPack( const char *path )
+    {
+        Open( path );
+    }
+    AssetPack( const AssetPack & )            = delete;
+    AssetPack &operator=( const AssetPack & ) = delete;
+
+    bool Open( const char *path )
+    {
+        Close();
+        if( !path ) return false;
+        if( const EmbeddedFile *Embedded{ FindEmbeddedFile( AssetPackPath( path ) ) } ) return Open( { Embedded->Data, Embedded->Size } );
+        std::error_code Error;
+        if( !std::filesystem::exists( path, Error ) ) return false;
+        try
+        {
+            File.Open( path );
+        }
+        catch( const std::exception & )
+        {
+            return false;
+        }
+        Bytes = { File.Data(), File.Size() };
+        if( !Check() )
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    // A pack already in memory, which has to outlive this; data should be aligned to
+    // AssetPackAlignment for the entries to be.
+    bool Open( std::span<const uint8_t> data )
+    {
+        Close();
+        Bytes = data;
+        if( !Check() )
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        File.Close();
+        Bytes = {};
+        Index = {};
+    }
+
+    bool Valid() const
+    {
+        return !Bytes.empty();
+    }
+
+    // Whether the pack is linked in rather than mapped.
+    bool Embedded() const
+    {
+        return Valid() && File.Empty();
+    }
+
+    // Null when the pack holds no such path.
+    const AssetPackEntry *Find( std::string_view path ) const
+    {
+        std::string Key{ AssetPackPath( path ) };
+        uint64_t PathHash{ Hash64( Key.data(), Key.size() ) };
+        auto Entry{ std::lower_bound( Index.begin(), Index.end(), PathHash, []( const AssetPackEntry &entry, uint64_t hash )
+                                      { return entry.PathHash < hash; } ) };
+        for( ; Entry != Index.end() && Entry->PathHash == PathHash; Entry++ )
+            if( Path( *Entry ) == Key )
+            {
+                Hits++;
+                return &*Entry;
+            }
+        Misses++;
+        return nullptr;
+    }
+
+    std::string_view Path( const AssetPackEntry &entry ) const
+    {
+        return { reinterpret_cast<const char *>( Bytes.data() ) + Paths + entry.PathOffset, entry.PathLength };
+    }
+
+    // The bytes as stored, which are the asset itself unless it is compressed.
+    std::span<const uint8_t> View( const AssetPackEntry &entry ) const
+    {
+        return { Bytes.data() + entry.Offset, entry.Size };
+    }
+
+    // Copies or decompresses the entry's RawSize bytes into destination.
+    bool Read( const AssetPackEntry &entry, void *destination ) const
+    {
+        if( entry.Compression == AssetCompression::Lz4 ) return Lz4Decompress( Bytes.data() + entry.Offset, entry.Size, static_cast<uint8_t *>( destination ), entry.RawSize );
+        memcpy( destination, Bytes.data() + entry.Offset, entry.Size );
+        return true;
+    }
+
+    std::span<const AssetPackEntry> Entries() const
+    {
+        return Index;
+    }
+
+    AssetPackStatistics Stat() const
+    {
+        AssetPackStatistics Statistics{};
+        for( const AssetPackEntry &Entry : Index )
+        {
+            Statistics.Entries++;
+            Statistics.Compressed += Entry.Compression != AssetCompression::None;
+            Statistics.RawBytes += Entry.RawSize;
+            Statistics.StoredBytes += Entry.Size;
+        }
+        Statistics.Hits   = Hits;
+        Statistics.Misses = Misses;
+        return Statistics;
+    }
+
+  private:
+    MappedFile File;
+    std::span<const uint8_t> Bytes; // File's, or memory given to Open()
+    std::span<const AssetPackEntry> Index;
+    uint64_t Paths{ 0 };
+    mutable std::atomic<uint32_t> Hits{ 0 };
+    mutable std::atomic<uint32_t> Misses{ 0 };
+
+    bool Check()
+    {
+        if( Bytes.size() < sizeof( AssetPackHeader ) ) return false;
+        AssetPackHeader Header;
+        memcpy( &Header, Bytes.data(), sizeof( Header ) );
+        // Bounds are compared by subtraction, so corrupt sizes cannot wrap past them.
+        const uint64_t IndexEnd{ sizeof( Header ) + Header.EntriesCount * sizeof( AssetPackEntry ) };
+        if( Header.Magic != AssetPackMagic || Header.Version != AssetPackVersion || Header.EntriesCount > Bytes.size() / sizeof( AssetPackEntry ) ||
+            IndexEnd > Bytes.size() || Header.PathsOffset < IndexEnd || Header.PathsOffset > Bytes.size() || Header.PathsSize > Bytes.size() - Header.PathsOffset )
+            return false;
+        Index = { reinterpret_cast<const AssetPackEntry *>( Bytes.data() + sizeof( Header ) ), Header.EntriesCount };
+        Paths = Header.PathsOffset;
+        for( const AssetPackEntry &Entry : Index )
+            if( Entry.Offset % AssetPackAlignment || Entry.Offset > Bytes.size() || Entry.Size > Bytes.size() - Entry.Offset || uint64_t( Entry.PathOffset ) + Entry.PathLength > Header.PathsSize ||
+                ( Entry.Compression == AssetCompression::None && Entry.Size != Entry.RawSize ) || Entry.Compression > AssetCompression::Lz4 )
+                return false;
+        return true;
+    }
+};
+
+// Collects entries and writes them as one pack, for the assetpack tool.
+class AssetPackWriter
+{
+  public:
+    // compress tries LZ4 and keeps it when it saves at least an eighth; entries used in place
+    // from the mapping, like the ones copied to staging memory, should stay raw.
+    void Add( std::string_view path, std::span<const uint8_t> data, bool compress )
+    {
+        Pending Entry{ AssetPackPath( path ), {}, data.size(), Hash64( data.data(), data.size() ), AssetCompression::None };
+        if( compress )
+        {
+            Entry.Data = Lz4Compress( data.data(), data.size() );
+            if( Entry.Data.size() <= data.size() - data.size() / 8 && !data.empty() ) Entry.Compression = AssetCompression::Lz4;
+        }
+        if( Entry.Compression == AssetCompression::None ) Entry.Data.assign( data.begin(), data.end() );
+        auto Same{ std::find_if( Entries.begin(), Entries.end(), [ & ]( const Pending &pending )
+                                 { return pending.Path == Entry.Path; } ) };
+        if( Same != Entries.end() ) *Same = std::move( Entry );
+        else Entries.push_back( std::move( Entry ) );
+    }
+
+    // Written to a temporary file first so a crash never leaves a truncated pack behind.
+    void Write( const std::filesystem::path &path ) const
+    {
+        std::vector<const Pending *> Sorted;
+        for( const Pending &Entry : Entries ) Sorted.push_back( &Entry );
+        std::sort( Sorted.begin(), Sorted.end(), []( const Pending *a, const Pending *b )
+                   { return Hash64( a->Path.data(), a->Path.size() ) < Hash64( b->Path.data(), b->Path.size() ); } );
+
+        AssetPackHeader Header{ AssetPackMagic, AssetPackVersion, Sorted.size(), sizeof( AssetPackHeader ) + Sorted.size() * sizeof( AssetPackEntry ), 0 };
+        std::vector<AssetPackEntry> Index;
+        std::string Paths;
+        for( const Pending *Entry : Sorted )
+        {
+            uint64_t PathHash{ Hash64( Entry->Path.data(), Entry->Path.size() ) };
+            if( !Index.empty() && Index.back().PathHash == PathHash )
+                throw std::runtime_error( std::format( "Asset paths {} and {} have the same hash.", Entry->Path, Paths.substr( Index.back().PathOffset ) ) );
+            Index.push_back( { PathHash, 0, Entry->Data.size(), Entry->RawSize, Entry->Hash, static_cast<uint32_t>( Paths.size() ), static_cast<uint32_t>( Entry->Path.size() ), Entry->Compression, 0 } );
+            Paths += Entry->Path;
+        }
+        Header.PathsSize = Paths.size();
+        uint64_t Offset{ Header.PathsOffset + Header.PathsSize };
+        for( AssetPackEntry &Entry : Index )
+        {
+            Entry.Offset = AlignUp( Offset );
+            Offset       = Entry.Offset + Entry.Size;
+        }
+
+        std::filesystem::path Temporary{ path };
+        Temporary += ".tmp";
+        {
+            std::ofstream Out{ Temporary, std::ios::binary | std::ios::trunc };
+            if( !Out ) throw std::runtime_error( std::format( "Failed to write asset pack {}.", Temporary.string() ) );
+            const char Padding[ AssetPackAlignment ]{};
+            Out.write( reinterpret_cast<const char *>( &Header ), sizeof( Header ) );
+            Out.write( reinterpret_cast<const char *>( Index.data() ), Index.size() * sizeof( AssetPackEntry ) );
+            Out.write( Paths.data(), Paths.size() );
+            uint64_t Written{ Header.PathsOffset + Header.PathsSize };
+            for( size_t Entry{ 0 }; Entry < Index.size(); Entry++ )
+            {
+                Out.write( Padding, Index[ Entry ].Offset - Written );
+                Out.write( reinterpret_cast<const char *>( Sorted[ Entry ]->Data.data() ), Sorted[ Entry ]->Data.size() );
+                Written = Index[ Entry ].Offset + Index[ Entry ].Size;
+            }
+            if( !Out ) throw std::runtime_error( std::format( "Failed to write asset pack {}.", Temporary.string() ) );
+        }
+        std::filesystem::rename( Temporary, path );
+    }
+
+    AssetPackStatistics Stat() const
+    {
+        AssetPackStatistics Statistics{};
+        for( const Pending &Entry : Entries )
+        {
+            Statistics.Entries++;
+            Statistics.Compressed += Entry.Compression != AssetCompression::None;
+            Statistics.RawBytes += Entry.RawSize;
+            Statistics.StoredBytes += Entry.Data.size();
+        }
+        return Statistics;
+    }
+
+  private:
+    struct Pending
+    {
+        std::string Path;
+        std::vector<uint8_t> Data;
+        uint64_t RawSize;
+        uint64_t Hash;
+        AssetCompression Compression;
+    };
+
+    std::vector<Pending> Entries;
+
+    static uint64_t AlignUp( uint64_t value )
+    {
+        return ( value + AssetPackAlignment - 1 ) & ~( AssetPackAlignment - 1 );
+    }
+};
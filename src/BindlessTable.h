@@ -0,0 +1,196 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_enum_string_helper.h>
+#include <mutex>
+#include <format>
+#include <algorithm>
+#include <stdexcept>
+
+// The descriptor indexing features a BindlessTable needs; shaders index it with dynamically
+// uniform values only, so non-uniform indexing is not asked for.
+inline bool BindlessSupported( const VkPhysicalDeviceFeatures &features, const VkPhysicalDeviceVulkan12Features &features12 )
+{
+    return features.shaderSampledImageArrayDynamicIndexing && features.shaderStorageBufferArrayDynamicIndexing && features12.runtimeDescriptorArray &&
+           features12.descriptorBindingPartiallyBound && features12.descriptorBindingSampledImageUpdateAfterBind && features12.descriptorBindingStorageBufferUpdateAfterBind &&
+           features12.descriptorBindingUpdateUnusedWhilePending;
+}
+
+struct BindlessStatistics
+{
+    uint32_t Textures{ 0 };
+    uint32_t Buffers{ 0 };
+    uint32_t Updates{ 0 }; // vkUpdateDescriptorSets calls, one per resource added
+};
+
+// One descriptor set holding every texture of a scene at binding 0 and storage buffers for
+// vertex pulling at binding 1, each slot addressed by the index the resource was added at.
+// The set is bound once per command buffer and draws pick their texture through a push
+// constant, so materials never switch sets. Slots are partially bound and updated after bind
+// while unused, so assets are added as they finish loading, while earlier frames are in flight.
+class BindlessTable
+{
+  public:
+    // Capacities are clamped to the update after bind limits, which bound a set created from an
+    // update after bind layout instead of the ones in VkPhysicalDeviceLimits.
+    BindlessTable( VkDevice device, const VkPhysicalDeviceLimits &limits, const VkPhysicalDeviceVulkan12Properties &properties12, bool anisotropy, uint32_t textures, uint32_t buffers )
+        : Device{ device }
+    {
+        TextureCapacity = std::max( std::min( { textures, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages } ), 1u );
+        BufferCapacity  = std::max( std::min( { buffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers } ), 1u );
+
+        VkSamplerCreateInfo SamplerCreateInfo{};
+        SamplerCreateInfo.sType            = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        SamplerCreateInfo.magFilter        = VK_FILTER_LINEAR;
+        SamplerCreateInfo.minFilter        = VK_FILTER_LINEAR;
+        SamplerCreateInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        SamplerCreateInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        SamplerCreateInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        SamplerCreateInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        SamplerCreateInfo.anisotropyEnable = anisotropy;
+        SamplerCreateInfo.maxAnisotropy    = std::min( 8.f, limits.maxSamplerAnisotropy );
+        SamplerCreateInfo.maxLod           = VK_LOD_CLAMP_NONE;
+        VkResult Result{ vkCreateSampler( Device, &SamplerCreateInfo, nullptr, &Sampler ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create bindless sampler, error: {}", string_VkResult( Result ) ) );
+
+        VkDescriptorSetLayoutBinding Bindings[ 2 ]{};
+        Bindings[ 0 ].binding         = 0;
+        Bindings[ 0 ].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        Bindings[ 0 ].descriptorCount = TextureCapacity;
+        Bindings[ 0 ].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+        Bindings[ 1 ].binding         = 1;
+        Bindings[ 1 ].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        Bindings[ 1 ].descriptorCount = BufferCapacity;
+        Bindings[ 1 ].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+        VkDescriptorBindingFlags Flags{ VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT };
+        VkDescriptorBindingFlags BindingFlags[ 2 ]{ Flags, Flags };
+        VkDescriptorSetLayoutBindingFlagsCreateInfo BindingFlagsCreateInfo{};
+        BindingFlagsCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        BindingFlagsCreateInfo.bindingCount  = 2;
+        BindingFlagsCreateInfo.pBindingFlags = BindingFlags;
+        VkDescriptorSetLayoutCreateInfo DescriptorSetLayoutCreateInfo{};
+        DescriptorSetLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        DescriptorSetLayoutCreateInfo.pNext        = &BindingFlagsCreateInfo;
+        DescriptorSetLayoutCreateInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        DescriptorSetLayoutCreateInfo.bindingCount = 2;
+        DescriptorSetLayoutCreateInfo.pBindings    = Bindings;
+        Result                                     = vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayout );
+        if( Result != VK_SUCCESS )
+        {
+            Destroy();
+            throw std::runtime_error( std::format( "Failed to create bindless descriptor set layout, error: {}", string_VkResult( Result ) ) );
+        }
+
+        VkDescriptorPoolSize PoolSizes[ 2 ]{ { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, TextureCapacity }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BufferCapacity } };
+        VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo{};
+        DescriptorPoolCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        DescriptorPoolCreateInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        DescriptorPoolCreateInfo.maxSets       = 1;
+        DescriptorPoolCreateInfo.poolSizeCount = 2;
+        DescriptorPoolCreateInfo.pPoolSizes    = PoolSizes;
+        Result                                 = vkCreateDescriptorPool( Device, &DescriptorPoolCreateInfo, nullptr, &DescriptorPool );
+        if( Result != VK_SUCCESS )
+        {
+            Destroy();
+            throw std::runtime_error( std::format( "Failed to create bindless descriptor pool, error: {}", string_VkResult( Result ) ) );
+        }
+        VkDescriptorSetAllocateInfo DescriptorSetAllocateInfo{};
+        DescriptorSetAllocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        DescriptorSetAllocateInfo.descriptorPool     = DescriptorPool;
+        DescriptorSetAllocateInfo.descriptorSetCount = 1;
+        DescriptorSetAllocateInfo.pSetLayouts        = &SetLayout;
+        Result                                       = vkAllocateDescriptorSets( Device, &DescriptorSetAllocateInfo, &Set );
+        if( Result != VK_SUCCESS )
+        {
+            Destroy();
+            throw std::runtime_error( std::format( "Failed to allocate bindless descriptor set, error: {}", string_VkResult( Result ) ) );
+        }
+    }
+    BindlessTable( const BindlessTable & )            = delete;
+    BindlessTable &operator=( const BindlessTable & ) = delete;
+
+    ~BindlessTable()
+    {
+        Destroy();
+    }
+
+    VkDescriptorSetLayout Layout() const
+    {
+        return SetLayout;
+    }
+    VkDescriptorSet Handle() const
+    {
+        return Set;
+    }
+    uint32_t Textures() const
+    {
+        return TextureCapacity;
+    }
+    uint32_t Buffers() const
+    {
+        return BufferCapacity;
+    }
+
+    BindlessStatistics Stat() const
+    {
+        std::lock_guard Lock{ Mutex };
+        return Statistics;
+    }
+
+    // Slot index must not be read by a submission still pending; any thread.
+    void SetTexture( uint32_t index, VkImageView view )
+    {
+        if( index >= TextureCapacity ) throw std::runtime_error( std::format( "Bindless texture {} out of {} slots.", index, TextureCapacity ) );
+        VkDescriptorImageInfo ImageInfo{ Sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        VkWriteDescriptorSet Write{};
+        Write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Write.dstSet          = Set;
+        Write.dstBinding      = 0;
+        Write.dstArrayElement = index;
+        Write.descriptorCount = 1;
+        Write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        Write.pImageInfo      = &ImageInfo;
+        std::lock_guard Lock{ Mutex };
+        vkUpdateDescriptorSets( Device, 1, &Write, 0, nullptr );
+        Statistics.Textures++;
+        Statistics.Updates++;
+    }
+
+    void SetBuffer( uint32_t index, VkBuffer buffer, VkDeviceSize size = VK_WHOLE_SIZE )
+    {
+        if( index >= BufferCapacity ) throw std::runtime_error( std::format( "Bindless buffer {} out of {} slots.", index, BufferCapacity ) );
+        VkDescriptorBufferInfo BufferInfo{ buffer, 0, size };
+        VkWriteDescriptorSet Write{};
+        Write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Write.dstSet          = Set;
+        Write.dstBinding      = 1;
+        Write.dstArrayElement = index;
+        Write.descriptorCount = 1;
+        Write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        Write.pBufferInfo     = &BufferInfo;
+        std::lock_guard Lock{ Mutex };
+        vkUpdateDescriptorSets( Device, 1, &Write, 0, nullptr );
+        Statistics.Buffers++;
+        Statistics.Updates++;
+    }
+
+  private:
+    VkDevice Device;
+    uint32_t TextureCapacity{ 0 };
+    uint32_t BufferCapacity{ 0 };
+    VkSampler Sampler{ VK_NULL_HANDLE };
+    VkDescriptorSetLayout SetLayout{ VK_NULL_HANDLE };
+    VkDescriptorPool DescriptorPool{ VK_NULL_HANDLE };
+    VkDescriptorSet Set{ VK_NULL_HANDLE };
+    mutable std::mutex Mutex; // vkUpdateDescriptorSets on one set is externally synchronized
+    BindlessStatistics Statistics;
+
+    void Destroy()
+    {
+        if( DescriptorPool ) vkDestroyDescriptorPool( Device, DescriptorPool, nullptr );
+        if( SetLayout ) vkDestroyDescriptorSetLayout( Device, SetLayout, nullptr );
+        if( Sampler ) vkDestroySampler( Device, Sampler, nullptr );
+        DescriptorPool = VK_NULL_HANDLE;
+        SetLayout      = VK_NULL_HANDLE;
+        Sampler        = VK_NULL_HANDLE;
+    }
+};
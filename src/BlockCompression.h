@@ -0,0 +1,511 @@
+#pragma once
+#include "vulkan.h"
+#include "TextureMips.h"
+#include <span>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+// Rgba8 is the fallback for devices without textureCompressionBC. Bc1 drops alpha and is
+// meant for opaque colour; Bc7 keeps alpha at twice the size.
+enum class TextureFormat : uint32_t
+{
+    Rgba8,
+    Bc1,
+    Bc7
+};
+
+inline const char *TextureFormatName( TextureFormat format )
+{
+    switch( format )
+    {
+        case TextureFormat::Bc1:
+            return "BC1";
+        case TextureFormat::Bc7:
+            return "BC7";
+        default:
+            return "RGBA8";
+    }
+}
+
+inline VkFormat TextureVkFormat( TextureFormat format, bool srgb )
+{
+    switch( format )
+    {
+        case TextureFormat::Bc1:
+            return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case TextureFormat::Bc7:
+            return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        default:
+            return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+// Texels per block side and bytes per block.
+inline uint32_t TextureBlockSide( TextureFormat format )
+{
+    return format == TextureFormat::Rgba8 ? 1 : 4;
+}
+
+inline uint32_t TextureBlockBytes( TextureFormat format )
+{
+    return format == TextureFormat::Bc1 ? 8 : format == TextureFormat::Bc7 ? 16 : 4;
+}
+
+inline size_t TextureLevelBytes( TextureFormat format, uint32_t width, uint32_t height )
+{
+    const uint32_t Side{ TextureBlockSide( format ) };
+    return size_t( ( width + Side - 1 ) / Side ) * ( ( height + Side - 1 ) / Side ) * TextureBlockBytes( format );
+}
+
+// 4x4 texels starting at block ( x, y ); blocks over the edge repeat the last row and column.
+inline void LoadBlock( const TextureLevel &level, uint32_t x, uint32_t y, uint8_t ( &block )[ 16 ][ 4 ] )
+{
+    for( uint32_t Row{ 0 }; Row < 4; Row++ )
+        for( uint32_t Column{ 0 }; Column < 4; Column++ )
+        {
+            uint32_t Sx{ std::min( x * 4 + Column, level.Width - 1 ) }, Sy{ std::min( y * 4 + Row, level.Height - 1 ) };
+            memcpy( block[ Row * 4 + Column ], &level.Pixels[ ( size_t( Sy ) * level.Width + Sx ) * 4 ], 4 );
+        }
+}
+
+// Principal axis of the block colours by power iteration, over the first Channels channels.
+template <uint32_t Channels>
+inline void BlockPrincipalAxis( const uint8_t ( &block )[ 16 ][ 4 ], float ( &mean )[ 4 ], float ( &axis )[ 4 ] )
+{
+    float Covariance[ Channels ][ Channels ]{};
+    for( uint32_t Channel{ 0 }; Channel < 4; Channel++ ) mean[ Channel ] = 0.f;
+    for( const auto &Texel : block )
+        for( uint32_t Channel{ 0 }; Channel < Channels; Channel++ ) mean[ Channel ] += Texel[ Channel ] / 16.f;
+    for( const auto &Texel : block )
+        for( uint32_t i{ 0 }; i < Channels; i++ )
+            for( uint32_t j{ 0 }; j < Channels; j++ ) Covariance[ i ][ j ] += ( Texel[ i ] - mean[ i ] ) * ( Texel[ j ] - mean[ j ] );
+    for( uint32_t Channel{ 0 }; Channel < 4; Channel++ ) axis[ Channel ] = Channel < Channels ? 1.f : 0.f;
+    for( uint32_t Iteration{ 0 }; Iteration < 8; Iteration++ )
+    {
+        float Next[ Channels ]{}, Length{ 0.f };
+        for( uint32_t i{ 0 }; i < Channels; i++ )
+            for( uint32_t j{ 0 }; j < Channels; j++ ) Next[ i ] += Covariance[ i ][ j ] * axis[ j ];
+        for( uint32_t i{ 0 }; i < Channels; i++ ) Length = std::max( Length, std::abs( Next[ i ] ) );
+        if( Length < 1e-6f ) break;
+        for( uint32_t i{ 0 }; i < Channels; i++ ) axis[ i ] = Next[ i ] / Length;
+    }
+}
+
+// Least squares endpoints for fixed per-texel weights ( 0 = first endpoint, 1 = second ).
+// Returns false when every texel uses the same weight and the system is singular.
+template <uint32_t Channels>
+inline bool BlockFitEndpoints( const uint8_t ( &block )[ 16 ][ 4 ], const float ( &weights )[ 16 ], float ( &first )[ 4 ], float ( &second )[ 4 ] )
+{
+    float AA{ 0.f }, AB{ 0.f }, BB{ 0.f }, AX[ Channels ]{}, BX[ Channels ]{};
+    for( uint32_t Texel{ 0 }; Texel < 16; Texel++ )
+    {
+        float B{ weights[ Texel ] }, A{ 1.f - B };
+        AA += A * A;
+        AB += A * B;
+        BB += B * B;
+        for( uint32_t Channel{ 0 }; Channel < Channels; Channel++ )
+        {
+            AX[ Channel ] += A * block[ Texel ][ Channel ];
+            BX[ Channel ] += B * block[ Texel ][ Channel ];
+        }
+    }
+    float Determinant{ AA * BB - AB * AB };
+    if( std::abs( Determinant ) < 1e-6f ) return false;
+    for( uint32_t Channel{ 0 }; Channel < Channels; Channel++ )
+    {
+        first[ Channel ]  = std::clamp( ( AX[ Channel ] * BB - BX[ Channel ] * AB ) / Determinant, 0.f, 255.f );
+        second[ Channel ] = std::clamp( ( BX[ Channel ] * AA - AX[ Channel ] * AB ) / Determinant, 0.f, 255.f );
+    }
+    return true;
+}
+
+// BC1
+
+inline uint16_t PackRgb565( const float ( &color )[ 4 ] )
+{
+    uint32_t R{ static_cast<uint32_t>( color[ 0 ] * 31.f / 255.f + 0.5f ) }, G{ static_cast<uint32_t>( color[ 1 ] * 63.f / 255.f + 0.5f ) }, B{ static_cast<uint32_t>( color[ 2 ] * 31.f / 255.f + 0.5f ) };
+    return static_cast<uint16_t>( R << 11 | G << 5 | B );
+}
+
+inline void UnpackRgb565( uint16_t color, int32_t ( &out )[ 3 ] )
+{
+    out[ 0 ] = ( color >> 11 & 31 ) * 255 / 31;
+    out[ 1 ] = ( color >> 5 & 63 ) * 255 / 63;
+    out[ 2 ] = ( color & 31 ) * 255 / 31;
+}
+
+// Palette of a four colour block, in index order.
+inline void Bc1Palette( uint16_t color0, uint16_t color1, int32_t ( &palette )[ 4 ][ 3 ] )
+{
+    UnpackRgb565( color0, palette[ 0 ] );
+    UnpackRgb565( color1, palette[ 1 ] );
+    for( uint32_t Channel{ 0 }; Channel < 3; Channel++ )
+    {
+        palette[ 2 ][ Channel ] = ( 2 * palette[ 0 ][ Channel ] + palette[ 1 ][ Channel ] ) / 3;
+        palette[ 3 ][ Channel ] = ( palette[ 0 ][ Channel ] + 2 * palette[ 1 ][ Channel ] ) / 3;
+    }
+}
+
+// Nearest palette entry for every texel; returns the squared error.
+inline uint32_t Bc1Indices( const uint8_t ( &block )[ 16 ][ 4 ], uint16_t color0, uint16_t color1, uint32_t &indices )
+{
+    int32_t Palette[ 4 ][ 3 ];
+    Bc1Palette( color0, color1, Palette );
+    uint32_t Error{ 0 };
+    indices = 0;
+    for( uint32_t Texel{ 0 }; Texel < 16; Texel++ )
+    {
+        uint32_t Best{ 0 }, BestError{ ~0u };
+        for( uint32_t Index{ 0 }; Index < 4; Index++ )
+        {
+            uint32_t Distance{ 0 };
+            for( uint32_t Channel{ 0 }; Channel < 3; Channel++ )
+            {
+                int32_t Delta{ block[ Texel ][ Channel ] - Palette[ Index ][ Channel ] };
+                Distance += Delta * Delta;
+            }
+            if( Distance < BestError )
+            {
+                BestError = Distance;
+                Best      = Index;
+            }
+        }
+        Error += BestError;
+        indices |= Best << ( Texel * 2 );
+    }
+    return Error;
+}
+
+// Endpoints from the principal axis, inset by 1/16 of the range, then refined twice by least
+// squares over the chosen indices. Always emits the four colour mode.
+inline void EncodeBc1( const uint8_t ( &block )[ 16 ][ 4 ], uint8_t *out )
+{
+    float Mean[ 4 ], Axis[ 4 ];
+    BlockPrincipalAxis<3>( block, Mean, Axis );
+    float Low{ 0.f }, High{ 0.f };
+    for( const auto &Texel : block )
+    {
+        float Projection{ ( Texel[ 0 ] - Mean[ 0 ] ) * Axis[ 0 ] + ( Texel[ 1 ] - Mean[ 1 ] ) * Axis[ 1 ] + ( Texel[ 2 ] - Mean[ 2 ] ) * Axis[ 2 ] };
+        Low  = std::min( Low, Projection );
+        High = std::max( High, Projection );
+    }
+    float Inset{ ( High - Low ) / 16.f };
+    float First[ 4 ], Second[ 4 ];
+    for( uint32_t Channel{ 0 }; Channel < 3; Channel++ )
+    {
+        First[ Channel ]  = std::clamp( Mean[ Channel ] + Axis[ Channel ] * ( High - Inset ), 0.f, 255.f );
+        Second[ Channel ] = std::clamp( Mean[ Channel ] + Axis[ Channel ] * ( Low + Inset ), 0.f, 255.f );
+    }
+
+    uint16_t Color0{ PackRgb565( First ) }, Color1{ PackRgb565( Second ) };
+    uint32_t Indices;
+    uint32_t Error{ Bc1Indices( block, Color0, Color1, Indices ) };
+    for( uint32_t Iteration{ 0 }; Iteration < 2 && Error; Iteration++ )
+    {
+        static constexpr float Weights[ 4 ]{ 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+        float TexelWeights[ 16 ];
+        for( uint32_t Texel{ 0 }; Texel < 16; Texel++ ) TexelWeights[ Texel ] = Weights[ Indices >> ( Texel * 2 ) & 3 ];
+        if( !BlockFitEndpoints<3>( block, TexelWeights, First, Second ) ) break;
+        uint16_t Candidate0{ PackRgb565( First ) }, Candidate1{ PackRgb565( Second ) };
+        uint32_t CandidateIndices;
+        uint32_t CandidateError{ Bc1Indices( block, Candidate0, Candidate1, CandidateIndices ) };
+        if( CandidateError >= Error ) break;
+        Color0  = Candidate0;
+        Color1  = Candidate1;
+        Indices = CandidateIndices;
+        Error   = CandidateError;
+    }
+
+    // color0 > color1 selects four colours; swapping the endpoints swaps indices 0-1 and 2-3.
+    if( Color0 < Color1 )
+    {
+        std::swap( Color0, Color1 );
+        Indices ^= 0x55555555;
+    }
+    else if( Color0 == Color1 )
+        Indices = 0;
+    memcpy( out, &Color0, 2 );
+    memcpy( out + 2, &Color1, 2 );
+    memcpy( out + 4, &Indices, 4 );
+}
+
+inline void DecodeBc1( const uint8_t *data, uint8_t ( &block )[ 16 ][ 4 ] )
+{
+    uint16_t Color0, Color1;
+    uint32_t Indices;
+    memcpy( &Color0, data, 2 );
+    memcpy( &Color1, data + 2, 2 );
+    memcpy( &Indices, data + 4, 4 );
+    int32_t Palette[ 4 ][ 3 ];
+    Bc1Palette( Color0, Color1, Palette );
+    if( Color0 <= Color1 )
+        for( uint32_t Channel{ 0 }; Channel < 3; Channel++ )
+        {
+            Palette[ 2 ][ Channel ] = ( Palette[ 0 ][ Channel ] + Palette[ 1 ][ Channel ] ) / 2;
+            Palette[ 3 ][ Channel ] = 0;
+        }
+    for( uint32_t Texel{ 0 }; Texel < 16; Texel++ )
+    {
+        uint32_t Index{ Indices >> ( Texel * 2 ) & 3 };
+        for( uint32_t Channel{ 0 }; Channel < 3; Channel++ ) block[ Texel ][ Channel ] = static_cast<uint8_t>( Palette[ Index ][ Channel ] );
+        block[ Texel ][ 3 ] = Color0 <= Color1 && Index == 3 ? 0 : 255;
+    }
+}
+
+// BC7
+
+const uint8_t Bc7Weights4[ 16 ]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Little-endian bit stream over one 16 byte block.
+class Bc7Bits
+{
+  public:
+    Bc7Bits( uint8_t *data ) : Data{ data } {}
+
+    void Write( uint32_t value, uint32_t bits )
+    {
+        for( uint32_t Bit{ 0 }; Bit < bits; Bit++, Position++ )
+            if( value >> Bit & 1 ) Data[ Position / 8 ] |= static_cast<uint8_t>( 1 << ( Position % 8 ) );
+    }
+
+    uint32_t Read( uint32_t bits )
+    {
+        uint32_t Value{ 0 };
+        for( uint32_t Bit{ 0 }; Bit < bits; Bit++, Position++ ) Value |= uint32_t( Data[ Position / 8 ] >> ( Position % 8 ) & 1 ) << Bit;
+        return Value;
+    }
+
+  private:
+    uint8_t *Data;
+    uint32_t Position{ 0 };
+};
+
+// Mode 6 endpoint: 7 bits per channel plus a p-bit shared by the channels. The p-bit that
+// lands closer to the unquantized colour wins.
+inline void QuantizeBc7Endpoint( const float ( &color )[ 4 ], uint8_t ( &codes )[ 4 ], uint8_t &pbit, uint8_t ( &value )[ 4 ] )
+{
+    float BestError{ std::numeric_limits<float>::max() };
+    for( uint8_t P{ 0 }; P < 2; P++ )
+    {
+        float Error{ 0.f };
+        uint8_t Codes[ 4 ], Values[ 4 ];
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+        {
+            Codes[ Channel ]  = static_cast<uint8_t>( std::clamp( ( color[ Channel ] - P ) / 2.f + 0.5f, 0.f, 127.f ) );
+            Values[ Channel ] = static_cast<uint8_t>( Codes[ Channel ] << 1 | P );
+            Error += ( Values[ Channel ] - color[ Channel ] ) * ( Values[ Channel ] - color[ Channel ] );
+        }
+        if( Error < BestError )
+        {
+            BestError = Error;
+            pbit      = P;
+            memcpy( codes, Codes, 4 );
+            memcpy( value, Values, 4 );
+        }
+    }
+}
+
+// Nearest interpolated colour for every texel; returns the squared error. The projection onto
+// the endpoint segment gives the index to within one step, so only its neighbours are tried.
+inline uint32_t Bc7Indices( const uint8_t ( &block )[ 16 ][ 4 ], const uint8_t ( &first )[ 4 ], const uint8_t ( &second )[ 4 ], uint8_t ( &indices )[ 16 ] )
+{
+    int32_t Palette[ 16 ][ 4 ];
+    for( uint32_t Index{ 0 }; Index < 16; Index++ )
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ ) Palette[ Index ][ Channel ] = ( ( 64 - Bc7Weights4[ Index ] ) * first[ Channel ] + Bc7Weights4[ Index ] * second[ Channel ] + 32 ) >> 6;
+    float Direction[ 4 ], LengthSquared{ 0.f };
+    for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+    {
+        Direction[ Channel ] = float( second[ Channel ] ) - first[ Channel ];
+        LengthSquared += Direction[ Channel ] * Direction[ Channel ];
+    }
+    const float Scale{ LengthSquared > 0.f ? 15.f / LengthSquared : 0.f };
+    uint32_t Error{ 0 };
+    for( uint32_t Texel{ 0 }; Texel < 16; Texel++ )
+    {
+        float Projection{ 0.f };
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ ) Projection += ( block[ Texel ][ Channel ] - float( first[ Channel ] ) ) * Direction[ Channel ];
+        int32_t Guess{ std::clamp( static_cast<int32_t>( Projection * Scale + 0.5f ), 0, 15 ) };
+        uint32_t BestError{ ~0u };
+        for( int32_t Index{ std::max( Guess - 1, 0 ) }; Index <= std::min( Guess + 1, 15 ); Index++ )
+        {
+            uint32_t Distance{ 0 };
+            for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+            {
+                int32_t Delta{ block[ Texel ][ Channel ] - Palette[ Index ][ Channel ] };
+                Distance += Delta * Delta;
+            }
+            if( Distance < BestError )
+            {
+                BestError        = Distance;
+                indices[ Texel ] = static_cast<uint8_t>( Index );
+            }
+        }
+        Error += BestError;
+    }
+    return Error;
+}
+
+// Mode 6 only: one subset, RGBA endpoints at 7+1 bits and 4 bit indices. It is the mode that
+// suits smooth natural images best and keeps the encoder a single fit per block.
+inline void EncodeBc7( const uint8_t ( &block )[ 16 ][ 4 ], uint8_t *out )
+{
+    float Mean[ 4 ], Axis[ 4 ];
+    BlockPrincipalAxis<4>( block, Mean, Axis );
+    float Low{ 0.f }, High{ 0.f };
+    for( const auto &Texel : block )
+    {
+        float Projection{ 0.f };
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ ) Projection += ( Texel[ Channel ] - Mean[ Channel ] ) * Axis[ Channel ];
+        Low  = std::min( Low, Projection );
+        High = std::max( High, Projection );
+    }
+    float First[ 4 ], Second[ 4 ];
+    for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+    {
+        First[ Channel ]  = std::clamp( Mean[ Channel ] + Axis[ Channel ] * Low, 0.f, 255.f );
+        Second[ Channel ] = std::clamp( Mean[ Channel ] + Axis[ Channel ] * High, 0.f, 255.f );
+    }
+
+    uint8_t Codes[ 2 ][ 4 ], PBits[ 2 ], Values[ 2 ][ 4 ], Indices[ 16 ];
+    QuantizeBc7Endpoint( First, Codes[ 0 ], PBits[ 0 ], Values[ 0 ] );
+    QuantizeBc7Endpoint( Second, Codes[ 1 ], PBits[ 1 ], Values[ 1 ] );
+    uint32_t Error{ Bc7Indices( block, Values[ 0 ], Values[ 1 ], Indices ) };
+    for( uint32_t Iteration{ 0 }; Iteration < 2 && Error; Iteration++ )
+    {
+        float Weights[ 16 ];
+        for( uint32_t Texel{ 0 }; Texel < 16; Texel++ ) Weights[ Texel ] = Bc7Weights4[ Indices[ Texel ] ] / 64.f;
+        if( !BlockFitEndpoints<4>( block, Weights, First, Second ) ) break;
+        uint8_t CandidateCodes[ 2 ][ 4 ], CandidatePBits[ 2 ], CandidateValues[ 2 ][ 4 ], CandidateIndices[ 16 ];
+        QuantizeBc7Endpoint( First, CandidateCodes[ 0 ], CandidatePBits[ 0 ], CandidateValues[ 0 ] );
+        QuantizeBc7Endpoint( Second, CandidateCodes[ 1 ], CandidatePBits[ 1 ], CandidateValues[ 1 ] );
+        uint32_t CandidateError{ Bc7Indices( block, CandidateValues[ 0 ], CandidateValues[ 1 ], CandidateIndices ) };
+        if( CandidateError >= Error ) break;
+        memcpy( Codes, CandidateCodes, sizeof( Codes ) );
+        memcpy( PBits, CandidatePBits, sizeof( PBits ) );
+        memcpy( Indices, CandidateIndices, sizeof( Indices ) );
+        Error = CandidateError;
+    }
+
+    // The first texel's index is stored without its top bit, so it must be below 8.
+    if( Indices[ 0 ] >= 8 )
+    {
+        std::swap( Codes[ 0 ], Codes[ 1 ] );
+        std::swap( PBits[ 0 ], PBits[ 1 ] );
+        for( auto &Index : Indices ) Index = static_cast<uint8_t>( 15 - Index );
+    }
+    memset( out, 0, 16 );
+    Bc7Bits Bits{ out };
+    Bits.Write( 1 << 6, 7 );
+    for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+    {
+        Bits.Write( Codes[ 0 ][ Channel ], 7 );
+        Bits.Write( Codes[ 1 ][ Channel ], 7 );
+    }
+    Bits.Write( PBits[ 0 ], 1 );
+    Bits.Write( PBits[ 1 ], 1 );
+    for( uint32_t Texel{ 0 }; Texel < 16; Texel++ ) Bits.Write( Indices[ Texel ], Texel ? 4 : 3 );
+}
+
+// Decodes the blocks EncodeBc7 produces; any other mode decodes to transparent black.
+inline void DecodeBc7( const uint8_t *data, uint8_t ( &block )[ 16 ][ 4 ] )
+{
+    uint8_t Data[ 16 ];
+    memcpy( Data, data, 16 );
+    Bc7Bits Bits{ Data };
+    if( Bits.Read( 7 ) != 1 << 6 )
+    {
+        memset( block, 0, sizeof( block ) );
+        return;
+    }
+    uint8_t Endpoints[ 2 ][ 4 ];
+    for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+    {
+        Endpoints[ 0 ][ Channel ] = static_cast<uint8_t>( Bits.Read( 7 ) << 1 );
+        Endpoints[ 1 ][ Channel ] = static_cast<uint8_t>( Bits.Read( 7 ) << 1 );
+    }
+    uint32_t PBits[ 2 ]{ Bits.Read( 1 ), Bits.Read( 1 ) };
+    for( uint32_t Endpoint{ 0 }; Endpoint < 2; Endpoint++ )
+        for( auto &Channel : Endpoints[ Endpoint ] ) Channel |= PBits[ Endpoint ];
+    for( uint32_t Texel{ 0 }; Texel < 16; Texel++ )
+    {
+        uint32_t Weight{ Bc7Weights4[ Bits.Read( Texel ? 4 : 3 ) ] };
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ ) block[ Texel ][ Channel ] = static_cast<uint8_t>( ( ( 64 - Weight ) * Endpoints[ 0 ][ Channel ] + Weight * Endpoints[ 1 ][ Channel ] + 32 ) >> 6 );
+    }
+}
+
+// Whole levels
+
+// Block rows are split evenly across threads; blocks are independent, so the output is the
+// same for any thread count.
+inline std::vector<uint8_t> CompressLevel( const TextureLevel &level, TextureFormat format, uint32_t threads = std::thread::hardware_concurrency() )
+{
+    if( format == TextureFormat::Rgba8 ) return level.Pixels;
+    std::vector<uint8_t> Out( TextureLevelBytes( format, level.Width, level.Height ) );
+    const uint32_t BlocksWide{ ( level.Width + 3 ) / 4 }, BlocksHigh{ ( level.Height + 3 ) / 4 };
+    const uint32_t BlockBytes{ TextureBlockBytes( format ) };
+    const uint32_t Workers{ std::max( 1u, std::min( threads, BlocksHigh ) ) };
+    auto Job{ [ & ]( uint32_t worker )
+              {
+                  uint8_t Block[ 16 ][ 4 ];
+                  for( uint32_t y{ BlocksHigh * worker / Workers }; y < BlocksHigh * ( worker + 1 ) / Workers; y++ )
+                      for( uint32_t x{ 0 }; x < BlocksWide; x++ )
+                      {
+                          LoadBlock( level, x, y, Block );
+                          uint8_t *Destination{ Out.data() + ( size_t( y ) * BlocksWide + x ) * BlockBytes };
+                          if( format == TextureFormat::Bc1 )
+                              EncodeBc1( Block, Destination );
+                          else
+                              EncodeBc7( Block, Destination );
+                      }
+              } };
+    std::vector<std::thread> Pool;
+    Pool.reserve( Workers - 1 );
+    for( uint32_t i{ 1 }; i < Workers; i++ ) Pool.emplace_back( Job, i );
+    Job( 0 );
+    for( auto &Thread : Pool ) Thread.join();
+    return Out;
+}
+
+inline TextureLevel DecompressLevel( std::span<const uint8_t> data, TextureFormat format, uint32_t width, uint32_t height )
+{
+    TextureLevel Level{ width, height, std::vector<uint8_t>( size_t( width ) * height * 4 ) };
+    if( format == TextureFormat::Rgba8 )
+    {
+        memcpy( Level.Pixels.data(), data.data(), std::min( data.size(), Level.Pixels.size() ) );
+        return Level;
+    }
+    const uint32_t BlocksWide{ ( width + 3 ) / 4 }, BlocksHigh{ ( height + 3 ) / 4 };
+    uint8_t Block[ 16 ][ 4 ];
+    for( uint32_t y{ 0 }; y < BlocksHigh; y++ )
+        for( uint32_t x{ 0 }; x < BlocksWide; x++ )
+        {
+            const uint8_t *Source{ data.data() + ( size_t( y ) * BlocksWide + x ) * TextureBlockBytes( format ) };
+            if( format == TextureFormat::Bc1 )
+                DecodeBc1( Source, Block );
+            else
+                DecodeBc7( Source, Block );
+            for( uint32_t Texel{ 0 }; Texel < 16; Texel++ )
+            {
+                uint32_t Px{ x * 4 + Texel % 4 }, Py{ y * 4 + Texel / 4 };
+                if( Px < width && Py < height ) memcpy( &Level.Pixels[ ( size_t( Py ) * width + Px ) * 4 ], Block[ Texel ], 4 );
+            }
+        }
+    return Level;
+}
+
+// Peak signal to noise ratio over the first channels channels, in dB; infinite when identical.
+inline double TexturePsnr( const TextureLevel &reference, const TextureLevel &test, uint32_t channels = 4 )
+{
+    double Sum{ 0.0 };
+    for( size_t Pixel{ 0 }; Pixel < size_t( reference.Width ) * reference.Height; Pixel++ )
+        for( uint32_t Channel{ 0 }; Channel < channels; Channel++ )
+        {
+            double Delta{ double( reference.Pixels[ Pixel * 4 + Channel ] ) - test.Pixels[ Pixel * 4 + Channel ] };
+            Sum += Delta * Delta;
+        }
+    double Mse{ Sum / ( double( reference.Width ) * reference.Height * channels ) };
+    return Mse > 0.0 ? 10.0 * std::log10( 255.0 * 255.0 / Mse ) : std::numeric_limits<double>::infinity();
+}
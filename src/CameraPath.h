@@ -0,0 +1,35 @@
+#pragma once
+#include "vulkan.h"
+#include <cmath>
+#include <numbers>
+
+// Scripted camera for benchmarks and captures: the pose is a function of the frame index
+// alone, so two runs of the same scene draw exactly the same frames. Over Frames frames the
+// eye circles Center once, rising, falling and moving in and out, always looking at it.
+struct CameraPath
+{
+    glm::vec3 Center{ 0.f };
+    float Radius{ 1.f }; // of the scene; the orbit keeps it all in view
+    uint32_t Frames{ 600 };
+
+    glm::vec3 Eye( uint32_t frame ) const
+    {
+        float Turn{ 2.f * std::numbers::pi_v<float> * float( frame % std::max( Frames, 1u ) ) / float( std::max( Frames, 1u ) ) };
+        float Distance{ Radius * ( 1.6f + 0.3f * std::sin( 3.f * Turn ) ) };
+        float Height{ Radius * ( 0.5f + 0.25f * std::sin( 2.f * Turn ) ) };
+        return Center + glm::vec3{ Distance * std::cos( Turn ), Height, Distance * std::sin( Turn ) };
+    }
+
+    glm::mat4 View( uint32_t frame ) const
+    {
+        return glm::lookAt( Eye( frame ), Center, glm::vec3{ 0.f, 1.f, 0.f } );
+    }
+
+    // Vulkan clip space: y points down and depth runs from 0 to 1.
+    glm::mat4 Projection( VkExtent2D extent ) const
+    {
+        glm::mat4 Result{ glm::perspective( glm::radians( 60.f ), float( extent.width ) / float( std::max( extent.height, 1u ) ), Radius * 0.01f, Radius * 8.f ) };
+        Result[ 1 ][ 1 ] *= -1.f;
+        return Result;
+    }
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <span>
+#include <format>
+#include <vector>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+// Records one subpass of a render pass instance from the workers of a JobSystem. Every thread
+// that can run a job, the workers plus the one waiting on them, owns a command pool per frame
+// in flight, so no pool is ever touched by two threads. A draw list is cut into slices, each
+// recorded into a secondary command buffer of the pool of whichever thread picked it up, and
+// the primary only executes them in order. Begin resets a frame's pools as a whole; the
+// secondary buffers stay allocated and are recorded again the next time that frame comes round.
+class CommandRecorder
+{
+  public:
+    CommandRecorder( VkDevice device, uint32_t family, JobSystem &jobs, uint32_t frames = 1 ) : Device{ device }, Jobs{ jobs }, ThreadsCount{ jobs.Threads() + 1 }
+    {
+        Pools.resize( size_t( frames ) * ThreadsCount );
+        VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+        CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        CommandPoolCreateInfo.queueFamilyIndex = family;
+        for( auto &Pool : Pools )
+        {
+            VkResult Result{ vkCreateCommandPool( Device, &CommandPoolCreateInfo, nullptr, &Pool.Handle ) };
+            if( Result != VK_SUCCESS )
+            {
+                Destroy();
+                throw std::runtime_error( std::format( "Failed to create recording command pool, error: {}", string_VkResult( Result ) ) );
+            }
+        }
+    }
+    CommandRecorder( const CommandRecorder & )            = delete;
+    CommandRecorder &operator=( const CommandRecorder & ) = delete;
+
+    ~CommandRecorder()
+    {
+        Destroy();
+    }
+
+    // Threads that may record, and so the most slices Record cuts a list into.
+    uint32_t Threads() const
+    {
+        return ThreadsCount;
+    }
+
+    // The job system slices are recorded on, for work that goes with recording.
+    JobSystem &Workers() const
+    {
+        return Jobs;
+    }
+
+    // The submission that last used frame must have completed.
+    void Begin( uint32_t frame )
+    {
+        Frame = frame;
+        for( uint32_t Thread{ 0 }; Thread < ThreadsCount; Thread++ )
+        {
+            ThreadPool &Pool{ Pools[ size_t( Frame ) * ThreadsCount + Thread ] };
+            VkResult Result{ vkResetCommandPool( Device, Pool.Handle, 0 ) };
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to reset recording command pool, error: {}", string_VkResult( Result ) ) );
+            Pool.Used = 0;
+        }
+    }
+
+    // Cuts count items into slices of at least minimum and calls record( commandBuffer, slice,
+    // first, last ) for each on the workers; commandBuffer continues subpass of renderPass on
+    // framebuffer. primary must be inside that render pass, begun with
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. Returns the number of slices.
+    uint32_t Record( VkCommandBuffer primary, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer, size_t count,
+                     const std::function<void( VkCommandBuffer, uint32_t, size_t, size_t )> &record, size_t minimum = 256 )
+    {
+        if( !count ) return 0;
+        uint32_t Slices{ static_cast<uint32_t>( std::min<size_t>( ThreadsCount, ( count + minimum - 1 ) / std::max<size_t>( minimum, 1 ) ) ) };
+        Secondaries.assign( Slices, VK_NULL_HANDLE );
+        Pending.clear();
+        VkCommandBufferInheritanceInfo InheritanceInfo{};
+        InheritanceInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        InheritanceInfo.renderPass  = renderPass;
+        InheritanceInfo.subpass     = subpass;
+        InheritanceInfo.framebuffer = framebuffer;
+        for( uint32_t Slice{ 0 }; Slice < Slices; Slice++ )
+            Pending.push_back( Jobs.Submit( "record slice", [ &, Slice ]
+                                            {
+                                                PROFILE_ZONE( "record slice" );
+                                                VkCommandBuffer Commands{ Acquire() };
+                                                VkCommandBufferBeginInfo BeginInfo{};
+                                                BeginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                                                BeginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                                                BeginInfo.pInheritanceInfo = &InheritanceInfo;
+                                                vkBeginCommandBuffer( Commands, &BeginInfo );
+                                                record( Commands, Slice, count * Slice / Slices, count * ( Slice + 1 ) / Slices );
+                                                VkResult Result{ vkEndCommandBuffer( Commands ) };
+                                                if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to record secondary command buffer, error: {}", string_VkResult( Result ) ) );
+                                                Secondaries[ Slice ] = Commands;
+                                            } ) );
+        // Every slice is waited for before a failure is rethrown, since they all reference this frame.
+        std::exception_ptr Error;
+        for( const Job &Each : Pending )
+        {
+            try
+            {
+                Jobs.Wait( Each );
+            }
+            catch( ... )
+            {
+                if( !Error ) Error = std::current_exception();
+            }
+        }
+        if( Error ) std::rethrow_exception( Error );
+        vkCmdExecuteCommands( primary, Slices, Secondaries.data() );
+        return Slices;
+    }
+
+  private:
+    struct ThreadPool
+    {
+        VkCommandPool Handle{ VK_NULL_HANDLE };
+        std::vector<VkCommandBuffer> Buffers;
+        size_t Used{ 0 };
+    };
+
+    VkDevice Device;
+    JobSystem &Jobs;
+    uint32_t ThreadsCount;
+    uint32_t Frame{ 0 };
+    std::vector<ThreadPool> Pools; // frame major, a pool per thread
+    std::vector<VkCommandBuffer> Secondaries;
+    std::vector<Job> Pending;
+
+    // Next free secondary buffer of the calling thread's pool; the thread waiting on the
+    // workers takes the last pool.
+    VkCommandBuffer Acquire()
+    {
+        uint32_t Thread{ std::min( Jobs.CurrentWorker(), ThreadsCount - 1 ) };
+        ThreadPool &Pool{ Pools[ size_t( Frame ) * ThreadsCount + Thread ] };
+        if( Pool.Used == Pool.Buffers.size() )
+        {
+            VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+            CommandBufferAllocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            CommandBufferAllocateInfo.commandPool        = Pool.Handle;
+            CommandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            CommandBufferAllocateInfo.commandBufferCount = 1;
+            VkCommandBuffer Commands{ VK_NULL_HANDLE };
+            VkResult Result{ vkAllocateCommandBuffers( Device, &CommandBufferAllocateInfo, &Commands ) };
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate secondary command buffer, error: {}", string_VkResult( Result ) ) );
+            Pool.Buffers.push_back( Commands );
+        }
+        return Pool.Buffers[ Pool.Used++ ];
+    }
+
+    void Destroy()
+    {
+        for( auto &Pool : Pools )
+            if( Pool.Handle ) vkDestroyCommandPool( Device, Pool.Handle, nullptr );
+        Pools.clear();
+    }
+};
@@ -0,0 +1,306 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_enum_string_helper.h>
+#include <mutex>
+#include <format>
+#include <vector>
+#include <stdexcept>
+#include "MemoryAllocator.h"
+
+// Sub-allocation of VkDeviceMemory. Drivers cap the number of live vkAllocateMemory calls
+// (maxMemoryAllocationCount, often 4096) and each one is slow, so resources share large blocks
+// per memory type and get TLSF ranges inside them. Resources larger than half a block get a
+// dedicated allocation.
+
+enum class DeviceResource
+{
+    Buffer,
+    Image // VK_IMAGE_TILING_OPTIMAL; linear images count as buffers
+};
+
+struct DeviceAllocation
+{
+    VkDeviceMemory Memory{ VK_NULL_HANDLE };
+    VkDeviceSize Offset{ 0 };
+    VkDeviceSize Size{ 0 };
+    void *Mapped{ nullptr }; // already offset; null unless the memory is host visible
+    uint32_t MemoryType{ ~0u };
+    uint32_t Pool{ ~0u };
+    PoolAllocation Range; // invalid for dedicated allocations
+};
+
+class DeviceMemoryAllocator
+{
+  public:
+    DeviceMemoryAllocator( VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = 64ull << 20 ) : Device{ device }
+    {
+        VkPhysicalDeviceProperties Properties;
+        vkGetPhysicalDeviceProperties( physicalDevice, &Properties );
+        vkGetPhysicalDeviceMemoryProperties( physicalDevice, &MemoryProperties );
+        MaxAllocations = Properties.limits.maxMemoryAllocationCount;
+        // Linear and optimal resources only need separate blocks when the granularity could put
+        // them on the same page.
+        SplitImages = Properties.limits.bufferImageGranularity > 1;
+        Pools.resize( MemoryProperties.memoryTypeCount * 2 );
+        for( uint32_t Type{ 0 }; Type < MemoryProperties.memoryTypeCount; Type++ )
+        {
+            // Small heaps (e.g. the 256 MB BAR window) get proportionally smaller blocks.
+            VkDeviceSize Heap{ MemoryProperties.memoryHeaps[ MemoryProperties.memoryTypes[ Type ].heapIndex ].size };
+            VkDeviceSize Size{ std::max<VkDeviceSize>( std::min( blockSize, Heap / 8 ), 1ull << 20 ) };
+            Pools[ Type * 2 ].Allocator     = MemoryPool{ Size };
+            Pools[ Type * 2 + 1 ].Allocator = MemoryPool{ Size };
+        }
+    }
+    DeviceMemoryAllocator( const DeviceMemoryAllocator & )            = delete;
+    DeviceMemoryAllocator &operator=( const DeviceMemoryAllocator & ) = delete;
+
+    ~DeviceMemoryAllocator()
+    {
+        for( auto &Pool : Pools )
+            for( auto &Block : Pool.Blocks )
+                if( Block.Memory ) vkFreeMemory( Device, Block.Memory, nullptr );
+    }
+
+    // Lowest memory type allowed by typeBits with every required flag, preferring one that
+    // also has the preferred flags. ~0u if none qualifies.
+    uint32_t FindMemoryType( uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0 ) const
+    {
+        uint32_t Fallback{ ~0u };
+        for( uint32_t Type{ 0 }; Type < MemoryProperties.memoryTypeCount; Type++ )
+        {
+            VkMemoryPropertyFlags Flags{ MemoryProperties.memoryTypes[ Type ].propertyFlags };
+            if( !( typeBits & ( 1u << Type ) ) || ( Flags & required ) != required ) continue;
+            if( ( Flags & preferred ) == preferred ) return Type;
+            if( Fallback == ~0u ) Fallback = Type;
+        }
+        return Fallback;
+    }
+
+    DeviceAllocation Allocate( const VkMemoryRequirements &requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0, DeviceResource resource = DeviceResource::Buffer )
+    {
+        DeviceAllocation Allocation;
+        Allocation.MemoryType = FindMemoryType( requirements.memoryTypeBits, required, preferred );
+        if( Allocation.MemoryType == ~0u )
+            throw std::runtime_error( std::format( "No memory type for bits {:#x} with flags {}.", requirements.memoryTypeBits, string_VkMemoryPropertyFlags( required ) ) );
+        Allocation.Pool = Allocation.MemoryType * 2 + ( SplitImages && resource == DeviceResource::Image );
+
+        std::lock_guard Lock{ Mutex };
+        Pool &Pool{ Pools[ Allocation.Pool ] };
+        if( requirements.size > Pool.Allocator.Size() / 2 )
+        {
+            Allocation.Memory = AllocateMemory( Allocation.MemoryType, requirements.size, &Allocation.Mapped );
+            Allocation.Size   = requirements.size;
+            Dedicated++;
+            DedicatedBytes += requirements.size;
+            return Allocation;
+        }
+
+        Allocation.Range = Pool.Allocator.Allocate( requirements.size, requirements.alignment );
+        if( !Allocation.Range.Valid() )
+        {
+            uint32_t Block{ Pool.Allocator.AddBlock() };
+            if( Block >= Pool.Blocks.size() ) Pool.Blocks.resize( Block + 1 );
+            try
+            {
+                Pool.Blocks[ Block ].Memory = AllocateMemory( Allocation.MemoryType, Pool.Allocator.Size(), &Pool.Blocks[ Block ].Mapped );
+            }
+            catch( ... )
+            {
+                Pool.Allocator.RemoveBlock( Block );
+                throw;
+            }
+            Allocation.Range = Pool.Allocator.Allocate( requirements.size, requirements.alignment );
+            if( !Allocation.Range.Valid() )
+                throw std::runtime_error( std::format( "A new {} byte memory block cannot hold {} bytes aligned to {}.", Pool.Allocator.Size(), requirements.size, requirements.alignment ) );
+        }
+        const auto &Block{ Pool.Blocks[ Allocation.Range.Block ] };
+        Allocation.Memory = Block.Memory;
+        Allocation.Offset = Allocation.Range.Range.Offset;
+        Allocation.Size   = requirements.size;
+        if( Block.Mapped ) Allocation.Mapped = static_cast<char *>( Block.Mapped ) + Allocation.Offset;
+        return Allocation;
+    }
+
+    void Free( DeviceAllocation &allocation )
+    {
+        if( !allocation.Memory ) return;
+        std::lock_guard Lock{ Mutex };
+        if( !allocation.Range.Valid() )
+        {
+            vkFreeMemory( Device, allocation.Memory, nullptr );
+            DeviceAllocations--;
+            Dedicated--;
+            DedicatedBytes -= allocation.Size;
+        }
+        else
+        {
+            Pool &Pool{ Pools[ allocation.Pool ] };
+            uint32_t Released{ Pool.Allocator.Free( allocation.Range ) };
+            if( Released != PoolAllocation::Invalid )
+            {
+                vkFreeMemory( Device, Pool.Blocks[ Released ].Memory, nullptr );
+                Pool.Blocks[ Released ] = {};
+                DeviceAllocations--;
+            }
+        }
+        allocation = {};
+    }
+
+    VkBuffer CreateBuffer( VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, DeviceAllocation &allocation )
+    {
+        VkBufferCreateInfo BufferCreateInfo{};
+        BufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        BufferCreateInfo.size        = size;
+        BufferCreateInfo.usage       = usage;
+        BufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VkBuffer Buffer;
+        VkResult Result{ vkCreateBuffer( Device, &BufferCreateInfo, nullptr, &Buffer ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create buffer, error: {}", string_VkResult( Result ) ) );
+        VkMemoryRequirements Requirements;
+        vkGetBufferMemoryRequirements( Device, Buffer, &Requirements );
+        try
+        {
+            allocation = Allocate( Requirements, required, preferred, DeviceResource::Buffer );
+        }
+        catch( ... )
+        {
+            vkDestroyBuffer( Device, Buffer, nullptr );
+            throw;
+        }
+        vkBindBufferMemory( Device, Buffer, allocation.Memory, allocation.Offset );
+        return Buffer;
+    }
+
+    void DestroyBuffer( VkBuffer buffer, DeviceAllocation &allocation )
+    {
+        vkDestroyBuffer( Device, buffer, nullptr );
+        Free( allocation );
+    }
+
+    VkImage CreateImage( const VkImageCreateInfo &imageCreateInfo, VkMemoryPropertyFlags required, DeviceAllocation &allocation )
+    {
+        VkImage Image;
+        VkResult Result{ vkCreateImage( Device, &imageCreateInfo, nullptr, &Image ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create image, error: {}", string_VkResult( Result ) ) );
+        VkMemoryRequirements Requirements;
+        vkGetImageMemoryRequirements( Device, Image, &Requirements );
+        try
+        {
+            allocation = Allocate( Requirements, required, 0, imageCreateInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? DeviceResource::Image : DeviceResource::Buffer );
+        }
+        catch( ... )
+        {
+            vkDestroyImage( Device, Image, nullptr );
+            throw;
+        }
+        vkBindImageMemory( Device, Image, allocation.Memory, allocation.Offset );
+        return Image;
+    }
+
+    void DestroyImage( VkImage image, DeviceAllocation &allocation )
+    {
+        vkDestroyImage( Device, image, nullptr );
+        Free( allocation );
+    }
+
+    // Whole blocks for callers that run their own LinearAllocator or RingAllocator inside,
+    // e.g. per-frame uniforms and staging. Released with FreeBlock.
+    DeviceAllocation AllocateBlock( VkDeviceSize size, uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0 )
+    {
+        return Allocate( { size, 1, typeBits }, required, preferred );
+    }
+
+    void FreeBlock( DeviceAllocation &allocation )
+    {
+        Free( allocation );
+    }
+
+    // Sub-allocated memory only; dedicated allocations count as one block each in Blocks and
+    // Reserved.
+    MemoryStatistics Stat() const
+    {
+        std::lock_guard Lock{ Mutex };
+        MemoryStatistics Statistics;
+        for( const auto &Pool : Pools ) Statistics += Pool.Allocator.Stat();
+        Statistics.Blocks += Dedicated;
+        Statistics.Allocations += Dedicated;
+        Statistics.Reserved += DedicatedBytes;
+        Statistics.Used += DedicatedBytes;
+        return Statistics;
+    }
+
+    DefragmentationStatistics Defragmentation() const
+    {
+        std::lock_guard Lock{ Mutex };
+        DefragmentationStatistics Statistics;
+        for( const auto &Pool : Pools )
+        {
+            DefragmentationStatistics PoolStatistics{ Pool.Allocator.Defragmentation() };
+            Statistics.ReleasableBlocks += PoolStatistics.ReleasableBlocks;
+            Statistics.BytesToMove += PoolStatistics.BytesToMove;
+        }
+        return Statistics;
+    }
+
+    // Live vkAllocateMemory objects, for comparison against maxMemoryAllocationCount.
+    uint32_t MemoryObjects() const
+    {
+        return DeviceAllocations;
+    }
+
+    const VkPhysicalDeviceMemoryProperties &Properties() const
+    {
+        return MemoryProperties;
+    }
+
+  private:
+    struct Block
+    {
+        VkDeviceMemory Memory{ VK_NULL_HANDLE };
+        void *Mapped{ nullptr };
+    };
+    struct Pool
+    {
+        MemoryPool Allocator;
+        std::vector<Block> Blocks; // indexed by MemoryPool block id
+    };
+
+    VkDevice Device;
+    VkPhysicalDeviceMemoryProperties MemoryProperties;
+    uint32_t MaxAllocations;
+    bool SplitImages;
+    // Pools[ type * 2 ] holds buffers and linear images, Pools[ type * 2 + 1 ] optimal images.
+    std::vector<Pool> Pools;
+    uint32_t DeviceAllocations{ 0 };
+    uint32_t Dedicated{ 0 };
+    VkDeviceSize DedicatedBytes{ 0 };
+    mutable std::mutex Mutex;
+
+    VkDeviceMemory AllocateMemory( uint32_t type, VkDeviceSize size, void **mapped )
+    {
+        if( DeviceAllocations >= MaxAllocations )
+            throw std::runtime_error( std::format( "Device memory allocation count limit reached: {}.", MaxAllocations ) );
+        VkMemoryAllocateInfo MemoryAllocateInfo{};
+        MemoryAllocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        MemoryAllocateInfo.allocationSize  = size;
+        MemoryAllocateInfo.memoryTypeIndex = type;
+        VkDeviceMemory Memory;
+        VkResult Result{ vkAllocateMemory( Device, &MemoryAllocateInfo, nullptr, &Memory ) };
+        if( Result != VK_SUCCESS )
+            throw std::runtime_error( std::format( "Failed to allocate {} bytes of device memory type {}, error: {}", size, type, string_VkResult( Result ) ) );
+        DeviceAllocations++;
+        // Host visible memory stays mapped for its whole life.
+        *mapped = nullptr;
+        if( MemoryProperties.memoryTypes[ type ].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+        {
+            Result = vkMapMemory( Device, Memory, 0, VK_WHOLE_SIZE, 0, mapped );
+            if( Result != VK_SUCCESS )
+            {
+                vkFreeMemory( Device, Memory, nullptr );
+                DeviceAllocations--;
+                throw std::runtime_error( std::format( "Failed to map device memory, error: {}", string_VkResult( Result ) ) );
+            }
+        }
+        return Memory;
+    }
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <span>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// Files linked into the executable as read-only data by the embedfiles tool. Built with
+// EMBED_ASSETS the source it generates defines EmbeddedFiles(); otherwise there are none and
+// every lookup falls through to the file system.
+struct EmbeddedFile
+{
+    const char *Path;    // as given to embedfiles, / separated
+    const uint8_t *Data; // 64-byte aligned and followed by a NUL
+    size_t Size;
+};
+
+#if defined( EMBED_ASSETS )
+std::span<const EmbeddedFile> EmbeddedFiles();
+#else
+inline std::span<const EmbeddedFile> EmbeddedFiles()
+{
+    return {};
+}
+#endif
+
+// Null when no file was embedded under path; a handful are, so a scan does.
+inline const EmbeddedFile *FindEmbeddedFile( std::string_view path )
+{
+    for( const EmbeddedFile &File : EmbeddedFiles() )
+        if( File.Path == path ) return &File;
+    return nullptr;
+}
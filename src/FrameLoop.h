@@ -0,0 +1,587 @@
+#pragma once
+#include "DeviceMemory.h"
+#include "Profiler.h"
+#include <span>
+#include <chrono>
+#include <format>
+#include <vector>
+#include <optional>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+
+// How the present mode is picked from what the surface offers; FIFO is always there to fall back to.
+enum class PresentPolicy
+{
+    Vsync,      // FIFO: never tears, frames queue up behind the display
+    LowLatency, // MAILBOX: never tears, a newer frame replaces the one waiting for the display
+    Uncapped,   // IMMEDIATE: may tear, nothing waits for the display
+};
+
+inline const char *PresentPolicyName( PresentPolicy policy )
+{
+    switch( policy )
+    {
+        case PresentPolicy::Vsync:
+            return "vsync";
+        case PresentPolicy::LowLatency:
+            return "low-latency";
+        case PresentPolicy::Uncapped:
+            return "uncapped";
+    }
+    return "unknown";
+}
+
+inline bool ParsePresentPolicy( const char *name, PresentPolicy &policy )
+{
+    for( PresentPolicy Each : { PresentPolicy::Vsync, PresentPolicy::LowLatency, PresentPolicy::Uncapped } )
+        if( !strcmp( name, PresentPolicyName( Each ) ) )
+        {
+            policy = Each;
+            return true;
+        }
+    return false;
+}
+
+inline VkPresentModeKHR ChoosePresentMode( std::span<const VkPresentModeKHR> available, PresentPolicy policy )
+{
+    auto Has{ [ & ]( VkPresentModeKHR mode )
+              { return std::find( available.begin(), available.end(), mode ) != available.end(); } };
+    switch( policy )
+    {
+        case PresentPolicy::Uncapped:
+            if( Has( VK_PRESENT_MODE_IMMEDIATE_KHR ) ) return VK_PRESENT_MODE_IMMEDIATE_KHR;
+            [[fallthrough]];
+        case PresentPolicy::LowLatency:
+            if( Has( VK_PRESENT_MODE_MAILBOX_KHR ) ) return VK_PRESENT_MODE_MAILBOX_KHR;
+            [[fallthrough]];
+        case PresentPolicy::Vsync:
+            break;
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+struct FrameLatency
+{
+    double WaitMs{ 0.0 };           // blocked on the frame slot's fence, i.e. the GPU is behind
+    double CpuMs{ 0.0 };            // acquire, recording and submit
+    double InputToPresentMs{ 0.0 }; // from the input the frame was built from to vkQueuePresentKHR, 0 without one
+};
+
+struct FrameLoopStatistics
+{
+    uint64_t Frames{ 0 };      // presented
+    uint64_t Skipped{ 0 };     // minimized, or the swapchain was out of date
+    uint64_t Recreations{ 0 }; // swapchains created, the first one included
+    uint64_t Retired{ 0 };     // old swapchains destroyed once the frames using them were done
+};
+
+// Renders to a window surface with up to FramesInFlight() frames recorded ahead of the GPU.
+// Every frame slot has its own command pool, reset rather than freed, its own fence and its
+// own acquire semaphore; the semaphore the present waits on belongs to the swapchain image.
+// A resize or an out of date swapchain only marks it stale: the next frame creates the new
+// one with oldSwapchain set, and the old one with its views, framebuffers and depth image is
+// destroyed once a frame submitted after it was replaced has finished, so nothing waits for
+// the device to go idle.
+class FrameLoop
+{
+  public:
+    // extent is used where the surface leaves the size to the swapchain, and is the window's
+    // framebuffer size. A timestampPeriod above 0 gives profiled builds a GPU track.
+    FrameLoop( VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, DeviceMemoryAllocator &memory, VkQueue graphicQueue, uint32_t graphicFamily, VkQueue presentQueue,
+               uint32_t presentFamily, VkExtent2D extent, uint32_t framesInFlight = 2, PresentPolicy policy = PresentPolicy::LowLatency, VkFormat depthFormat = VK_FORMAT_D32_SFLOAT,
+               float timestampPeriod = 0.f, uint32_t timestampBits = 0 )
+        : PhysicalDevice{ physicalDevice }, Device{ device }, Surface{ surface }, Memory{ memory }, GraphicQueue{ graphicQueue }, PresentQueue{ presentQueue }, Families{ graphicFamily, presentFamily },
+          Requested{ extent }, Policy{ policy }, DepthFormat{ depthFormat }
+    {
+        uint32_t Count{ 0 };
+        vkGetPhysicalDeviceSurfaceFormatsKHR( PhysicalDevice, Surface, &Count, nullptr );
+        std::vector<VkSurfaceFormatKHR> Formats( Count );
+        vkGetPhysicalDeviceSurfaceFormatsKHR( PhysicalDevice, Surface, &Count, Formats.data() );
+        if( Formats.empty() ) throw std::runtime_error( "Surface without formats." );
+        SurfaceFormat = Formats.front();
+        for( const auto &Format : Formats )
+            if( ( Format.format == VK_FORMAT_B8G8R8A8_SRGB || Format.format == VK_FORMAT_R8G8B8A8_SRGB ) && Format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR )
+            {
+                SurfaceFormat = Format;
+                break;
+            }
+        vkGetPhysicalDeviceSurfacePresentModesKHR( PhysicalDevice, Surface, &Count, nullptr );
+        std::vector<VkPresentModeKHR> Modes( Count );
+        vkGetPhysicalDeviceSurfacePresentModesKHR( PhysicalDevice, Surface, &Count, Modes.data() );
+        Mode = ChoosePresentMode( Modes, Policy );
+        // Whatever was created before a failure is released, as the destructor would.
+        try
+        {
+            CreateRenderPass();
+
+            Slots.resize( std::max( framesInFlight, 1u ) );
+            for( auto &Each : Slots )
+            {
+                VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+                CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                CommandPoolCreateInfo.queueFamilyIndex = graphicFamily;
+                VkResult Result{ vkCreateCommandPool( Device, &CommandPoolCreateInfo, nullptr, &Each.Pool ) };
+                if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create frame command pool, error: {}", string_VkResult( Result ) ) );
+                VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+                CommandBufferAllocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                CommandBufferAllocateInfo.commandPool        = Each.Pool;
+                CommandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                CommandBufferAllocateInfo.commandBufferCount = 1;
+                Result                                       = vkAllocateCommandBuffers( Device, &CommandBufferAllocateInfo, &Each.Commands );
+                if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate frame command buffer, error: {}", string_VkResult( Result ) ) );
+                VkFenceCreateInfo FenceCreateInfo{};
+                FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+                FenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+                Result                = vkCreateFence( Device, &FenceCreateInfo, nullptr, &Each.Done );
+                if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create frame fence, error: {}", string_VkResult( Result ) ) );
+                Each.Acquired = CreateSemaphore();
+            }
+            if constexpr( ProfilerEnabled )
+                if( timestampPeriod > 0.f ) Gpu.emplace( Device, GraphicQueue, graphicFamily, timestampPeriod, timestampBits, "GPU graphics queue", FramesInFlight() );
+            if( !Rebuild() ) Stale = true; // minimized from the start
+        }
+        catch( ... )
+        {
+            Release();
+            throw;
+        }
+    }
+    FrameLoop( const FrameLoop & )            = delete;
+    FrameLoop &operator=( const FrameLoop & ) = delete;
+
+    // Shutdown is the one place that waits for the device.
+    ~FrameLoop()
+    {
+        vkDeviceWaitIdle( Device );
+        Release();
+    }
+
+    // Pipelines drawing to the window are created against this render pass, subpass 0. It
+    // outlives swapchain recreation, the surface format being picked once.
+    VkRenderPass RenderPass() const
+    {
+        return Pass;
+    }
+    VkExtent2D Extent() const
+    {
+        return Chain.Extent;
+    }
+    // Framebuffer of the image being recorded, valid inside the callbacks of Render.
+    VkFramebuffer Framebuffer() const
+    {
+        return Chain.Framebuffers[ Image ];
+    }
+    uint32_t FramesInFlight() const
+    {
+        return static_cast<uint32_t>( Slots.size() );
+    }
+    // Slot of the frame being recorded, for resources kept per frame in flight.
+    uint32_t Frame() const
+    {
+        return Slot;
+    }
+    VkPresentModeKHR PresentMode() const
+    {
+        return Mode;
+    }
+    VkSurfaceFormatKHR Format() const
+    {
+        return SurfaceFormat;
+    }
+    const FrameLatency &LastFrame() const
+    {
+        return Times;
+    }
+    FrameLoopStatistics Stat() const
+    {
+        return Statistics;
+    }
+    // For PROFILE_GPU_ZONE in the callbacks of Render; null unless profiling with timestamps.
+    GpuProfiler *GpuZones()
+    {
+        return Gpu ? &*Gpu : nullptr;
+    }
+
+    // Every frame submitted so far has finished, e.g. before what they draw is destroyed.
+    void Wait()
+    {
+        for( auto &Each : Slots ) vkWaitForFences( Device, 1, &Each.Done, VK_TRUE, UINT64_MAX );
+        Completed = Submitted;
+    }
+
+    // The window's framebuffer changed size; the swapchain follows on the next frame.
+    void Resize( VkExtent2D extent )
+    {
+        Requested = extent;
+        Stale     = true;
+    }
+
+    // One frame, as OffscreenTarget::Render, presented at the end. input is when the input
+    // the frame reflects arrived. Returns false when nothing was drawn: the window has no
+    // area, or the swapchain went out of date and is recreated on the next call.
+    bool Render( const std::function<void( VkCommandBuffer )> &prepare, const std::function<void( VkCommandBuffer )> &record, std::span<const float, 4> clear, VkSemaphore wait = VK_NULL_HANDLE,
+                 uint64_t waitValue = 0, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, std::chrono::steady_clock::time_point input = {} )
+    {
+        PROFILE_ZONE( "window frame" );
+        if( Stale && !Rebuild() )
+        {
+            Statistics.Skipped++;
+            return false;
+        }
+        FrameSlot &Current{ Slots[ Slot ] };
+        auto Start{ std::chrono::steady_clock::now() };
+        {
+            PROFILE_ZONE( "wait for frame slot" );
+            vkWaitForFences( Device, 1, &Current.Done, VK_TRUE, UINT64_MAX );
+        }
+        Completed = std::max( Completed, Current.Serial );
+        if( Gpu ) Gpu->Collect( Slot );
+        DestroyRetired();
+        auto Waited{ std::chrono::steady_clock::now() };
+
+        VkResult Result{ vkAcquireNextImageKHR( Device, Chain.Swapchain, UINT64_MAX, Current.Acquired, VK_NULL_HANDLE, &Image ) };
+        if( Result == VK_ERROR_OUT_OF_DATE_KHR )
+        {
+            Stale = true;
+            Statistics.Skipped++;
+            return false;
+        }
+        if( Result != VK_SUCCESS && Result != VK_SUBOPTIMAL_KHR ) throw std::runtime_error( std::format( "Failed to acquire swapchain image, error: {}", string_VkResult( Result ) ) );
+        if( Result == VK_SUBOPTIMAL_KHR ) Stale = true; // the semaphore is signalled, so this frame still goes out
+
+        Result = vkResetCommandPool( Device, Current.Pool, 0 );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to reset frame command pool, error: {}", string_VkResult( Result ) ) );
+        VkCommandBufferBeginInfo BeginInfo{};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        Result          = vkBeginCommandBuffer( Current.Commands, &BeginInfo );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to begin frame command buffer, error: {}", string_VkResult( Result ) ) );
+        if( Gpu ) Gpu->BeginFrame( Current.Commands, Slot );
+        {
+            PROFILE_GPU_ZONE( GpuZones(), Current.Commands, "prepare" );
+            if( prepare ) prepare( Current.Commands );
+        }
+        VkClearValue ClearValues[ 2 ]{};
+        memcpy( ClearValues[ 0 ].color.float32, clear.data(), sizeof( float ) * 4 );
+        ClearValues[ 1 ].depthStencil = { 1.f, 0 };
+        VkRenderPassBeginInfo RenderPassBeginInfo{};
+        RenderPassBeginInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        RenderPassBeginInfo.renderPass      = Pass;
+        RenderPassBeginInfo.framebuffer     = Chain.Framebuffers[ Image ];
+        RenderPassBeginInfo.renderArea      = { { 0, 0 }, Chain.Extent };
+        RenderPassBeginInfo.clearValueCount = 2;
+        RenderPassBeginInfo.pClearValues    = ClearValues;
+        {
+            PROFILE_GPU_ZONE( GpuZones(), Current.Commands, "render pass" );
+            vkCmdBeginRenderPass( Current.Commands, &RenderPassBeginInfo, contents );
+            if( record ) record( Current.Commands );
+            vkCmdEndRenderPass( Current.Commands );
+        }
+        Result = vkEndCommandBuffer( Current.Commands );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to record frame, error: {}", string_VkResult( Result ) ) );
+
+        // Binary semaphores ignore their timeline value.
+        VkSemaphore Waits[ 2 ]{ Current.Acquired, wait };
+        uint64_t WaitValues[ 2 ]{ 0, waitValue };
+        VkPipelineStageFlags WaitStages[ 2 ]{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo{};
+        TimelineSubmitInfo.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineSubmitInfo.waitSemaphoreValueCount = wait ? 2 : 1;
+        TimelineSubmitInfo.pWaitSemaphoreValues    = WaitValues;
+        VkSubmitInfo SubmitInfo{};
+        SubmitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext                = wait ? &TimelineSubmitInfo : nullptr;
+        SubmitInfo.waitSemaphoreCount   = wait ? 2 : 1;
+        SubmitInfo.pWaitSemaphores      = Waits;
+        SubmitInfo.pWaitDstStageMask    = WaitStages;
+        SubmitInfo.commandBufferCount   = 1;
+        SubmitInfo.pCommandBuffers      = &Current.Commands;
+        SubmitInfo.signalSemaphoreCount = 1;
+        SubmitInfo.pSignalSemaphores    = &Chain.Rendered[ Image ];
+        // Reset only now, so a failure above cannot leave a fence that is never signalled.
+        vkResetFences( Device, 1, &Current.Done );
+        Result = vkQueueSubmit( GraphicQueue, 1, &SubmitInfo, Current.Done );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to submit frame, error: {}", string_VkResult( Result ) ) );
+        Current.Serial = ++Submitted;
+        auto Recorded{ std::chrono::steady_clock::now() };
+
+        VkPresentInfoKHR PresentInfo{};
+        PresentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        PresentInfo.waitSemaphoreCount = 1;
+        PresentInfo.pWaitSemaphores    = &Chain.Rendered[ Image ];
+        PresentInfo.swapchainCount     = 1;
+        PresentInfo.pSwapchains        = &Chain.Swapchain;
+        PresentInfo.pImageIndices      = &Image;
+        {
+            PROFILE_ZONE( "present" );
+            Result = vkQueuePresentKHR( PresentQueue, &PresentInfo );
+        }
+        auto Presented{ std::chrono::steady_clock::now() };
+        if( Result == VK_ERROR_OUT_OF_DATE_KHR || Result == VK_SUBOPTIMAL_KHR ) Stale = true;
+        else if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to present, error: {}", string_VkResult( Result ) ) );
+
+        Times.WaitMs           = std::chrono::duration<double, std::milli>( Waited - Start ).count();
+        Times.CpuMs            = std::chrono::duration<double, std::milli>( Recorded - Waited ).count();
+        Times.InputToPresentMs = input == std::chrono::steady_clock::time_point{} ? 0.0 : std::chrono::duration<double, std::milli>( Presented - input ).count();
+        Statistics.Frames++;
+        Slot = ( Slot + 1 ) % FramesInFlight();
+        return true;
+    }
+
+  private:
+    struct FrameSlot
+    {
+        VkCommandPool Pool{ VK_NULL_HANDLE };
+        VkCommandBuffer Commands{ VK_NULL_HANDLE };
+        VkFence Done{ VK_NULL_HANDLE };
+        VkSemaphore Acquired{ VK_NULL_HANDLE };
+        uint64_t Serial{ 0 }; // of the frame last submitted from this slot
+    };
+
+    // A swapchain and everything sized to it.
+    struct SwapchainGeneration
+    {
+        VkSwapchainKHR Swapchain{ VK_NULL_HANDLE };
+        VkExtent2D Extent{ 0, 0 };
+        std::vector<VkImageView> Views;
+        std::vector<VkFramebuffer> Framebuffers;
+        std::vector<VkSemaphore> Rendered; // per image, signalled by the frame's submit and waited by its present
+        VkImage Depth{ VK_NULL_HANDLE };
+        VkImageView DepthView{ VK_NULL_HANDLE };
+        DeviceAllocation DepthMemory;
+        uint64_t RetiredAt{ 0 }; // last frame submitted before it was replaced
+    };
+
+    VkPhysicalDevice PhysicalDevice;
+    VkDevice Device;
+    VkSurfaceKHR Surface;
+    DeviceMemoryAllocator &Memory;
+    VkQueue GraphicQueue;
+    VkQueue PresentQueue;
+    uint32_t Families[ 2 ]; // graphics, present
+    VkExtent2D Requested;
+    PresentPolicy Policy;
+    VkFormat DepthFormat;
+    VkSurfaceFormatKHR SurfaceFormat{};
+    VkPresentModeKHR Mode{ VK_PRESENT_MODE_FIFO_KHR };
+    VkRenderPass Pass{ VK_NULL_HANDLE };
+    std::vector<FrameSlot> Slots;
+    uint32_t Slot{ 0 };
+    uint32_t Image{ 0 };
+    SwapchainGeneration Chain;
+    std::vector<SwapchainGeneration> Retired;
+    bool Stale{ false };
+    uint64_t Submitted{ 0 };
+    uint64_t Completed{ 0 }; // every frame up to this one has finished on the GPU
+    FrameLatency Times;
+    FrameLoopStatistics Statistics;
+    std::optional<GpuProfiler> Gpu;
+
+    // False while the surface has no area, e.g. a minimized window; the old swapchain is kept.
+    bool Rebuild()
+    {
+        PROFILE_ZONE( "create swapchain" );
+        VkSurfaceCapabilitiesKHR Capabilities{};
+        VkResult Result{ vkGetPhysicalDeviceSurfaceCapabilitiesKHR( PhysicalDevice, Surface, &Capabilities ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to get surface capabilities, error: {}", string_VkResult( Result ) ) );
+        VkExtent2D Extent{ Capabilities.currentExtent };
+        if( Extent.width == UINT32_MAX )
+            Extent = { std::clamp( Requested.width, Capabilities.minImageExtent.width, Capabilities.maxImageExtent.width ),
+                       std::clamp( Requested.height, Capabilities.minImageExtent.height, Capabilities.maxImageExtent.height ) };
+        if( !Extent.width || !Extent.height ) return false;
+        // One more than the minimum so acquire does not wait for the image being displayed.
+        uint32_t Images{ Capabilities.minImageCount + 1 };
+        if( Capabilities.maxImageCount ) Images = std::min( Images, Capabilities.maxImageCount );
+
+        VkSwapchainCreateInfoKHR SwapchainCreateInfo{};
+        SwapchainCreateInfo.sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        SwapchainCreateInfo.surface          = Surface;
+        SwapchainCreateInfo.minImageCount    = Images;
+        SwapchainCreateInfo.imageFormat      = SurfaceFormat.format;
+        SwapchainCreateInfo.imageColorSpace  = SurfaceFormat.colorSpace;
+        SwapchainCreateInfo.imageExtent      = Extent;
+        SwapchainCreateInfo.imageArrayLayers = 1;
+        SwapchainCreateInfo.imageUsage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        SwapchainCreateInfo.imageSharingMode = Families[ 0 ] == Families[ 1 ] ? VK_SHARING_MODE_EXCLUSIVE : VK_SHARING_MODE_CONCURRENT;
+        if( Families[ 0 ] != Families[ 1 ] )
+        {
+            SwapchainCreateInfo.queueFamilyIndexCount = 2;
+            SwapchainCreateInfo.pQueueFamilyIndices   = Families;
+        }
+        SwapchainCreateInfo.preTransform   = Capabilities.currentTransform;
+        SwapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        for( VkCompositeAlphaFlagBitsKHR Alpha : { VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR, VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR, VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR, VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR } )
+            if( Capabilities.supportedCompositeAlpha & Alpha )
+            {
+                SwapchainCreateInfo.compositeAlpha = Alpha;
+                break;
+            }
+        SwapchainCreateInfo.presentMode  = Mode;
+        SwapchainCreateInfo.clipped      = VK_TRUE;
+        SwapchainCreateInfo.oldSwapchain = Chain.Swapchain;
+        VkSwapchainKHR Swapchain{ VK_NULL_HANDLE };
+        Result = vkCreateSwapchainKHR( Device, &SwapchainCreateInfo, nullptr, &Swapchain );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create swapchain, error: {}", string_VkResult( Result ) ) );
+        // The old swapchain can no longer be acquired from, but frames using it may be in flight.
+        if( Chain.Swapchain )
+        {
+            Chain.RetiredAt = Submitted;
+            Retired.push_back( std::move( Chain ) );
+        }
+        Chain           = {};
+        Chain.Swapchain = Swapchain;
+        Chain.Extent    = Extent;
+
+        uint32_t Count{ 0 };
+        vkGetSwapchainImagesKHR( Device, Swapchain, &Count, nullptr );
+        std::vector<VkImage> SwapchainImages( Count );
+        vkGetSwapchainImagesKHR( Device, Swapchain, &Count, SwapchainImages.data() );
+        VkImageCreateInfo ImageCreateInfo{};
+        ImageCreateInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.format        = DepthFormat;
+        ImageCreateInfo.extent        = { Extent.width, Extent.height, 1 };
+        ImageCreateInfo.mipLevels     = 1;
+        ImageCreateInfo.arrayLayers   = 1;
+        ImageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        ImageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        ImageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        Chain.Depth                   = Memory.CreateImage( ImageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Chain.DepthMemory );
+        Chain.DepthView               = CreateView( Chain.Depth, DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT );
+        for( VkImage SwapchainImage : SwapchainImages )
+        {
+            Chain.Views.push_back( CreateView( SwapchainImage, SurfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT ) );
+            VkImageView Attachments[ 2 ]{ Chain.Views.back(), Chain.DepthView };
+            VkFramebufferCreateInfo FramebufferCreateInfo{};
+            FramebufferCreateInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            FramebufferCreateInfo.renderPass      = Pass;
+            FramebufferCreateInfo.attachmentCount = 2;
+            FramebufferCreateInfo.pAttachments    = Attachments;
+            FramebufferCreateInfo.width           = Extent.width;
+            FramebufferCreateInfo.height          = Extent.height;
+            FramebufferCreateInfo.layers          = 1;
+            VkFramebuffer Framebuffer{ VK_NULL_HANDLE };
+            Result = vkCreateFramebuffer( Device, &FramebufferCreateInfo, nullptr, &Framebuffer );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create swapchain framebuffer, error: {}", string_VkResult( Result ) ) );
+            Chain.Framebuffers.push_back( Framebuffer );
+            Chain.Rendered.push_back( CreateSemaphore() );
+        }
+        Stale = false;
+        Statistics.Recreations++;
+        return true;
+    }
+
+    // The queue runs submits in order, so once a frame submitted after a swapchain was
+    // replaced has finished, every frame that rendered to it has too.
+    void DestroyRetired()
+    {
+        std::erase_if( Retired, [ & ]( SwapchainGeneration &old )
+                       {
+                           if( Completed <= old.RetiredAt ) return false;
+                           Destroy( old );
+                           Statistics.Retired++;
+                           return true; } );
+    }
+
+    // Every handle the loop owns; ones never created are null and skipped.
+    void Release()
+    {
+        Gpu.reset();
+        for( auto &Old : Retired ) Destroy( Old );
+        Destroy( Chain );
+        for( auto &Each : Slots )
+        {
+            if( Each.Acquired ) vkDestroySemaphore( Device, Each.Acquired, nullptr );
+            if( Each.Done ) vkDestroyFence( Device, Each.Done, nullptr );
+            if( Each.Pool ) vkDestroyCommandPool( Device, Each.Pool, nullptr );
+        }
+        if( Pass ) vkDestroyRenderPass( Device, Pass, nullptr );
+    }
+
+    void Destroy( SwapchainGeneration &generation )
+    {
+        for( VkSemaphore Semaphore : generation.Rendered ) vkDestroySemaphore( Device, Semaphore, nullptr );
+        for( VkFramebuffer Framebuffer : generation.Framebuffers ) vkDestroyFramebuffer( Device, Framebuffer, nullptr );
+        for( VkImageView View : generation.Views ) vkDestroyImageView( Device, View, nullptr );
+        if( generation.DepthView ) vkDestroyImageView( Device, generation.DepthView, nullptr );
+        if( generation.Depth ) Memory.DestroyImage( generation.Depth, generation.DepthMemory );
+        if( generation.Swapchain ) vkDestroySwapchainKHR( Device, generation.Swapchain, nullptr );
+        generation = {};
+    }
+
+    VkSemaphore CreateSemaphore()
+    {
+        VkSemaphoreCreateInfo SemaphoreCreateInfo{};
+        SemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore Semaphore{ VK_NULL_HANDLE };
+        VkResult Result{ vkCreateSemaphore( Device, &SemaphoreCreateInfo, nullptr, &Semaphore ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create frame semaphore, error: {}", string_VkResult( Result ) ) );
+        return Semaphore;
+    }
+
+    VkImageView CreateView( VkImage image, VkFormat format, VkImageAspectFlags aspect )
+    {
+        VkImageViewCreateInfo ImageViewCreateInfo{};
+        ImageViewCreateInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ImageViewCreateInfo.image            = image;
+        ImageViewCreateInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+        ImageViewCreateInfo.format           = format;
+        ImageViewCreateInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+        VkImageView View{ VK_NULL_HANDLE };
+        VkResult Result{ vkCreateImageView( Device, &ImageViewCreateInfo, nullptr, &View ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create swapchain image view, error: {}", string_VkResult( Result ) ) );
+        return View;
+    }
+
+    // Color is cleared and ends ready to present; depth is cleared and thrown away. The depth
+    // image is shared by the frames in flight, so each one's depth writes wait for the last.
+    void CreateRenderPass()
+    {
+        VkAttachmentDescription Attachments[ 2 ]{};
+        Attachments[ 0 ].format         = SurfaceFormat.format;
+        Attachments[ 0 ].samples        = VK_SAMPLE_COUNT_1_BIT;
+        Attachments[ 0 ].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        Attachments[ 0 ].storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        Attachments[ 0 ].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        Attachments[ 0 ].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        Attachments[ 0 ].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        Attachments[ 0 ].finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        Attachments[ 1 ]                = Attachments[ 0 ];
+        Attachments[ 1 ].format         = DepthFormat;
+        Attachments[ 1 ].storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        Attachments[ 1 ].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference ColorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference DepthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        VkSubpassDescription Subpass{};
+        Subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        Subpass.colorAttachmentCount    = 1;
+        Subpass.pColorAttachments       = &ColorReference;
+        Subpass.pDepthStencilAttachment = &DepthReference;
+
+        // The layout transition of the acquired image waits for the acquire semaphore's stage.
+        VkSubpassDependency Dependency{};
+        Dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
+        Dependency.dstSubpass    = 0;
+        Dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        Dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        Dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        VkRenderPassCreateInfo RenderPassCreateInfo{};
+        RenderPassCreateInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        RenderPassCreateInfo.attachmentCount = 2;
+        RenderPassCreateInfo.pAttachments    = Attachments;
+        RenderPassCreateInfo.subpassCount    = 1;
+        RenderPassCreateInfo.pSubpasses      = &Subpass;
+        RenderPassCreateInfo.dependencyCount = 1;
+        RenderPassCreateInfo.pDependencies   = &Dependency;
+        VkResult Result{ vkCreateRenderPass( Device, &RenderPassCreateInfo, nullptr, &Pass ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create window render pass, error: {}", string_VkResult( Result ) ) );
+    }
+};
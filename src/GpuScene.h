@@ -0,0 +1,242 @@
+#pragma once
+#include "vulkan.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "SceneTransforms.h"
+#include <span>
+#include <tuple>
+#include <numeric>
+#include <mutex>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+// Device local copy of a CachedMesh, with the bounding sphere of its vertices in model space.
+struct SceneMesh
+{
+    VkBuffer Vertecies{ VK_NULL_HANDLE };
+    VkBuffer Indices{ VK_NULL_HANDLE };
+    DeviceAllocation VerteciesMemory;
+    DeviceAllocation IndicesMemory;
+    std::vector<MeshLod> Lods;
+    glm::vec3 Center{ 0.f };
+    float Radius{ 0.f };
+};
+
+// Device local copy of a CachedTexture, every mip level included.
+struct SceneTexture
+{
+    VkImage Image{ VK_NULL_HANDLE };
+    VkImageView View{ VK_NULL_HANDLE };
+    DeviceAllocation Memory;
+};
+
+// What an instance draws; where it is lives at the same index of GpuScene::Transforms.
+struct SceneInstance
+{
+    uint32_t Mesh{ 0 };
+    uint32_t Texture{ 0 };
+};
+
+// Instances First to First + Count, all of one mesh and texture: one instanced draw.
+struct SceneBatch
+{
+    uint32_t Mesh{ 0 };
+    uint32_t Texture{ 0 };
+    uint32_t First{ 0 };
+    uint32_t Count{ 0 };
+};
+
+// Meshes and textures on the device and the instances placing them. The slots are sized up
+// front so several jobs can upload into them at once; uploads go through Uploads() and draws
+// wait on the value Flush returns. Where the device has descriptor indexing, and bindless is
+// asked for, each texture and vertex buffer also lands in a BindlessTable at its slot's index.
+// Instances and Transforms are parallel arrays; Group sorts both by mesh and texture and cuts
+// them into the batches a renderer draws, so it must run again after instances are added.
+class GpuScene
+{
+  public:
+    std::vector<SceneInstance> Instances;
+    SceneTransforms Transforms;
+
+    GpuScene( VulkanInstance &vulkan, size_t meshes, size_t textures, bool bindless = true ) : Vulkan{ vulkan }, SceneMeshes( meshes ), SceneTextures( textures )
+    {
+        if( bindless && Vulkan.DescriptorIndexing() )
+            Table.emplace( Vulkan.Device(), Vulkan.Properties().limits, Vulkan.Properties12(), Vulkan.Features().samplerAnisotropy, static_cast<uint32_t>( textures ), static_cast<uint32_t>( meshes ) );
+    }
+    GpuScene( const GpuScene & )            = delete;
+    GpuScene &operator=( const GpuScene & ) = delete;
+
+    ~GpuScene()
+    {
+        Vulkan.Uploads().Wait( Vulkan.Uploads().Flush() );
+        auto &Memory{ Vulkan.DeviceMemory() };
+        for( auto &Texture : SceneTextures )
+        {
+            if( Texture.View ) vkDestroyImageView( Vulkan.Device(), Texture.View, nullptr );
+            if( Texture.Image ) Memory.DestroyImage( Texture.Image, Texture.Memory );
+        }
+        for( auto &Mesh : SceneMeshes )
+        {
+            if( Mesh.Vertecies ) Memory.DestroyBuffer( Mesh.Vertecies, Mesh.VerteciesMemory );
+            if( Mesh.Indices ) Memory.DestroyBuffer( Mesh.Indices, Mesh.IndicesMemory );
+        }
+    }
+
+    void UploadMesh( size_t index, const CachedMesh &mesh )
+    {
+        PROFILE_ZONE( "upload mesh" );
+        SceneMesh &Target{ SceneMeshes[ index ] };
+        // Vulkan has no empty buffers; a mesh with nothing to draw gets neither buffers nor
+        // levels, and the renderers skip it.
+        if( mesh.Vertecies().empty() || mesh.Indices().empty() ) return;
+        glm::vec3 Min{ std::numeric_limits<float>::max() }, Max{ -std::numeric_limits<float>::max() };
+        for( const Vertex &Each : mesh.Vertecies() )
+        {
+            Min = glm::min( Min, Each.coordinate );
+            Max = glm::max( Max, Each.coordinate );
+        }
+        Target.Center = mesh.Vertecies().empty() ? glm::vec3{ 0.f } : ( Min + Max ) * 0.5f;
+        Target.Radius = 0.f;
+        for( const Vertex &Each : mesh.Vertecies() ) Target.Radius = std::max( Target.Radius, glm::length( Each.coordinate - Target.Center ) );
+        Target.Lods.assign( mesh.Lods().begin(), mesh.Lods().end() );
+
+        std::lock_guard Lock{ UploadsLock };
+        auto &Memory{ Vulkan.DeviceMemory() };
+        auto &Uploads{ Vulkan.Uploads() };
+        VkDeviceSize VerteciesSize{ mesh.Vertecies().size_bytes() }, IndicesSize{ mesh.Indices().size_bytes() };
+        VkBufferUsageFlags VerteciesUsage{ VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | ( Table ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0u ) };
+        Target.Vertecies = Memory.CreateBuffer( VerteciesSize, VerteciesUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, Target.VerteciesMemory );
+        Target.Indices   = Memory.CreateBuffer( IndicesSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, Target.IndicesMemory );
+        Uploads.UploadBuffer( Target.Vertecies, 0, mesh.Vertecies().data(), VerteciesSize );
+        Uploads.UploadBuffer( Target.Indices, 0, mesh.Indices().data(), IndicesSize );
+        if( Table ) Table->SetBuffer( static_cast<uint32_t>( index ), Target.Vertecies );
+    }
+
+    void UploadTexture( size_t index, const CachedTexture &texture )
+    {
+        PROFILE_ZONE( "upload texture" );
+        std::lock_guard Lock{ UploadsLock };
+        auto &Memory{ Vulkan.DeviceMemory() };
+        auto &Uploads{ Vulkan.Uploads() };
+        VkImageCreateInfo ImageCreateInfo{};
+        ImageCreateInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.format        = texture.Format();
+        ImageCreateInfo.extent        = { texture.Width(), texture.Height(), 1 };
+        ImageCreateInfo.mipLevels     = static_cast<uint32_t>( texture.Regions().size() );
+        ImageCreateInfo.arrayLayers   = 1;
+        ImageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        ImageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        ImageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        SceneTexture &Target{ SceneTextures[ index ] };
+        Target.Image = Memory.CreateImage( ImageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Target.Memory );
+        Uploads.UploadImage( Target.Image, ImageCreateInfo.mipLevels, texture.Regions(), texture.Data() );
+
+        VkImageViewCreateInfo ImageViewCreateInfo{};
+        ImageViewCreateInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ImageViewCreateInfo.image            = Target.Image;
+        ImageViewCreateInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+        ImageViewCreateInfo.format           = ImageCreateInfo.format;
+        ImageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, ImageCreateInfo.mipLevels, 0, 1 };
+        VkResult Result{ vkCreateImageView( Vulkan.Device(), &ImageViewCreateInfo, nullptr, &Target.View ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create texture view, error: {}", string_VkResult( Result ) ) );
+        if( Table ) Table->SetTexture( static_cast<uint32_t>( index ), Target.View );
+    }
+
+    // Submits every upload made so far; frames drawing the scene wait on Uploads().Semaphore()
+    // at the returned value, and must record Uploads().Acquire() once before their first draw.
+    uint64_t Flush()
+    {
+        Flushed = Vulkan.Uploads().Flush();
+        return Flushed;
+    }
+    uint64_t Uploaded() const
+    {
+        return Flushed;
+    }
+
+    std::span<const SceneMesh> Meshes() const
+    {
+        return SceneMeshes;
+    }
+    std::span<const SceneTexture> Textures() const
+    {
+        return SceneTextures;
+    }
+
+    // Null when the scene binds a descriptor set per texture.
+    const BindlessTable *Bindless() const
+    {
+        return Table ? &*Table : nullptr;
+    }
+
+    uint32_t AddInstance( uint32_t mesh, uint32_t texture, const glm::vec3 &translation, const glm::quat &rotation = glm::quat{ 1.f, 0.f, 0.f, 0.f },
+                          const glm::vec3 &scale = glm::vec3{ 1.f } )
+    {
+        Instances.push_back( { mesh, texture } );
+        return Transforms.Add( translation, rotation, scale );
+    }
+
+    // Stable, so instances of one batch keep the order they were added in.
+    void Group()
+    {
+        std::vector<uint32_t> Order( Instances.size() );
+        std::iota( Order.begin(), Order.end(), 0u );
+        std::stable_sort( Order.begin(), Order.end(), [ & ]( uint32_t a, uint32_t b )
+                          { return std::tie( Instances[ a ].Mesh, Instances[ a ].Texture ) < std::tie( Instances[ b ].Mesh, Instances[ b ].Texture ); } );
+        std::vector<SceneInstance> Sorted( Instances.size() );
+        for( size_t Index{ 0 }; Index < Order.size(); Index++ ) Sorted[ Index ] = Instances[ Order[ Index ] ];
+        Instances.swap( Sorted );
+        Transforms.Reorder( Order );
+
+        SceneBatches.clear();
+        for( uint32_t Index{ 0 }; Index < Instances.size(); Index++ )
+        {
+            const SceneInstance &Instance{ Instances[ Index ] };
+            if( SceneBatches.empty() || SceneBatches.back().Mesh != Instance.Mesh || SceneBatches.back().Texture != Instance.Texture )
+                SceneBatches.push_back( { Instance.Mesh, Instance.Texture, Index, 0 } );
+            SceneBatches.back().Count++;
+        }
+        GroupedCount = Instances.size();
+    }
+
+    // Empty until Group runs; a renderer throws when instances were added since.
+    std::span<const SceneBatch> Batches() const
+    {
+        return SceneBatches;
+    }
+    bool Grouped() const
+    {
+        return GroupedCount == Instances.size() && Transforms.Size() == Instances.size();
+    }
+
+    // Sphere around every instance, xyz the center and w the radius.
+    glm::vec4 Bounds() const
+    {
+        if( Instances.empty() ) return glm::vec4{ 0.f };
+        glm::vec3 Min{ std::numeric_limits<float>::max() }, Max{ -std::numeric_limits<float>::max() };
+        for( uint32_t Index{ 0 }; Index < Instances.size(); Index++ )
+        {
+            const SceneMesh &Mesh{ SceneMeshes[ Instances[ Index ].Mesh ] };
+            glm::vec3 Scale{ Transforms.Scale( Index ) };
+            glm::vec3 Center{ Transforms.Translation( Index ) + Transforms.Rotation( Index ) * ( Scale * Mesh.Center ) };
+            float Radius{ Mesh.Radius * std::max( { std::abs( Scale.x ), std::abs( Scale.y ), std::abs( Scale.z ) } ) };
+            Min = glm::min( Min, Center - Radius );
+            Max = glm::max( Max, Center + Radius );
+        }
+        return glm::vec4{ ( Min + Max ) * 0.5f, glm::length( Max - Min ) * 0.5f };
+    }
+
+  private:
+    VulkanInstance &Vulkan;
+    std::vector<SceneMesh> SceneMeshes;
+    std::vector<SceneTexture> SceneTextures;
+    std::optional<BindlessTable> Table;
+    std::vector<SceneBatch> SceneBatches;
+    size_t GroupedCount{ 0 };
+    std::mutex UploadsLock; // DeviceMemory and UploadQueue are used by one job at a time
+    uint64_t Flushed{ 0 };
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// XXH64 over raw bytes.
+inline uint64_t Hash64( const void *data, size_t size, uint64_t seed = 0 )
+{
+    constexpr uint64_t P1{ 11400714785074694791ull };
+    constexpr uint64_t P2{ 14029467366897019727ull };
+    constexpr uint64_t P3{ 1609587929392839161ull };
+    constexpr uint64_t P4{ 9650029242287828579ull };
+    constexpr uint64_t P5{ 2870177450012600261ull };
+    auto Rotl{ []( uint64_t x, int r )
+               { return ( x << r ) | ( x >> ( 64 - r ) ); } };
+    auto Read64{ []( const uint8_t *p )
+                 { uint64_t v; memcpy( &v, p, 8 ); return v; } };
+    auto Read32{ []( const uint8_t *p )
+                 { uint32_t v; memcpy( &v, p, 4 ); return v; } };
+    auto Round{ [ & ]( uint64_t acc, uint64_t input )
+                { return Rotl( acc + input * P2, 31 ) * P1; } };
+    auto MergeRound{ [ & ]( uint64_t acc, uint64_t value )
+                     { return ( acc ^ Round( 0, value ) ) * P1 + P4; } };
+
+    const uint8_t *p{ static_cast<const uint8_t *>( data ) };
+    const uint8_t *End{ p + size };
+    uint64_t h;
+    if( size >= 32 )
+    {
+        uint64_t v1{ seed + P1 + P2 }, v2{ seed + P2 }, v3{ seed }, v4{ seed - P1 };
+        for( ; p + 32 <= End; p += 32 )
+        {
+            v1 = Round( v1, Read64( p ) );
+            v2 = Round( v2, Read64( p + 8 ) );
+            v3 = Round( v3, Read64( p + 16 ) );
+            v4 = Round( v4, Read64( p + 24 ) );
+        }
+        h = Rotl( v1, 1 ) + Rotl( v2, 7 ) + Rotl( v3, 12 ) + Rotl( v4, 18 );
+        h = MergeRound( h, v1 );
+        h = MergeRound( h, v2 );
+        h = MergeRound( h, v3 );
+        h = MergeRound( h, v4 );
+    }
+    else
+        h = seed + P5;
+    h += size;
+    for( ; p + 8 <= End; p += 8 )
+        h = Rotl( h ^ Round( 0, Read64( p ) ), 27 ) * P1 + P4;
+    if( p + 4 <= End )
+    {
+        h = Rotl( h ^ ( Read32( p ) * P1 ), 23 ) * P2 + P3;
+        p += 4;
+    }
+    for( ; p < End; p++ )
+        h = Rotl( h ^ ( *p * P5 ), 11 ) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,327 @@
+#pragma once
+#include "vulkan.h"
+#include "Profiler.h"
+#include <span>
+#include <format>
+#include <vector>
+
+// The depth attachment a pyramid is built from, left in DEPTH_STENCIL_READ_ONLY_OPTIMAL by the
+// render pass that drew it.
+struct DepthSource
+{
+    VkImageView View;
+    VkExtent2D Extent;
+};
+
+struct HiZPushConstants
+{
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Reduce;
+};
+
+// Texels of a side of size at level, rounded down as Vulkan sizes mip levels.
+inline uint32_t LevelSize( uint32_t size, uint32_t level )
+{
+    return std::max( size >> level, 1u );
+}
+
+struct HiZStatistics
+{
+    uint32_t Builds{ 0 };
+    uint32_t Captures{ 0 }; // builds that also copied level 0 out
+};
+
+// A farthest-depth mip chain of a depth attachment, built by hiz.comp a level per dispatch.
+// Level 0 is the depth at full size, each further level half the one below rounded down, as
+// Vulkan sizes mips, down to a single texel. The last texel of a level also covers the row or
+// column an odd side below leaves over, so a box of n texels at level 0 falls on at most 2x2
+// texels of level ceil(log2 n) once clamped to its size. The image stays in GENERAL, written
+// as storage and read by texelFetch. With
+// Capture on, level 0 is also copied to a host buffer, for checking culling on the CPU.
+class HiZPyramid
+{
+  public:
+    HiZPyramid( VulkanInstance &vulkan, const DepthSource &depth, const char *shader, const AssetPack *pack = nullptr ) : Vulkan{ vulkan }, PyramidExtent{ depth.Extent }
+    {
+        VkDevice Device{ Vulkan.Device() };
+        uint32_t Longest{ std::max( { PyramidExtent.width, PyramidExtent.height, 1u } ) };
+        while( Longest >> LevelsCount ) LevelsCount++; // floor(log2 Longest) + 1
+
+        try
+        {
+            VkImageCreateInfo ImageCreateInfo{};
+            ImageCreateInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            ImageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+            ImageCreateInfo.format        = VK_FORMAT_R32_SFLOAT;
+            ImageCreateInfo.extent        = { PyramidExtent.width, PyramidExtent.height, 1 };
+            ImageCreateInfo.mipLevels     = LevelsCount;
+            ImageCreateInfo.arrayLayers   = 1;
+            ImageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+            ImageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+            ImageCreateInfo.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            ImageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+            ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            Image                         = Vulkan.DeviceMemory().CreateImage( ImageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ImageMemory );
+            Whole                         = CreateView( 0, LevelsCount );
+            for( uint32_t Level{ 0 }; Level < LevelsCount; Level++ ) Views.push_back( CreateView( Level, 1 ) );
+
+            // texelFetch ignores filtering; the sampler only has to exist.
+            VkSamplerCreateInfo SamplerCreateInfo{};
+            SamplerCreateInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+            SamplerCreateInfo.magFilter    = VK_FILTER_NEAREST;
+            SamplerCreateInfo.minFilter    = VK_FILTER_NEAREST;
+            SamplerCreateInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            SamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            SamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            SamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            SamplerCreateInfo.maxLod       = VK_LOD_CLAMP_NONE;
+            VkResult Result{ vkCreateSampler( Device, &SamplerCreateInfo, nullptr, &PointSampler ) };
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create depth pyramid sampler, error: {}", string_VkResult( Result ) ) );
+
+            VkDescriptorSetLayoutBinding Bindings[ 2 ]{ { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+                                                        { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr } };
+            VkDescriptorSetLayoutCreateInfo DescriptorSetLayoutCreateInfo{};
+            DescriptorSetLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            DescriptorSetLayoutCreateInfo.bindingCount = 2;
+            DescriptorSetLayoutCreateInfo.pBindings    = Bindings;
+            Result                                     = vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayout );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create depth pyramid descriptor set layout, error: {}", string_VkResult( Result ) ) );
+
+            VkPushConstantRange PushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( HiZPushConstants ) };
+            VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo{};
+            PipelineLayoutCreateInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            PipelineLayoutCreateInfo.setLayoutCount         = 1;
+            PipelineLayoutCreateInfo.pSetLayouts            = &SetLayout;
+            PipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+            PipelineLayoutCreateInfo.pPushConstantRanges    = &PushConstantRange;
+            Result                                          = vkCreatePipelineLayout( Device, &PipelineLayoutCreateInfo, nullptr, &Layout );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create depth pyramid pipeline layout, error: {}", string_VkResult( Result ) ) );
+
+            VkShaderModule Module{ CreateShaderModule( Device, shader, pack ) };
+            VkComputePipelineCreateInfo ComputePipelineCreateInfo{};
+            ComputePipelineCreateInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            ComputePipelineCreateInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            ComputePipelineCreateInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+            ComputePipelineCreateInfo.stage.module = Module;
+            ComputePipelineCreateInfo.stage.pName  = "main";
+            ComputePipelineCreateInfo.layout       = Layout;
+            try
+            {
+                Vulkan.PipelineCompiler().CreateComputePipelines( { &ComputePipelineCreateInfo, 1 }, &Pipeline );
+            }
+            catch( ... )
+            {
+                vkDestroyShaderModule( Device, Module, nullptr );
+                throw;
+            }
+            vkDestroyShaderModule( Device, Module, nullptr );
+
+            VkDescriptorPoolSize PoolSizes[ 2 ]{ { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, LevelsCount }, { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, LevelsCount } };
+            VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo{};
+            DescriptorPoolCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            DescriptorPoolCreateInfo.maxSets       = LevelsCount;
+            DescriptorPoolCreateInfo.poolSizeCount = 2;
+            DescriptorPoolCreateInfo.pPoolSizes    = PoolSizes;
+            Result                                 = vkCreateDescriptorPool( Device, &DescriptorPoolCreateInfo, nullptr, &DescriptorPool );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create depth pyramid descriptor pool, error: {}", string_VkResult( Result ) ) );
+            std::vector<VkDescriptorSetLayout> Layouts( LevelsCount, SetLayout );
+            Sets.resize( LevelsCount );
+            VkDescriptorSetAllocateInfo DescriptorSetAllocateInfo{};
+            DescriptorSetAllocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            DescriptorSetAllocateInfo.descriptorPool     = DescriptorPool;
+            DescriptorSetAllocateInfo.descriptorSetCount = LevelsCount;
+            DescriptorSetAllocateInfo.pSetLayouts        = Layouts.data();
+            Result                                       = vkAllocateDescriptorSets( Device, &DescriptorSetAllocateInfo, Sets.data() );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate depth pyramid descriptor sets, error: {}", string_VkResult( Result ) ) );
+
+            // Each level reads the one below it, level 0 the depth attachment.
+            std::vector<VkDescriptorImageInfo> ImageInfos;
+            std::vector<VkWriteDescriptorSet> Writes;
+            ImageInfos.reserve( size_t( LevelsCount ) * 2 );
+            for( uint32_t Level{ 0 }; Level < LevelsCount; Level++ )
+            {
+                ImageInfos.push_back( Level ? VkDescriptorImageInfo{ PointSampler, Views[ Level - 1 ], VK_IMAGE_LAYOUT_GENERAL }
+                                            : VkDescriptorImageInfo{ PointSampler, depth.View, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL } );
+                ImageInfos.push_back( { VK_NULL_HANDLE, Views[ Level ], VK_IMAGE_LAYOUT_GENERAL } );
+                for( uint32_t Binding{ 0 }; Binding < 2; Binding++ )
+                {
+                    VkWriteDescriptorSet Write{};
+                    Write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    Write.dstSet          = Sets[ Level ];
+                    Write.dstBinding      = Binding;
+                    Write.descriptorCount = 1;
+                    Write.descriptorType  = Binding ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                    Write.pImageInfo      = &ImageInfos[ size_t( Level ) * 2 + Binding ];
+                    Writes.push_back( Write );
+                }
+            }
+            vkUpdateDescriptorSets( Device, static_cast<uint32_t>( Writes.size() ), Writes.data(), 0, nullptr );
+        }
+        catch( ... )
+        {
+            Destroy();
+            throw;
+        }
+    }
+    HiZPyramid( const HiZPyramid & )            = delete;
+    HiZPyramid &operator=( const HiZPyramid & ) = delete;
+
+    ~HiZPyramid()
+    {
+        Destroy();
+    }
+
+    // Every level, for texelFetch with an explicit level; GENERAL once built.
+    VkImageView View() const
+    {
+        return Whole;
+    }
+    VkSampler Sampler() const
+    {
+        return PointSampler;
+    }
+    uint32_t Levels() const
+    {
+        return LevelsCount;
+    }
+    VkExtent2D Extent() const
+    {
+        return PyramidExtent;
+    }
+    HiZStatistics Stat() const
+    {
+        return Statistics;
+    }
+
+    // Whether the following builds copy level 0 out for Depth.
+    void Capture( bool capture )
+    {
+        if( capture && !Readback )
+        {
+            Readback = Vulkan.DeviceMemory().CreateBuffer( VkDeviceSize( PyramidExtent.width ) * PyramidExtent.height * sizeof( float ), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, ReadbackMemory );
+            if( !ReadbackMemory.Mapped ) throw std::runtime_error( "Depth pyramid readback memory is not mapped." );
+        }
+        Capturing = capture;
+    }
+
+    // Rows of level 0 as of the last completed build with Capture on; empty before any.
+    std::span<const float> Depth() const
+    {
+        if( !Readback || !Statistics.Captures ) return {};
+        return { static_cast<const float *>( ReadbackMemory.Mapped ), size_t( PyramidExtent.width ) * PyramidExtent.height };
+    }
+
+    // Outside a render pass, after the depth attachment was written and before anything reads
+    // the pyramid; leaves every level readable by compute shaders.
+    void Build( VkCommandBuffer commandBuffer )
+    {
+        PROFILE_ZONE( "build depth pyramid" );
+        // The whole chain is rewritten, so the last frame's contents are dropped.
+        VkImageMemoryBarrier Barrier{};
+        Barrier.sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        Barrier.srcAccessMask               = 0;
+        Barrier.dstAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+        Barrier.oldLayout                   = VK_IMAGE_LAYOUT_UNDEFINED;
+        Barrier.newLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+        Barrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+        Barrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+        Barrier.image                       = Image;
+        Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        Barrier.subresourceRange.levelCount = LevelsCount;
+        Barrier.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier );
+
+        vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline );
+        Barrier.srcAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+        Barrier.dstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+        Barrier.oldLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+        Barrier.subresourceRange.levelCount = 1;
+        for( uint32_t Level{ 0 }; Level < LevelsCount; Level++ )
+        {
+            HiZPushConstants Constants{ LevelSize( PyramidExtent.width, Level ), LevelSize( PyramidExtent.height, Level ), Level ? 1u : 0u };
+            vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Layout, 0, 1, &Sets[ Level ], 0, nullptr );
+            vkCmdPushConstants( commandBuffer, Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( Constants ), &Constants );
+            vkCmdDispatch( commandBuffer, ( Constants.Width + 7 ) / 8, ( Constants.Height + 7 ) / 8, 1 );
+            Barrier.subresourceRange.baseMipLevel = Level;
+            vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier );
+        }
+        Statistics.Builds++;
+        if( !Capturing ) return;
+
+        Barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+        Barrier.subresourceRange.baseMipLevel = 0;
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier );
+        VkBufferImageCopy Copy{};
+        Copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        Copy.imageExtent      = { PyramidExtent.width, PyramidExtent.height, 1 };
+        vkCmdCopyImageToBuffer( commandBuffer, Image, VK_IMAGE_LAYOUT_GENERAL, Readback, 1, &Copy );
+        VkBufferMemoryBarrier Copied{};
+        Copied.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        Copied.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        Copied.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+        Copied.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        Copied.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        Copied.buffer              = Readback;
+        Copied.size                = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &Copied, 0, nullptr );
+        Statistics.Captures++;
+    }
+
+  private:
+    VulkanInstance &Vulkan;
+    VkExtent2D PyramidExtent;
+    uint32_t LevelsCount{ 1 };
+    VkImage Image{ VK_NULL_HANDLE };
+    DeviceAllocation ImageMemory;
+    VkImageView Whole{ VK_NULL_HANDLE };
+    std::vector<VkImageView> Views; // one per level, the storage images
+    VkSampler PointSampler{ VK_NULL_HANDLE };
+    VkDescriptorSetLayout SetLayout{ VK_NULL_HANDLE };
+    VkPipelineLayout Layout{ VK_NULL_HANDLE };
+    VkPipeline Pipeline{ VK_NULL_HANDLE };
+    VkDescriptorPool DescriptorPool{ VK_NULL_HANDLE };
+    std::vector<VkDescriptorSet> Sets; // one per level
+    VkBuffer Readback{ VK_NULL_HANDLE };
+    DeviceAllocation ReadbackMemory;
+    bool Capturing{ false };
+    HiZStatistics Statistics;
+
+    VkImageView CreateView( uint32_t level, uint32_t levels )
+    {
+        VkImageViewCreateInfo ImageViewCreateInfo{};
+        ImageViewCreateInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ImageViewCreateInfo.image            = Image;
+        ImageViewCreateInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+        ImageViewCreateInfo.format           = VK_FORMAT_R32_SFLOAT;
+        ImageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, levels, 0, 1 };
+        VkImageView View;
+        VkResult Result{ vkCreateImageView( Vulkan.Device(), &ImageViewCreateInfo, nullptr, &View ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create depth pyramid view, error: {}", string_VkResult( Result ) ) );
+        return View;
+    }
+
+    void Destroy()
+    {
+        VkDevice Device{ Vulkan.Device() };
+        if( Readback ) Vulkan.DeviceMemory().DestroyBuffer( Readback, ReadbackMemory );
+        if( DescriptorPool ) vkDestroyDescriptorPool( Device, DescriptorPool, nullptr );
+        if( Pipeline ) vkDestroyPipeline( Device, Pipeline, nullptr );
+        if( Layout ) vkDestroyPipelineLayout( Device, Layout, nullptr );
+        if( SetLayout ) vkDestroyDescriptorSetLayout( Device, SetLayout, nullptr );
+        if( PointSampler ) vkDestroySampler( Device, PointSampler, nullptr );
+        for( VkImageView Each : Views ) vkDestroyImageView( Device, Each, nullptr );
+        if( Whole ) vkDestroyImageView( Device, Whole, nullptr );
+        if( Image ) Vulkan.DeviceMemory().DestroyImage( Image, ImageMemory );
+        Readback       = VK_NULL_HANDLE;
+        DescriptorPool = VK_NULL_HANDLE;
+        Pipeline       = VK_NULL_HANDLE;
+        Layout         = VK_NULL_HANDLE;
+        SetLayout      = VK_NULL_HANDLE;
+        PointSampler   = VK_NULL_HANDLE;
+        Views.clear();
+        Whole = VK_NULL_HANDLE;
+        Image = VK_NULL_HANDLE;
+    }
+};
@@ -0,0 +1,546 @@
+#pragma once
+#include "GpuScene.h"
+#include "MeshletCulling.h"
+#include "HiZPyramid.h"
+#include <span>
+#include <vector>
+#include <cstring>
+
+// How the instances of a scene reach the GPU: instanced draws straight from the CPU, or culled
+// by cull.comp into indirect commands, drawn with vkCmdDrawIndexedIndirectCount or, without it,
+// a multi-draw over every slot of a batch where culled instances have instanceCount 0.
+enum class CullingMode
+{
+    Off,
+    IndirectCount,
+    MultiDrawIndirect
+};
+
+inline const char *CullingModeName( CullingMode mode )
+{
+    switch( mode )
+    {
+        case CullingMode::Off:
+            return "off";
+        case CullingMode::IndirectCount:
+            return "indirect-count";
+        case CullingMode::MultiDrawIndirect:
+            return "multi-draw-indirect";
+    }
+    return "unknown";
+}
+
+inline bool ParseCullingMode( const char *name, CullingMode &mode )
+{
+    for( CullingMode Each : { CullingMode::Off, CullingMode::IndirectCount, CullingMode::MultiDrawIndirect } )
+        if( !strcmp( name, CullingModeName( Each ) ) )
+        {
+            mode = Each;
+            return true;
+        }
+    return false;
+}
+
+// The commands name their instance through firstInstance, which indirect draws only honour
+// with drawIndirectFirstInstance.
+inline bool IndirectCullingSupported( const VkPhysicalDeviceFeatures &features )
+{
+    return features.drawIndirectFirstInstance;
+}
+
+// cull.comp's buffers, std430.
+struct CullObject
+{
+    glm::vec4 Sphere; // model space, w the radius
+    uint32_t Batch;
+    uint32_t Padding[ 3 ];
+};
+
+struct CullBatch
+{
+    uint32_t IndexCount;
+    uint32_t FirstIndex;
+    int32_t VertexOffset;
+    uint32_t First;
+};
+
+struct CullPushConstants
+{
+    glm::vec4 Planes[ 6 ];
+    uint32_t Objects;
+    uint32_t Compact;
+};
+
+// occlusion.comp's; the frustum planes come from ViewProj on the GPU.
+struct OcclusionPushConstants
+{
+    glm::mat4 ViewProj;
+    uint32_t Objects;
+    uint32_t Batches;
+    uint32_t Compact;
+    uint32_t Late;
+    uint32_t Width; // of the pyramid's level 0
+    uint32_t Height;
+    uint32_t Levels;
+};
+
+// What occlusion.comp counted over a frame's two phases.
+struct OcclusionCounters
+{
+    uint32_t Tested{ 0 };   // in the frustum, so tested against the pyramid
+    uint32_t Occluded{ 0 }; // of those, behind it
+    uint32_t DrawnEarly{ 0 };
+    uint32_t DrawnLate{ 0 };
+};
+
+static_assert( sizeof( CullObject ) == 32 && sizeof( CullBatch ) == 16 && sizeof( CullPushConstants ) <= 128 && sizeof( OcclusionPushConstants ) <= 128 );
+
+// The CPU reference of cull.comp, from the same matrices: per instance the least distance of its
+// world space sphere inside a frustum plane, visible when not negative. Values near 0 may land
+// either way on the GPU.
+inline std::vector<float> CullReference( const GpuScene &scene, const CullView &view )
+{
+    std::vector<float> Margins( scene.Instances.size() );
+    for( uint32_t Index{ 0 }; Index < Margins.size(); Index++ )
+    {
+        const SceneMesh &Mesh{ scene.Meshes()[ scene.Instances[ Index ].Mesh ] };
+        glm::mat4 Model{ scene.Transforms.Matrix( Index ) };
+        glm::vec3 Center{ Model * glm::vec4{ Mesh.Center, 1.f } };
+        float Radius{ Mesh.Radius * std::sqrt( std::max( { glm::dot( glm::vec3{ Model[ 0 ] }, glm::vec3{ Model[ 0 ] } ), glm::dot( glm::vec3{ Model[ 1 ] }, glm::vec3{ Model[ 1 ] } ),
+                                                           glm::dot( glm::vec3{ Model[ 2 ] }, glm::vec3{ Model[ 2 ] } ) } ) ) };
+        float Margin{ std::numeric_limits<float>::max() };
+        for( const auto &Plane : view.Planes ) Margin = std::min( Margin, Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w + Radius );
+        Margins[ Index ] = Margin;
+    }
+    return Margins;
+}
+
+// The brute force reference of occlusion.comp's late phase, against the full size depth it
+// builds its pyramid from: per instance the nearest depth of the box around its world space
+// sphere less the farthest depth of every pixel centre inside that box on screen. Occluded when
+// positive; the pyramid only ever sees farther depths, so the GPU may keep an instance this
+// finds occluded but must not cull one it finds visible. Boxes reaching in front of the near
+// plane are -infinity, never occluded, and boxes covering no pixel centre +infinity.
+inline std::vector<float> OcclusionReference( const GpuScene &scene, const glm::mat4 &viewProj, std::span<const float> depth, VkExtent2D extent )
+{
+    std::vector<float> Margins( scene.Instances.size() );
+    for( uint32_t Index{ 0 }; Index < Margins.size(); Index++ )
+    {
+        const SceneMesh &Mesh{ scene.Meshes()[ scene.Instances[ Index ].Mesh ] };
+        glm::mat4 Model{ scene.Transforms.Matrix( Index ) };
+        glm::vec3 Center{ Model * glm::vec4{ Mesh.Center, 1.f } };
+        float Radius{ Mesh.Radius * std::sqrt( std::max( { glm::dot( glm::vec3{ Model[ 0 ] }, glm::vec3{ Model[ 0 ] } ), glm::dot( glm::vec3{ Model[ 1 ] }, glm::vec3{ Model[ 1 ] } ),
+                                                           glm::dot( glm::vec3{ Model[ 2 ] }, glm::vec3{ Model[ 2 ] } ) } ) ) };
+        glm::vec2 Low{ 1.f }, High{ -1.f };
+        float Nearest{ 1.f };
+        bool Near{ false };
+        for( uint32_t Corner{ 0 }; Corner < 8; Corner++ )
+        {
+            glm::vec3 Offset{ Corner & 1 ? Radius : -Radius, Corner & 2 ? Radius : -Radius, Corner & 4 ? Radius : -Radius };
+            glm::vec4 Clip{ viewProj * glm::vec4{ Center + Offset, 1.f } };
+            if( Clip.z < 0.f ) Near = true;
+            glm::vec3 Ndc{ glm::vec3{ Clip } / Clip.w };
+            Low     = glm::min( Low, glm::vec2{ Ndc } );
+            High    = glm::max( High, glm::vec2{ Ndc } );
+            Nearest = std::min( Nearest, Ndc.z );
+        }
+        if( Near )
+        {
+            Margins[ Index ] = -std::numeric_limits<float>::infinity();
+            continue;
+        }
+        float Farthest{ -std::numeric_limits<float>::infinity() };
+        glm::vec2 Size{ float( extent.width ), float( extent.height ) };
+        glm::vec2 First{ glm::max( glm::ceil( ( Low * 0.5f + 0.5f ) * Size - 0.5f ), glm::vec2{ 0.f } ) };
+        glm::vec2 Last{ glm::min( glm::floor( ( High * 0.5f + 0.5f ) * Size - 0.5f ), Size - 1.f ) };
+        for( float y{ First.y }; y <= Last.y; y++ )
+            for( float x{ First.x }; x <= Last.x; x++ ) Farthest = std::max( Farthest, depth[ size_t( y ) * extent.width + size_t( x ) ] );
+        Margins[ Index ] = Farthest == -std::numeric_limits<float>::infinity() ? std::numeric_limits<float>::infinity() : Nearest - Farthest;
+    }
+    return Margins;
+}
+
+struct CullingStatistics
+{
+    uint32_t Dispatches{ 0 };
+    uint32_t Rebuilds{ 0 }; // buffers sized again after the scene changed
+};
+
+// Frustum culling of every instance of a GpuScene on the GPU, writing the indirect commands
+// SceneRenderer draws its batches with. Objects and batches, static while the scene is, sit in
+// host visible buffers; commands, counts and visibility have a region per frame in flight. The
+// matrices are the renderer's, read from its ring through a dynamic offset. Counts and
+// visibility stay mapped, readable once the frame's submission completed.
+//
+// Given a HiZPyramid, shader is occlusion.comp and every frame is culled twice, early and late,
+// with commands and counts for each phase; the visibility then carries over to the next frame
+// of the same frame in flight, and OcclusionCounters are kept per frame.
+class IndirectCuller
+{
+  public:
+    IndirectCuller( VulkanInstance &vulkan, const GpuScene &scene, CullingMode mode, uint32_t frames, const char *shader, const HiZPyramid *pyramid = nullptr,
+                    const AssetPack *pack = nullptr )
+        : Vulkan{ vulkan }, Scene{ scene }, Frames{ std::max( frames, 1u ) }, Pyramid{ pyramid }, Phases{ pyramid ? 2u : 1u }
+    {
+        const VkPhysicalDeviceFeatures &Features{ Vulkan.Features() };
+        bool CountSupported{ Vulkan.Features12().drawIndirectCount && Features.multiDrawIndirect };
+        Selected       = mode == CullingMode::IndirectCount && !CountSupported ? CullingMode::MultiDrawIndirect : mode;
+        MaxDrawCount   = Features.multiDrawIndirect ? std::max( Vulkan.Properties().limits.maxDrawIndirectCount, 1u ) : 1u;
+        Alignment      = std::max<VkDeviceSize>( Vulkan.Properties().limits.minStorageBufferOffsetAlignment, 4 );
+        VkDevice Device{ Vulkan.Device() };
+
+        // Bindings 0 to 5 as in cull.comp; occlusion.comp adds the pyramid and its counters.
+        VkDescriptorSetLayoutBinding Bindings[ 8 ]{};
+        for( uint32_t Binding{ 0 }; Binding < BindingsCount(); Binding++ )
+            Bindings[ Binding ] = { Binding, BindingType( Binding ), 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+        VkDescriptorSetLayoutCreateInfo DescriptorSetLayoutCreateInfo{};
+        DescriptorSetLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        DescriptorSetLayoutCreateInfo.bindingCount = BindingsCount();
+        DescriptorSetLayoutCreateInfo.pBindings    = Bindings;
+        VkResult Result{ vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayout ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create culling descriptor set layout, error: {}", string_VkResult( Result ) ) );
+
+        VkPushConstantRange PushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, Pyramid ? uint32_t( sizeof( OcclusionPushConstants ) ) : uint32_t( sizeof( CullPushConstants ) ) };
+        VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo{};
+        PipelineLayoutCreateInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        PipelineLayoutCreateInfo.setLayoutCount         = 1;
+        PipelineLayoutCreateInfo.pSetLayouts            = &SetLayout;
+        PipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        PipelineLayoutCreateInfo.pPushConstantRanges    = &PushConstantRange;
+        Result                                          = vkCreatePipelineLayout( Device, &PipelineLayoutCreateInfo, nullptr, &Layout );
+        if( Result != VK_SUCCESS )
+        {
+            Destroy();
+            throw std::runtime_error( std::format( "Failed to create culling pipeline layout, error: {}", string_VkResult( Result ) ) );
+        }
+
+        try
+        {
+            VkShaderModule Module{ CreateShaderModule( Device, shader, pack ) };
+            VkComputePipelineCreateInfo ComputePipelineCreateInfo{};
+            ComputePipelineCreateInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            ComputePipelineCreateInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            ComputePipelineCreateInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+            ComputePipelineCreateInfo.stage.module = Module;
+            ComputePipelineCreateInfo.stage.pName  = "main";
+            ComputePipelineCreateInfo.layout       = Layout;
+            try
+            {
+                Vulkan.PipelineCompiler().CreateComputePipelines( { &ComputePipelineCreateInfo, 1 }, &Pipeline );
+            }
+            catch( ... )
+            {
+                vkDestroyShaderModule( Device, Module, nullptr );
+                throw;
+            }
+            vkDestroyShaderModule( Device, Module, nullptr );
+
+            VkDescriptorPoolSize PoolSizes[ 3 ]{ { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, ( Pyramid ? 6 : 5 ) * Frames },
+                                                 { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, Frames },
+                                                 { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Frames } };
+            VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo{};
+            DescriptorPoolCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            DescriptorPoolCreateInfo.maxSets       = Frames;
+            DescriptorPoolCreateInfo.poolSizeCount = Pyramid ? 3 : 2;
+            DescriptorPoolCreateInfo.pPoolSizes    = PoolSizes;
+            Result                                 = vkCreateDescriptorPool( Device, &DescriptorPoolCreateInfo, nullptr, &DescriptorPool );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create culling descriptor pool, error: {}", string_VkResult( Result ) ) );
+            std::vector<VkDescriptorSetLayout> Layouts( Frames, SetLayout );
+            Sets.resize( Frames );
+            VkDescriptorSetAllocateInfo DescriptorSetAllocateInfo{};
+            DescriptorSetAllocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            DescriptorSetAllocateInfo.descriptorPool     = DescriptorPool;
+            DescriptorSetAllocateInfo.descriptorSetCount = Frames;
+            DescriptorSetAllocateInfo.pSetLayouts        = Layouts.data();
+            Result                                       = vkAllocateDescriptorSets( Device, &DescriptorSetAllocateInfo, Sets.data() );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate culling descriptor sets, error: {}", string_VkResult( Result ) ) );
+            Build();
+        }
+        catch( ... )
+        {
+            Destroy();
+            throw;
+        }
+    }
+    IndirectCuller( const IndirectCuller & )            = delete;
+    IndirectCuller &operator=( const IndirectCuller & ) = delete;
+
+    ~IndirectCuller()
+    {
+        Destroy();
+    }
+
+    // IndirectCount falls back to MultiDrawIndirect where the device has no draw count.
+    CullingMode Mode() const
+    {
+        return Selected;
+    }
+
+    CullingStatistics Stat() const
+    {
+        return Statistics;
+    }
+
+    // The buffer the world matrices are read from, range bytes from each dynamic offset; true
+    // when the descriptors had to be written.
+    bool Models( VkBuffer buffer, VkDeviceSize range )
+    {
+        if( buffer == ModelsBuffer && range == ModelsRange ) return false;
+        ModelsBuffer = buffer;
+        ModelsRange  = range;
+        WriteSets();
+        return true;
+    }
+
+    // Outside a render pass, after Models and before the draws of frame; models is the dynamic
+    // offset of this frame's matrices, aligned for storage buffers. With a pyramid, the early
+    // phase goes before the first render pass and the late one once the pyramid was built from
+    // the depth the early draws left.
+    void Dispatch( VkCommandBuffer commandBuffer, const glm::mat4 &view, const glm::mat4 &proj, VkDeviceSize models, uint32_t frame, bool late = false )
+    {
+        PROFILE_ZONE( "dispatch culling" );
+        if( !late && ( Scene.Instances.size() != ObjectsCount || Scene.Batches().size() != BatchesCount ) )
+        {
+            vkDeviceWaitIdle( Vulkan.Device() );
+            Release();
+            Build();
+            WriteSets();
+            Statistics.Rebuilds++;
+        }
+        if( !ObjectsCount ) return;
+        frame = std::min( frame, Frames - 1 );
+        if( !late )
+        {
+            // The last submission of this frame in flight is done drawing from its regions, and
+            // its visibility writes are seen by this one.
+            VkMemoryBarrier Previous{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+            vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                  &Previous, 0, nullptr, 0, nullptr );
+            if( Selected == CullingMode::IndirectCount ) vkCmdFillBuffer( commandBuffer, Counts, frame * CountsRegion, CountsRegion, 0 );
+            if( Pyramid ) vkCmdFillBuffer( commandBuffer, CountersBuffer, frame * CountersRegion, CountersRegion, 0 );
+            VkMemoryBarrier Cleared{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+            vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &Cleared, 0, nullptr, 0, nullptr );
+        }
+        uint32_t Offset{ static_cast<uint32_t>( models ) };
+        vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline );
+        vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Layout, 0, 1, &Sets[ frame ], 1, &Offset );
+        if( Pyramid )
+        {
+            OcclusionPushConstants Constants{ proj * view, static_cast<uint32_t>( ObjectsCount ), static_cast<uint32_t>( BatchesCount ), Selected == CullingMode::IndirectCount, late,
+                                              Pyramid->Extent().width, Pyramid->Extent().height, Pyramid->Levels() };
+            vkCmdPushConstants( commandBuffer, Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( Constants ), &Constants );
+        }
+        else
+        {
+            CullView View{ MakeCullView( { glm::mat4{ 1.f }, view, proj } ) };
+            CullPushConstants Constants{};
+            for( uint32_t Plane{ 0 }; Plane < 6; Plane++ ) Constants.Planes[ Plane ] = View.Planes[ Plane ];
+            Constants.Objects = static_cast<uint32_t>( ObjectsCount );
+            Constants.Compact = Selected == CullingMode::IndirectCount;
+            vkCmdPushConstants( commandBuffer, Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( Constants ), &Constants );
+        }
+        vkCmdDispatch( commandBuffer, static_cast<uint32_t>( ( ObjectsCount + 63 ) / 64 ), 1, 1 );
+        // The late phase adds to the early one's counters.
+        bool Again{ Pyramid && !late };
+        VkMemoryBarrier Culled{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT,
+                                VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT | ( Again ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT : 0u ) };
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT | ( Again ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0u ),
+                              0, 1, &Culled, 0, nullptr, 0, nullptr );
+        Statistics.Dispatches++;
+    }
+
+    // The draws of batch index of the scene, its mesh and texture already bound, from the early
+    // or late phase's commands; returns how many draw calls that took. Any thread, one command
+    // buffer each.
+    uint32_t Draw( VkCommandBuffer commandBuffer, uint32_t index, uint32_t frame, bool late = false )
+    {
+        const SceneBatch &Batch{ Scene.Batches()[ index ] };
+        frame = std::min( frame, Frames - 1 );
+        VkDeviceSize First{ frame * CommandsRegion + VkDeviceSize( ( late ? ObjectsCount : 0 ) + Batch.First ) * sizeof( VkDrawIndexedIndirectCommand ) };
+        uint32_t Calls{ 0 };
+        if( Selected == CullingMode::IndirectCount )
+        {
+            vkCmdDrawIndexedIndirectCount( commandBuffer, Commands, First, Counts, frame * CountsRegion + ( ( late ? BatchesCount : 0 ) + index ) * sizeof( uint32_t ), std::min( Batch.Count, MaxDrawCount ),
+                                           sizeof( VkDrawIndexedIndirectCommand ) );
+            Calls = 1;
+        }
+        else
+            for( uint32_t Drawn{ 0 }; Drawn < Batch.Count; Drawn += MaxDrawCount, Calls++ )
+                vkCmdDrawIndexedIndirect( commandBuffer, Commands, First + VkDeviceSize( Drawn ) * sizeof( VkDrawIndexedIndirectCommand ), std::min( Batch.Count - Drawn, MaxDrawCount ),
+                                          sizeof( VkDrawIndexedIndirectCommand ) );
+        return Calls;
+    }
+
+    // Per instance 1 when cull.comp, or occlusion.comp's late phase, found it visible, as of the
+    // last completed submission of frame.
+    std::span<const uint32_t> Visibility( uint32_t frame ) const
+    {
+        const uint8_t *Mapped{ static_cast<const uint8_t *>( VisibilityMemory.Mapped ) + std::min( frame, Frames - 1 ) * VisibilityRegion };
+        return { reinterpret_cast<const uint32_t *>( Mapped ), ObjectsCount };
+    }
+
+    // Instances drawn, the same way; the count buffer sums to it, the visibility flags in the
+    // fallback, or the counters with a pyramid, whose early draws may since have been occluded.
+    uint32_t Visible( uint32_t frame ) const
+    {
+        uint32_t Result{ 0 };
+        if( Selected == CullingMode::IndirectCount )
+        {
+            const uint8_t *Mapped{ static_cast<const uint8_t *>( CountsMemory.Mapped ) + std::min( frame, Frames - 1 ) * CountsRegion };
+            for( uint32_t Count : std::span{ reinterpret_cast<const uint32_t *>( Mapped ), BatchesCount * Phases } ) Result += Count;
+        }
+        else if( Pyramid )
+        {
+            OcclusionCounters Counted{ Counters( frame ) };
+            Result = Counted.DrawnEarly + Counted.DrawnLate;
+        }
+        else
+            for( uint32_t Flag : Visibility( frame ) ) Result += Flag;
+        return Result;
+    }
+
+    // occlusion.comp's counters, the same way; zero without a pyramid.
+    OcclusionCounters Counters( uint32_t frame ) const
+    {
+        OcclusionCounters Result;
+        if( CountersMemory.Mapped ) memcpy( &Result, static_cast<const uint8_t *>( CountersMemory.Mapped ) + std::min( frame, Frames - 1 ) * CountersRegion, sizeof( Result ) );
+        return Result;
+    }
+
+    // Culled early and late against a pyramid.
+    bool Occlusion() const
+    {
+        return Pyramid;
+    }
+
+  private:
+    VulkanInstance &Vulkan;
+    const GpuScene &Scene;
+    uint32_t Frames;
+    const HiZPyramid *Pyramid;
+    uint32_t Phases; // early and late with a pyramid
+    CullingMode Selected;
+    uint32_t MaxDrawCount{ 1 };
+    VkDeviceSize Alignment{ 4 };
+    VkDescriptorSetLayout SetLayout{ VK_NULL_HANDLE };
+    VkPipelineLayout Layout{ VK_NULL_HANDLE };
+    VkPipeline Pipeline{ VK_NULL_HANDLE };
+    VkDescriptorPool DescriptorPool{ VK_NULL_HANDLE };
+    std::vector<VkDescriptorSet> Sets; // one per frame in flight
+    VkBuffer ModelsBuffer{ VK_NULL_HANDLE };
+    VkDeviceSize ModelsRange{ 0 };
+    size_t ObjectsCount{ 0 }, BatchesCount{ 0 };
+    VkBuffer Objects{ VK_NULL_HANDLE }, Batches{ VK_NULL_HANDLE }, Commands{ VK_NULL_HANDLE }, Counts{ VK_NULL_HANDLE }, VisibilityFlags{ VK_NULL_HANDLE }, CountersBuffer{ VK_NULL_HANDLE };
+    DeviceAllocation ObjectsMemory, BatchesMemory, CommandsMemory, CountsMemory, VisibilityMemory, CountersMemory;
+    VkDeviceSize CommandsRegion{ 0 }, CountsRegion{ 0 }, VisibilityRegion{ 0 }, CountersRegion{ 0 }; // bytes per frame
+    CullingStatistics Statistics;
+
+    VkDeviceSize Align( VkDeviceSize size ) const
+    {
+        return ( std::max<VkDeviceSize>( size, 4 ) + Alignment - 1 ) / Alignment * Alignment;
+    }
+
+    uint32_t BindingsCount() const
+    {
+        return Pyramid ? 8 : 6;
+    }
+
+    VkDescriptorType BindingType( uint32_t binding ) const
+    {
+        return binding == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : binding == 6 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+
+    // Sizes every buffer for the scene as it is now and fills objects and batches.
+    void Build()
+    {
+        auto &Memory{ Vulkan.DeviceMemory() };
+        const VkMemoryPropertyFlags Host{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+        ObjectsCount     = Scene.Instances.size();
+        BatchesCount     = Scene.Batches().size();
+        CommandsRegion   = Align( Phases * ObjectsCount * sizeof( VkDrawIndexedIndirectCommand ) );
+        CountsRegion     = Align( Phases * BatchesCount * sizeof( uint32_t ) );
+        VisibilityRegion = Align( ObjectsCount * sizeof( uint32_t ) );
+        CountersRegion   = Align( sizeof( OcclusionCounters ) );
+        Objects          = Memory.CreateBuffer( Align( ObjectsCount * sizeof( CullObject ) ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, Host, 0, ObjectsMemory );
+        Batches          = Memory.CreateBuffer( Align( BatchesCount * sizeof( CullBatch ) ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, Host, 0, BatchesMemory );
+        Commands         = Memory.CreateBuffer( CommandsRegion * Frames, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, CommandsMemory );
+        Counts           = Memory.CreateBuffer( CountsRegion * Frames, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, Host, 0, CountsMemory );
+        VisibilityFlags  = Memory.CreateBuffer( VisibilityRegion * Frames, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, Host, 0, VisibilityMemory );
+        if( Pyramid ) CountersBuffer = Memory.CreateBuffer( CountersRegion * Frames, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, Host, 0, CountersMemory );
+        if( !ObjectsMemory.Mapped || !BatchesMemory.Mapped || !CountsMemory.Mapped || !VisibilityMemory.Mapped || ( Pyramid && !CountersMemory.Mapped ) )
+            throw std::runtime_error( "Culling buffers are not mapped." );
+
+        auto *Object{ static_cast<CullObject *>( ObjectsMemory.Mapped ) };
+        auto *Batch{ static_cast<CullBatch *>( BatchesMemory.Mapped ) };
+        for( uint32_t Index{ 0 }; Index < BatchesCount; Index++ )
+        {
+            const SceneBatch &Each{ Scene.Batches()[ Index ] };
+            const SceneMesh &Mesh{ Scene.Meshes()[ Each.Mesh ] };
+            Batch[ Index ] = Mesh.Lods.empty() ? CullBatch{ 0, 0, 0, Each.First }
+                                               : CullBatch{ Mesh.Lods.front().IndicesCount, Mesh.Lods.front().IndeciesOffset, static_cast<int32_t>( Mesh.Lods.front().VerteciesOffset ), Each.First };
+            for( uint32_t Instance{ Each.First }; Instance < Each.First + Each.Count; Instance++ ) Object[ Instance ] = { glm::vec4{ Mesh.Center, Mesh.Radius }, Index, {} };
+        }
+        memset( VisibilityMemory.Mapped, 0, VisibilityRegion * Frames );
+        memset( CountsMemory.Mapped, 0, CountsRegion * Frames );
+        if( Pyramid ) memset( CountersMemory.Mapped, 0, CountersRegion * Frames );
+    }
+
+    void WriteSets()
+    {
+        if( !ModelsBuffer ) return;
+        std::vector<VkDescriptorBufferInfo> BufferInfos;
+        std::vector<VkWriteDescriptorSet> Writes;
+        BufferInfos.reserve( size_t( Frames ) * 8 );
+        VkDescriptorImageInfo PyramidInfo{ Pyramid ? Pyramid->Sampler() : VK_NULL_HANDLE, Pyramid ? Pyramid->View() : VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL };
+        for( uint32_t Frame{ 0 }; Frame < Frames; Frame++ )
+        {
+            BufferInfos.push_back( { Objects, 0, VK_WHOLE_SIZE } );
+            BufferInfos.push_back( { Batches, 0, VK_WHOLE_SIZE } );
+            BufferInfos.push_back( { ModelsBuffer, 0, ModelsRange } );
+            BufferInfos.push_back( { Commands, Frame * CommandsRegion, CommandsRegion } );
+            BufferInfos.push_back( { Counts, Frame * CountsRegion, CountsRegion } );
+            BufferInfos.push_back( { VisibilityFlags, Frame * VisibilityRegion, VisibilityRegion } );
+            BufferInfos.push_back( {} );
+            BufferInfos.push_back( { CountersBuffer, Frame * CountersRegion, CountersRegion } );
+            for( uint32_t Binding{ 0 }; Binding < BindingsCount(); Binding++ )
+            {
+                VkWriteDescriptorSet Write{};
+                Write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                Write.dstSet          = Sets[ Frame ];
+                Write.dstBinding      = Binding;
+                Write.descriptorCount = 1;
+                Write.descriptorType  = BindingType( Binding );
+                if( Binding == 6 ) Write.pImageInfo = &PyramidInfo;
+                else Write.pBufferInfo = &BufferInfos[ size_t( Frame ) * 8 + Binding ];
+                Writes.push_back( Write );
+            }
+        }
+        vkUpdateDescriptorSets( Vulkan.Device(), static_cast<uint32_t>( Writes.size() ), Writes.data(), 0, nullptr );
+    }
+
+    void Release()
+    {
+        auto &Memory{ Vulkan.DeviceMemory() };
+        if( Objects ) Memory.DestroyBuffer( Objects, ObjectsMemory );
+        if( Batches ) Memory.DestroyBuffer( Batches, BatchesMemory );
+        if( Commands ) Memory.DestroyBuffer( Commands, CommandsMemory );
+        if( Counts ) Memory.DestroyBuffer( Counts, CountsMemory );
+        if( VisibilityFlags ) Memory.DestroyBuffer( VisibilityFlags, VisibilityMemory );
+        if( CountersBuffer ) Memory.DestroyBuffer( CountersBuffer, CountersMemory );
+        Objects = Batches = Commands = Counts = VisibilityFlags = CountersBuffer = VK_NULL_HANDLE;
+    }
+
+    void Destroy()
+    {
+        VkDevice Device{ Vulkan.Device() };
+        Release();
+        if( DescriptorPool ) vkDestroyDescriptorPool( Device, DescriptorPool, nullptr );
+        if( Pipeline ) vkDestroyPipeline( Device, Pipeline, nullptr );
+        if( Layout ) vkDestroyPipelineLayout( Device, Layout, nullptr );
+        if( SetLayout ) vkDestroyDescriptorSetLayout( Device, SetLayout, nullptr );
+        DescriptorPool = VK_NULL_HANDLE;
+        Pipeline       = VK_NULL_HANDLE;
+        Layout         = VK_NULL_HANDLE;
+        SetLayout      = VK_NULL_HANDLE;
+    }
+};
@@ -0,0 +1,283 @@
+#pragma once
+#include "Timeline.h"
+#include "Profiler.h"
+#include <span>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+// Work-stealing job system. Every worker owns a deque: it pushes and pops its own jobs at the
+// back, so freshly spawned work stays hot in its cache, while idle workers steal the oldest
+// jobs from the front of the others. A job runs once all of its dependencies have finished;
+// the one finishing last pushes it, so nothing polls. An exception thrown by a job is kept
+// and rethrown by Wait, and the jobs depending on it are skipped with the same error.
+
+struct JobState
+{
+    std::string Name;
+    std::function<void()> Work;
+    std::vector<std::shared_ptr<JobState>> Dependencies;
+    std::atomic<uint32_t> Pending{ 1 }; // unfinished dependencies, plus one held by Submit
+    std::mutex Lock;                    // guards Finished and Continuations
+    bool Finished{ false };
+    std::vector<std::shared_ptr<JobState>> Continuations;
+    std::atomic<bool> Done{ false };
+    std::exception_ptr Error;
+};
+
+using Job = std::shared_ptr<JobState>;
+
+struct JobStatistics
+{
+    uint64_t Jobs{ 0 };
+    uint64_t Steals{ 0 };
+};
+
+class JobSystem
+{
+  public:
+    // threads workers besides the caller, which runs jobs only while it waits.
+    JobSystem( uint32_t threads = DefaultThreads(), Timeline *timeline = nullptr ) : Queues( threads ), Lanes{ timeline }
+    {
+        Workers.reserve( threads );
+        for( uint32_t Index{ 0 }; Index < threads; Index++ )
+            Workers.emplace_back( [ this, Index ]
+                                  { Run( Index ); } );
+    }
+    JobSystem( const JobSystem & )            = delete;
+    JobSystem &operator=( const JobSystem & ) = delete;
+    // Jobs still queued are dropped; the ones running are finished first.
+    ~JobSystem()
+    {
+        {
+            std::lock_guard Lock{ SleepLock };
+            Stopping = true;
+        }
+        Wake.notify_all();
+        for( auto &Worker : Workers ) Worker.join();
+    }
+
+    static uint32_t DefaultThreads()
+    {
+        return std::max( 2u, std::thread::hardware_concurrency() ) - 1;
+    }
+
+    Job Submit( std::string name, std::function<void()> work, std::span<const Job> dependencies = {} )
+    {
+        Job Result{ std::make_shared<JobState>() };
+        Result->Name = std::move( name );
+        Result->Work = std::move( work );
+        Result->Dependencies.assign( dependencies.begin(), dependencies.end() );
+        Result->Pending += static_cast<uint32_t>( dependencies.size() );
+        for( const Job &Dependency : dependencies )
+        {
+            std::unique_lock Lock{ Dependency->Lock };
+            if( Dependency->Finished )
+            {
+                Lock.unlock();
+                Result->Pending--;
+            }
+            else
+                Dependency->Continuations.push_back( Result );
+        }
+        if( !--Result->Pending ) Push( Result );
+        return Result;
+    }
+    Job Submit( std::string name, std::function<void()> work, std::initializer_list<Job> dependencies )
+    {
+        return Submit( std::move( name ), std::move( work ), std::span<const Job>{ dependencies.begin(), dependencies.size() } );
+    }
+
+    // Runs other jobs while job is pending, so waiting from inside a job cannot deadlock.
+    void Wait( const Job &job )
+    {
+        while( !job->Done.load( std::memory_order_acquire ) )
+        {
+            if( Job Next{ Take( CurrentWorker() ) } )
+            {
+                Execute( Next );
+                continue;
+            }
+            std::unique_lock Lock{ SleepLock };
+            Waiters++;
+            Wake.wait( Lock, [ & ]
+                       { return job->Done.load( std::memory_order_acquire ) || Queued.load() > 0; } );
+            Waiters--;
+        }
+        if( job->Error ) std::rethrow_exception( job->Error );
+    }
+    void Wait( std::span<const Job> jobs )
+    {
+        for( const Job &Each : jobs ) Wait( Each );
+    }
+
+    uint32_t Threads() const
+    {
+        return static_cast<uint32_t>( Workers.size() );
+    }
+
+    // Workers asleep with nothing queued, for jobs that spread over threads of their own.
+    uint32_t Idle() const
+    {
+        return Sleeping.load();
+    }
+
+    JobStatistics Stat() const
+    {
+        return { Executed.load(), Steals.load() };
+    }
+
+    // Worker index of the calling thread within this system, or UINT32_MAX.
+    uint32_t CurrentWorker() const
+    {
+        return ThisSystem() == this ? ThisWorker() : UINT32_MAX;
+    }
+
+  private:
+    struct Queue
+    {
+        std::mutex Lock;
+        std::deque<Job> Jobs;
+    };
+
+    std::vector<Queue> Queues;
+    std::vector<std::thread> Workers;
+    Timeline *Lanes;
+    std::mutex SleepLock;
+    std::condition_variable Wake;
+    bool Stopping{ false };
+    uint32_t Waiters{ 0 }; // guarded by SleepLock
+    std::atomic<uint32_t> Queued{ 0 };
+    std::atomic<uint32_t> Sleeping{ 0 };
+    std::atomic<uint32_t> NextQueue{ 0 };
+    std::atomic<uint64_t> Executed{ 0 };
+    std::atomic<uint64_t> Steals{ 0 };
+
+    static const JobSystem *&ThisSystem()
+    {
+        static thread_local const JobSystem *System{ nullptr };
+        return System;
+    }
+    static uint32_t &ThisWorker()
+    {
+        static thread_local uint32_t Worker{ UINT32_MAX };
+        return Worker;
+    }
+
+    // Workers keep their own work local; other threads spread it round robin.
+    void Push( const Job &job )
+    {
+        if( Queues.empty() )
+        {
+            Execute( job );
+            return;
+        }
+        uint32_t Worker{ CurrentWorker() };
+        uint32_t Index{ Worker != UINT32_MAX ? Worker : NextQueue++ % static_cast<uint32_t>( Queues.size() ) };
+        {
+            std::lock_guard Lock{ Queues[ Index ].Lock };
+            Queues[ Index ].Jobs.push_back( job );
+        }
+        Queued++;
+        std::lock_guard Lock{ SleepLock };
+        if( Waiters ) Wake.notify_all();
+        else Wake.notify_one();
+    }
+
+    Job Take( uint32_t worker )
+    {
+        if( !Queued.load() ) return nullptr;
+        const uint32_t Count{ static_cast<uint32_t>( Queues.size() ) };
+        if( worker != UINT32_MAX )
+        {
+            std::lock_guard Lock{ Queues[ worker ].Lock };
+            if( !Queues[ worker ].Jobs.empty() )
+            {
+                Job Result{ std::move( Queues[ worker ].Jobs.back() ) };
+                Queues[ worker ].Jobs.pop_back();
+                Queued--;
+                return Result;
+            }
+        }
+        uint32_t First{ worker != UINT32_MAX ? worker + 1 : NextQueue.load() };
+        for( uint32_t Offset{ 0 }; Offset < Count; Offset++ )
+        {
+            uint32_t Victim{ ( First + Offset ) % Count };
+            if( Victim == worker ) continue;
+            std::lock_guard Lock{ Queues[ Victim ].Lock };
+            if( Queues[ Victim ].Jobs.empty() ) continue;
+            Job Result{ std::move( Queues[ Victim ].Jobs.front() ) };
+            Queues[ Victim ].Jobs.pop_front();
+            Queued--;
+            if( worker != UINT32_MAX ) Steals++;
+            return Result;
+        }
+        return nullptr;
+    }
+
+    void Execute( const Job &job )
+    {
+        for( const Job &Dependency : job->Dependencies )
+            if( Dependency->Error )
+            {
+                job->Error = Dependency->Error;
+                break;
+            }
+        job->Dependencies.clear();
+        if( !job->Error )
+        {
+            auto Begin{ Timeline::Clock::now() };
+            try
+            {
+                job->Work();
+            }
+            catch( ... )
+            {
+                job->Error = std::current_exception();
+            }
+            uint32_t Worker{ CurrentWorker() };
+            if( Lanes ) Lanes->Record( job->Name, Worker == UINT32_MAX ? 0 : Worker + 1, Begin, Timeline::Clock::now() );
+        }
+        job->Work = nullptr;
+        Executed++;
+
+        std::vector<Job> Ready;
+        {
+            std::lock_guard Lock{ job->Lock };
+            job->Finished = true;
+            Ready.swap( job->Continuations );
+        }
+        job->Done.store( true, std::memory_order_release );
+        for( const Job &Continuation : Ready )
+            if( !--Continuation->Pending ) Push( Continuation );
+        std::lock_guard Lock{ SleepLock };
+        if( Waiters ) Wake.notify_all();
+    }
+
+    void Run( uint32_t worker )
+    {
+        ThisSystem() = this;
+        ThisWorker() = worker;
+        PROFILE_THREAD( std::format( "worker {}", worker ) );
+        while( true )
+        {
+            if( Job Next{ Take( worker ) } )
+            {
+                Execute( Next );
+                continue;
+            }
+            std::unique_lock Lock{ SleepLock };
+            Sleeping++;
+            Wake.wait( Lock, [ this ]
+                       { return Stopping || Queued.load() > 0; } );
+            Sleeping--;
+            if( Stopping ) return;
+        }
+    }
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+typedef void ( *LoggerCallback )( const char *data );
+
+struct LoggerCallbacks
+{
+    LoggerCallback trace;
+    LoggerCallback debug;
+    LoggerCallback info;
+    LoggerCallback warn;
+    LoggerCallback error;
+    LoggerCallback critical;
+};
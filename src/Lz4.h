@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+// LZ4 block format: sequences of a token, literals and a match against the last 64 KB. The
+// compressor is greedy with one hash table probe per position; it ends on at least five
+// literals with no match starting in the last twelve bytes, as every LZ4 decoder expects.
+inline size_t Lz4Bound( size_t size )
+{
+    return size + size / 255 + 16;
+}
+
+// destination holds at least Lz4Bound( size ) bytes; returns the compressed size.
+inline size_t Lz4Compress( const uint8_t *source, size_t size, uint8_t *destination )
+{
+    constexpr size_t LastLiterals{ 5 };
+    constexpr size_t MatchLimit{ 12 };
+    constexpr size_t MaxOffset{ 65535 };
+    std::vector<uint32_t> Table( 1 << 16, 0 ); // position + 1, 0 for none
+    auto Hash{ [ & ]( size_t position )
+               { uint32_t Value; memcpy( &Value, source + position, 4 ); return ( Value * 2654435761u ) >> 16; } };
+    uint8_t *Out{ destination };
+    auto Length{ [ & ]( size_t value )
+                 { for( ; value >= 255; value -= 255 ) *Out++ = 255; *Out++ = static_cast<uint8_t>( value ); } };
+    auto Literals{ [ & ]( uint8_t *token, size_t anchor, size_t count )
+                   {
+                       *token |= static_cast<uint8_t>( std::min<size_t>( count, 15 ) << 4 );
+                       if( count >= 15 ) Length( count - 15 );
+                       memcpy( Out, source + anchor, count );
+                       Out += count;
+                   } };
+
+    size_t Anchor{ 0 }, Position{ 0 };
+    while( Position + MatchLimit <= size )
+    {
+        uint32_t &Slot{ Table[ Hash( Position ) ] };
+        size_t Candidate{ Slot };
+        Slot = static_cast<uint32_t>( Position + 1 );
+        if( !Candidate-- || Position - Candidate > MaxOffset || memcmp( source + Candidate, source + Position, 4 ) )
+        {
+            Position++;
+            continue;
+        }
+        size_t Match{ 4 };
+        while( Position + Match < size - LastLiterals && source[ Candidate + Match ] == source[ Position + Match ] ) Match++;
+        uint8_t *Token{ Out++ };
+        *Token = static_cast<uint8_t>( std::min<size_t>( Match - 4, 15 ) );
+        Literals( Token, Anchor, Position - Anchor );
+        size_t Offset{ Position - Candidate };
+        *Out++ = static_cast<uint8_t>( Offset );
+        *Out++ = static_cast<uint8_t>( Offset >> 8 );
+        if( Match - 4 >= 15 ) Length( Match - 4 - 15 );
+        Position += Match;
+        Anchor = Position;
+    }
+    uint8_t *Token{ Out++ };
+    *Token = 0;
+    Literals( Token, Anchor, size - Anchor );
+    return static_cast<size_t>( Out - destination );
+}
+
+inline std::vector<uint8_t> Lz4Compress( const uint8_t *source, size_t size )
+{
+    std::vector<uint8_t> Compressed( Lz4Bound( size ) );
+    Compressed.resize( Lz4Compress( source, size, Compressed.data() ) );
+    return Compressed;
+}
+
+// False on malformed input or when the output is not exactly capacity bytes. Matches read
+// back what was written, so destination should be cached memory, not write-combined.
+inline bool Lz4Decompress( const uint8_t *source, size_t size, uint8_t *destination, size_t capacity )
+{
+    const uint8_t *In{ source }, *End{ source + size };
+    uint8_t *Out{ destination }, *Limit{ destination + capacity };
+    auto Length{ [ & ]( size_t &value )
+                 {
+                     uint8_t Byte;
+                     do
+                     {
+                         if( In == End ) return false;
+                         Byte = *In++;
+                         value += Byte;
+                     } while( Byte == 255 );
+                     return true;
+                 } };
+    while( In < End )
+    {
+        uint8_t Token{ *In++ };
+        size_t Literals{ size_t( Token >> 4 ) };
+        if( Literals == 15 && !Length( Literals ) ) return false;
+        if( size_t( End - In ) < Literals || size_t( Limit - Out ) < Literals ) return false;
+        memcpy( Out, In, Literals );
+        In += Literals;
+        Out += Literals;
+        if( In == End ) break; // the last sequence has no match
+        if( End - In < 2 ) return false;
+        size_t Offset{ size_t( In[ 0 ] ) | size_t( In[ 1 ] ) << 8 };
+        In += 2;
+        size_t Match{ size_t( Token & 15 ) };
+        if( Match == 15 && !Length( Match ) ) return false;
+        Match += 4;
+        if( !Offset || size_t( Out - destination ) < Offset || size_t( Limit - Out ) < Match ) return false;
+        const uint8_t *From{ Out - Offset };
+        if( Offset >= Match ) memcpy( Out, From, Match );
+        else
+            for( size_t Index{ 0 }; Index < Match; Index++ ) Out[ Index ] = From[ Index ];
+        Out += Match;
+    }
+    return Out == Limit;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <stdexcept>
+#if defined( _WIN32 )
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <unistd.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#endif
+
+// Every file MappedFile opened so far, for startup I/O reports.
+struct FileStatistics
+{
+    uint32_t Opens{ 0 };
+    uint64_t Bytes{ 0 };
+    double Milliseconds{ 0.0 }; // opening and mapping; the pages are read on first touch
+};
+
+// Read-only view of a whole file, mapped by the OS instead of read into heap memory.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    MappedFile( const char *path )
+    {
+        Open( path );
+    }
+    MappedFile( const MappedFile & )            = delete;
+    MappedFile &operator=( const MappedFile & ) = delete;
+    MappedFile( MappedFile &&other ) noexcept
+    {
+        *this = std::move( other );
+    }
+    MappedFile &operator=( MappedFile &&other ) noexcept
+    {
+        if( this != &other )
+        {
+            Close();
+            std::swap( Bytes, other.Bytes );
+            std::swap( Length, other.Length );
+#if defined( _WIN32 )
+            std::swap( File, other.File );
+            std::swap( Mapping, other.Mapping );
+#endif
+        }
+        return *this;
+    }
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    void Open( const char *path )
+    {
+        Close();
+        auto Start{ std::chrono::steady_clock::now() };
+#if defined( _WIN32 )
+        File = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+        if( File == INVALID_HANDLE_VALUE )
+            throw std::runtime_error( std::string{ "Failed to open file: " } + path );
+        LARGE_INTEGER FileSize{};
+        if( !GetFileSizeEx( File, &FileSize ) )
+            throw std::runtime_error( std::string{ "Failed to open file: " } + path );
+        Length = static_cast<size_t>( FileSize.QuadPart );
+        if( !Length ) return;
+        Mapping = CreateFileMappingA( File, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        if( !Mapping )
+            throw std::runtime_error( std::string{ "Failed to map file: " } + path );
+        Bytes = static_cast<const uint8_t *>( MapViewOfFile( Mapping, FILE_MAP_READ, 0, 0, 0 ) );
+        if( !Bytes )
+            throw std::runtime_error( std::string{ "Failed to map file: " } + path );
+#else
+        int Descriptor{ open( path, O_RDONLY ) };
+        if( Descriptor < 0 )
+            throw std::runtime_error( std::string{ "Failed to open file: " } + path );
+        struct stat Stat{};
+        if( fstat( Descriptor, &Stat ) )
+        {
+            close( Descriptor );
+            throw std::runtime_error( std::string{ "Failed to open file: " } + path );
+        }
+        Length = static_cast<size_t>( Stat.st_size );
+        if( Length )
+        {
+            void *View{ mmap( nullptr, Length, PROT_READ, MAP_PRIVATE, Descriptor, 0 ) };
+            if( View == MAP_FAILED )
+            {
+                close( Descriptor );
+                Length = 0;
+                throw std::runtime_error( std::string{ "Failed to map file: " } + path );
+            }
+            madvise( View, Length, MADV_SEQUENTIAL );
+            Bytes = static_cast<const uint8_t *>( View );
+        }
+        close( Descriptor );
+#endif
+        Opens++;
+        MappedBytes += Length;
+        OpenNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - Start ).count();
+    }
+
+    void Close()
+    {
+#if defined( _WIN32 )
+        if( Bytes ) UnmapViewOfFile( Bytes );
+        if( Mapping ) CloseHandle( Mapping );
+        if( File != INVALID_HANDLE_VALUE ) CloseHandle( File );
+        Mapping = nullptr;
+        File    = INVALID_HANDLE_VALUE;
+#else
+        if( Bytes ) munmap( const_cast<uint8_t *>( Bytes ), Length );
+#endif
+        Bytes  = nullptr;
+        Length = 0;
+    }
+
+    const uint8_t *Data() const
+    {
+        return Bytes;
+    }
+    size_t Size() const
+    {
+        return Length;
+    }
+    bool Empty() const
+    {
+        return !Length;
+    }
+
+    static FileStatistics Stat()
+    {
+        return { Opens.load(), MappedBytes.load(), OpenNanoseconds.load() / 1e6 };
+    }
+
+  private:
+    const uint8_t *Bytes{ nullptr };
+    size_t Length{ 0 };
+#if defined( _WIN32 )
+    HANDLE File{ INVALID_HANDLE_VALUE };
+    HANDLE Mapping{ nullptr };
+#endif
+    inline static std::atomic<uint32_t> Opens{ 0 };
+    inline static std::atomic<uint64_t> MappedBytes{ 0 };
+    inline static std::atomic<uint64_t> OpenNanoseconds{ 0 };
+};
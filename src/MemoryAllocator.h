@@ -0,0 +1,508 @@
+#pragma once
+#include <bit>
+#include <array>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// Offset-only allocators used to sub-allocate device memory blocks. Nothing here touches
+// Vulkan, so they can be exercised and benchmarked without a GPU.
+
+inline uint64_t AlignUp( uint64_t value, uint64_t alignment )
+{
+    return alignment > 1 ? ( value + alignment - 1 ) / alignment * alignment : value;
+}
+
+struct TlsfAllocation
+{
+    static constexpr uint32_t Invalid{ ~0u };
+    uint64_t Offset{ 0 };
+    uint64_t Size{ 0 };
+    uint32_t Node{ Invalid };
+
+    bool Valid() const
+    {
+        return Node != Invalid;
+    }
+};
+
+// Two-level segregated fit (Masmano et al. 2004): free ranges are binned by the position of
+// their top bit and the next SecondLevelBits bits, and two bitmaps find a bin whose every range
+// fits in O(1). Allocation and free touch a constant number of nodes, neighbouring free ranges
+// are merged on free.
+class TlsfAllocator
+{
+  public:
+    TlsfAllocator( uint64_t size = 0 )
+    {
+        Reset( size );
+    }
+
+    void Reset( uint64_t size )
+    {
+        Nodes.clear();
+        SpareNodes.clear();
+        FirstLevelMap = 0;
+        SecondLevelMap.fill( 0 );
+        for( auto &Level : Heads ) Level.fill( TlsfAllocation::Invalid );
+        Capacity = size;
+        UsedBytes = 0;
+        Count     = 0;
+        if( !size ) return;
+        uint32_t Node{ NewNode() };
+        Nodes[ Node ] = { 0, size, TlsfAllocation::Invalid, TlsfAllocation::Invalid, TlsfAllocation::Invalid, TlsfAllocation::Invalid, true };
+        InsertFree( Node );
+    }
+
+    // Invalid() when no free range can hold size bytes at the requested alignment.
+    TlsfAllocation Allocate( uint64_t size, uint64_t alignment = 1 )
+    {
+        size = std::max<uint64_t>( size, 1 );
+        uint64_t Search{ size + ( alignment > 1 ? alignment - 1 : 0 ) };
+        uint32_t Node{ FindFree( Search ) };
+        if( Node == TlsfAllocation::Invalid ) return {};
+        RemoveFree( Node );
+
+        uint64_t Padding{ AlignUp( Nodes[ Node ].Offset, alignment ) - Nodes[ Node ].Offset };
+        if( Padding )
+        {
+            // The physical predecessor is never free (it would have been merged), so the
+            // padding becomes a free range of its own.
+            uint32_t Front{ Split( Node, Padding ) };
+            std::swap( Node, Front );
+            InsertFree( Front );
+        }
+        if( Nodes[ Node ].Size - size >= MinSplit ) InsertFree( Split( Node, size ) );
+        Nodes[ Node ].Free = false;
+        UsedBytes += Nodes[ Node ].Size;
+        Count++;
+        return { Nodes[ Node ].Offset, Nodes[ Node ].Size, Node };
+    }
+
+    void Free( const TlsfAllocation &allocation )
+    {
+        uint32_t Node{ allocation.Node };
+        UsedBytes -= Nodes[ Node ].Size;
+        Count--;
+        Nodes[ Node ].Free = true;
+        uint32_t Previous{ Nodes[ Node ].PreviousPhysical };
+        if( Previous != TlsfAllocation::Invalid && Nodes[ Previous ].Free )
+        {
+            RemoveFree( Previous );
+            Merge( Previous, Node );
+            Node = Previous;
+        }
+        uint32_t Next{ Nodes[ Node ].NextPhysical };
+        if( Next != TlsfAllocation::Invalid && Nodes[ Next ].Free )
+        {
+            RemoveFree( Next );
+            Merge( Node, Next );
+        }
+        InsertFree( Node );
+    }
+
+    uint64_t Size() const
+    {
+        return Capacity;
+    }
+    uint64_t Used() const
+    {
+        return UsedBytes;
+    }
+    uint32_t Allocations() const
+    {
+        return Count;
+    }
+    bool Empty() const
+    {
+        return !Count;
+    }
+
+    // Walks every free range; meant for statistics, not the allocation path.
+    template <typename F>
+    void ForEachFree( F &&visit ) const
+    {
+        for( const auto &Level : Heads )
+            for( uint32_t Head : Level )
+                for( uint32_t Node{ Head }; Node != TlsfAllocation::Invalid; Node = Nodes[ Node ].NextFree ) visit( Nodes[ Node ].Offset, Nodes[ Node ].Size );
+    }
+
+  private:
+    static constexpr uint32_t SecondLevelBits{ 5 };
+    static constexpr uint32_t SecondLevels{ 1u << SecondLevelBits };
+    static constexpr uint32_t FirstLevels{ 64 - SecondLevelBits + 1 };
+    // Remainders smaller than this stay inside the allocation instead of becoming a range.
+    static constexpr uint64_t MinSplit{ 16 };
+
+    struct Node
+    {
+        uint64_t Offset;
+        uint64_t Size;
+        uint32_t PreviousPhysical, NextPhysical;
+        uint32_t PreviousFree, NextFree;
+        bool Free;
+    };
+
+    std::vector<Node> Nodes;
+    std::vector<uint32_t> SpareNodes;
+    uint64_t FirstLevelMap{ 0 };
+    std::array<uint32_t, FirstLevels> SecondLevelMap{};
+    std::array<std::array<uint32_t, SecondLevels>, FirstLevels> Heads{};
+    uint64_t Capacity{ 0 };
+    uint64_t UsedBytes{ 0 };
+    uint32_t Count{ 0 };
+
+    // Bin of a range of this size; sizes below SecondLevels share first level 0 at unit steps.
+    static void Mapping( uint64_t size, uint32_t &first, uint32_t &second )
+    {
+        if( size < SecondLevels )
+        {
+            first  = 0;
+            second = static_cast<uint32_t>( size );
+            return;
+        }
+        uint32_t Top{ static_cast<uint32_t>( std::bit_width( size ) - 1 ) };
+        first  = Top - SecondLevelBits + 1;
+        second = static_cast<uint32_t>( size >> ( Top - SecondLevelBits ) ) - SecondLevels;
+    }
+
+    uint32_t FindFree( uint64_t size ) const
+    {
+        // Round up to the next bin so any range found there fits.
+        if( size >= SecondLevels )
+        {
+            uint64_t Round{ ( uint64_t{ 1 } << ( std::bit_width( size ) - 1 - SecondLevelBits ) ) - 1 };
+            if( size > ~uint64_t{ 0 } - Round ) return TlsfAllocation::Invalid;
+            size += Round;
+        }
+        uint32_t First, Second;
+        Mapping( size, First, Second );
+        if( First >= FirstLevels ) return TlsfAllocation::Invalid;
+        uint32_t Map{ Second < 32 ? SecondLevelMap[ First ] & ( ~0u << Second ) : 0 };
+        if( !Map )
+        {
+            uint64_t Firsts{ First + 1 < 64 ? FirstLevelMap & ( ~uint64_t{ 0 } << ( First + 1 ) ) : 0 };
+            if( !Firsts ) return TlsfAllocation::Invalid;
+            First = static_cast<uint32_t>( std::countr_zero( Firsts ) );
+            Map   = SecondLevelMap[ First ];
+        }
+        return Heads[ First ][ std::countr_zero( Map ) ];
+    }
+
+    void InsertFree( uint32_t node )
+    {
+        uint32_t First, Second;
+        Mapping( Nodes[ node ].Size, First, Second );
+        uint32_t &Head{ Heads[ First ][ Second ] };
+        Nodes[ node ].Free         = true;
+        Nodes[ node ].PreviousFree = TlsfAllocation::Invalid;
+        Nodes[ node ].NextFree     = Head;
+        if( Head != TlsfAllocation::Invalid ) Nodes[ Head ].PreviousFree = node;
+        Head = node;
+        FirstLevelMap |= uint64_t{ 1 } << First;
+        SecondLevelMap[ First ] |= 1u << Second;
+    }
+
+    void RemoveFree( uint32_t node )
+    {
+        uint32_t First, Second;
+        Mapping( Nodes[ node ].Size, First, Second );
+        Node &Entry{ Nodes[ node ] };
+        if( Entry.PreviousFree != TlsfAllocation::Invalid )
+            Nodes[ Entry.PreviousFree ].NextFree = Entry.NextFree;
+        else
+            Heads[ First ][ Second ] = Entry.NextFree;
+        if( Entry.NextFree != TlsfAllocation::Invalid ) Nodes[ Entry.NextFree ].PreviousFree = Entry.PreviousFree;
+        if( Heads[ First ][ Second ] == TlsfAllocation::Invalid )
+        {
+            SecondLevelMap[ First ] &= ~( 1u << Second );
+            if( !SecondLevelMap[ First ] ) FirstLevelMap &= ~( uint64_t{ 1 } << First );
+        }
+    }
+
+    // Cuts node after size bytes and returns the new node holding the remainder.
+    uint32_t Split( uint32_t node, uint64_t size )
+    {
+        uint32_t Rest{ NewNode() };
+        Node &Entry{ Nodes[ node ] };
+        Nodes[ Rest ] = { Entry.Offset + size, Entry.Size - size, node, Entry.NextPhysical, TlsfAllocation::Invalid, TlsfAllocation::Invalid, false };
+        if( Entry.NextPhysical != TlsfAllocation::Invalid ) Nodes[ Entry.NextPhysical ].PreviousPhysical = Rest;
+        Entry.NextPhysical = Rest;
+        Entry.Size         = size;
+        return Rest;
+    }
+
+    // Absorbs next, the physical successor of node.
+    void Merge( uint32_t node, uint32_t next )
+    {
+        Nodes[ node ].Size += Nodes[ next ].Size;
+        Nodes[ node ].NextPhysical = Nodes[ next ].NextPhysical;
+        if( Nodes[ next ].NextPhysical != TlsfAllocation::Invalid ) Nodes[ Nodes[ next ].NextPhysical ].PreviousPhysical = node;
+        SpareNodes.push_back( next );
+    }
+
+    uint32_t NewNode()
+    {
+        if( !SpareNodes.empty() )
+        {
+            uint32_t Node{ SpareNodes.back() };
+            SpareNodes.pop_back();
+            return Node;
+        }
+        Nodes.emplace_back();
+        return static_cast<uint32_t>( Nodes.size() - 1 );
+    }
+};
+
+// Bump allocator for data that dies all at once, e.g. everything recorded for one frame.
+class LinearAllocator
+{
+  public:
+    static constexpr uint64_t Invalid{ ~uint64_t{ 0 } };
+
+    LinearAllocator( uint64_t size = 0 ) : Capacity{ size } {}
+
+    uint64_t Allocate( uint64_t size, uint64_t alignment = 1 )
+    {
+        uint64_t Offset{ AlignUp( Head, alignment ) };
+        if( Offset + size > Capacity ) return Invalid;
+        Head = Offset + size;
+        return Offset;
+    }
+
+    void Reset()
+    {
+        Head = 0;
+    }
+
+    uint64_t Size() const
+    {
+        return Capacity;
+    }
+    uint64_t Used() const
+    {
+        return Head;
+    }
+
+  private:
+    uint64_t Capacity;
+    uint64_t Head{ 0 };
+};
+
+// Ring for per-frame data with several frames in flight: FinishFrame() marks where the frame
+// ended, ReleaseFrame() hands back the oldest finished frame once the GPU is done with it.
+// Head and Tail only grow; the physical offset is their value modulo the size.
+class RingAllocator
+{
+  public:
+    static constexpr uint64_t Invalid{ ~uint64_t{ 0 } };
+
+    RingAllocator( uint64_t size = 0 ) : Capacity{ size } {}
+
+    // Allocations never straddle the end; the skipped tail counts as used until released.
+    uint64_t Allocate( uint64_t size, uint64_t alignment = 1 )
+    {
+        if( !Capacity ) return Invalid;
+        if( Head == Tail )
+        {
+            // Empty: restart at the physical beginning so the end cannot split a large request.
+            Head = Tail = AlignUp( Head, Capacity );
+            for( auto &Frame : Frames ) Frame = Head;
+        }
+        uint64_t Physical{ Head % Capacity };
+        uint64_t Offset{ AlignUp( Physical, alignment ) };
+        uint64_t Skip{ Offset - Physical };
+        if( Offset + size > Capacity )
+        {
+            Skip += Capacity - Offset;
+            Offset = 0;
+        }
+        if( Head + Skip + size - Tail > Capacity ) return Invalid;
+        Head += Skip + size;
+        return Offset;
+    }
+
+    void FinishFrame()
+    {
+        Frames.push_back( Head );
+    }
+
+    void ReleaseFrame()
+    {
+        if( Frames.empty() ) return;
+        Tail = Frames.front();
+        Frames.pop_front();
+    }
+
+    uint64_t Size() const
+    {
+        return Capacity;
+    }
+    uint64_t Used() const
+    {
+        return Head - Tail;
+    }
+    size_t FramesInFlight() const
+    {
+        return Frames.size();
+    }
+
+  private:
+    uint64_t Capacity;
+    uint64_t Head{ 0 };
+    uint64_t Tail{ 0 };
+    std::deque<uint64_t> Frames;
+};
+
+struct MemoryStatistics
+{
+    uint32_t Blocks{ 0 };
+    uint32_t Allocations{ 0 };
+    uint64_t Reserved{ 0 };
+    uint64_t Used{ 0 };
+    uint32_t FreeRanges{ 0 };
+    uint64_t LargestFreeRange{ 0 };
+
+    // 0 when all free memory is one range, close to 1 when it is scattered in small pieces.
+    float Fragmentation() const
+    {
+        uint64_t Free{ Reserved - Used };
+        return Free ? 1.f - static_cast<float>( LargestFreeRange ) / Free : 0.f;
+    }
+
+    MemoryStatistics &operator+=( const MemoryStatistics &other )
+    {
+        Blocks += other.Blocks;
+        Allocations += other.Allocations;
+        Reserved += other.Reserved;
+        Used += other.Used;
+        FreeRanges += other.FreeRanges;
+        LargestFreeRange = std::max( LargestFreeRange, other.LargestFreeRange );
+        return *this;
+    }
+};
+
+// What a compaction pass could achieve: blocks that could be emptied by moving their
+// allocations into free space elsewhere, and the bytes that would move. Ignores how that free
+// space is split, so it is an upper bound.
+struct DefragmentationStatistics
+{
+    uint32_t ReleasableBlocks{ 0 };
+    uint64_t BytesToMove{ 0 };
+};
+
+struct PoolAllocation
+{
+    static constexpr uint32_t Invalid{ ~0u };
+    uint32_t Block{ Invalid };
+    TlsfAllocation Range;
+
+    bool Valid() const
+    {
+        return Block != Invalid;
+    }
+};
+
+// A growing set of equally sized TLSF blocks. The pool only hands out block ids; whoever owns
+// it creates the backing memory when Allocate fails and calls AddBlock. At most one empty
+// block is kept around, Free reports any further one so its memory can be released.
+class MemoryPool
+{
+  public:
+    MemoryPool( uint64_t blockSize = 0 ) : BlockSize{ blockSize } {}
+
+    PoolAllocation Allocate( uint64_t size, uint64_t alignment = 1 )
+    {
+        for( uint32_t Block{ 0 }; Block < Blocks.size(); Block++ )
+        {
+            if( !Live[ Block ] || Blocks[ Block ].Size() - Blocks[ Block ].Used() < size ) continue;
+            TlsfAllocation Range{ Blocks[ Block ].Allocate( size, alignment ) };
+            if( Range.Valid() ) return { Block, Range };
+        }
+        return {};
+    }
+
+    uint32_t AddBlock()
+    {
+        uint32_t Block{ static_cast<uint32_t>( std::find( Live.begin(), Live.end(), 0 ) - Live.begin() ) };
+        if( Block == Blocks.size() )
+        {
+            Blocks.emplace_back();
+            Live.push_back( 0 );
+        }
+        Blocks[ Block ].Reset( BlockSize );
+        Live[ Block ] = 1;
+        return Block;
+    }
+
+    // For when the backing memory of a fresh block could not be created.
+    void RemoveBlock( uint32_t block )
+    {
+        Live[ block ] = 0;
+    }
+
+    // Returns a block that became redundant, or PoolAllocation::Invalid.
+    uint32_t Free( const PoolAllocation &allocation )
+    {
+        TlsfAllocator &Block{ Blocks[ allocation.Block ] };
+        Block.Free( allocation.Range );
+        if( !Block.Empty() ) return PoolAllocation::Invalid;
+        for( uint32_t Other{ 0 }; Other < Blocks.size(); Other++ )
+            if( Other != allocation.Block && Live[ Other ] && Blocks[ Other ].Empty() )
+            {
+                Live[ allocation.Block ] = 0;
+                return allocation.Block;
+            }
+        return PoolAllocation::Invalid;
+    }
+
+    uint64_t Size() const
+    {
+        return BlockSize;
+    }
+
+    MemoryStatistics Stat() const
+    {
+        MemoryStatistics Statistics;
+        for( uint32_t Block{ 0 }; Block < Blocks.size(); Block++ )
+        {
+            if( !Live[ Block ] ) continue;
+            Statistics.Blocks++;
+            Statistics.Allocations += Blocks[ Block ].Allocations();
+            Statistics.Reserved += Blocks[ Block ].Size();
+            Statistics.Used += Blocks[ Block ].Used();
+            Blocks[ Block ].ForEachFree( [ & ]( uint64_t, uint64_t size )
+                                         {
+                                             Statistics.FreeRanges++;
+                                             Statistics.LargestFreeRange = std::max( Statistics.LargestFreeRange, size ); } );
+        }
+        return Statistics;
+    }
+
+    DefragmentationStatistics Defragmentation() const
+    {
+        std::vector<const TlsfAllocator *> Order;
+        for( uint32_t Block{ 0 }; Block < Blocks.size(); Block++ )
+            if( Live[ Block ] && !Blocks[ Block ].Empty() ) Order.push_back( &Blocks[ Block ] );
+        std::sort( Order.begin(), Order.end(), []( const TlsfAllocator *a, const TlsfAllocator *b )
+                   { return a->Used() < b->Used(); } );
+        // Empty the least used blocks into the free space of the fuller ones that remain.
+        uint64_t Space{ 0 };
+        for( const auto *Block : Order ) Space += Block->Size() - Block->Used();
+        DefragmentationStatistics Statistics;
+        for( const auto *Block : Order )
+        {
+            Space -= Block->Size() - Block->Used();
+            if( Statistics.BytesToMove + Block->Used() > Space ) break;
+            Statistics.ReleasableBlocks++;
+            Statistics.BytesToMove += Block->Used();
+        }
+        return Statistics;
+    }
+
+  private:
+    uint64_t BlockSize;
+    std::vector<TlsfAllocator> Blocks;
+    std::vector<uint8_t> Live;
+};
@@ -0,0 +1,336 @@
+#pragma once
+#include "vulkan.h"
+#include "Hash.h"
+#include "ObjLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include <span>
+#include <chrono>
+#include <format>
+#include <string>
+#include <fstream>
+#include <filesystem>
+
+// On-disk layout: MeshCacheHeader, source path, then the vertex and index blobs at
+// MeshCacheAlignment-aligned offsets, followed by the MeshLod table. Vertecies are stored exactly
+// as struct Vertex, after OptimizeMesh and GenerateLods; bump MeshCacheVersion whenever that
+// processing changes.
+struct MeshCacheHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t VertexSize;
+    uint32_t PathLength;
+    uint64_t PathHash;
+    uint64_t SourceSize;
+    int64_t SourceTime;
+    uint64_t SourceHash;
+    uint64_t VerteciesCount;
+    uint64_t IndicesCount;
+    uint64_t VerteciesOffset;
+    uint64_t IndicesOffset;
+    uint64_t LodsCount;
+    uint64_t LodsOffset;
+};
+
+const uint32_t MeshCacheMagic{ 0x4843534D }; // "MSCH"
+const uint32_t MeshCacheVersion{ 3 };
+const uint64_t MeshCacheAlignment{ 64 };
+
+// Mesh ready for upload, backed either by a mapped cache file or by freshly parsed data.
+class CachedMesh
+{
+  public:
+    std::span<const Vertex> Vertecies() const
+    {
+        return VerteciesView;
+    }
+    std::span<const uint32_t> Indices() const
+    {
+        return IndicesView;
+    }
+    // Level 0 is the full mesh; every level indexes Vertecies() and its range lies in Indices().
+    std::span<const MeshLod> Lods() const
+    {
+        return LodsView;
+    }
+    bool Mapped() const
+    {
+        return !File.Empty() || Packed;
+    }
+
+  private:
+    friend class MeshCache;
+    MappedFile File;
+    bool Packed{ false }; // viewed in an AssetPack, which outlives the mesh
+    LodChain Parsed;
+    std::span<const Vertex> VerteciesView;
+    std::span<const uint32_t> IndicesView;
+    std::span<const MeshLod> LodsView;
+};
+
+// Given a pack, a mesh packed under PackPath() is used from it as is: the Assets target
+// rebuilds the pack with its sources, so packed meshes are not checked against them.
+class MeshCache
+{
+  public:
+    MeshCache( const char *directory, LoggerCallbacks loggers, const AssetPack *pack = nullptr ) : Directory{ directory }, Loggers{ loggers }, Assets{ pack }
+    {
+    }
+
+    CachedMesh Load( const char *path )
+    {
+        PROFILE_ZONE( "load mesh" );
+        auto Start{ std::chrono::steady_clock::now() };
+        CachedMesh Mesh;
+        if( FindPacked( path, Mesh ) )
+        {
+            Loggers.info( std::format( "Mesh {}: packed load in {:.3f} ms.", path, ElapsedMs( Start ) ).c_str() );
+            return Mesh;
+        }
+        std::filesystem::path CachePath{ CacheFile( path ) };
+        if( TryMap( path, CachePath, Mesh ) )
+        {
+            Loggers.info( std::format( "Mesh {}: warm load from cache in {:.3f} ms.", path, ElapsedMs( Start ) ).c_str() );
+            return Mesh;
+        }
+
+        MappedFile Source{ path };
+        Model Parsed;
+        ObjLoader{}.Parse( reinterpret_cast<const char *>( Source.Data() ), Source.Size(), Parsed );
+        MeshCacheHeader Header{ MakeHeader( path, Source ) };
+        Source.Close();
+        double ParseMs{ ElapsedMs( Start ) };
+
+        auto OptimizeStart{ std::chrono::steady_clock::now() };
+        VertexCacheStatistics Before{ AnalyzeVertexCache( Parsed.ModelVerteciesIndices, Parsed.ModelVertecies.size() ) };
+        OptimizeMesh( Parsed );
+        VertexCacheStatistics After{ AnalyzeVertexCache( Parsed.ModelVerteciesIndices, Parsed.ModelVertecies.size() ) };
+        Loggers.info( std::format( "Mesh {}: optimized in {:.3f} ms, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.", path, ElapsedMs( OptimizeStart ), Before.Acmr, After.Acmr, Before.Atvr, After.Atvr ).c_str() );
+
+        auto LodsStart{ std::chrono::steady_clock::now() };
+        Mesh.Parsed = GenerateLods( Parsed );
+        Parsed      = {};
+        for( size_t Level{ 0 }; Level < Mesh.Parsed.Levels.size(); Level++ )
+            Loggers.info( std::format( "Mesh {}: LOD {} has {} triangles, error {:.5f}.", path, Level, Mesh.Parsed.Levels[ Level ].IndicesCount / 3, Mesh.Parsed.Levels[ Level ].Error ).c_str() );
+        Loggers.info( std::format( "Mesh {}: LODs generated in {:.3f} ms.", path, ElapsedMs( LodsStart ) ).c_str() );
+
+        if( Write( CachePath, path, Header, Mesh.Parsed ) && TryMap( path, CachePath, Mesh ) )
+            Mesh.Parsed = {};
+        else
+        {
+            Mesh.VerteciesView = Mesh.Parsed.Mesh.ModelVertecies;
+            Mesh.IndicesView   = Mesh.Parsed.Mesh.ModelVerteciesIndices;
+            Mesh.LodsView      = Mesh.Parsed.Levels;
+        }
+        Loggers.info( std::format( "Mesh {}: cold load in {:.3f} ms (parse {:.3f} ms).", path, ElapsedMs( Start ), ParseMs ).c_str() );
+        return Mesh;
+    }
+
+    std::filesystem::path CacheFile( const char *path ) const
+    {
+        return Directory / std::format( "{:016x}.mesh", Hash64( path, strlen( path ) ) );
+    }
+
+    // A cache file packed under this path holds the mesh of the source at path.
+    static std::string PackPath( const char *path )
+    {
+        return std::format( "{}.mesh", path );
+    }
+
+  private:
+    std::filesystem::path Directory;
+    LoggerCallbacks Loggers;
+    const AssetPack *Assets;
+
+    static uint64_t AlignUp( uint64_t value )
+    {
+        return ( value + MeshCacheAlignment - 1 ) & ~( MeshCacheAlignment - 1 );
+    }
+
+    static double ElapsedMs( std::chrono::steady_clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    }
+
+    static int64_t SourceTime( const char *path )
+    {
+        std::error_code Error;
+        return std::filesystem::last_write_time( path, Error ).time_since_epoch().count();
+    }
+
+    static MeshCacheHeader MakeHeader( const char *path, const MappedFile &source )
+    {
+        MeshCacheHeader Header{};
+        Header.Magic      = MeshCacheMagic;
+        Header.Version    = MeshCacheVersion;
+        Header.VertexSize = sizeof( Vertex );
+        Header.PathLength = static_cast<uint32_t>( strlen( path ) );
+        Header.PathHash   = Hash64( path, Header.PathLength );
+        Header.SourceSize = source.Size();
+        Header.SourceTime = SourceTime( path );
+        Header.SourceHash = Hash64( source.Data(), source.Size() );
+        return Header;
+    }
+
+    // Maps the cache file and checks it still belongs to the source. An mtime change alone is
+    // tolerated when the content hash still matches; the stored mtime is refreshed then.
+    bool TryMap( const char *path, const std::filesystem::path &cachePath, CachedMesh &mesh )
+    {
+        std::error_code Error;
+        if( !std::filesystem::exists( cachePath, Error ) ) return false;
+        MappedFile File;
+        try
+        {
+            File.Open( cachePath.string().c_str() );
+        }
+        catch( const std::exception & )
+        {
+            return false;
+        }
+        MeshCacheHeader Header;
+        if( !Parse( { File.Data(), File.Size() }, path, Header ) ) return false;
+
+        uint64_t Size{ std::filesystem::file_size( path, Error ) };
+        if( Error || Size != Header.SourceSize ) return false;
+        int64_t Time{ SourceTime( path ) };
+        if( Time != Header.SourceTime )
+        {
+            MappedFile Source{ path };
+            if( Hash64( Source.Data(), Source.Size() ) != Header.SourceHash ) return false;
+            Header.SourceTime = Time;
+            File.Close();
+            {
+                std::fstream Patch{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+                Patch.write( reinterpret_cast<const char *>( &Header ), sizeof( Header ) );
+                if( !Patch ) Loggers.warn( std::format( "Failed to refresh the source time in mesh cache {}.", cachePath.string() ).c_str() );
+            }
+            // Size and hash matched, so the cache is used whether or not the time was stored.
+            try
+            {
+                File.Open( cachePath.string().c_str() );
+            }
+            catch( const std::exception & )
+            {
+                return false;
+            }
+            if( !Parse( { File.Data(), File.Size() }, path, Header ) ) return false;
+        }
+
+        Bind( File.Data(), Header, mesh );
+        mesh.File = std::move( File );
+        return true;
+    }
+
+    bool FindPacked( const char *path, CachedMesh &mesh ) const
+    {
+        const AssetPackEntry *Entry{ Assets ? Assets->Find( PackPath( path ) ) : nullptr };
+        MeshCacheHeader Header;
+        if( !Entry || Entry->Compression != AssetCompression::None || !Parse( Assets->View( *Entry ), path, Header ) ) return false;
+        Bind( Assets->View( *Entry ).data(), Header, mesh );
+        mesh.Packed = true;
+        return true;
+    }
+
+    // Checks data is a cache file of path in this version with every table inside it and
+    // aligned for its type, and every level drawing only vertecies that exist, so neither Bind
+    // nor a draw of a corrupt file reads out of bounds.
+    static bool Parse( std::span<const uint8_t> data, const char *path, MeshCacheHeader &header )
+    {
+        if( data.size() < sizeof( MeshCacheHeader ) ) return false;
+        memcpy( &header, data.data(), sizeof( header ) );
+        uint32_t PathLength{ static_cast<uint32_t>( strlen( path ) ) };
+        return header.Magic == MeshCacheMagic && header.Version == MeshCacheVersion && header.VertexSize == sizeof( Vertex ) &&
+               header.PathLength == PathLength && sizeof( header ) + PathLength <= data.size() &&
+               !memcmp( data.data() + sizeof( header ), path, PathLength ) &&
+               Fits( header.VerteciesOffset, header.VerteciesCount, sizeof( Vertex ), data.size() ) &&
+               Fits( header.IndicesOffset, header.IndicesCount, sizeof( uint32_t ), data.size() ) && Fits( header.LodsOffset, header.LodsCount, sizeof( MeshLod ), data.size() ) &&
+               Aligned<Vertex>( data.data() + header.VerteciesOffset ) && Aligned<uint32_t>( data.data() + header.IndicesOffset ) &&
+               Aligned<MeshLod>( data.data() + header.LodsOffset ) && LodsFit( data.data(), header );
+    }
+
+    // Whether count elements of stride bytes at offset lie within size bytes; bounded by
+    // division so a corrupt count cannot wrap the product past the check.
+    static bool Fits( uint64_t offset, uint64_t count, uint64_t stride, uint64_t size )
+    {
+        return offset <= size && count <= ( size - offset ) / stride;
+    }
+
+    template <typename T>
+    static bool Aligned( const uint8_t *data )
+    {
+        return reinterpret_cast<uintptr_t>( data ) % alignof( T ) == 0;
+    }
+
+    // Every level's index range inside the index table and its indices, offset by the level's
+    // first vertex, inside the vertex table.
+    static bool LodsFit( const uint8_t *data, const MeshCacheHeader &header )
+    {
+        const MeshLod *Lods{ reinterpret_cast<const MeshLod *>( data + header.LodsOffset ) };
+        const uint32_t *Indices{ reinterpret_cast<const uint32_t *>( data + header.IndicesOffset ) };
+        for( uint64_t Level{ 0 }; Level < header.LodsCount; Level++ )
+        {
+            const MeshLod &Lod{ Lods[ Level ] };
+            if( Lod.VerteciesOffset > header.VerteciesCount || uint64_t( Lod.IndeciesOffset ) + Lod.IndicesCount > header.IndicesCount ) return false;
+            const uint64_t Limit{ header.VerteciesCount - Lod.VerteciesOffset };
+            for( uint32_t i{ 0 }; i < Lod.IndicesCount; i++ )
+                if( Indices[ Lod.IndeciesOffset + i ] >= Limit ) return false;
+        }
+        return true;
+    }
+
+    static void Bind( const uint8_t *data, const MeshCacheHeader &header, CachedMesh &mesh )
+    {
+        mesh.VerteciesView = { reinterpret_cast<const Vertex *>( data + header.VerteciesOffset ), header.VerteciesCount };
+        mesh.IndicesView   = { reinterpret_cast<const uint32_t *>( data + header.IndicesOffset ), header.IndicesCount };
+        mesh.LodsView      = { reinterpret_cast<const MeshLod *>( data + header.LodsOffset ), header.LodsCount };
+    }
+
+    // Written to a temporary file first so a crash never leaves a truncated cache behind.
+    bool Write( const std::filesystem::path &cachePath, const char *path, MeshCacheHeader header, const LodChain &chain )
+    {
+        const Model &model{ chain.Mesh };
+        header.VerteciesCount  = model.ModelVertecies.size();
+        header.IndicesCount    = model.ModelVerteciesIndices.size();
+        header.VerteciesOffset = AlignUp( sizeof( header ) + header.PathLength );
+        header.IndicesOffset   = AlignUp( header.VerteciesOffset + header.VerteciesCount * sizeof( Vertex ) );
+        header.LodsCount       = chain.Levels.size();
+        header.LodsOffset      = AlignUp( header.IndicesOffset + header.IndicesCount * sizeof( uint32_t ) );
+
+        // Created here rather than up front, so a run served by the pack or the cache as it is
+        // creates nothing.
+        std::error_code Error;
+        std::filesystem::create_directories( Directory, Error );
+        if( Error )
+        {
+            Loggers.warn( std::format( "Mesh cache directory {} unavailable: {}.", Directory.string(), Error.message() ).c_str() );
+            return false;
+        }
+        std::filesystem::path Temporary{ cachePath };
+        Temporary += ".tmp";
+        {
+            std::ofstream Out{ Temporary, std::ios::binary | std::ios::trunc };
+            if( !Out ) return false;
+            const char Padding[ MeshCacheAlignment ]{};
+            Out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+            Out.write( path, header.PathLength );
+            Out.write( Padding, header.VerteciesOffset - sizeof( header ) - header.PathLength );
+            Out.write( reinterpret_cast<const char *>( model.ModelVertecies.data() ), header.VerteciesCount * sizeof( Vertex ) );
+            Out.write( Padding, header.IndicesOffset - header.VerteciesOffset - header.VerteciesCount * sizeof( Vertex ) );
+            Out.write( reinterpret_cast<const char *>( model.ModelVerteciesIndices.data() ), header.IndicesCount * sizeof( uint32_t ) );
+            Out.write( Padding, header.LodsOffset - header.IndicesOffset - header.IndicesCount * sizeof( uint32_t ) );
+            Out.write( reinterpret_cast<const char *>( chain.Levels.data() ), header.LodsCount * sizeof( MeshLod ) );
+            if( !Out ) return false;
+        }
+        std::filesystem::rename( Temporary, cachePath, Error );
+        if( Error )
+        {
+            Loggers.warn( std::format( "Failed to write mesh cache {}: {}.", cachePath.string(), Error.message() ).c_str() );
+            std::filesystem::remove( Temporary, Error );
+            return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,272 @@
+#pragma once
+#include "vulkan.h"
+#include <span>
+#include <vector>
+#include <numeric>
+#include <cassert>
+#include <algorithm>
+
+struct VertexCacheStatistics
+{
+    uint32_t Transforms{ 0 };
+    float Acmr{ 0.f }; // transformed vertecies per triangle
+    float Atvr{ 0.f }; // transformed vertecies per unique vertex
+};
+
+struct MeshOptimizerOptions
+{
+    uint32_t CacheSize{ 16 };
+    bool Overdraw{ true };
+    // Clusters for overdraw sorting may cost this much ACMR relative to the cache-optimal order.
+    float OverdrawThreshold{ 1.05f };
+};
+
+// FIFO post-transform cache simulation, the model Tipsify optimizes for.
+inline VertexCacheStatistics AnalyzeVertexCache( std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16 )
+{
+    VertexCacheStatistics Statistics;
+    std::vector<uint32_t> Timestamps( vertexCount, 0 );
+    uint32_t Time{ cacheSize + 1 };
+    for( uint32_t Index : indices )
+    {
+        if( Time - Timestamps[ Index ] > cacheSize )
+        {
+            Timestamps[ Index ] = Time++;
+            Statistics.Transforms++;
+        }
+    }
+    if( !indices.empty() ) Statistics.Acmr = Statistics.Transforms / ( indices.size() / 3.f );
+    if( vertexCount ) Statistics.Atvr = Statistics.Transforms / static_cast<float>( vertexCount );
+    return Statistics;
+}
+
+// Bytes pulled through a direct-mapped cache of 64-byte lines, relative to the vertex buffer size.
+inline float AnalyzeVertexFetch( std::span<const uint32_t> indices, size_t vertexCount, size_t vertexSize, size_t cacheBytes = 16 * 1024 )
+{
+    constexpr size_t LineSize{ 64 };
+    std::vector<size_t> Lines( cacheBytes / LineSize, ~size_t{ 0 } );
+    size_t Fetched{ 0 };
+    for( uint32_t Index : indices )
+    {
+        size_t Begin{ Index * vertexSize / LineSize };
+        size_t End{ ( ( Index + 1 ) * vertexSize - 1 ) / LineSize };
+        for( size_t Line{ Begin }; Line <= End; Line++ )
+        {
+            size_t &Slot{ Lines[ Line % Lines.size() ] };
+            if( Slot != Line )
+            {
+                Slot = Line;
+                Fetched += LineSize;
+            }
+        }
+    }
+    return vertexCount ? Fetched / static_cast<float>( vertexCount * vertexSize ) : 0.f;
+}
+
+// Tipsify (Sander, Nehab, Barczak 2007): linear-time triangle reordering for a FIFO cache of
+// cacheSize entries. Returns the triangle offsets where the fan walk hit a dead end; the
+// overdraw pass treats them as hard cluster boundaries.
+inline std::vector<uint32_t> OptimizeVertexCache( std::span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16 )
+{
+    const size_t TrianglesCount{ indices.size() / 3 };
+    std::vector<uint32_t> Boundaries{ 0 };
+    if( !TrianglesCount ) return Boundaries;
+
+    // Vertex to triangle adjacency
+    std::vector<uint32_t> Live( vertexCount, 0 );
+    for( uint32_t Index : indices ) Live[ Index ]++;
+    std::vector<uint32_t> AdjacencyOffset( vertexCount + 1, 0 );
+    for( size_t v{ 0 }; v < vertexCount; v++ ) AdjacencyOffset[ v + 1 ] = AdjacencyOffset[ v ] + Live[ v ];
+    std::vector<uint32_t> Adjacency( indices.size() );
+    {
+        std::vector<uint32_t> Fill( AdjacencyOffset.begin(), AdjacencyOffset.end() - 1 );
+        for( size_t i{ 0 }; i < indices.size(); i++ ) Adjacency[ Fill[ indices[ i ] ]++ ] = static_cast<uint32_t>( i / 3 );
+    }
+    // Vertex to triangle adjacency end
+
+    std::vector<uint32_t> CacheTime( vertexCount, 0 );
+    std::vector<uint8_t> Emitted( TrianglesCount, 0 );
+    std::vector<uint32_t> DeadEnds;
+    std::vector<uint32_t> Candidates;
+    std::vector<uint32_t> Output;
+    Output.reserve( indices.size() );
+    uint32_t Time{ cacheSize + 1 };
+    size_t Cursor{ 0 };
+    int64_t Fanning{ indices[ 0 ] };
+    while( Fanning >= 0 )
+    {
+        Candidates.clear();
+        for( uint32_t a{ AdjacencyOffset[ Fanning ] }; a < AdjacencyOffset[ Fanning + 1 ]; a++ )
+        {
+            uint32_t Triangle{ Adjacency[ a ] };
+            if( Emitted[ Triangle ] ) continue;
+            Emitted[ Triangle ] = 1;
+            for( uint32_t k{ 0 }; k < 3; k++ )
+            {
+                uint32_t v{ indices[ Triangle * 3 + k ] };
+                Output.push_back( v );
+                DeadEnds.push_back( v );
+                Candidates.push_back( v );
+                Live[ v ]--;
+                if( Time - CacheTime[ v ] > cacheSize ) CacheTime[ v ] = Time++;
+            }
+        }
+
+        // Next fanning vertex: the candidate that stays in cache longest while its remaining
+        // triangles are emitted.
+        int64_t Best{ -1 };
+        int64_t BestPriority{ -1 };
+        for( uint32_t v : Candidates )
+        {
+            if( !Live[ v ] ) continue;
+            int64_t Priority{ 0 };
+            if( Time - CacheTime[ v ] + 2 * Live[ v ] <= cacheSize ) Priority = Time - CacheTime[ v ];
+            if( Priority > BestPriority )
+            {
+                Best         = v;
+                BestPriority = Priority;
+            }
+        }
+        if( Best < 0 )
+        {
+            if( Output.size() < indices.size() ) Boundaries.push_back( static_cast<uint32_t>( Output.size() / 3 ) );
+            while( !DeadEnds.empty() && Best < 0 )
+            {
+                uint32_t v{ DeadEnds.back() };
+                DeadEnds.pop_back();
+                if( Live[ v ] ) Best = v;
+            }
+            for( ; Best < 0 && Cursor < vertexCount; Cursor++ )
+                if( Live[ Cursor ] ) Best = static_cast<int64_t>( Cursor );
+        }
+        Fanning = Best;
+    }
+    assert( Output.size() == indices.size() );
+    std::copy( Output.begin(), Output.end(), indices.begin() );
+    return Boundaries;
+}
+
+// Splits the cache-ordered triangles into clusters and draws the most outward-facing clusters
+// first (Sander et al. 2007), so inner surfaces are more likely to fail the depth test. Hard
+// boundaries come from Tipsify; soft ones are added wherever restarting the cache costs less
+// than threshold times the cluster's ACMR.
+inline void OptimizeOverdraw( std::span<uint32_t> indices, std::span<const Vertex> vertecies, const std::vector<uint32_t> &hardBoundaries, uint32_t cacheSize = 16, float threshold = 1.05f )
+{
+    const uint32_t TrianglesCount{ static_cast<uint32_t>( indices.size() / 3 ) };
+    if( TrianglesCount < 2 ) return;
+
+    // Soft boundaries
+    std::vector<uint32_t> Clusters;
+    std::vector<uint32_t> Timestamps( vertecies.size(), 0 );
+    uint32_t Time{ cacheSize + 1 };
+    auto Misses{ [ & ]( uint32_t triangle )
+                 {
+                     uint32_t Result{ 0 };
+                     for( uint32_t k{ 0 }; k < 3; k++ )
+                     {
+                         uint32_t v{ indices[ triangle * 3 + k ] };
+                         if( Time - Timestamps[ v ] > cacheSize )
+                         {
+                             Timestamps[ v ] = Time++;
+                             Result++;
+                         }
+                     }
+                     return Result;
+                 } };
+    for( size_t h{ 0 }; h < hardBoundaries.size(); h++ )
+    {
+        uint32_t Begin{ hardBoundaries[ h ] };
+        uint32_t End{ h + 1 < hardBoundaries.size() ? hardBoundaries[ h + 1 ] : TrianglesCount };
+        Time += cacheSize + 1;
+        uint32_t ClusterMisses{ 0 };
+        for( uint32_t t{ Begin }; t < End; t++ ) ClusterMisses += Misses( t );
+        float Limit{ threshold * ClusterMisses / std::max( End - Begin, 1u ) };
+
+        uint32_t Start{ Begin };
+        uint32_t RunMisses{ 0 };
+        Time += cacheSize + 1;
+        Clusters.push_back( Begin );
+        for( uint32_t t{ Begin }; t < End; t++ )
+        {
+            RunMisses += Misses( t );
+            if( t + 1 < End && RunMisses <= Limit * ( t + 1 - Start ) )
+            {
+                Clusters.push_back( t + 1 );
+                Start     = t + 1;
+                RunMisses = 0;
+                Time += cacheSize + 1;
+            }
+        }
+    }
+    Clusters.push_back( TrianglesCount );
+    // Soft boundaries end
+
+    // Order clusters by how far their area-weighted centroid lies along their own normal.
+    auto Corner{ [ & ]( uint32_t triangle, uint32_t k )
+                 { return vertecies[ indices[ triangle * 3 + k ] ].coordinate; } };
+    glm::vec3 MeshCentroid{ 0.f };
+    float MeshArea{ 0.f };
+    std::vector<glm::vec3> Centroids( Clusters.size() - 1, glm::vec3{ 0.f } );
+    std::vector<glm::vec3> Normals( Clusters.size() - 1, glm::vec3{ 0.f } );
+    for( size_t c{ 0 }; c + 1 < Clusters.size(); c++ )
+    {
+        float Area{ 0.f };
+        for( uint32_t t{ Clusters[ c ] }; t < Clusters[ c + 1 ]; t++ )
+        {
+            glm::vec3 a{ Corner( t, 0 ) }, b{ Corner( t, 1 ) }, d{ Corner( t, 2 ) };
+            glm::vec3 Normal{ glm::cross( b - a, d - a ) };
+            float TriangleArea{ glm::length( Normal ) };
+            Centroids[ c ] += ( a + b + d ) * ( TriangleArea / 3.f );
+            Normals[ c ] += Normal;
+            Area += TriangleArea;
+        }
+        MeshCentroid += Centroids[ c ];
+        MeshArea += Area;
+        if( Area > 0.f ) Centroids[ c ] /= Area;
+    }
+    if( MeshArea > 0.f ) MeshCentroid /= MeshArea;
+    std::vector<float> Sort( Clusters.size() - 1 );
+    for( size_t c{ 0 }; c < Sort.size(); c++ )
+    {
+        float Length{ glm::length( Normals[ c ] ) };
+        Sort[ c ] = Length > 0.f ? glm::dot( Centroids[ c ] - MeshCentroid, Normals[ c ] / Length ) : 0.f;
+    }
+    std::vector<uint32_t> Order( Sort.size() );
+    std::iota( Order.begin(), Order.end(), 0u );
+    std::stable_sort( Order.begin(), Order.end(), [ & ]( uint32_t a, uint32_t b )
+                      { return Sort[ a ] > Sort[ b ]; } );
+
+    std::vector<uint32_t> Output;
+    Output.reserve( indices.size() );
+    for( uint32_t c : Order )
+        Output.insert( Output.end(), indices.begin() + Clusters[ c ] * 3, indices.begin() + Clusters[ c + 1 ] * 3 );
+    std::copy( Output.begin(), Output.end(), indices.begin() );
+}
+
+// Renumbers vertecies in first-use order so fetches walk the vertex buffer forwards.
+// Unreferenced vertecies are dropped.
+inline void OptimizeVertexFetch( Model &model )
+{
+    constexpr uint32_t Unused{ ~0u };
+    std::vector<uint32_t> Remap( model.ModelVertecies.size(), Unused );
+    std::vector<Vertex> Vertecies;
+    Vertecies.reserve( model.ModelVertecies.size() );
+    for( auto &Index : model.ModelVerteciesIndices )
+    {
+        if( Remap[ Index ] == Unused )
+        {
+            Remap[ Index ] = static_cast<uint32_t>( Vertecies.size() );
+            Vertecies.push_back( model.ModelVertecies[ Index ] );
+        }
+        Index = Remap[ Index ];
+    }
+    model.ModelVertecies.swap( Vertecies );
+}
+
+inline void OptimizeMesh( Model &model, const MeshOptimizerOptions &options = {} )
+{
+    std::vector<uint32_t> Boundaries{ OptimizeVertexCache( model.ModelVerteciesIndices, model.ModelVertecies.size(), options.CacheSize ) };
+    if( options.Overdraw )
+        OptimizeOverdraw( model.ModelVerteciesIndices, model.ModelVertecies, Boundaries, options.CacheSize, options.OverdrawThreshold );
+    OptimizeVertexFetch( model );
+}
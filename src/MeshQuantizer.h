@@ -0,0 +1,85 @@
+#pragma once
+#include "vulkan.h"
+#include "VertexLayout.h"
+#include <span>
+#include <vector>
+#include <limits>
+
+struct QuantizationError
+{
+    float MaxPosition{ 0.f };
+    float RmsPosition{ 0.f };
+    float MaxColor{ 0.f };
+    float MaxTexture{ 0.f };
+};
+
+// Vertecies re-encoded into Layout (position, color, texture coordinate). For unorm positions
+// the mesh bounds are mapped to [0, 1]; Dequantize() undoes that and belongs in front of the
+// model matrix.
+template <typename Layout>
+struct QuantizedMesh
+{
+    std::vector<std::byte> Vertecies;
+    std::vector<uint32_t> Indices;
+    size_t VerteciesCount{ 0 };
+    glm::vec3 Offset{ 0.f };
+    glm::vec3 Scale{ 1.f };
+    QuantizationError Error;
+
+    glm::mat4 Dequantize() const
+    {
+        glm::mat4 Result{ 1.f };
+        Result[ 0 ][ 0 ] = Scale.x;
+        Result[ 1 ][ 1 ] = Scale.y;
+        Result[ 2 ][ 2 ] = Scale.z;
+        Result[ 3 ]      = glm::vec4{ Offset, 1.f };
+        return Result;
+    }
+};
+
+template <typename Layout>
+QuantizedMesh<Layout> QuantizeMesh( std::span<const Vertex> vertecies, std::span<const uint32_t> indices )
+{
+    static_assert( Layout::Count == 3, "Expected position, color and texture coordinate attributes." );
+    using Position = typename Layout::template Attribute<0>;
+    QuantizedMesh<Layout> Mesh;
+    Mesh.VerteciesCount = vertecies.size();
+    Mesh.Indices.assign( indices.begin(), indices.end() );
+    Mesh.Vertecies.resize( vertecies.size() * Layout::Stride );
+    if( vertecies.empty() ) return Mesh;
+
+    if constexpr( Position::Normalized )
+    {
+        glm::vec3 Min{ std::numeric_limits<float>::max() }, Max{ std::numeric_limits<float>::lowest() };
+        for( const auto &Point : vertecies )
+        {
+            Min = glm::min( Min, Point.coordinate );
+            Max = glm::max( Max, Point.coordinate );
+        }
+        Mesh.Offset = Min;
+        Mesh.Scale  = glm::max( Max - Min, glm::vec3{ std::numeric_limits<float>::min() } );
+    }
+
+    double SquaredPosition{ 0.0 };
+    for( size_t i{ 0 }; i < vertecies.size(); i++ )
+    {
+        const Vertex &Point{ vertecies[ i ] };
+        std::byte *Out{ Mesh.Vertecies.data() + i * Layout::Stride };
+        Layout::template Write<0>( Out, glm::vec4{ ( Point.coordinate - Mesh.Offset ) / Mesh.Scale, 1.f } );
+        Layout::template Write<1>( Out, Point.color );
+        Layout::template Write<2>( Out, glm::vec4{ Point.texture, 0.f, 0.f } );
+
+        glm::vec4 Decoded{ Layout::template Read<0>( Out ) };
+        glm::vec3 DecodedPosition{ glm::vec3{ Decoded.x, Decoded.y, Decoded.z } * Mesh.Scale + Mesh.Offset };
+        float PositionError{ glm::length( DecodedPosition - Point.coordinate ) };
+        glm::vec4 ColorError{ glm::abs( Layout::template Read<1>( Out ) - Point.color ) };
+        glm::vec4 DecodedTexture{ Layout::template Read<2>( Out ) };
+        glm::vec2 TextureError{ glm::abs( glm::vec2{ DecodedTexture.x, DecodedTexture.y } - Point.texture ) };
+        Mesh.Error.MaxPosition = std::max( Mesh.Error.MaxPosition, PositionError );
+        Mesh.Error.MaxColor    = std::max( { Mesh.Error.MaxColor, ColorError.x, ColorError.y, ColorError.z, ColorError.w } );
+        Mesh.Error.MaxTexture  = std::max( { Mesh.Error.MaxTexture, TextureError.x, TextureError.y } );
+        SquaredPosition += static_cast<double>( PositionError ) * PositionError;
+    }
+    Mesh.Error.RmsPosition = static_cast<float>( std::sqrt( SquaredPosition / vertecies.size() ) );
+    return Mesh;
+}
@@ -0,0 +1,422 @@
+#pragma once
+#include "vulkan.h"
+#include "MeshOptimizer.h"
+#include <span>
+#include <limits>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+// Symmetric 4x4 plane quadric (Garland, Heckbert 1997) plus the area that produced it, so the
+// error can be read back as a mean squared distance.
+struct Quadric
+{
+    double a2{ 0 }, ab{ 0 }, ac{ 0 }, ad{ 0 }, b2{ 0 }, bc{ 0 }, bd{ 0 }, c2{ 0 }, cd{ 0 }, d2{ 0 };
+    double Weight{ 0 };
+
+    static Quadric Plane( const glm::vec3 &normal, float distance, double weight )
+    {
+        double a{ normal.x }, b{ normal.y }, c{ normal.z }, d{ distance };
+        return { a * a * weight, a * b * weight, a * c * weight, a * d * weight, b * b * weight, b * c * weight,
+                 b * d * weight, c * c * weight, c * d * weight, d * d * weight, weight };
+    }
+
+    Quadric &operator+=( const Quadric &other )
+    {
+        a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad, b2 += other.b2;
+        bc += other.bc, bd += other.bd, c2 += other.c2, cd += other.cd, d2 += other.d2;
+        Weight += other.Weight;
+        return *this;
+    }
+
+    double Error( const glm::vec3 &point ) const
+    {
+        double x{ point.x }, y{ point.y }, z{ point.z };
+        double Result{ a2 * x * x + b2 * y * y + c2 * z * z + 2 * ( ab * x * y + ac * x * z + bc * y * z ) +
+                       2 * ( ad * x + bd * y + cd * z ) + d2 };
+        return std::max( Result, 0.0 );
+    }
+};
+
+// Half-edge collapse simplification driven by plane quadrics. Collapses run in passes; every
+// pass picks the cheapest edges whose neighbourhoods do not overlap, so the adjacency built at
+// the start of the pass stays exact.
+//
+// Vertecies that share a position but differ in color or texture coordinate are wedges of one
+// position. A collapse moves every wedge of the removed position onto the wedge it shares an
+// edge with, which keeps UV and color seams intact and only lets seams shorten along
+// themselves. Open borders behave the same way, and seam and border edges carry extra plane
+// quadrics so their outline stays put. Collapses that would flip a triangle are rejected.
+class MeshSimplifier
+{
+  public:
+    MeshSimplifier( std::span<const Vertex> vertecies ) : Vertecies{ vertecies }
+    {
+        Normalize();
+        Weld();
+    }
+
+    // Reduces indices towards targetIndexCount without exceeding targetError, given relative to
+    // the mesh extent. Returns the error reached, on the same scale.
+    float Simplify( std::vector<uint32_t> &indices, size_t targetIndexCount, float targetError )
+    {
+        Quadrics.assign( Vertecies.size(), Quadric{} );
+        BuildAdjacency( indices );
+        BuildEdges( indices );
+        AddQuadrics( indices );
+        const double ErrorLimit{ static_cast<double>( targetError ) * targetError };
+        double ResultError{ 0.0 };
+        std::vector<uint32_t> Remap( Vertecies.size() );
+        std::vector<uint8_t> Locked( Vertecies.size() );
+        std::vector<Collapse> Candidates;
+        std::vector<uint32_t> Order;
+        while( indices.size() > targetIndexCount )
+        {
+            BuildAdjacency( indices );
+            BuildEdges( indices );
+            Candidates.clear();
+            for( const auto &Edge : Edges )
+            {
+                Collapse Best{ Cost( Edge.A, Edge.B, Edge ) };
+                Collapse Reverse{ Cost( Edge.B, Edge.A, Edge ) };
+                if( Reverse.Error < Best.Error ) Best = Reverse;
+                if( Best.Error <= ErrorLimit ) Candidates.push_back( Best );
+            }
+            SortByError( Candidates, Order );
+
+            std::iota( Remap.begin(), Remap.end(), 0u );
+            std::fill( Locked.begin(), Locked.end(), 0 );
+            size_t Remaining{ indices.size() / 3 };
+            size_t Collapsed{ 0 };
+            for( uint32_t c : Order )
+            {
+                const Collapse &Candidate{ Candidates[ c ] };
+                if( Remaining * 3 <= targetIndexCount ) break;
+                if( Locked[ Candidate.From ] || Locked[ Candidate.To ] ) continue;
+                if( !TryCollapse( indices, Candidate, Remap, Locked, Remaining ) ) continue;
+                ResultError = std::max( ResultError, Candidate.Error );
+                Collapsed++;
+            }
+            if( !Collapsed ) break;
+
+            size_t Write{ 0 };
+            for( size_t i{ 0 }; i < indices.size(); i += 3 )
+            {
+                uint32_t a{ Remap[ indices[ i ] ] }, b{ Remap[ indices[ i + 1 ] ] }, c{ Remap[ indices[ i + 2 ] ] };
+                if( Positions[ a ] == Positions[ b ] || Positions[ b ] == Positions[ c ] || Positions[ a ] == Positions[ c ] ) continue;
+                indices[ Write++ ] = a;
+                indices[ Write++ ] = b;
+                indices[ Write++ ] = c;
+            }
+            indices.resize( Write );
+        }
+        return static_cast<float>( std::sqrt( ResultError ) );
+    }
+
+    // Length that relative errors are measured against.
+    float Extent() const
+    {
+        return Scale;
+    }
+
+  private:
+    static constexpr uint32_t Invalid{ ~0u };
+    // Seam and border planes weigh this much more than the surface they bound.
+    static constexpr double BoundaryWeight{ 10.0 };
+
+    struct Edge
+    {
+        uint32_t A, B; // positions, A < B; Edges are grouped by A
+        uint32_t WedgeA, WedgeB;
+        uint32_t Triangles;
+        bool Seam;
+    };
+
+    struct Collapse
+    {
+        uint32_t From{ Invalid }, To{ Invalid };
+        double Error{ std::numeric_limits<double>::max() };
+    };
+
+    std::span<const Vertex> Vertecies;
+    std::vector<glm::vec3> Points; // normalized to the unit cube
+    std::vector<uint32_t> Positions; // vertex to the first vertex with the same coordinate
+    std::vector<Quadric> Quadrics; // by position
+    std::vector<Edge> Edges;
+    std::vector<uint32_t> EdgeOffset; // by position
+    std::vector<std::pair<uint32_t, uint32_t>> Wedges; // scratch for TryCollapse
+    std::vector<uint8_t> Border; // by position: lies on an open border or non-manifold edge
+    std::vector<uint8_t> Complex; // by position: touches a non-manifold edge, never moves
+    std::vector<uint32_t> AdjacencyOffset;
+    std::vector<uint32_t> Adjacency; // by position: triangles
+    glm::vec3 Origin{ 0.f };
+    float Scale{ 1.f };
+
+    void Normalize()
+    {
+        if( Vertecies.empty() ) return;
+        glm::vec3 Min{ std::numeric_limits<float>::max() }, Max{ std::numeric_limits<float>::lowest() };
+        for( const auto &Point : Vertecies )
+        {
+            Min = glm::min( Min, Point.coordinate );
+            Max = glm::max( Max, Point.coordinate );
+        }
+        glm::vec3 Size{ Max - Min };
+        Origin = Min;
+        Scale  = std::max( { Size.x, Size.y, Size.z, std::numeric_limits<float>::min() } );
+        Points.resize( Vertecies.size() );
+        for( size_t i{ 0 }; i < Vertecies.size(); i++ ) Points[ i ] = ( Vertecies[ i ].coordinate - Origin ) / Scale;
+    }
+
+    void Weld()
+    {
+        std::vector<uint32_t> Order( Vertecies.size() );
+        std::iota( Order.begin(), Order.end(), 0u );
+        auto Less{ [ & ]( uint32_t a, uint32_t b )
+                   {
+                       const glm::vec3 &p{ Vertecies[ a ].coordinate }, &q{ Vertecies[ b ].coordinate };
+                       if( p.x != q.x ) return p.x < q.x;
+                       if( p.y != q.y ) return p.y < q.y;
+                       if( p.z != q.z ) return p.z < q.z;
+                       return a < b;
+                   } };
+        std::sort( Order.begin(), Order.end(), Less );
+        Positions.resize( Vertecies.size() );
+        for( size_t i{ 0 }; i < Order.size(); i++ )
+        {
+            bool Same{ i && Vertecies[ Order[ i ] ].coordinate == Vertecies[ Order[ i - 1 ] ].coordinate };
+            Positions[ Order[ i ] ] = Same ? Positions[ Order[ i - 1 ] ] : Order[ i ];
+        }
+    }
+
+    // Unique position edges with their triangle count; an edge is a seam when its two
+    // triangles disagree on the wedges at either end. Needs the adjacency of the same indices.
+    void BuildEdges( const std::vector<uint32_t> &indices )
+    {
+        Edges.clear();
+        EdgeOffset.assign( Vertecies.size() + 1, 0 );
+        for( uint32_t a{ 0 }; a < Vertecies.size(); a++ )
+        {
+            EdgeOffset[ a ] = static_cast<uint32_t>( Edges.size() );
+            for( uint32_t t{ AdjacencyOffset[ a ] }; t < AdjacencyOffset[ a + 1 ]; t++ )
+            {
+                const uint32_t *Triangle{ &indices[ Adjacency[ t ] * 3 ] };
+                uint32_t Own{ 0 };
+                while( Positions[ Triangle[ Own ] ] != a ) Own++;
+                for( uint32_t k{ 1 }; k < 3; k++ )
+                {
+                    uint32_t Other{ Triangle[ ( Own + k ) % 3 ] };
+                    uint32_t b{ Positions[ Other ] };
+                    if( b <= a ) continue;
+                    auto Found{ std::find_if( Edges.begin() + EdgeOffset[ a ], Edges.end(), [ & ]( const Edge &edge )
+                                              { return edge.B == b; } ) };
+                    if( Found == Edges.end() )
+                        Edges.push_back( { a, b, Triangle[ Own ], Other, 1, false } );
+                    else
+                    {
+                        Found->Triangles++;
+                        Found->Seam |= Found->WedgeA != Triangle[ Own ] || Found->WedgeB != Other;
+                    }
+                }
+            }
+        }
+        EdgeOffset[ Vertecies.size() ] = static_cast<uint32_t>( Edges.size() );
+
+        Border.assign( Vertecies.size(), 0 );
+        Complex.assign( Vertecies.size(), 0 );
+        for( const auto &Edge : Edges )
+        {
+            if( Edge.Triangles != 2 ) Border[ Edge.A ] = Border[ Edge.B ] = 1;
+            if( Edge.Triangles > 2 ) Complex[ Edge.A ] = Complex[ Edge.B ] = 1;
+        }
+    }
+
+    void AddQuadrics( const std::vector<uint32_t> &indices )
+    {
+        for( size_t i{ 0 }; i < indices.size(); i += 3 )
+        {
+            const uint32_t Corners[ 3 ]{ Positions[ indices[ i ] ], Positions[ indices[ i + 1 ] ], Positions[ indices[ i + 2 ] ] };
+            glm::vec3 Normal{ glm::cross( Points[ Corners[ 1 ] ] - Points[ Corners[ 0 ] ], Points[ Corners[ 2 ] ] - Points[ Corners[ 0 ] ] ) };
+            float Area{ glm::length( Normal ) };
+            if( Area <= 0.f ) continue;
+            Normal /= Area;
+            Quadric Surface{ Quadric::Plane( Normal, -glm::dot( Normal, Points[ Corners[ 0 ] ] ), Area * 0.5 ) };
+            for( uint32_t k{ 0 }; k < 3; k++ ) Quadrics[ Corners[ k ] ] += Surface;
+
+            // Planes through seam and border edges, perpendicular to the surface.
+            for( uint32_t k{ 0 }; k < 3; k++ )
+            {
+                uint32_t a{ Corners[ k ] }, b{ Corners[ ( k + 1 ) % 3 ] };
+                const Edge *Found{ FindEdge( a, b ) };
+                if( !Found || ( Found->Triangles == 2 && !Found->Seam ) ) continue;
+                glm::vec3 Direction{ Points[ b ] - Points[ a ] };
+                glm::vec3 Side{ glm::cross( Direction, Normal ) };
+                float Length{ glm::length( Side ) };
+                if( Length <= 0.f ) continue;
+                Side /= Length;
+                Quadric Boundary{ Quadric::Plane( Side, -glm::dot( Side, Points[ a ] ), glm::dot( Direction, Direction ) * BoundaryWeight ) };
+                Quadrics[ a ] += Boundary;
+                Quadrics[ b ] += Boundary;
+            }
+        }
+    }
+
+    const Edge *FindEdge( uint32_t a, uint32_t b ) const
+    {
+        if( a > b ) std::swap( a, b );
+        for( uint32_t e{ EdgeOffset[ a ] }; e < EdgeOffset[ a + 1 ]; e++ )
+            if( Edges[ e ].B == b ) return &Edges[ e ];
+        return nullptr;
+    }
+
+    // Counting sort on the top 11 bits of the float error; exact order within a bucket does not
+    // matter for the result.
+    static void SortByError( const std::vector<Collapse> &candidates, std::vector<uint32_t> &order )
+    {
+        constexpr uint32_t Buckets{ 1 << 11 };
+        std::vector<uint32_t> Keys( candidates.size() );
+        std::vector<uint32_t> Offsets( Buckets + 1, 0 );
+        for( size_t i{ 0 }; i < candidates.size(); i++ )
+        {
+            float Error{ static_cast<float>( candidates[ i ].Error ) };
+            uint32_t Bits;
+            memcpy( &Bits, &Error, sizeof( Bits ) );
+            Keys[ i ] = ( Bits >> 20 ) & ( Buckets - 1 );
+            Offsets[ Keys[ i ] + 1 ]++;
+        }
+        for( uint32_t k{ 0 }; k < Buckets; k++ ) Offsets[ k + 1 ] += Offsets[ k ];
+        order.resize( candidates.size() );
+        for( size_t i{ 0 }; i < candidates.size(); i++ ) order[ Offsets[ Keys[ i ] ]++ ] = static_cast<uint32_t>( i );
+    }
+
+    void BuildAdjacency( const std::vector<uint32_t> &indices )
+    {
+        AdjacencyOffset.assign( Vertecies.size() + 1, 0 );
+        for( uint32_t Index : indices ) AdjacencyOffset[ Positions[ Index ] + 1 ]++;
+        for( size_t v{ 0 }; v < Vertecies.size(); v++ ) AdjacencyOffset[ v + 1 ] += AdjacencyOffset[ v ];
+        Adjacency.resize( indices.size() );
+        std::vector<uint32_t> Fill( AdjacencyOffset.begin(), AdjacencyOffset.end() - 1 );
+        for( size_t i{ 0 }; i < indices.size(); i++ ) Adjacency[ Fill[ Positions[ indices[ i ] ] ]++ ] = static_cast<uint32_t>( i / 3 );
+    }
+
+    Collapse Cost( uint32_t from, uint32_t to, const Edge &edge ) const
+    {
+        if( Complex[ from ] ) return {};
+        // Border vertecies may only slide along the border.
+        if( Border[ from ] && edge.Triangles != 1 ) return {};
+        Quadric Sum{ Quadrics[ from ] };
+        Sum += Quadrics[ to ];
+        return { from, to, Sum.Error( Points[ to ] ) / std::max( Sum.Weight, std::numeric_limits<double>::min() ) };
+    }
+
+    bool TryCollapse( const std::vector<uint32_t> &indices, const Collapse &collapse, std::vector<uint32_t> &remap, std::vector<uint8_t> &locked, size_t &remaining )
+    {
+        // Wedge mapping: from wedge, to wedge or Invalid.
+        Wedges.clear();
+        auto Target{ [ & ]( uint32_t wedge ) -> uint32_t &
+                     {
+                         for( auto &Entry : Wedges )
+                             if( Entry.first == wedge ) return Entry.second;
+                         Wedges.push_back( { wedge, Invalid } );
+                         return Wedges.back().second;
+                     } };
+        uint32_t Removed{ 0 };
+        for( uint32_t a{ AdjacencyOffset[ collapse.From ] }; a < AdjacencyOffset[ collapse.From + 1 ]; a++ )
+        {
+            const uint32_t *Triangle{ &indices[ Adjacency[ a ] * 3 ] };
+            uint32_t From{ 0 };
+            while( Positions[ Triangle[ From ] ] != collapse.From ) From++;
+            uint32_t &Mapped{ Target( Triangle[ From ] ) };
+            for( uint32_t k{ 0 }; k < 3; k++ )
+            {
+                if( Positions[ Triangle[ k ] ] != collapse.To ) continue;
+                if( Mapped != Invalid && Mapped != Triangle[ k ] ) return false;
+                Mapped = Triangle[ k ];
+                Removed++;
+            }
+        }
+        for( const auto &Entry : Wedges )
+            if( Entry.second == Invalid ) return false;
+        // Wedge mapping end
+
+        // Flip check
+        for( uint32_t a{ AdjacencyOffset[ collapse.From ] }; a < AdjacencyOffset[ collapse.From + 1 ]; a++ )
+        {
+            const uint32_t *Triangle{ &indices[ Adjacency[ a ] * 3 ] };
+            glm::vec3 Before[ 3 ], After[ 3 ];
+            bool Shared{ false };
+            for( uint32_t k{ 0 }; k < 3; k++ )
+            {
+                uint32_t Position{ Positions[ Triangle[ k ] ] };
+                Shared |= Position == collapse.To;
+                Before[ k ] = Points[ Position ];
+                After[ k ]  = Position == collapse.From ? Points[ collapse.To ] : Before[ k ];
+            }
+            if( Shared ) continue;
+            glm::vec3 NormalBefore{ glm::cross( Before[ 1 ] - Before[ 0 ], Before[ 2 ] - Before[ 0 ] ) };
+            glm::vec3 NormalAfter{ glm::cross( After[ 1 ] - After[ 0 ], After[ 2 ] - After[ 0 ] ) };
+            if( glm::dot( NormalBefore, NormalAfter ) <= 1e-2f * glm::length( NormalBefore ) * glm::length( NormalAfter ) ) return false;
+        }
+        // Flip check end
+
+        for( const auto &Entry : Wedges ) remap[ Entry.first ] = Entry.second;
+        Quadrics[ collapse.To ] += Quadrics[ collapse.From ];
+        for( uint32_t a{ AdjacencyOffset[ collapse.From ] }; a < AdjacencyOffset[ collapse.From + 1 ]; a++ )
+            for( uint32_t k{ 0 }; k < 3; k++ ) locked[ Positions[ indices[ Adjacency[ a ] * 3 + k ] ] ] = 1;
+        remaining -= Removed;
+        return true;
+    }
+};
+
+struct LodOptions
+{
+    // Triangle count of each level relative to the source mesh.
+    std::vector<float> Ratios{ 0.5f, 0.25f, 0.125f, 0.0625f };
+    // Largest accumulated error relative to the mesh extent.
+    float MaxError{ 0.05f };
+    // A level that keeps more than this share of its parent's triangles ends the chain.
+    float MinReduction{ 0.9f };
+};
+
+// Index range of one level inside LodChain::Mesh; VerteciesOffset and IndeciesOffset follow the
+// meaning they have in Model.
+struct MeshLod
+{
+    uint32_t VerteciesOffset{};
+    uint32_t IndeciesOffset{};
+    uint32_t IndicesCount{};
+    float Error{}; // relative to the mesh extent
+};
+
+// Every level indexes the same vertex buffer; their index ranges sit back to back in
+// Mesh.ModelVerteciesIndices, finest first.
+struct LodChain
+{
+    Model Mesh;
+    std::vector<MeshLod> Levels;
+};
+
+// Each level is simplified from the previous one, so errors add up along the chain.
+inline LodChain GenerateLods( const Model &source, const LodOptions &options = {} )
+{
+    LodChain Chain;
+    Chain.Mesh = source;
+    Chain.Levels.push_back( { source.VerteciesOffset, source.IndeciesOffset, static_cast<uint32_t>( source.ModelVerteciesIndices.size() ), 0.f } );
+    MeshSimplifier Simplifier{ source.ModelVertecies };
+    std::vector<uint32_t> Indices{ source.ModelVerteciesIndices };
+    float Error{ 0.f };
+    for( float Ratio : options.Ratios )
+    {
+        size_t Previous{ Indices.size() };
+        size_t Target{ static_cast<size_t>( source.ModelVerteciesIndices.size() / 3 * Ratio ) * 3 };
+        if( Target >= Previous ) continue;
+        Error += Simplifier.Simplify( Indices, Target, options.MaxError - Error );
+        if( Indices.empty() || Indices.size() > Previous * options.MinReduction ) break;
+        OptimizeVertexCache( Indices, source.ModelVertecies.size() );
+        MeshLod Level{ source.VerteciesOffset, static_cast<uint32_t>( source.IndeciesOffset + Chain.Mesh.ModelVerteciesIndices.size() ),
+                       static_cast<uint32_t>( Indices.size() ), Error };
+        Chain.Mesh.ModelVerteciesIndices.insert( Chain.Mesh.ModelVerteciesIndices.end(), Indices.begin(), Indices.end() );
+        Chain.Levels.push_back( Level );
+    }
+    return Chain;
+}
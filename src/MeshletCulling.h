@@ -0,0 +1,237 @@
+#pragma once
+#include "vulkan.h"
+#include "Meshlets.h"
+#include <span>
+#include <thread>
+#include <vector>
+#include <cstring>
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#    include <immintrin.h>
+#endif
+
+// Frustum planes ( xyz inward normal, w distance ) and camera position, both in model space so
+// MeshletBounds can be tested without transforming them.
+struct CullView
+{
+    std::array<glm::vec4, 6> Planes;
+    glm::vec3 Camera;
+};
+
+// Gribb-Hartmann extraction from proj * view * model; depth is 0..1, so the near plane is the
+// third row alone.
+inline CullView MakeCullView( const DemensionsUniformrObject &uniform )
+{
+    glm::mat4 Clip{ uniform.proj * uniform.view * uniform.model };
+    glm::vec4 Rows[ 4 ];
+    for( uint32_t i{ 0 }; i < 4; i++ ) Rows[ i ] = { Clip[ 0 ][ i ], Clip[ 1 ][ i ], Clip[ 2 ][ i ], Clip[ 3 ][ i ] };
+    CullView View;
+    View.Planes = { Rows[ 3 ] + Rows[ 0 ], Rows[ 3 ] - Rows[ 0 ], Rows[ 3 ] + Rows[ 1 ], Rows[ 3 ] - Rows[ 1 ], Rows[ 2 ], Rows[ 3 ] - Rows[ 2 ] };
+    for( auto &Plane : View.Planes ) Plane /= glm::length( glm::vec3{ Plane.x, Plane.y, Plane.z } );
+    glm::vec4 Camera{ glm::inverse( uniform.view * uniform.model )[ 3 ] };
+    View.Camera = glm::vec3{ Camera.x, Camera.y, Camera.z } / Camera.w;
+    return View;
+}
+
+// MeshletBounds in structure-of-arrays form, padded to a multiple of Width with entries that
+// never pass the frustum test.
+class MeshletCullData
+{
+  public:
+    static constexpr uint32_t Width{ 8 };
+
+    MeshletCullData() = default;
+    MeshletCullData( std::span<const MeshletBounds> bounds )
+    {
+        Assign( bounds );
+    }
+
+    void Assign( std::span<const MeshletBounds> bounds )
+    {
+        Count = static_cast<uint32_t>( bounds.size() );
+        size_t Padded{ ( bounds.size() + Width - 1 ) / Width * Width };
+        for( auto *Lane : { &X, &Y, &Z, &AxisX, &AxisY, &AxisZ, &Cutoff } ) Lane->assign( Padded, 0.f );
+        Radius.assign( Padded, -std::numeric_limits<float>::max() );
+        for( size_t i{ 0 }; i < bounds.size(); i++ )
+        {
+            X[ i ]      = bounds[ i ].Center.x;
+            Y[ i ]      = bounds[ i ].Center.y;
+            Z[ i ]      = bounds[ i ].Center.z;
+            Radius[ i ] = bounds[ i ].Radius;
+            AxisX[ i ]  = bounds[ i ].ConeAxis.x;
+            AxisY[ i ]  = bounds[ i ].ConeAxis.y;
+            AxisZ[ i ]  = bounds[ i ].ConeAxis.z;
+            Cutoff[ i ] = bounds[ i ].ConeCutoff;
+        }
+    }
+
+    uint32_t Size() const
+    {
+        return Count;
+    }
+    uint32_t PaddedSize() const
+    {
+        return static_cast<uint32_t>( X.size() );
+    }
+
+    std::vector<float> X, Y, Z, Radius, AxisX, AxisY, AxisZ, Cutoff;
+
+  private:
+    uint32_t Count{ 0 };
+};
+
+// Every kernel writes the indices of visible meshlets in [begin, end) to out, in order, and
+// returns how many it wrote; begin and end are multiples of MeshletCullData::Width or the
+// padded size.
+inline uint32_t CullMeshletsScalar( const MeshletCullData &data, const CullView &view, uint32_t begin, uint32_t end, uint32_t *out )
+{
+    uint32_t Written{ 0 };
+    for( uint32_t i{ begin }; i < end; i++ )
+    {
+        glm::vec3 Center{ data.X[ i ], data.Y[ i ], data.Z[ i ] };
+        bool Visible{ true };
+        for( const auto &Plane : view.Planes )
+            Visible &= Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w >= -data.Radius[ i ];
+        glm::vec3 Offset{ Center - view.Camera };
+        float Along{ Offset.x * data.AxisX[ i ] + Offset.y * data.AxisY[ i ] + Offset.z * data.AxisZ[ i ] };
+        Visible &= Along < data.Cutoff[ i ] * glm::length( Offset ) + data.Radius[ i ];
+        if( Visible ) out[ Written++ ] = i;
+    }
+    return Written;
+}
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+inline uint32_t CompactMask( uint32_t mask, uint32_t base, uint32_t *out )
+{
+    uint32_t Written{ 0 };
+    while( mask )
+    {
+#if defined( _MSC_VER )
+        unsigned long Bit;
+        _BitScanForward( &Bit, mask );
+#else
+        uint32_t Bit{ static_cast<uint32_t>( __builtin_ctz( mask ) ) };
+#endif
+        out[ Written++ ] = base + Bit;
+        mask &= mask - 1;
+    }
+    return Written;
+}
+
+inline uint32_t CullMeshletsSse( const MeshletCullData &data, const CullView &view, uint32_t begin, uint32_t end, uint32_t *out )
+{
+    __m128 Planes[ 6 ][ 4 ];
+    for( uint32_t p{ 0 }; p < 6; p++ )
+        for( uint32_t k{ 0 }; k < 4; k++ ) Planes[ p ][ k ] = _mm_set1_ps( view.Planes[ p ][ k ] );
+    const __m128 CameraX{ _mm_set1_ps( view.Camera.x ) }, CameraY{ _mm_set1_ps( view.Camera.y ) }, CameraZ{ _mm_set1_ps( view.Camera.z ) };
+    const __m128 Zero{ _mm_setzero_ps() };
+    uint32_t Written{ 0 };
+    for( uint32_t i{ begin }; i < end; i += 4 )
+    {
+        __m128 X{ _mm_loadu_ps( &data.X[ i ] ) }, Y{ _mm_loadu_ps( &data.Y[ i ] ) }, Z{ _mm_loadu_ps( &data.Z[ i ] ) };
+        __m128 Radius{ _mm_loadu_ps( &data.Radius[ i ] ) };
+        __m128 NegativeRadius{ _mm_sub_ps( Zero, Radius ) };
+        __m128 Visible{ _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) };
+        for( uint32_t p{ 0 }; p < 6; p++ )
+        {
+            __m128 Distance{ _mm_add_ps( _mm_add_ps( _mm_mul_ps( Planes[ p ][ 0 ], X ), _mm_mul_ps( Planes[ p ][ 1 ], Y ) ),
+                                         _mm_add_ps( _mm_mul_ps( Planes[ p ][ 2 ], Z ), Planes[ p ][ 3 ] ) ) };
+            Visible = _mm_and_ps( Visible, _mm_cmpge_ps( Distance, NegativeRadius ) );
+        }
+        __m128 OffsetX{ _mm_sub_ps( X, CameraX ) }, OffsetY{ _mm_sub_ps( Y, CameraY ) }, OffsetZ{ _mm_sub_ps( Z, CameraZ ) };
+        __m128 Along{ _mm_add_ps( _mm_add_ps( _mm_mul_ps( OffsetX, _mm_loadu_ps( &data.AxisX[ i ] ) ), _mm_mul_ps( OffsetY, _mm_loadu_ps( &data.AxisY[ i ] ) ) ),
+                                  _mm_mul_ps( OffsetZ, _mm_loadu_ps( &data.AxisZ[ i ] ) ) ) };
+        __m128 Length{ _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( OffsetX, OffsetX ), _mm_mul_ps( OffsetY, OffsetY ) ), _mm_mul_ps( OffsetZ, OffsetZ ) ) ) };
+        __m128 Limit{ _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &data.Cutoff[ i ] ), Length ), Radius ) };
+        Visible = _mm_and_ps( Visible, _mm_cmplt_ps( Along, Limit ) );
+        Written += CompactMask( static_cast<uint32_t>( _mm_movemask_ps( Visible ) ), i, out + Written );
+    }
+    return Written;
+}
+#endif
+
+#if defined( __AVX2__ )
+inline uint32_t CullMeshletsAvx2( const MeshletCullData &data, const CullView &view, uint32_t begin, uint32_t end, uint32_t *out )
+{
+    __m256 Planes[ 6 ][ 4 ];
+    for( uint32_t p{ 0 }; p < 6; p++ )
+        for( uint32_t k{ 0 }; k < 4; k++ ) Planes[ p ][ k ] = _mm256_set1_ps( view.Planes[ p ][ k ] );
+    const __m256 CameraX{ _mm256_set1_ps( view.Camera.x ) }, CameraY{ _mm256_set1_ps( view.Camera.y ) }, CameraZ{ _mm256_set1_ps( view.Camera.z ) };
+    const __m256 Zero{ _mm256_setzero_ps() };
+    uint32_t Written{ 0 };
+    for( uint32_t i{ begin }; i < end; i += 8 )
+    {
+        __m256 X{ _mm256_loadu_ps( &data.X[ i ] ) }, Y{ _mm256_loadu_ps( &data.Y[ i ] ) }, Z{ _mm256_loadu_ps( &data.Z[ i ] ) };
+        __m256 Radius{ _mm256_loadu_ps( &data.Radius[ i ] ) };
+        __m256 NegativeRadius{ _mm256_sub_ps( Zero, Radius ) };
+        __m256 Visible{ _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) ) };
+        for( uint32_t p{ 0 }; p < 6; p++ )
+        {
+            __m256 Distance{ _mm256_fmadd_ps( Planes[ p ][ 0 ], X, _mm256_fmadd_ps( Planes[ p ][ 1 ], Y, _mm256_fmadd_ps( Planes[ p ][ 2 ], Z, Planes[ p ][ 3 ] ) ) ) };
+            Visible = _mm256_and_ps( Visible, _mm256_cmp_ps( Distance, NegativeRadius, _CMP_GE_OQ ) );
+        }
+        __m256 OffsetX{ _mm256_sub_ps( X, CameraX ) }, OffsetY{ _mm256_sub_ps( Y, CameraY ) }, OffsetZ{ _mm256_sub_ps( Z, CameraZ ) };
+        __m256 Along{ _mm256_fmadd_ps( OffsetX, _mm256_loadu_ps( &data.AxisX[ i ] ),
+                                       _mm256_fmadd_ps( OffsetY, _mm256_loadu_ps( &data.AxisY[ i ] ), _mm256_mul_ps( OffsetZ, _mm256_loadu_ps( &data.AxisZ[ i ] ) ) ) ) };
+        __m256 Length{ _mm256_sqrt_ps( _mm256_fmadd_ps( OffsetX, OffsetX, _mm256_fmadd_ps( OffsetY, OffsetY, _mm256_mul_ps( OffsetZ, OffsetZ ) ) ) ) };
+        __m256 Limit{ _mm256_fmadd_ps( _mm256_loadu_ps( &data.Cutoff[ i ] ), Length, Radius ) };
+        Visible = _mm256_and_ps( Visible, _mm256_cmp_ps( Along, Limit, _CMP_LT_OQ ) );
+        Written += CompactMask( static_cast<uint32_t>( _mm256_movemask_ps( Visible ) ), i, out + Written );
+    }
+    return Written;
+}
+#endif
+
+// Widest kernel this translation unit was compiled for; AVX2 needs ENABLE_AVX2 in CMake, and
+// targets without SSE, ARM64 among them, run the scalar one.
+inline uint32_t CullMeshlets( const MeshletCullData &data, const CullView &view, uint32_t begin, uint32_t end, uint32_t *out )
+{
+#if defined( __AVX2__ )
+    return CullMeshletsAvx2( data, view, begin, end, out );
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    return CullMeshletsSse( data, view, begin, end, out );
+#else
+    return CullMeshletsScalar( data, view, begin, end, out );
+#endif
+}
+
+inline const char *CullMeshletsKernel()
+{
+#if defined( __AVX2__ )
+    return "AVX2";
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+// Splits the meshlets into one range per thread; every thread compacts into its own slice of
+// out, and the slices are then moved together. out must hold PaddedSize() entries.
+inline uint32_t CullMeshletsParallel( const MeshletCullData &data, const CullView &view, std::vector<uint32_t> &out, uint32_t threads = std::thread::hardware_concurrency() )
+{
+    const uint32_t Blocks{ data.PaddedSize() / MeshletCullData::Width };
+    const uint32_t Workers{ std::max( 1u, std::min( threads, Blocks ) ) };
+    out.resize( data.PaddedSize() );
+    std::vector<uint32_t> Written( Workers, 0 );
+    auto Job{ [ & ]( uint32_t worker )
+              {
+                  uint32_t Begin{ Blocks * worker / Workers * MeshletCullData::Width };
+                  uint32_t End{ Blocks * ( worker + 1 ) / Workers * MeshletCullData::Width };
+                  Written[ worker ] = CullMeshlets( data, view, Begin, End, out.data() + Begin );
+              } };
+    std::vector<std::thread> Pool;
+    Pool.reserve( Workers - 1 );
+    for( uint32_t i{ 1 }; i < Workers; i++ ) Pool.emplace_back( Job, i );
+    Job( 0 );
+    for( auto &Thread : Pool ) Thread.join();
+
+    uint32_t Count{ Written[ 0 ] };
+    for( uint32_t Worker{ 1 }; Worker < Workers; Worker++ )
+    {
+        uint32_t Begin{ Blocks * Worker / Workers * MeshletCullData::Width };
+        memmove( out.data() + Count, out.data() + Begin, Written[ Worker ] * sizeof( uint32_t ) );
+        Count += Written[ Worker ];
+    }
+    out.resize( Count );
+    return Count;
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include "vulkan.h"
+#include <span>
+#include <array>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+const uint32_t MeshletMaxVertecies{ 64 };
+const uint32_t MeshletMaxTriangles{ 124 };
+
+// Ranges into MeshletMesh::Vertecies and MeshletMesh::Triangles.
+struct Meshlet
+{
+    uint32_t VerteciesOffset{};
+    uint32_t TrianglesOffset{};
+    uint32_t VerteciesCount{};
+    uint32_t TrianglesCount{};
+};
+
+// Bounding sphere and normal cone in model space. A meshlet is back-facing for every camera
+// position where dot( Center - camera, ConeAxis ) >= ConeCutoff * |Center - camera| + Radius;
+// ConeCutoff is 1 when the normals spread too far for the test to ever pass.
+struct MeshletBounds
+{
+    glm::vec3 Center{ 0.f };
+    float Radius{ 0.f };
+    glm::vec3 ConeAxis{ 0.f, 0.f, 1.f };
+    float ConeCutoff{ 1.f };
+};
+
+struct MeshletMesh
+{
+    std::vector<Meshlet> Meshlets;
+    std::vector<MeshletBounds> Bounds;
+    std::vector<uint32_t> Vertecies; // meshlet-local to mesh vertex index
+    std::vector<uint8_t> Triangles; // three meshlet-local indices per triangle
+};
+
+inline MeshletBounds ComputeMeshletBounds( std::span<const Vertex> vertecies, const MeshletMesh &mesh, const Meshlet &meshlet )
+{
+    MeshletBounds Bounds;
+    auto Point{ [ & ]( uint32_t local )
+                { return vertecies[ mesh.Vertecies[ meshlet.VerteciesOffset + local ] ].coordinate; } };
+    if( !meshlet.VerteciesCount ) return Bounds;
+
+    // Ritter: sphere over the two mutually far points, grown to cover the rest.
+    auto Farthest{ [ & ]( const glm::vec3 &from )
+                   {
+                       uint32_t Result{ 0 };
+                       float Distance{ -1.f };
+                       for( uint32_t v{ 0 }; v < meshlet.VerteciesCount; v++ )
+                       {
+                           glm::vec3 Offset{ Point( v ) - from };
+                           if( glm::dot( Offset, Offset ) > Distance )
+                           {
+                               Distance = glm::dot( Offset, Offset );
+                               Result   = v;
+                           }
+                       }
+                       return Point( Result );
+                   } };
+    glm::vec3 a{ Farthest( Point( 0 ) ) };
+    glm::vec3 b{ Farthest( a ) };
+    Bounds.Center = ( a + b ) * 0.5f;
+    Bounds.Radius = glm::length( b - a ) * 0.5f;
+    for( uint32_t v{ 0 }; v < meshlet.VerteciesCount; v++ )
+    {
+        float Distance{ glm::length( Point( v ) - Bounds.Center ) };
+        if( Distance <= Bounds.Radius ) continue;
+        float Radius{ ( Bounds.Radius + Distance ) * 0.5f };
+        Bounds.Center += ( Point( v ) - Bounds.Center ) * ( ( Radius - Bounds.Radius ) / Distance );
+        Bounds.Radius = Radius;
+    }
+
+    // Normal cone
+    std::vector<glm::vec3> Normals;
+    Normals.reserve( meshlet.TrianglesCount );
+    glm::vec3 Axis{ 0.f };
+    for( uint32_t t{ 0 }; t < meshlet.TrianglesCount; t++ )
+    {
+        const uint8_t *Triangle{ &mesh.Triangles[ meshlet.TrianglesOffset + t * 3 ] };
+        glm::vec3 p0{ Point( Triangle[ 0 ] ) }, p1{ Point( Triangle[ 1 ] ) }, p2{ Point( Triangle[ 2 ] ) };
+        glm::vec3 Normal{ glm::cross( p1 - p0, p2 - p0 ) };
+        float Length{ glm::length( Normal ) };
+        if( Length <= 0.f ) continue;
+        Normals.push_back( Normal / Length );
+        Axis += Normals.back();
+    }
+    float AxisLength{ glm::length( Axis ) };
+    if( Normals.empty() || AxisLength <= 0.f ) return Bounds;
+    Bounds.ConeAxis = Axis / AxisLength;
+    float MinDot{ 1.f };
+    for( const auto &Normal : Normals ) MinDot = std::min( MinDot, glm::dot( Normal, Bounds.ConeAxis ) );
+    // The cone of back-facing view directions opens by the normal spread plus 90 degrees.
+    Bounds.ConeCutoff = MinDot <= 0.1f ? 1.f : std::sqrt( 1.f - MinDot * MinDot );
+    return Bounds;
+}
+
+// Greedy clustering: a meshlet grows by the adjacent triangle that adds the fewest new
+// vertecies and is flushed once the next triangle no longer fits. Seeds follow index order,
+// which after OptimizeMesh is already spatially coherent.
+inline MeshletMesh BuildMeshlets( std::span<const Vertex> vertecies, std::span<const uint32_t> indices, uint32_t maxVertecies = MeshletMaxVertecies, uint32_t maxTriangles = MeshletMaxTriangles )
+{
+    constexpr uint32_t Unassigned{ ~0u };
+    MeshletMesh Mesh;
+    const uint32_t TrianglesCount{ static_cast<uint32_t>( indices.size() / 3 ) };
+    // A meshlet has to fit at least one triangle, or no triangle is ever accepted.
+    maxVertecies = std::clamp<uint32_t>( maxVertecies, 3, 256 );
+    maxTriangles = std::max<uint32_t>( maxTriangles, 1 );
+
+    // Vertex to triangle adjacency
+    std::vector<uint32_t> AdjacencyOffset( vertecies.size() + 1, 0 );
+    for( uint32_t Index : indices ) AdjacencyOffset[ Index + 1 ]++;
+    for( size_t v{ 0 }; v < vertecies.size(); v++ ) AdjacencyOffset[ v + 1 ] += AdjacencyOffset[ v ];
+    std::vector<uint32_t> Adjacency( indices.size() );
+    {
+        std::vector<uint32_t> Fill( AdjacencyOffset.begin(), AdjacencyOffset.end() - 1 );
+        for( size_t i{ 0 }; i < indices.size(); i++ ) Adjacency[ Fill[ indices[ i ] ]++ ] = static_cast<uint32_t>( i / 3 );
+    }
+    // Vertex to triangle adjacency end
+
+    // Candidates are bucketed by how many of their corners are still missing from the current
+    // meshlet; stale bucket entries are skipped when reached.
+    std::vector<uint8_t> Emitted( TrianglesCount, 0 );
+    std::vector<uint8_t> Missing( TrianglesCount, 3 );
+    std::vector<uint32_t> Local( vertecies.size(), Unassigned );
+    std::array<std::vector<uint32_t>, 3> Candidates;
+    std::array<size_t, 3> Heads{}; // oldest entries first, so meshlets grow ring by ring
+    Meshlet Current;
+    uint32_t Seed{ 0 };
+    auto Flush{ [ & ]
+                {
+                    if( !Current.TrianglesCount ) return;
+                    for( uint32_t v{ 0 }; v < Current.VerteciesCount; v++ )
+                    {
+                        uint32_t Index{ Mesh.Vertecies[ Current.VerteciesOffset + v ] };
+                        Local[ Index ] = Unassigned;
+                        for( uint32_t a{ AdjacencyOffset[ Index ] }; a < AdjacencyOffset[ Index + 1 ]; a++ ) Missing[ Adjacency[ a ] ] = 3;
+                    }
+                    for( auto &Bucket : Candidates ) Bucket.clear();
+                    Heads = {};
+                    Mesh.Meshlets.push_back( Current );
+                    Current = { static_cast<uint32_t>( Mesh.Vertecies.size() ), static_cast<uint32_t>( Mesh.Triangles.size() ), 0, 0 };
+                } };
+    while( true )
+    {
+        // Best connected candidate
+        uint32_t Best{ Unassigned };
+        for( uint32_t New{ 0 }; New < 3 && Best == Unassigned; New++ )
+        {
+            auto &Bucket{ Candidates[ New ] };
+            auto &Head{ Heads[ New ] };
+            while( Head < Bucket.size() && ( Emitted[ Bucket[ Head ] ] || Missing[ Bucket[ Head ] ] != New ) ) Head++;
+            if( Head < Bucket.size() ) Best = Bucket[ Head ];
+        }
+        if( Best == Unassigned )
+        {
+            while( Seed < TrianglesCount && Emitted[ Seed ] ) Seed++;
+            if( Seed == TrianglesCount ) break;
+            Best = Seed;
+        }
+        if( Current.VerteciesCount + Missing[ Best ] > maxVertecies || Current.TrianglesCount + 1 > maxTriangles )
+        {
+            Flush();
+            continue;
+        }
+
+        Emitted[ Best ] = 1;
+        for( uint32_t k{ 0 }; k < 3; k++ )
+        {
+            uint32_t v{ indices[ Best * 3 + k ] };
+            if( Local[ v ] == Unassigned )
+            {
+                Local[ v ] = Current.VerteciesCount++;
+                Mesh.Vertecies.push_back( v );
+                for( uint32_t a{ AdjacencyOffset[ v ] }; a < AdjacencyOffset[ v + 1 ]; a++ )
+                {
+                    uint32_t Triangle{ Adjacency[ a ] };
+                    Missing[ Triangle ]--;
+                    if( !Emitted[ Triangle ] ) Candidates[ Missing[ Triangle ] ].push_back( Triangle );
+                }
+            }
+            Mesh.Triangles.push_back( static_cast<uint8_t>( Local[ v ] ) );
+        }
+        Current.TrianglesCount++;
+    }
+    Flush();
+
+    Mesh.Bounds.reserve( Mesh.Meshlets.size() );
+    for( const auto &Entry : Mesh.Meshlets ) Mesh.Bounds.push_back( ComputeMeshletBounds( vertecies, Mesh, Entry ) );
+    return Mesh;
+}
@@ -0,0 +1,341 @@
+#pragma once
+#include "vulkan.h"
+#include "MappedFile.h"
+#include "VertexDedup.h"
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+// Wavefront OBJ loader: the file is memory-mapped, split into line-aligned chunks and every chunk
+// is parsed on its own thread. Only v (with optional vertex colors), vt and f are read.
+class ObjLoader
+{
+  public:
+    ObjLoader( uint32_t threads = std::thread::hardware_concurrency() ) : Threads{ threads ? threads : 1 } {}
+
+    void Load( const char *path, Model &model )
+    {
+        MappedFile File{ path };
+        Parse( reinterpret_cast<const char *>( File.Data() ), File.Size(), model );
+    }
+
+    void Parse( const char *data, size_t size, Model &model )
+    {
+        model.ModelVertecies.clear();
+        model.ModelVerteciesIndices.clear();
+        if( !size ) return;
+
+        // Chunks
+        size_t ChunksCount{ std::max<size_t>( 1, std::min<size_t>( Threads, size / MinChunkSize ) ) };
+        std::vector<const char *> Bounds{ data };
+        for( size_t i{ 1 }; i < ChunksCount; i++ )
+        {
+            const char *Split{ data + size * i / ChunksCount };
+            if( Split <= Bounds.back() ) continue;
+            const char *LineEnd{ static_cast<const char *>( memchr( Split, '\n', data + size - Split ) ) };
+            if( !LineEnd ) break;
+            Bounds.push_back( LineEnd + 1 );
+        }
+        Bounds.push_back( data + size );
+        ChunksCount = Bounds.size() - 1;
+
+        std::vector<Chunk> Chunks( ChunksCount );
+        RunParallel( ChunksCount, [ & ]( size_t i )
+                     { ParseChunk( Bounds[ i ], Bounds[ i + 1 ], Chunks[ i ] ); } );
+        // Chunks end
+
+        // Merge
+        std::vector<glm::vec3> Positions;
+        std::vector<glm::vec3> Colors;
+        std::vector<glm::vec2> Texcoords;
+        std::vector<uint32_t> PositionsBase( ChunksCount + 1 );
+        std::vector<uint32_t> TexcoordsBase( ChunksCount + 1 );
+        std::vector<size_t> CornersBase( ChunksCount + 1 );
+        bool HasColors{ false };
+        for( size_t i{ 0 }; i < ChunksCount; i++ )
+        {
+            PositionsBase[ i + 1 ] = PositionsBase[ i ] + static_cast<uint32_t>( Chunks[ i ].Positions.size() );
+            TexcoordsBase[ i + 1 ] = TexcoordsBase[ i ] + static_cast<uint32_t>( Chunks[ i ].Texcoords.size() );
+            CornersBase[ i + 1 ]   = CornersBase[ i ] + Chunks[ i ].Corners.size();
+            HasColors |= !Chunks[ i ].Colors.empty();
+        }
+        Positions.resize( PositionsBase.back() );
+        Texcoords.resize( TexcoordsBase.back() );
+        if( HasColors ) Colors.resize( PositionsBase.back(), glm::vec3{ 1.f } );
+
+        std::vector<Vertex> Corners( CornersBase.back() );
+        RunParallel( ChunksCount, [ & ]( size_t i )
+                     {
+                         Chunk &Part{ Chunks[ i ] };
+                         std::copy( Part.Positions.begin(), Part.Positions.end(), Positions.begin() + PositionsBase[ i ] );
+                         std::copy( Part.Texcoords.begin(), Part.Texcoords.end(), Texcoords.begin() + TexcoordsBase[ i ] );
+                         if( !Part.Colors.empty() )
+                             std::copy( Part.Colors.begin(), Part.Colors.end(), Colors.begin() + PositionsBase[ i ] );
+                         for( const auto &Fixup : Part.RelativeFixups )
+                         {
+                             Corner &Relative{ Part.Corners[ Fixup.first ] };
+                             if( Fixup.second & RelativePosition ) Relative.Position += PositionsBase[ i ];
+                             if( Fixup.second & RelativeTexcoord ) Relative.Texcoord += TexcoordsBase[ i ];
+                         } } );
+        RunParallel( ChunksCount, [ & ]( size_t i )
+                     {
+                         size_t Out{ CornersBase[ i ] };
+                         for( const auto &Index : Chunks[ i ].Corners )
+                         {
+                             Vertex &Result{ Corners[ Out++ ] };
+                             Result.coordinate = Index.Position >= 0 && Index.Position < static_cast<int64_t>( Positions.size() ) ? Positions[ Index.Position ] : glm::vec3{ 0.f };
+                             Result.color      = glm::vec4{ HasColors && Index.Position >= 0 && Index.Position < static_cast<int64_t>( Colors.size() ) ? Colors[ Index.Position ] : glm::vec3{ 1.f }, 1.f };
+                             if( Index.Texcoord >= 0 && Index.Texcoord < static_cast<int64_t>( Texcoords.size() ) )
+                                 Result.texture = { Texcoords[ Index.Texcoord ].x, 1.f - Texcoords[ Index.Texcoord ].y };
+                             else
+                                 Result.texture = glm::vec2{ 0.f };
+                         } } );
+        Chunks.clear();
+
+        VertexDedup{ Threads }.Run( Corners, model );
+        // Merge end
+    }
+
+    static const char *ParseFloat( const char *p, const char *end, float &value )
+    {
+        static constexpr double Pow10[]{ 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const char *Start{ p };
+        bool Negative{ false };
+        if( p < end && ( *p == '-' || *p == '+' ) ) Negative = *p++ == '-';
+        uint64_t Mantissa{ 0 };
+        int32_t Exponent{ 0 };
+        int32_t Digits{ 0 };
+        bool Any{ false };
+        for( ; p < end && IsDigit( *p ); p++, Any = true )
+        {
+            if( Digits < 19 )
+            {
+                Mantissa = Mantissa * 10 + ( *p - '0' );
+                Digits += Mantissa != 0;
+            }
+            else
+                Exponent++;
+        }
+        if( p < end && *p == '.' )
+        {
+            for( p++; p < end && IsDigit( *p ); p++, Any = true )
+            {
+                if( Digits < 19 )
+                {
+                    Mantissa = Mantissa * 10 + ( *p - '0' );
+                    Digits += Mantissa != 0;
+                    Exponent--;
+                }
+            }
+        }
+        if( !Any )
+        {
+            value = 0.f;
+            return Start;
+        }
+        if( p < end && ( *p == 'e' || *p == 'E' ) )
+        {
+            const char *ExponentStart{ p++ };
+            bool NegativeExponent{ false };
+            if( p < end && ( *p == '-' || *p == '+' ) ) NegativeExponent = *p++ == '-';
+            if( p < end && IsDigit( *p ) )
+            {
+                int32_t Explicit{ 0 };
+                for( ; p < end && IsDigit( *p ); p++ )
+                    if( Explicit < 10000 ) Explicit = Explicit * 10 + ( *p - '0' );
+                Exponent += NegativeExponent ? -Explicit : Explicit;
+            }
+            else
+                p = ExponentStart;
+        }
+        double Result{ static_cast<double>( Mantissa ) };
+        if( Exponent >= 0 && Exponent <= 22 && Mantissa < ( 1ull << 53 ) )
+            Result *= Pow10[ Exponent ];
+        else if( Exponent < 0 && Exponent >= -22 && Mantissa < ( 1ull << 53 ) )
+            Result /= Pow10[ -Exponent ];
+        else if( Mantissa )
+            Result *= std::pow( 10.0, Exponent );
+        value = static_cast<float>( Negative ? -Result : Result );
+        return p;
+    }
+
+    static const char *ParseInt( const char *p, const char *end, int64_t &value )
+    {
+        const char *Start{ p };
+        bool Negative{ false };
+        if( p < end && ( *p == '-' || *p == '+' ) ) Negative = *p++ == '-';
+        if( p == end || !IsDigit( *p ) )
+        {
+            value = 0;
+            return Start;
+        }
+        int64_t Result{ 0 };
+        for( ; p < end && IsDigit( *p ); p++ )
+            Result = Result * 10 + ( *p - '0' );
+        value = Negative ? -Result : Result;
+        return p;
+    }
+
+  private:
+    static constexpr size_t MinChunkSize{ 64 * 1024 };
+    static constexpr uint8_t RelativePosition{ 1 };
+    static constexpr uint8_t RelativeTexcoord{ 2 };
+    uint32_t Threads;
+
+    // Absolute zero-based indices, or chunk-relative ones listed in RelativeFixups. -1 if missing.
+    struct Corner
+    {
+        int64_t Position;
+        int64_t Texcoord;
+    };
+
+    struct Chunk
+    {
+        std::vector<glm::vec3> Positions;
+        std::vector<glm::vec3> Colors;
+        std::vector<glm::vec2> Texcoords;
+        std::vector<Corner> Corners;
+        std::vector<std::pair<size_t, uint8_t>> RelativeFixups;
+    };
+
+    static bool IsDigit( char c )
+    {
+        return static_cast<unsigned char>( c - '0' ) < 10;
+    }
+    static bool IsSpace( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+    static const char *SkipSpaces( const char *p, const char *end )
+    {
+        while( p < end && IsSpace( *p ) ) p++;
+        return p;
+    }
+
+    template <typename F>
+    static void RunParallel( size_t count, F &&job )
+    {
+        if( count == 1 )
+        {
+            job( 0 );
+            return;
+        }
+        std::vector<std::thread> Workers;
+        Workers.reserve( count - 1 );
+        for( size_t i{ 1 }; i < count; i++ )
+            Workers.emplace_back( job, i );
+        job( 0 );
+        for( auto &Worker : Workers ) Worker.join();
+    }
+
+    static void ParseChunk( const char *p, const char *end, Chunk &chunk )
+    {
+        size_t Estimate{ static_cast<size_t>( end - p ) / 32 };
+        chunk.Positions.reserve( Estimate );
+        chunk.Texcoords.reserve( Estimate );
+        chunk.Corners.reserve( Estimate * 3 );
+        std::vector<Corner> Polygon;
+        std::vector<uint8_t> PolygonRelative;
+        while( p < end )
+        {
+            const char *LineEnd{ static_cast<const char *>( memchr( p, '\n', end - p ) ) };
+            if( !LineEnd ) LineEnd = end;
+            p = SkipSpaces( p, LineEnd );
+            if( LineEnd - p > 2 && p[ 0 ] == 'v' && IsSpace( p[ 1 ] ) )
+            {
+                glm::vec3 Position{ 0.f };
+                p = SkipSpaces( p + 2, LineEnd );
+                for( int i{ 0 }; i < 3; i++ )
+                    p = SkipSpaces( ParseFloat( p, LineEnd, Position[ i ] ), LineEnd );
+                chunk.Positions.push_back( Position );
+                if( p < LineEnd )
+                {
+                    // Three more values are a color; a single fourth one is the w of a
+                    // homogeneous position and is ignored.
+                    glm::vec3 Color{ 1.f };
+                    int Values{ 0 };
+                    for( ; Values < 3; Values++ )
+                    {
+                        const char *Value{ ParseFloat( p, LineEnd, Color[ Values ] ) };
+                        if( Value == p ) break;
+                        p = SkipSpaces( Value, LineEnd );
+                    }
+                    if( Values == 3 )
+                    {
+                        chunk.Colors.resize( chunk.Positions.size() - 1, glm::vec3{ 1.f } );
+                        chunk.Colors.push_back( Color );
+                    }
+                }
+            }
+            else if( LineEnd - p > 3 && p[ 0 ] == 'v' && p[ 1 ] == 't' && IsSpace( p[ 2 ] ) )
+            {
+                glm::vec2 Texcoord{ 0.f };
+                p = SkipSpaces( p + 3, LineEnd );
+                for( int i{ 0 }; i < 2; i++ )
+                    p = SkipSpaces( ParseFloat( p, LineEnd, Texcoord[ i ] ), LineEnd );
+                chunk.Texcoords.push_back( Texcoord );
+            }
+            else if( LineEnd - p > 2 && p[ 0 ] == 'f' && IsSpace( p[ 1 ] ) )
+            {
+                Polygon.clear();
+                PolygonRelative.clear();
+                p = SkipSpaces( p + 2, LineEnd );
+                while( p < LineEnd )
+                {
+                    int64_t Index{ 0 };
+                    Corner Face{ -1, -1 };
+                    uint8_t Relative{ 0 };
+                    const char *Next{ ParseInt( p, LineEnd, Index ) };
+                    if( Next == p ) break;
+                    p = Next;
+                    if( Index < 0 )
+                    {
+                        Face.Position = static_cast<int64_t>( chunk.Positions.size() ) + Index;
+                        Relative |= RelativePosition;
+                    }
+                    else
+                        Face.Position = Index - 1;
+                    if( p < LineEnd && *p == '/' )
+                    {
+                        p++;
+                        Next = ParseInt( p, LineEnd, Index );
+                        if( Next != p )
+                        {
+                            if( Index < 0 )
+                            {
+                                Face.Texcoord = static_cast<int64_t>( chunk.Texcoords.size() ) + Index;
+                                Relative |= RelativeTexcoord;
+                            }
+                            else
+                                Face.Texcoord = Index - 1;
+                            p = Next;
+                        }
+                        if( p < LineEnd && *p == '/' )
+                        {
+                            p++;
+                            ParseInt( p, LineEnd, Index );
+                            while( p < LineEnd && !IsSpace( *p ) ) p++;
+                        }
+                    }
+                    Polygon.push_back( Face );
+                    PolygonRelative.push_back( Relative );
+                    p = SkipSpaces( p, LineEnd );
+                }
+                for( size_t i{ 2 }; i < Polygon.size(); i++ )
+                {
+                    for( size_t Point : { size_t{ 0 }, i - 1, i } )
+                    {
+                        if( PolygonRelative[ Point ] )
+                            chunk.RelativeFixups.emplace_back( chunk.Corners.size(), PolygonRelative[ Point ] );
+                        chunk.Corners.push_back( Polygon[ Point ] );
+                    }
+                }
+            }
+            p = LineEnd + 1;
+        }
+        if( !chunk.Colors.empty() ) chunk.Colors.resize( chunk.Positions.size(), glm::vec3{ 1.f } );
+    }
+};
@@ -0,0 +1,407 @@
+#pragma once
+#include "DeviceMemory.h"
+#include "Profiler.h"
+#include <span>
+#include <chrono>
+#include <format>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <functional>
+
+// Color and depth images a frame renders into when there is no surface, and a host visible
+// buffer the color is copied to at the end of every frame. Frames are submitted to the
+// graphics queue one at a time and waited for, so ReadBack always sees the last one. A frame
+// may also be drawn in two render passes, for occlusion culling against its own early depth.
+
+struct OffscreenFrameTimes
+{
+    double CpuMs{ 0.0 };   // recording and submit
+    double FrameMs{ 0.0 }; // until the fence signalled
+    double GpuMs{ 0.0 };   // between the first and last command, 0 without timestamps
+};
+
+class OffscreenTarget
+{
+  public:
+    // timestampPeriod is VkPhysicalDeviceLimits::timestampPeriod, or 0 where the graphics queue
+    // has no timestamps; timestampBits is the queue family's timestampValidBits.
+    OffscreenTarget( VkDevice device, DeviceMemoryAllocator &memory, VkQueue queue, uint32_t family, VkExtent2D extent, float timestampPeriod = 0.f, uint32_t timestampBits = 64,
+                     VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM, VkFormat depthFormat = VK_FORMAT_D32_SFLOAT )
+        : Device{ device }, Memory{ memory }, Queue{ queue }, TargetExtent{ extent }, TimestampPeriod{ timestampPeriod }, ColorFormat{ colorFormat }, DepthFormat{ depthFormat }
+    {
+        ColorImage = CreateImage( ColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, ColorMemory );
+        DepthImage = CreateImage( DepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, DepthMemory );
+        ColorView  = CreateView( ColorImage, ColorFormat, VK_IMAGE_ASPECT_COLOR_BIT );
+        DepthView  = CreateView( DepthImage, DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT );
+        Readback   = Memory.CreateBuffer( VkDeviceSize( extent.width ) * extent.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                            VK_MEMORY_PROPERTY_HOST_CACHED_BIT, ReadbackMemory );
+        if( !ReadbackMemory.Mapped ) throw std::runtime_error( "Readback memory is not mapped." );
+        CreateRenderPass();
+
+        VkImageView Attachments[ 2 ]{ ColorView, DepthView };
+        VkFramebufferCreateInfo FramebufferCreateInfo{};
+        FramebufferCreateInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        FramebufferCreateInfo.renderPass      = Pass;
+        FramebufferCreateInfo.attachmentCount = 2;
+        FramebufferCreateInfo.pAttachments    = Attachments;
+        FramebufferCreateInfo.width           = extent.width;
+        FramebufferCreateInfo.height          = extent.height;
+        FramebufferCreateInfo.layers          = 1;
+        VkResult Result{ vkCreateFramebuffer( Device, &FramebufferCreateInfo, nullptr, &Target ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen framebuffer, error: {}", string_VkResult( Result ) ) );
+
+        VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+        CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        CommandPoolCreateInfo.queueFamilyIndex = family;
+        Result                                 = vkCreateCommandPool( Device, &CommandPoolCreateInfo, nullptr, &CommandPool );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen command pool, error: {}", string_VkResult( Result ) ) );
+        VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+        CommandBufferAllocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        CommandBufferAllocateInfo.commandPool        = CommandPool;
+        CommandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        CommandBufferAllocateInfo.commandBufferCount = 1;
+        Result                                       = vkAllocateCommandBuffers( Device, &CommandBufferAllocateInfo, &Commands );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate offscreen command buffer, error: {}", string_VkResult( Result ) ) );
+        VkFenceCreateInfo FenceCreateInfo{};
+        FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        Result                = vkCreateFence( Device, &FenceCreateInfo, nullptr, &Done );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen fence, error: {}", string_VkResult( Result ) ) );
+        if( TimestampPeriod > 0.f )
+        {
+            VkQueryPoolCreateInfo QueryPoolCreateInfo{};
+            QueryPoolCreateInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            QueryPoolCreateInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+            QueryPoolCreateInfo.queryCount = 2;
+            if( vkCreateQueryPool( Device, &QueryPoolCreateInfo, nullptr, &Timestamps ) != VK_SUCCESS ) Timestamps = VK_NULL_HANDLE;
+            if constexpr( ProfilerEnabled ) Gpu.emplace( Device, Queue, family, TimestampPeriod, timestampBits, "GPU graphics queue" );
+        }
+    }
+    OffscreenTarget( const OffscreenTarget & )            = delete;
+    OffscreenTarget &operator=( const OffscreenTarget & ) = delete;
+
+    ~OffscreenTarget()
+    {
+        Gpu.reset();
+        if( Timestamps ) vkDestroyQueryPool( Device, Timestamps, nullptr );
+        vkDestroyFence( Device, Done, nullptr );
+        vkDestroyCommandPool( Device, CommandPool, nullptr );
+        vkDestroyFramebuffer( Device, Target, nullptr );
+        vkDestroyRenderPass( Device, LatePass, nullptr );
+        vkDestroyRenderPass( Device, EarlyPass, nullptr );
+        vkDestroyRenderPass( Device, Pass, nullptr );
+        vkDestroyImageView( Device, DepthView, nullptr );
+        vkDestroyImageView( Device, ColorView, nullptr );
+        Memory.DestroyBuffer( Readback, ReadbackMemory );
+        Memory.DestroyImage( DepthImage, DepthMemory );
+        Memory.DestroyImage( ColorImage, ColorMemory );
+    }
+
+    // Pipelines drawing into the target are created against this render pass, subpass 0; the
+    // early and late passes of a two pass frame are compatible with it.
+    VkRenderPass RenderPass() const
+    {
+        return Pass;
+    }
+    // Sampled between the passes of a two pass frame, in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+    VkImageView Depth() const
+    {
+        return DepthView;
+    }
+    VkExtent2D Extent() const
+    {
+        return TargetExtent;
+    }
+    VkFramebuffer Framebuffer() const
+    {
+        return Target;
+    }
+    const OffscreenFrameTimes &LastFrame() const
+    {
+        return Times;
+    }
+    // For PROFILE_GPU_ZONE in the callbacks of Render; null unless profiling with timestamps.
+    GpuProfiler *GpuZones()
+    {
+        return Gpu ? &*Gpu : nullptr;
+    }
+
+    // One frame: prepare records outside the render pass, e.g. barriers and copies; then color
+    // and depth are cleared and record draws inside it; then the color is copied out. wait is a
+    // timeline semaphore, such as the upload one, the frame waits for at waitValue first. With
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS record may only execute secondary buffers.
+    // Given late, the render pass keeps its depth for between, recorded outside any render pass
+    // with the depth readable by compute shaders, and a second render pass loading color and
+    // depth again is recorded by late, with the same contents.
+    void Render( const std::function<void( VkCommandBuffer )> &prepare, const std::function<void( VkCommandBuffer )> &record, std::span<const float, 4> clear, VkSemaphore wait = VK_NULL_HANDLE,
+                 uint64_t waitValue = 0, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, const std::function<void( VkCommandBuffer )> &between = {},
+                 const std::function<void( VkCommandBuffer )> &late = {} )
+    {
+        PROFILE_ZONE( "offscreen frame" );
+        auto Start{ std::chrono::steady_clock::now() };
+        vkResetCommandBuffer( Commands, 0 );
+        VkCommandBufferBeginInfo BeginInfo{};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer( Commands, &BeginInfo );
+        if( Timestamps )
+        {
+            vkCmdResetQueryPool( Commands, Timestamps, 0, 2 );
+            vkCmdWriteTimestamp( Commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Timestamps, 0 );
+        }
+        if( Gpu ) Gpu->BeginFrame( Commands );
+        {
+            PROFILE_GPU_ZONE( GpuZones(), Commands, "prepare" );
+            if( prepare ) prepare( Commands );
+        }
+
+        VkClearValue ClearValues[ 2 ]{};
+        memcpy( ClearValues[ 0 ].color.float32, clear.data(), sizeof( float ) * 4 );
+        ClearValues[ 1 ].depthStencil = { 1.f, 0 };
+        VkRenderPassBeginInfo RenderPassBeginInfo{};
+        RenderPassBeginInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        RenderPassBeginInfo.renderPass      = late ? EarlyPass : Pass;
+        RenderPassBeginInfo.framebuffer     = Target;
+        RenderPassBeginInfo.renderArea      = { { 0, 0 }, TargetExtent };
+        RenderPassBeginInfo.clearValueCount = 2;
+        RenderPassBeginInfo.pClearValues    = ClearValues;
+        {
+            PROFILE_GPU_ZONE( GpuZones(), Commands, "render pass" );
+            vkCmdBeginRenderPass( Commands, &RenderPassBeginInfo, contents );
+            if( record ) record( Commands );
+            vkCmdEndRenderPass( Commands );
+        }
+        if( late )
+        {
+            {
+                PROFILE_GPU_ZONE( GpuZones(), Commands, "between passes" );
+                if( between ) between( Commands );
+            }
+            PROFILE_GPU_ZONE( GpuZones(), Commands, "late render pass" );
+            RenderPassBeginInfo.renderPass      = LatePass;
+            RenderPassBeginInfo.clearValueCount = 0;
+            RenderPassBeginInfo.pClearValues    = nullptr;
+            vkCmdBeginRenderPass( Commands, &RenderPassBeginInfo, contents );
+            late( Commands );
+            vkCmdEndRenderPass( Commands );
+        }
+
+        // The render pass leaves the color in TRANSFER_SRC_OPTIMAL.
+        VkBufferImageCopy Copy{};
+        Copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        Copy.imageExtent      = { TargetExtent.width, TargetExtent.height, 1 };
+        {
+            PROFILE_GPU_ZONE( GpuZones(), Commands, "read back copy" );
+            vkCmdCopyImageToBuffer( Commands, ColorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Readback, 1, &Copy );
+        }
+        VkBufferMemoryBarrier Barrier{};
+        Barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        Barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        Barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+        Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        Barrier.buffer              = Readback;
+        Barrier.size                = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier( Commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &Barrier, 0, nullptr );
+        if( Timestamps ) vkCmdWriteTimestamp( Commands, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, Timestamps, 1 );
+        vkEndCommandBuffer( Commands );
+
+        VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo{};
+        TimelineSubmitInfo.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineSubmitInfo.waitSemaphoreValueCount = 1;
+        TimelineSubmitInfo.pWaitSemaphoreValues    = &waitValue;
+        VkPipelineStageFlags WaitStage{ VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        VkSubmitInfo SubmitInfo{};
+        SubmitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext              = wait ? &TimelineSubmitInfo : nullptr;
+        SubmitInfo.waitSemaphoreCount = wait ? 1 : 0;
+        SubmitInfo.pWaitSemaphores    = &wait;
+        SubmitInfo.pWaitDstStageMask  = &WaitStage;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers    = &Commands;
+        VkResult Result{ vkQueueSubmit( Queue, 1, &SubmitInfo, Done ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to submit offscreen frame, error: {}", string_VkResult( Result ) ) );
+        Times.CpuMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+        {
+            PROFILE_ZONE( "wait for frame" );
+            vkWaitForFences( Device, 1, &Done, VK_TRUE, UINT64_MAX );
+            vkResetFences( Device, 1, &Done );
+        }
+        if( Gpu ) Gpu->Collect();
+        Times.FrameMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+        uint64_t Ticks[ 2 ]{};
+        if( Timestamps && vkGetQueryPoolResults( Device, Timestamps, 0, 2, sizeof( Ticks ), Ticks, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT ) == VK_SUCCESS )
+            Times.GpuMs = ( Ticks[ 1 ] - Ticks[ 0 ] ) * double( TimestampPeriod ) / 1e6;
+    }
+
+    // Tightly packed rows of the last frame, in ColorFormat; 4 bytes per pixel.
+    std::vector<uint8_t> ReadBack() const
+    {
+        const uint8_t *Pixels{ static_cast<const uint8_t *>( ReadbackMemory.Mapped ) };
+        return { Pixels, Pixels + size_t( TargetExtent.width ) * TargetExtent.height * 4 };
+    }
+
+    // Binary PPM, which any image viewer opens and needs no encoder; alpha is dropped.
+    bool WritePpm( const char *path ) const
+    {
+        std::ofstream Out{ path, std::ios::binary | std::ios::trunc };
+        if( !Out ) return false;
+        Out << std::format( "P6\n{} {}\n255\n", TargetExtent.width, TargetExtent.height );
+        std::vector<uint8_t> Pixels{ ReadBack() };
+        std::vector<char> Row( size_t( TargetExtent.width ) * 3 );
+        const bool Bgra{ ColorFormat == VK_FORMAT_B8G8R8A8_UNORM || ColorFormat == VK_FORMAT_B8G8R8A8_SRGB };
+        for( uint32_t y{ 0 }; y < TargetExtent.height; y++ )
+        {
+            const uint8_t *Source{ Pixels.data() + size_t( y ) * TargetExtent.width * 4 };
+            for( uint32_t x{ 0 }; x < TargetExtent.width; x++ )
+                for( uint32_t Channel{ 0 }; Channel < 3; Channel++ ) Row[ x * 3 + Channel ] = static_cast<char>( Source[ x * 4 + ( Bgra ? 2 - Channel : Channel ) ] );
+            Out.write( Row.data(), Row.size() );
+        }
+        return static_cast<bool>( Out );
+    }
+
+  private:
+    VkDevice Device;
+    DeviceMemoryAllocator &Memory;
+    VkQueue Queue;
+    VkExtent2D TargetExtent;
+    float TimestampPeriod;
+    VkFormat ColorFormat;
+    VkFormat DepthFormat;
+    VkImage ColorImage{ VK_NULL_HANDLE };
+    VkImage DepthImage{ VK_NULL_HANDLE };
+    DeviceAllocation ColorMemory;
+    DeviceAllocation DepthMemory;
+    VkImageView ColorView{ VK_NULL_HANDLE };
+    VkImageView DepthView{ VK_NULL_HANDLE };
+    VkBuffer Readback{ VK_NULL_HANDLE };
+    DeviceAllocation ReadbackMemory;
+    VkRenderPass Pass{ VK_NULL_HANDLE };
+    VkRenderPass EarlyPass{ VK_NULL_HANDLE }; // Pass keeping its depth and color for LatePass
+    VkRenderPass LatePass{ VK_NULL_HANDLE };
+    VkFramebuffer Target{ VK_NULL_HANDLE };
+    VkCommandPool CommandPool{ VK_NULL_HANDLE };
+    VkCommandBuffer Commands{ VK_NULL_HANDLE };
+    VkFence Done{ VK_NULL_HANDLE };
+    VkQueryPool Timestamps{ VK_NULL_HANDLE };
+    OffscreenFrameTimes Times;
+    std::optional<GpuProfiler> Gpu;
+
+    VkImage CreateImage( VkFormat format, VkImageUsageFlags usage, DeviceAllocation &allocation )
+    {
+        VkImageCreateInfo ImageCreateInfo{};
+        ImageCreateInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ImageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+        ImageCreateInfo.format        = format;
+        ImageCreateInfo.extent        = { TargetExtent.width, TargetExtent.height, 1 };
+        ImageCreateInfo.mipLevels     = 1;
+        ImageCreateInfo.arrayLayers   = 1;
+        ImageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        ImageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        ImageCreateInfo.usage         = usage;
+        ImageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return Memory.CreateImage( ImageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocation );
+    }
+
+    VkImageView CreateView( VkImage image, VkFormat format, VkImageAspectFlags aspect )
+    {
+        VkImageViewCreateInfo ImageViewCreateInfo{};
+        ImageViewCreateInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        ImageViewCreateInfo.image            = image;
+        ImageViewCreateInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+        ImageViewCreateInfo.format           = format;
+        ImageViewCreateInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+        VkImageView View;
+        VkResult Result{ vkCreateImageView( Device, &ImageViewCreateInfo, nullptr, &View ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen image view, error: {}", string_VkResult( Result ) ) );
+        return View;
+    }
+
+    // Color is cleared and ends ready to be copied out; depth is cleared and thrown away. The
+    // early pass stores both instead, the depth ready to be sampled by compute shaders, and the
+    // late pass loads them, ending as Pass does.
+    void CreateRenderPass()
+    {
+        VkAttachmentDescription Attachments[ 2 ]{};
+        Attachments[ 0 ].format         = ColorFormat;
+        Attachments[ 0 ].samples        = VK_SAMPLE_COUNT_1_BIT;
+        Attachments[ 0 ].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        Attachments[ 0 ].storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        Attachments[ 0 ].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        Attachments[ 0 ].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        Attachments[ 0 ].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        Attachments[ 0 ].finalLayout    = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        Attachments[ 1 ]                = Attachments[ 0 ];
+        Attachments[ 1 ].format         = DepthFormat;
+        Attachments[ 1 ].storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        Attachments[ 1 ].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference ColorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference DepthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        VkSubpassDescription Subpass{};
+        Subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        Subpass.colorAttachmentCount    = 1;
+        Subpass.pColorAttachments       = &ColorReference;
+        Subpass.pDepthStencilAttachment = &DepthReference;
+
+        // The previous frame's copy must finish before this one clears the color again.
+        VkSubpassDependency Dependencies[ 2 ]{};
+        Dependencies[ 0 ].srcSubpass    = VK_SUBPASS_EXTERNAL;
+        Dependencies[ 0 ].dstSubpass    = 0;
+        Dependencies[ 0 ].srcStageMask  = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        Dependencies[ 0 ].dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        Dependencies[ 0 ].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 0 ].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 1 ].srcSubpass    = 0;
+        Dependencies[ 1 ].dstSubpass    = VK_SUBPASS_EXTERNAL;
+        Dependencies[ 1 ].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        Dependencies[ 1 ].dstStageMask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        Dependencies[ 1 ].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 1 ].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        VkRenderPassCreateInfo RenderPassCreateInfo{};
+        RenderPassCreateInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        RenderPassCreateInfo.attachmentCount = 2;
+        RenderPassCreateInfo.pAttachments    = Attachments;
+        RenderPassCreateInfo.subpassCount    = 1;
+        RenderPassCreateInfo.pSubpasses      = &Subpass;
+        RenderPassCreateInfo.dependencyCount = 2;
+        RenderPassCreateInfo.pDependencies   = Dependencies;
+        VkResult Result{ vkCreateRenderPass( Device, &RenderPassCreateInfo, nullptr, &Pass ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen render pass, error: {}", string_VkResult( Result ) ) );
+
+        Attachments[ 0 ].finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        Attachments[ 1 ].storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        Attachments[ 1 ].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        Dependencies[ 1 ].srcStageMask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        Dependencies[ 1 ].dstStageMask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        Dependencies[ 1 ].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 1 ].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        Result                          = vkCreateRenderPass( Device, &RenderPassCreateInfo, nullptr, &EarlyPass );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen early render pass, error: {}", string_VkResult( Result ) ) );
+
+        // The early pass's writes land before these loads, and the compute reads of its depth
+        // are over before it is written again.
+        Attachments[ 0 ].loadOp         = VK_ATTACHMENT_LOAD_OP_LOAD;
+        Attachments[ 0 ].initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        Attachments[ 0 ].finalLayout    = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        Attachments[ 1 ].loadOp         = VK_ATTACHMENT_LOAD_OP_LOAD;
+        Attachments[ 1 ].storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        Attachments[ 1 ].initialLayout  = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        Attachments[ 1 ].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        Dependencies[ 0 ].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        Dependencies[ 0 ].dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        Dependencies[ 0 ].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 0 ].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 1 ].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        Dependencies[ 1 ].dstStageMask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        Dependencies[ 1 ].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        Dependencies[ 1 ].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        Result                          = vkCreateRenderPass( Device, &RenderPassCreateInfo, nullptr, &LatePass );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create offscreen late render pass, error: {}", string_VkResult( Result ) ) );
+    }
+};
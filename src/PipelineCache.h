@@ -0,0 +1,275 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_enum_string_helper.h>
+#include "Hash.h"
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "Profiler.h"
+#include <span>
+#include <mutex>
+#include <chrono>
+#include <format>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+
+// On-disk layout: PipelineCacheFile, then the blob from vkGetPipelineCacheData. The blob
+// starts with the header Vulkan defines for VK_PIPELINE_CACHE_HEADER_VERSION_ONE; a blob from
+// another GPU or driver is dropped before the driver sees it, and the hash catches files
+// truncated by a crash, which some drivers do not survive.
+struct PipelineCacheFile
+{
+    uint32_t Magic;
+    uint32_t Reserved;
+    uint64_t DataSize;
+    uint64_t DataHash;
+};
+
+struct PipelineCacheHeader
+{
+    uint32_t Length;
+    uint32_t Version;
+    uint32_t VendorID;
+    uint32_t DeviceID;
+    uint8_t UUID[ VK_UUID_SIZE ];
+};
+
+const uint32_t PipelineCacheMagic{ 0x48435050 }; // "PPCH"
+
+inline bool ValidPipelineCacheData( std::span<const uint8_t> data, const VkPhysicalDeviceProperties &properties )
+{
+    if( data.size() < sizeof( PipelineCacheHeader ) ) return false;
+    PipelineCacheHeader Header;
+    memcpy( &Header, data.data(), sizeof( Header ) );
+    return Header.Length >= sizeof( PipelineCacheHeader ) && Header.Version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           Header.VendorID == properties.vendorID && Header.DeviceID == properties.deviceID &&
+           !memcmp( Header.UUID, properties.pipelineCacheUUID, VK_UUID_SIZE );
+}
+
+enum class PipelineCacheState
+{
+    Cold,    // no file
+    Warm,
+    Corrupt, // truncated or overwritten
+    Foreign, // another GPU or driver version
+    Rejected // the driver refused the blob
+};
+
+inline const char *PipelineCacheStateName( PipelineCacheState state )
+{
+    switch( state )
+    {
+        case PipelineCacheState::Warm:
+            return "warm";
+        case PipelineCacheState::Corrupt:
+            return "corrupt";
+        case PipelineCacheState::Foreign:
+            return "foreign";
+        case PipelineCacheState::Rejected:
+            return "rejected";
+        default:
+            return "cold";
+    }
+}
+
+struct PipelineCacheStatistics
+{
+    uint32_t Pipelines{ 0 };
+    double Milliseconds{ 0.0 };
+};
+
+// SPIR-V packed under path in pack is used from there, decompressed if it has to be.
+inline VkShaderModule CreateShaderModule( VkDevice device, const char *path, const AssetPack *pack = nullptr )
+{
+    MappedFile Code;
+    std::vector<uint32_t> Decompressed;
+    std::span<const uint8_t> Words;
+    if( const AssetPackEntry *Entry{ pack ? pack->Find( path ) : nullptr } )
+    {
+        Words = pack->View( *Entry );
+        if( Entry->Compression != AssetCompression::None )
+        {
+            Decompressed.resize( ( Entry->RawSize + 3 ) / 4 );
+            if( !pack->Read( *Entry, Decompressed.data() ) ) throw std::runtime_error( std::format( "Failed to decompress shader {}.", path ) );
+            Words = { reinterpret_cast<const uint8_t *>( Decompressed.data() ), Entry->RawSize };
+        }
+    }
+    else
+    {
+        Code.Open( path );
+        Words = { Code.Data(), Code.Size() };
+    }
+    VkShaderModuleCreateInfo ShaderModuleCreateInfo{};
+    ShaderModuleCreateInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    ShaderModuleCreateInfo.codeSize = Words.size();
+    ShaderModuleCreateInfo.pCode    = reinterpret_cast<const uint32_t *>( Words.data() );
+    VkShaderModule Module;
+    VkResult Result{ vkCreateShaderModule( device, &ShaderModuleCreateInfo, nullptr, &Module ) };
+    if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create shader module {}, error: {}", path, string_VkResult( Result ) ) );
+    return Module;
+}
+
+// The VkPipelineCache every pipeline is created through, loaded at startup; the owner calls
+// Save() before shutdown. Threads compiling in parallel take a WorkerCache() each so they do
+// not contend on the lock inside one shared cache; Save() merges them back.
+class PipelineCache
+{
+  public:
+    PipelineCache( VkDevice device, const VkPhysicalDeviceProperties &properties, const char *path ) : Device{ device }, Properties{ properties }, Path{ path }
+    {
+        std::vector<uint8_t> Data{ Read() };
+        Cache = Create( Data );
+        if( !Cache && Loaded == PipelineCacheState::Warm )
+        {
+            Loaded = PipelineCacheState::Rejected;
+            Cache  = Create( {} );
+        }
+        if( !Cache ) throw std::runtime_error( "Failed to create pipeline cache." );
+    }
+    PipelineCache( const PipelineCache & )            = delete;
+    PipelineCache &operator=( const PipelineCache & ) = delete;
+
+    ~PipelineCache()
+    {
+        for( auto Worker : Workers ) vkDestroyPipelineCache( Device, Worker, nullptr );
+        vkDestroyPipelineCache( Device, Cache, nullptr );
+    }
+
+    VkPipelineCache Handle() const
+    {
+        return Cache;
+    }
+
+    // What happened to the file at startup.
+    PipelineCacheState State() const
+    {
+        return Loaded;
+    }
+
+    VkPipelineCache WorkerCache()
+    {
+        std::lock_guard Lock{ Mutex };
+        VkPipelineCache Worker{ Create( {} ) };
+        if( !Worker ) throw std::runtime_error( "Failed to create worker pipeline cache." );
+        Workers.push_back( Worker );
+        return Worker;
+    }
+
+    // cache defaults to the main one.
+    void CreateGraphicsPipelines( std::span<const VkGraphicsPipelineCreateInfo> infos, VkPipeline *pipelines, VkPipelineCache cache = VK_NULL_HANDLE )
+    {
+        PROFILE_ZONE( "create graphics pipelines" );
+        auto Start{ std::chrono::steady_clock::now() };
+        VkResult Result{ vkCreateGraphicsPipelines( Device, cache ? cache : Cache, static_cast<uint32_t>( infos.size() ), infos.data(), nullptr, pipelines ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create graphics pipelines, error: {}", string_VkResult( Result ) ) );
+        Record( static_cast<uint32_t>( infos.size() ), Start );
+    }
+
+    void CreateComputePipelines( std::span<const VkComputePipelineCreateInfo> infos, VkPipeline *pipelines, VkPipelineCache cache = VK_NULL_HANDLE )
+    {
+        PROFILE_ZONE( "create compute pipelines" );
+        auto Start{ std::chrono::steady_clock::now() };
+        VkResult Result{ vkCreateComputePipelines( Device, cache ? cache : Cache, static_cast<uint32_t>( infos.size() ), infos.data(), nullptr, pipelines ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create compute pipelines, error: {}", string_VkResult( Result ) ) );
+        Record( static_cast<uint32_t>( infos.size() ), Start );
+    }
+
+    PipelineCacheStatistics Stat() const
+    {
+        std::lock_guard Lock{ Mutex };
+        return Statistics;
+    }
+
+    // Merges worker caches and replaces the file through a temporary, so readers never see a
+    // partial blob. Throws when the file cannot be written.
+    void Save()
+    {
+        std::lock_guard Lock{ Mutex };
+        if( !Workers.empty() )
+        {
+            vkMergePipelineCaches( Device, Cache, static_cast<uint32_t>( Workers.size() ), Workers.data() );
+            for( auto Worker : Workers ) vkDestroyPipelineCache( Device, Worker, nullptr );
+            Workers.clear();
+        }
+        size_t Size{ 0 };
+        VkResult Result{ vkGetPipelineCacheData( Device, Cache, &Size, nullptr ) };
+        std::vector<uint8_t> Data( Size );
+        if( Result == VK_SUCCESS ) Result = vkGetPipelineCacheData( Device, Cache, &Size, Data.data() );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to read pipeline cache data, error: {}", string_VkResult( Result ) ) );
+        Data.resize( Size );
+
+        if( Path.has_parent_path() ) std::filesystem::create_directories( Path.parent_path() );
+        std::filesystem::path Temporary{ Path };
+        Temporary += ".tmp";
+        {
+            std::ofstream Out{ Temporary, std::ios::binary | std::ios::trunc };
+            PipelineCacheFile File{ PipelineCacheMagic, 0, Data.size(), Hash64( Data.data(), Data.size() ) };
+            Out.write( reinterpret_cast<const char *>( &File ), sizeof( File ) );
+            Out.write( reinterpret_cast<const char *>( Data.data() ), Data.size() );
+            if( !Out ) throw std::runtime_error( std::format( "Failed to write {}.", Temporary.string() ) );
+        }
+        std::filesystem::rename( Temporary, Path );
+    }
+
+  private:
+    VkDevice Device;
+    VkPhysicalDeviceProperties Properties;
+    std::filesystem::path Path;
+    VkPipelineCache Cache{ VK_NULL_HANDLE };
+    std::vector<VkPipelineCache> Workers;
+    PipelineCacheStatistics Statistics;
+    PipelineCacheState Loaded{ PipelineCacheState::Cold };
+    mutable std::mutex Mutex;
+
+    VkPipelineCache Create( std::span<const uint8_t> data )
+    {
+        VkPipelineCacheCreateInfo PipelineCacheCreateInfo{};
+        PipelineCacheCreateInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        PipelineCacheCreateInfo.initialDataSize = data.size();
+        PipelineCacheCreateInfo.pInitialData    = data.data();
+        VkPipelineCache Result{ VK_NULL_HANDLE };
+        if( vkCreatePipelineCache( Device, &PipelineCacheCreateInfo, nullptr, &Result ) != VK_SUCCESS ) return VK_NULL_HANDLE;
+        return Result;
+    }
+
+    // Empty unless the file is usable; Loaded says why.
+    std::vector<uint8_t> Read()
+    {
+        std::error_code Error;
+        if( !std::filesystem::exists( Path, Error ) ) return {};
+        MappedFile File;
+        try
+        {
+            File.Open( Path.string().c_str() );
+        }
+        catch( const std::exception & )
+        {
+            Loaded = PipelineCacheState::Corrupt;
+            return {};
+        }
+        PipelineCacheFile Header{};
+        if( File.Size() >= sizeof( Header ) ) memcpy( &Header, File.Data(), sizeof( Header ) );
+        std::span<const uint8_t> Data{ File.Data() + std::min<size_t>( File.Size(), sizeof( Header ) ), File.Size() - std::min<size_t>( File.Size(), sizeof( Header ) ) };
+        if( Header.Magic != PipelineCacheMagic || Header.DataSize != Data.size() || Hash64( Data.data(), Data.size() ) != Header.DataHash )
+        {
+            Loaded = PipelineCacheState::Corrupt;
+            return {};
+        }
+        if( !ValidPipelineCacheData( Data, Properties ) )
+        {
+            Loaded = PipelineCacheState::Foreign;
+            return {};
+        }
+        Loaded = PipelineCacheState::Warm;
+        return { Data.begin(), Data.end() };
+    }
+
+    void Record( uint32_t count, std::chrono::steady_clock::time_point start )
+    {
+        double Ms{ std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() };
+        std::lock_guard Lock{ Mutex };
+        Statistics.Pipelines += count;
+        Statistics.Milliseconds += Ms;
+    }
+};
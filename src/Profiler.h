@@ -0,0 +1,379 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_enum_string_helper.h>
+#include <span>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+// Scoped CPU and GPU zones, written out as Chrome trace events for about:tracing or Perfetto.
+// Zones are compiled in only with ENABLE_PROFILER; otherwise the PROFILE_ macros expand to
+// nothing and cost nothing. Every thread appends to its own chunked buffer that is never moved
+// or freed, publishing each event with one release store, so recording takes no lock and a
+// trace can be written while other threads keep recording.
+#ifdef ENABLE_PROFILER
+constexpr bool ProfilerEnabled{ true };
+#    define PROFILE_CONCAT_( a, b )                    a##b
+#    define PROFILE_CONCAT( a, b )                     PROFILE_CONCAT_( a, b )
+#    define PROFILE_ZONE( name )                       ProfilerZone PROFILE_CONCAT( ProfileZone, __LINE__ ){ name }
+#    define PROFILE_THREAD( name )                     Profiler::Get().NameThread( name )
+#    define PROFILE_GPU_ZONE( gpu, commandBuffer, name ) GpuProfilerZone PROFILE_CONCAT( GpuProfileZone, __LINE__ ){ gpu, commandBuffer, name }
+#else
+constexpr bool ProfilerEnabled{ false };
+#    define PROFILE_ZONE( name )
+#    define PROFILE_THREAD( name )
+#    define PROFILE_GPU_ZONE( gpu, commandBuffer, name )
+#endif
+
+// Name must outlive the profiler; zone names are string literals.
+struct ProfilerEvent
+{
+    const char *Name;
+    int64_t Begin; // ns since the profiler started
+    int64_t End;
+};
+
+// Events of one thread, or of one GPU queue. Only the owner pushes; anyone may read.
+class ProfilerTrack
+{
+  public:
+    static constexpr size_t ChunkSize{ 4096 };
+
+    ProfilerTrack( uint32_t id, std::string name ) : Id{ id }, Name{ std::move( name ) }, Head{ std::make_unique<Chunk>() }, Tail{ Head.get() }
+    {
+    }
+    ~ProfilerTrack()
+    {
+        // Iteratively, so a long trace does not recurse once per chunk.
+        std::unique_ptr<Chunk> Next{ std::move( Head->Owned ) };
+        while( Next ) Next = std::move( Next->Owned );
+    }
+
+    void Push( const ProfilerEvent &event )
+    {
+        size_t Used{ Tail->Count.load( std::memory_order_relaxed ) };
+        if( Used == ChunkSize )
+        {
+            Tail->Owned = std::make_unique<Chunk>();
+            Tail->Next.store( Tail->Owned.get(), std::memory_order_release );
+            Tail = Tail->Owned.get();
+            Used = 0;
+        }
+        Tail->Events[ Used ] = event;
+        Tail->Count.store( Used + 1, std::memory_order_release );
+    }
+
+    template <typename F>
+    void ForEach( F &&visit ) const
+    {
+        for( const Chunk *Current{ Head.get() }; Current; Current = Current->Next.load( std::memory_order_acquire ) )
+        {
+            size_t Count{ Current->Count.load( std::memory_order_acquire ) };
+            for( size_t Index{ 0 }; Index < Count; Index++ ) visit( Current->Events[ Index ] );
+        }
+    }
+
+    const uint32_t Id;
+    std::string Name; // guarded by the profiler lock
+
+  private:
+    struct Chunk
+    {
+        ProfilerEvent Events[ ChunkSize ];
+        std::atomic<size_t> Count{ 0 };
+        std::atomic<Chunk *> Next{ nullptr };
+        std::unique_ptr<Chunk> Owned;
+    };
+    std::unique_ptr<Chunk> Head;
+    Chunk *Tail; // owner only
+};
+
+class Profiler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Never destroyed, so zones in static destructors still have somewhere to go.
+    static Profiler &Get()
+    {
+        static Profiler *Instance{ new Profiler };
+        return *Instance;
+    }
+
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - Start ).count();
+    }
+
+    // The calling thread's track, created on first use.
+    ProfilerTrack &Thread()
+    {
+        static thread_local ProfilerTrack *Local{ nullptr };
+        if( !Local ) Local = &Track( std::format( "thread {}", NextThread++ ) );
+        return *Local;
+    }
+    void NameThread( std::string name )
+    {
+        ProfilerTrack &Local{ Thread() };
+        std::lock_guard Lock{ TracksLock };
+        Local.Name = std::move( name );
+    }
+
+    // A track not tied to a thread, such as a GPU queue; pushed to by one thread at a time.
+    ProfilerTrack &Track( std::string name )
+    {
+        std::lock_guard Lock{ TracksLock };
+        Tracks.push_back( std::make_unique<ProfilerTrack>( static_cast<uint32_t>( Tracks.size() + 1 ), std::move( name ) ) );
+        return *Tracks.back();
+    }
+
+    // Chrome trace event format: one complete ("X") event per zone, times in microseconds.
+    bool WriteChromeTrace( const char *path ) const
+    {
+        std::string Json{ "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" };
+        bool First{ true };
+        auto Separator{ [ & ]
+                        {
+                            if( !First ) Json += ",\n";
+                            First = false;
+                        } };
+        std::vector<const ProfilerTrack *> Snapshot;
+        {
+            std::lock_guard Lock{ TracksLock };
+            for( const auto &Each : Tracks )
+            {
+                Snapshot.push_back( Each.get() );
+                Separator();
+                Json += std::format( "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":{}}}}}", Each->Id, Escape( Each->Name.c_str() ) );
+                Separator();
+                Json += std::format( "{{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"sort_index\":{}}}}}", Each->Id, Each->Id );
+            }
+        }
+        for( const ProfilerTrack *Each : Snapshot )
+            Each->ForEach( [ & ]( const ProfilerEvent &event )
+                           {
+                               Separator();
+                               Json += std::format( "{{\"name\":{},\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}", Escape( event.Name ), Each->Id, event.Begin / 1e3,
+                                                    ( event.End - event.Begin ) / 1e3 ); } );
+        Json += "\n]}\n";
+        std::ofstream Out{ path, std::ios::binary };
+        Out << Json;
+        return static_cast<bool>( Out );
+    }
+
+  private:
+    Clock::time_point Start{ Clock::now() };
+    mutable std::mutex TracksLock;
+    std::vector<std::unique_ptr<ProfilerTrack>> Tracks;
+    std::atomic<uint32_t> NextThread{ 0 };
+
+    Profiler() = default;
+
+    static std::string Escape( const char *text )
+    {
+        std::string Result{ "\"" };
+        for( const char *Char{ text }; *Char; Char++ )
+        {
+            if( *Char == '"' || *Char == '\\' ) Result += '\\';
+            if( static_cast<unsigned char>( *Char ) >= 0x20 ) Result += *Char;
+        }
+        return Result + "\"";
+    }
+};
+
+class ProfilerZone
+{
+  public:
+    explicit ProfilerZone( const char *name ) : Name{ name }, Begin{ Profiler::Get().Now() }
+    {
+    }
+    ProfilerZone( const ProfilerZone & )            = delete;
+    ProfilerZone &operator=( const ProfilerZone & ) = delete;
+    ~ProfilerZone()
+    {
+        Profiler &Instance{ Profiler::Get() };
+        Instance.Thread().Push( { Name, Begin, Instance.Now() } );
+    }
+
+  private:
+    const char *Name;
+    int64_t Begin;
+};
+
+// Timestamp queries around regions of the command buffers submitted to one queue. The pool is
+// split in a slice per frame in flight: BeginFrame resets the slice outside any render pass,
+// zones are written into it, and Collect reads it back once that frame's submit has finished.
+// GPU ticks are mapped onto the CPU clock by Calibrate, which stamps an empty submit and takes
+// the middle of the CPU time around it; VK_EXT_calibrated_timestamps is not needed.
+class GpuProfiler
+{
+  public:
+    GpuProfiler( VkDevice device, VkQueue queue, uint32_t family, float timestampPeriod, uint32_t validBits, const char *track, uint32_t frames = 1, uint32_t zonesPerFrame = 256 )
+        : Device{ device }, Queue{ queue }, Period{ timestampPeriod }, Mask{ validBits >= 64 ? ~0ull : ( 1ull << validBits ) - 1 }, Frames( frames ), ZonesPerFrame{ zonesPerFrame },
+          Events{ Profiler::Get().Track( track ) }
+    {
+        VkQueryPoolCreateInfo QueryPoolCreateInfo{};
+        QueryPoolCreateInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        QueryPoolCreateInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        QueryPoolCreateInfo.queryCount = frames * zonesPerFrame * 2 + 1; // the last one calibrates
+        VkResult Result{ vkCreateQueryPool( Device, &QueryPoolCreateInfo, nullptr, &Queries ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create profiler query pool, error: {}", string_VkResult( Result ) ) );
+
+        VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+        CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        CommandPoolCreateInfo.queueFamilyIndex = family;
+        Result                                 = vkCreateCommandPool( Device, &CommandPoolCreateInfo, nullptr, &CommandPool );
+        if( Result != VK_SUCCESS )
+        {
+            vkDestroyQueryPool( Device, Queries, nullptr );
+            throw std::runtime_error( std::format( "Failed to create profiler command pool, error: {}", string_VkResult( Result ) ) );
+        }
+        VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+        CommandBufferAllocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        CommandBufferAllocateInfo.commandPool        = CommandPool;
+        CommandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        CommandBufferAllocateInfo.commandBufferCount = 1;
+        Result                                       = vkAllocateCommandBuffers( Device, &CommandBufferAllocateInfo, &Commands );
+        if( Result == VK_SUCCESS )
+        {
+            VkFenceCreateInfo FenceCreateInfo{};
+            FenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            Result                = vkCreateFence( Device, &FenceCreateInfo, nullptr, &Done );
+        }
+        if( Result != VK_SUCCESS )
+        {
+            vkDestroyCommandPool( Device, CommandPool, nullptr );
+            vkDestroyQueryPool( Device, Queries, nullptr );
+            throw std::runtime_error( std::format( "Failed to set up profiler commands, error: {}", string_VkResult( Result ) ) );
+        }
+        for( auto &Frame : Frames ) Frame.Names.resize( ZonesPerFrame );
+        Calibrate();
+    }
+    GpuProfiler( const GpuProfiler & )            = delete;
+    GpuProfiler &operator=( const GpuProfiler & ) = delete;
+
+    ~GpuProfiler()
+    {
+        vkDestroyFence( Device, Done, nullptr );
+        vkDestroyCommandPool( Device, CommandPool, nullptr );
+        vkDestroyQueryPool( Device, Queries, nullptr );
+    }
+
+    void BeginFrame( VkCommandBuffer commandBuffer, uint32_t frame = 0 )
+    {
+        Current = frame % static_cast<uint32_t>( Frames.size() );
+        vkCmdResetQueryPool( commandBuffer, Queries, Current * ZonesPerFrame * 2, ZonesPerFrame * 2 );
+        Frames[ Current ].Used = 0;
+    }
+
+    // ~0u once the frame's slice is full; End ignores it.
+    uint32_t Begin( VkCommandBuffer commandBuffer, const char *name )
+    {
+        FrameZones &Frame{ Frames[ Current ] };
+        if( Frame.Used == ZonesPerFrame ) return ~0u;
+        uint32_t Zone{ Frame.Used++ };
+        Frame.Names[ Zone ] = name;
+        vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Queries, Query( Zone ) );
+        return Zone;
+    }
+    void End( VkCommandBuffer commandBuffer, uint32_t zone )
+    {
+        if( zone != ~0u ) vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, Queries, Query( zone ) + 1 );
+    }
+
+    // The frame's submit must have finished.
+    void Collect( uint32_t frame = 0 )
+    {
+        FrameZones &Frame{ Frames[ frame % Frames.size() ] };
+        if( !Frame.Used ) return;
+        Ticks.resize( Frame.Used * 2 );
+        uint32_t First{ static_cast<uint32_t>( frame % Frames.size() ) * ZonesPerFrame * 2 };
+        if( vkGetQueryPoolResults( Device, Queries, First, Frame.Used * 2, Ticks.size() * sizeof( uint64_t ), Ticks.data(), sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT ) != VK_SUCCESS ) return;
+        for( uint32_t Zone{ 0 }; Zone < Frame.Used; Zone++ ) Events.Push( { Frame.Names[ Zone ], Cpu( Ticks[ Zone * 2 ] ), Cpu( Ticks[ Zone * 2 + 1 ] ) } );
+        Frame.Used = 0;
+    }
+
+    // Blocks on the queue for one empty submit; call again now and then if the clocks drift.
+    void Calibrate()
+    {
+        uint32_t Last{ static_cast<uint32_t>( Frames.size() ) * ZonesPerFrame * 2 };
+        vkResetCommandBuffer( Commands, 0 );
+        VkCommandBufferBeginInfo BeginInfo{};
+        BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer( Commands, &BeginInfo );
+        vkCmdResetQueryPool( Commands, Queries, Last, 1 );
+        vkCmdWriteTimestamp( Commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, Queries, Last );
+        vkEndCommandBuffer( Commands );
+        VkSubmitInfo SubmitInfo{};
+        SubmitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers    = &Commands;
+        int64_t Before{ Profiler::Get().Now() };
+        if( vkQueueSubmit( Queue, 1, &SubmitInfo, Done ) != VK_SUCCESS ) return;
+        vkWaitForFences( Device, 1, &Done, VK_TRUE, UINT64_MAX );
+        int64_t After{ Profiler::Get().Now() };
+        vkResetFences( Device, 1, &Done );
+        uint64_t Tick{ 0 };
+        if( vkGetQueryPoolResults( Device, Queries, Last, 1, sizeof( Tick ), &Tick, sizeof( Tick ), VK_QUERY_RESULT_64_BIT ) != VK_SUCCESS ) return;
+        Offset = ( Before + After ) / 2 - static_cast<int64_t>( double( Tick & Mask ) * Period );
+    }
+
+  private:
+    struct FrameZones
+    {
+        std::vector<const char *> Names;
+        uint32_t Used{ 0 };
+    };
+
+    VkDevice Device;
+    VkQueue Queue;
+    float Period;
+    uint64_t Mask;
+    std::vector<FrameZones> Frames;
+    uint32_t ZonesPerFrame;
+    uint32_t Current{ 0 };
+    ProfilerTrack &Events;
+    VkQueryPool Queries{ VK_NULL_HANDLE };
+    VkCommandPool CommandPool{ VK_NULL_HANDLE };
+    VkCommandBuffer Commands{ VK_NULL_HANDLE };
+    VkFence Done{ VK_NULL_HANDLE };
+    int64_t Offset{ 0 };
+    std::vector<uint64_t> Ticks;
+
+    uint32_t Query( uint32_t zone ) const
+    {
+        return ( Current * ZonesPerFrame + zone ) * 2;
+    }
+    int64_t Cpu( uint64_t tick ) const
+    {
+        return Offset + static_cast<int64_t>( double( tick & Mask ) * Period );
+    }
+};
+
+// gpu may be null, for targets without timestamps.
+class GpuProfilerZone
+{
+  public:
+    GpuProfilerZone( GpuProfiler *gpu, VkCommandBuffer commandBuffer, const char *name ) : Gpu{ gpu }, CommandBuffer{ commandBuffer }, Zone{ gpu ? gpu->Begin( commandBuffer, name ) : ~0u }
+    {
+    }
+    GpuProfilerZone( const GpuProfilerZone & )            = delete;
+    GpuProfilerZone &operator=( const GpuProfilerZone & ) = delete;
+    ~GpuProfilerZone()
+    {
+        if( Gpu ) Gpu->End( CommandBuffer, Zone );
+    }
+
+  private:
+    GpuProfiler *Gpu;
+    VkCommandBuffer CommandBuffer;
+    uint32_t Zone;
+};
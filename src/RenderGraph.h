@@ -0,0 +1,656 @@
+#pragma once
+#include "DeviceMemory.h"
+#include "Profiler.h"
+#include <string>
+#include <format>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+// A frame as passes that declare which images and buffers they read and write, instead of
+// recording their own barriers. Compile orders the passes by those declarations, drops the
+// ones whose results nothing uses, and works out every barrier of the frame once: passes with
+// no dependency between them share a level, and the barriers a level needs go out in one
+// vkCmdPipelineBarrier, a single global memory barrier covering all buffers. Uses that find a
+// resource already in their layout and its writes already visible get no barrier at all.
+// Transient images live only within a frame; they are created by Compile and placed in shared
+// memory, images whose levels do not overlap aliasing the same bytes.
+
+// How a pass touches a resource; Read drops the write accesses.
+enum class GraphAccess
+{
+    ColorAttachment,
+    DepthAttachment,
+    DepthRead,       // depth tests without writes
+    FragmentSampled, // also any sampled depth
+    ComputeSampled,
+    ComputeStorage,  // storage image, read and written
+    ComputeBuffer,   // storage buffer
+    IndirectBuffer,
+    TransferSrc,
+    TransferDst
+};
+
+struct ResourceUse
+{
+    VkPipelineStageFlags Stages{ 0 };
+    VkAccessFlags Access{ 0 };
+    VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED }; // images only
+};
+
+inline ResourceUse GraphAccessUse( GraphAccess access )
+{
+    const VkPipelineStageFlags Fragment{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT };
+    switch( access )
+    {
+        case GraphAccess::ColorAttachment:
+            return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        case GraphAccess::DepthAttachment:
+            return { Fragment, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        case GraphAccess::DepthRead:
+            return { Fragment, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        case GraphAccess::FragmentSampled:
+            return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        case GraphAccess::ComputeSampled:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        case GraphAccess::ComputeStorage:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+        case GraphAccess::ComputeBuffer:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+        case GraphAccess::IndirectBuffer:
+            return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+        case GraphAccess::TransferSrc:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+        case GraphAccess::TransferDst:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    }
+    return {};
+}
+
+// A transient image: 2D, optimal tiling, one layer.
+struct GraphImage
+{
+    VkFormat Format{ VK_FORMAT_UNDEFINED };
+    VkExtent2D Extent{ 0, 0 };
+    VkImageUsageFlags Usage{ 0 };
+    VkImageAspectFlags Aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+    uint32_t Levels{ 1 };
+};
+
+// What a compiled frame costs; the same every Execute.
+struct RenderGraphStatistics
+{
+    uint32_t Passes{ 0 };
+    uint32_t Culled{ 0 };           // passes whose writes nothing kept reads
+    uint32_t Levels{ 0 };           // groups of passes recorded between two barrier calls
+    uint32_t BarrierCalls{ 0 };     // vkCmdPipelineBarrier per frame
+    uint32_t ImageBarriers{ 0 };
+    uint32_t BufferHazards{ 0 };    // folded into the levels' global memory barriers
+    uint32_t UnbatchedCalls{ 0 };   // a call per barrier, as passes recording their own would take
+    uint32_t Elided{ 0 };           // uses needing no barrier, already in layout and visible
+    VkDeviceSize TransientBytes{ 0 }; // transient images each in memory of their own
+    VkDeviceSize AliasedBytes{ 0 };   // the memory they share instead
+};
+
+using GraphResource = uint32_t;
+
+class RenderGraph
+{
+  public:
+    RenderGraph( VkDevice device, DeviceMemoryAllocator &memory ) : Device{ device }, Memory{ memory } {}
+    RenderGraph( const RenderGraph & )            = delete;
+    RenderGraph &operator=( const RenderGraph & ) = delete;
+
+    ~RenderGraph()
+    {
+        Release();
+    }
+
+    // An image that outlives the frame, in layout at the start of every Execute and put back in
+    // it at the end. Whatever used it before Execute must already be ordered before it, as a
+    // frame that waited for the last one's fence is.
+    GraphResource Import( const char *name, VkImage image, VkImageAspectFlags aspect, VkImageLayout layout, uint32_t levels = 1 )
+    {
+        Resource Imported{ name };
+        Imported.Image  = image;
+        Imported.Aspect = aspect;
+        Imported.Levels = levels;
+        Imported.Layout = layout;
+        Resources.push_back( Imported );
+        Compiled = false;
+        return static_cast<GraphResource>( Resources.size() - 1 );
+    }
+    GraphResource Import( const char *name, VkBuffer buffer )
+    {
+        Resource Imported{ name };
+        Imported.Buffer = buffer;
+        Resources.push_back( Imported );
+        Compiled = false;
+        return static_cast<GraphResource>( Resources.size() - 1 );
+    }
+    // Created by Compile, its contents undefined at the first use of every frame.
+    GraphResource Transient( const char *name, const GraphImage &image )
+    {
+        Resource Created{ name };
+        Created.Transient   = true;
+        Created.Description = image;
+        Created.Aspect      = image.Aspect;
+        Created.Levels      = std::max( image.Levels, 1u );
+        Resources.push_back( Created );
+        Compiled = false;
+        return static_cast<GraphResource>( Resources.size() - 1 );
+    }
+
+    // record runs in Execute, outside any render pass unless it begins its own; passes are
+    // ordered by their reads and writes, in the order they were added where those allow.
+    uint32_t AddPass( const char *name, std::function<void( VkCommandBuffer )> record )
+    {
+        Passes.push_back( { name, std::move( record ) } );
+        Compiled = false;
+        return static_cast<uint32_t>( Passes.size() - 1 );
+    }
+    void Read( uint32_t pass, GraphResource resource, GraphAccess access )
+    {
+        ResourceUse Use{ GraphAccessUse( access ) };
+        Use.Access &= ~WriteAccess;
+        Declare( pass, resource, Use, false );
+    }
+    void Write( uint32_t pass, GraphResource resource, GraphAccess access )
+    {
+        Declare( pass, resource, GraphAccessUse( access ), true );
+    }
+
+    // Transient images have no handles before Compile; culled ones never get any.
+    VkImage Image( GraphResource resource ) const
+    {
+        return Resources.at( resource ).Image;
+    }
+    VkImageView View( GraphResource resource ) const
+    {
+        return Resources.at( resource ).View;
+    }
+    VkBuffer Buffer( GraphResource resource ) const
+    {
+        return Resources.at( resource ).Buffer;
+    }
+
+    // Orders and culls the passes, creates and aliases the transient images and works out every
+    // barrier; again after anything was added.
+    void Compile()
+    {
+        PROFILE_ZONE( "compile render graph" );
+        Release();
+        Statistics = {};
+        Batches.clear();
+        for( auto &Each : Resources ) Each.First = ~0u, Each.Last = 0;
+
+        // A read depends on the last write, a write on the last write and every read since.
+        // Reads in another layout than the reads before them wait for those like a write.
+        std::vector<std::vector<uint32_t>> After( Passes.size() ), Inputs( Passes.size() );
+        std::vector<uint32_t> LastWriter( Resources.size(), ~0u );
+        std::vector<std::vector<uint32_t>> Readers( Resources.size() );
+        std::vector<VkImageLayout> ReadLayout( Resources.size(), VK_IMAGE_LAYOUT_UNDEFINED );
+        auto Depend{ [ & ]( std::vector<uint32_t> &list, uint32_t pass, uint32_t on )
+                     {
+                         if( on != pass && std::find( list.begin(), list.end(), on ) == list.end() ) list.push_back( on );
+                     } };
+        for( uint32_t Pass{ 0 }; Pass < Passes.size(); Pass++ )
+            for( const Use &Each : Passes[ Pass ].Uses )
+            {
+                GraphResource Resource{ Each.Resource };
+                if( LastWriter[ Resource ] != ~0u )
+                {
+                    Depend( After[ Pass ], Pass, LastWriter[ Resource ] );
+                    Depend( Inputs[ Pass ], Pass, LastWriter[ Resource ] );
+                }
+                bool Relayout{ !Each.Write && !Readers[ Resource ].empty() && Each.Access.Layout != ReadLayout[ Resource ] };
+                if( Each.Write || Relayout )
+                {
+                    for( uint32_t Reader : Readers[ Resource ] ) Depend( After[ Pass ], Pass, Reader );
+                    Readers[ Resource ].clear();
+                }
+                if( Each.Write ) LastWriter[ Resource ] = Pass;
+                else Readers[ Resource ].push_back( Pass );
+                ReadLayout[ Resource ] = Each.Access.Layout;
+            }
+
+        // Dependencies only point back, so one pass from the end finds every pass feeding an
+        // imported resource.
+        for( auto &Pass : Passes ) Pass.Kept = false;
+        for( uint32_t Pass{ static_cast<uint32_t>( Passes.size() ) }; Pass-- > 0; )
+        {
+            for( const Use &Each : Passes[ Pass ].Uses )
+                if( Each.Write && !Resources[ Each.Resource ].Transient ) Passes[ Pass ].Kept = true;
+            if( Passes[ Pass ].Kept )
+                for( uint32_t Input : Inputs[ Pass ] ) Passes[ Input ].Kept = true;
+        }
+        for( uint32_t Pass{ 0 }; Pass < Passes.size(); Pass++ )
+        {
+            if( !Passes[ Pass ].Kept )
+            {
+                Statistics.Culled++;
+                continue;
+            }
+            uint32_t Level{ 0 };
+            for( uint32_t Before : After[ Pass ] )
+                if( Passes[ Before ].Kept ) Level = std::max( Level, Passes[ Before ].Level + 1 );
+            Passes[ Pass ].Level = Level;
+            if( Batches.size() <= Level ) Batches.resize( Level + 1 );
+            Batches[ Level ].Passes.push_back( Pass );
+            Statistics.Passes++;
+            for( const Use &Each : Passes[ Pass ].Uses )
+            {
+                Resources[ Each.Resource ].First = std::min( Resources[ Each.Resource ].First, Level );
+                Resources[ Each.Resource ].Last  = std::max( Resources[ Each.Resource ].Last, Level );
+            }
+        }
+        Statistics.Levels = static_cast<uint32_t>( Batches.size() );
+        try
+        {
+            CreateTransients();
+        }
+        catch( ... )
+        {
+            Release();
+            throw;
+        }
+        PlanBarriers();
+        Compiled = true;
+    }
+
+    // The kept passes in order, each level's barriers first; batched false gives every barrier
+    // a call of its own instead, for comparison.
+    void Execute( VkCommandBuffer commandBuffer, bool batched = true )
+    {
+        PROFILE_ZONE( "execute render graph" );
+        if( !Compiled ) Compile();
+        for( const Batch &Each : Batches )
+        {
+            if( batched )
+            {
+                if( Each.Src )
+                    vkCmdPipelineBarrier( commandBuffer, Each.Src, Each.Dst, 0, Each.Memory.srcAccessMask || Each.Memory.dstAccessMask ? 1 : 0, &Each.Memory, 0, nullptr,
+                                          static_cast<uint32_t>( Each.Images.size() ), Each.Images.data() );
+            }
+            else
+                for( const Barrier &Single : Each.Barriers )
+                    vkCmdPipelineBarrier( commandBuffer, Single.Src, Single.Dst, 0, Single.Image.image ? 0 : 1, &Single.Memory, 0, nullptr, Single.Image.image ? 1 : 0, &Single.Image );
+            for( uint32_t Pass : Each.Passes )
+                if( Passes[ Pass ].Record ) Passes[ Pass ].Record( commandBuffer );
+        }
+    }
+
+    RenderGraphStatistics Stat() const
+    {
+        return Statistics;
+    }
+
+    // Pass names in the order Execute records them, levels split by " | ".
+    std::string Order() const
+    {
+        std::string Result;
+        for( const Batch &Each : Batches )
+        {
+            if( Each.Passes.empty() ) continue;
+            if( !Result.empty() ) Result += " | ";
+            for( size_t Index{ 0 }; Index < Each.Passes.size(); Index++ ) Result += ( Index ? ", " : "" ) + Passes[ Each.Passes[ Index ] ].Name;
+        }
+        return Result;
+    }
+
+  private:
+    static constexpr VkAccessFlags WriteAccess{ VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                                VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT };
+
+    struct Resource
+    {
+        std::string Name;
+        bool Transient{ false };
+        GraphImage Description;
+        VkImage Image{ VK_NULL_HANDLE };
+        VkImageView View{ VK_NULL_HANDLE };
+        VkBuffer Buffer{ VK_NULL_HANDLE };
+        VkImageAspectFlags Aspect{ 0 };
+        uint32_t Levels{ 1 };
+        VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED }; // imported, between frames
+        uint32_t First{ ~0u }, Last{ 0 };                  // levels it is used in
+        VkMemoryRequirements Requirements{};
+        VkDeviceSize Offset{ 0 };
+        uint32_t Block{ ~0u };
+        VkPipelineStageFlags AliasStages{ 0 }; // of the images in its memory, itself included
+        VkAccessFlags AliasAccess{ 0 };
+    };
+    struct Use
+    {
+        GraphResource Resource;
+        ResourceUse Access;
+        bool Write;
+    };
+    struct Pass
+    {
+        std::string Name;
+        std::function<void( VkCommandBuffer )> Record;
+        std::vector<Use> Uses;
+        bool Kept{ false };
+        uint32_t Level{ 0 };
+    };
+    // A single barrier: an image one, or a memory one when Image.image is null.
+    struct Barrier
+    {
+        VkPipelineStageFlags Src{ 0 }, Dst{ 0 };
+        VkImageMemoryBarrier Image{};
+        VkMemoryBarrier Memory{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    };
+    // A level's passes and the barriers before them, also merged into one call.
+    struct Batch
+    {
+        std::vector<uint32_t> Passes;
+        std::vector<Barrier> Barriers;
+        VkPipelineStageFlags Src{ 0 }, Dst{ 0 };
+        std::vector<VkImageMemoryBarrier> Images;
+        VkMemoryBarrier Memory{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    };
+
+    VkDevice Device;
+    DeviceMemoryAllocator &Memory;
+    std::vector<Resource> Resources;
+    std::vector<Pass> Passes;
+    std::vector<Batch> Batches; // a level each, then the imported images put back
+    std::vector<DeviceAllocation> Blocks;
+    bool Compiled{ false };
+    RenderGraphStatistics Statistics;
+
+    void Declare( uint32_t pass, GraphResource resource, const ResourceUse &use, bool write )
+    {
+        if( pass >= Passes.size() || resource >= Resources.size() ) throw std::runtime_error( "Render graph pass or resource out of range." );
+        bool Image{ Resources[ resource ].Transient || Resources[ resource ].Image };
+        if( Image != ( use.Layout != VK_IMAGE_LAYOUT_UNDEFINED ) )
+            throw std::runtime_error( std::format( "Render graph pass {} uses {} as {}.", Passes[ pass ].Name, Resources[ resource ].Name, Image ? "a buffer" : "an image" ) );
+        Passes[ pass ].Uses.push_back( { resource, use, write } );
+        Compiled = false;
+    }
+
+    // Largest first, each at the lowest offset clear of the images whose levels overlap its
+    // own, in a block per set of memory types.
+    void CreateTransients()
+    {
+        std::vector<GraphResource> Placed;
+        for( GraphResource Index{ 0 }; Index < Resources.size(); Index++ )
+        {
+            Resource &Each{ Resources[ Index ] };
+            if( !Each.Transient || Each.First == ~0u ) continue;
+            VkImageCreateInfo ImageCreateInfo{};
+            ImageCreateInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            ImageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+            ImageCreateInfo.format        = Each.Description.Format;
+            ImageCreateInfo.extent        = { Each.Description.Extent.width, Each.Description.Extent.height, 1 };
+            ImageCreateInfo.mipLevels     = Each.Levels;
+            ImageCreateInfo.arrayLayers   = 1;
+            ImageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+            ImageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+            ImageCreateInfo.usage         = Each.Description.Usage;
+            ImageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+            ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkResult Result{ vkCreateImage( Device, &ImageCreateInfo, nullptr, &Each.Image ) };
+            if( Result != VK_SUCCESS )
+            {
+                Each.Image = VK_NULL_HANDLE;
+                throw std::runtime_error( std::format( "Failed to create transient image {}, error: {}", Each.Name, string_VkResult( Result ) ) );
+            }
+            vkGetImageMemoryRequirements( Device, Each.Image, &Each.Requirements );
+            Statistics.TransientBytes += Each.Requirements.size;
+            Placed.push_back( Index );
+        }
+        std::stable_sort( Placed.begin(), Placed.end(), [ & ]( GraphResource a, GraphResource b ) { return Resources[ a ].Requirements.size > Resources[ b ].Requirements.size; } );
+
+        std::vector<std::pair<uint32_t, VkMemoryRequirements>> Types; // memory type bits, the block they share
+        for( size_t Index{ 0 }; Index < Placed.size(); Index++ )
+        {
+            Resource &Each{ Resources[ Placed[ Index ] ] };
+            auto Type{ std::find_if( Types.begin(), Types.end(), [ & ]( const auto &type ) { return type.first == Each.Requirements.memoryTypeBits; } ) };
+            if( Type == Types.end() ) Type = Types.emplace( Types.end(), Each.Requirements.memoryTypeBits, VkMemoryRequirements{ 0, 1, Each.Requirements.memoryTypeBits } );
+            Each.Block = static_cast<uint32_t>( Type - Types.begin() );
+
+            VkDeviceSize Alignment{ std::max<VkDeviceSize>( Each.Requirements.alignment, 1 ) };
+            std::vector<std::pair<VkDeviceSize, VkDeviceSize>> Taken; // of the images alive with it
+            for( size_t Other{ 0 }; Other < Index; Other++ )
+            {
+                const Resource &Before{ Resources[ Placed[ Other ] ] };
+                if( Before.Block == Each.Block && Before.First <= Each.Last && Each.First <= Before.Last ) Taken.emplace_back( Before.Offset, Before.Offset + Before.Requirements.size );
+            }
+            std::sort( Taken.begin(), Taken.end() );
+            VkDeviceSize Offset{ 0 };
+            for( const auto &[ Begin, End ] : Taken )
+            {
+                if( Offset + Each.Requirements.size <= Begin ) break;
+                Offset = std::max( Offset, ( End + Alignment - 1 ) / Alignment * Alignment );
+            }
+            Each.Offset            = Offset;
+            Type->second.size      = std::max( Type->second.size, Offset + Each.Requirements.size );
+            Type->second.alignment = std::max( Type->second.alignment, Alignment );
+        }
+        // The first use of an image in a frame, a transition from UNDEFINED, waits for every use
+        // of the images in the same bytes: those earlier in the frame, and those later in it
+        // as well as the image itself, whose last uses were in the frame submitted before.
+        for( GraphResource Index : Placed )
+            for( GraphResource Other : Placed )
+            {
+                Resource &Each{ Resources[ Index ] };
+                const Resource &Before{ Resources[ Other ] };
+                if( Before.Block != Each.Block ) continue;
+                if( Before.Offset >= Each.Offset + Each.Requirements.size || Each.Offset >= Before.Offset + Before.Requirements.size ) continue;
+                for( const auto &Pass : Passes )
+                    if( Pass.Kept )
+                        for( const Use &Used : Pass.Uses )
+                            if( Used.Resource == Other )
+                            {
+                                Each.AliasStages |= Used.Access.Stages;
+                                Each.AliasAccess |= Used.Access.Access & WriteAccess;
+                            }
+            }
+
+        for( const auto &[ Bits, Requirements ] : Types )
+        {
+            Blocks.push_back( Memory.Allocate( Requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, DeviceResource::Image ) );
+            Statistics.AliasedBytes += Requirements.size;
+        }
+        for( GraphResource Index : Placed )
+        {
+            Resource &Each{ Resources[ Index ] };
+            const DeviceAllocation &Block{ Blocks[ Each.Block ] };
+            VkResult Result{ vkBindImageMemory( Device, Each.Image, Block.Memory, Block.Offset + Each.Offset ) };
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to bind transient image {}, error: {}", Each.Name, string_VkResult( Result ) ) );
+            VkImageViewCreateInfo ImageViewCreateInfo{};
+            ImageViewCreateInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            ImageViewCreateInfo.image            = Each.Image;
+            ImageViewCreateInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+            ImageViewCreateInfo.format           = Each.Description.Format;
+            ImageViewCreateInfo.subresourceRange = { Each.Aspect, 0, Each.Levels, 0, 1 };
+            Result                               = vkCreateImageView( Device, &ImageViewCreateInfo, nullptr, &Each.View );
+            if( Result != VK_SUCCESS )
+            {
+                Each.View = VK_NULL_HANDLE;
+                throw std::runtime_error( std::format( "Failed to create transient image view {}, error: {}", Each.Name, string_VkResult( Result ) ) );
+            }
+        }
+    }
+
+    // Walks the levels in order, keeping per resource its layout, the writes not yet made
+    // visible, where they were and the reads since, and turns each level's uses into barriers.
+    void PlanBarriers()
+    {
+        struct State
+        {
+            VkImageLayout Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+            VkPipelineStageFlags WriteStages{ 0 }; // last write, or layout transition
+            VkAccessFlags WriteAccess{ 0 };
+            VkPipelineStageFlags ReadStages{ 0 };    // since it
+            VkPipelineStageFlags VisibleStages{ 0 }; // it was made visible to
+            VkAccessFlags VisibleAccess{ 0 };
+            bool Fresh{ true }; // transient, not used yet this frame
+        };
+        std::vector<State> States( Resources.size() );
+        for( GraphResource Index{ 0 }; Index < Resources.size(); Index++ ) States[ Index ].Layout = Resources[ Index ].Layout;
+
+        for( Batch &Level : Batches )
+        {
+            // A resource's uses within a level are all reads in one layout, bar a pass both
+            // reading and writing it; they take one barrier.
+            std::vector<std::pair<GraphResource, Use>> Merged;
+            for( uint32_t Pass : Level.Passes )
+                for( const Use &Each : Passes[ Pass ].Uses )
+                {
+                    auto Found{ std::find_if( Merged.begin(), Merged.end(), [ & ]( const auto &merged ) { return merged.first == Each.Resource; } ) };
+                    if( Found == Merged.end() )
+                    {
+                        Merged.emplace_back( Each.Resource, Each );
+                        continue;
+                    }
+                    if( Found->second.Access.Layout != Each.Access.Layout )
+                        throw std::runtime_error( std::format( "Render graph pass {} uses {} in two layouts at once.", Passes[ Pass ].Name, Resources[ Each.Resource ].Name ) );
+                    Found->second.Access.Stages |= Each.Access.Stages;
+                    Found->second.Access.Access |= Each.Access.Access;
+                    Found->second.Write = Found->second.Write || Each.Write;
+                    Statistics.Elided++;
+                }
+
+            for( auto &[ Index, Each ] : Merged )
+            {
+                const Resource &Used{ Resources[ Index ] };
+                State &Tracked{ States[ Index ] };
+                bool Image{ Used.Image != VK_NULL_HANDLE };
+                bool Transition{ Image && ( Tracked.Layout != Each.Access.Layout || ( Used.Transient && Tracked.Fresh ) ) };
+                VkPipelineStageFlags Src{ 0 };
+                VkAccessFlags SrcAccess{ 0 };
+                if( Tracked.WriteStages &&
+                    ( Transition || Each.Write || ( Each.Access.Stages & ~Tracked.VisibleStages ) || ( Each.Access.Access & ~Tracked.VisibleAccess ) ) )
+                {
+                    Src |= Tracked.WriteStages;
+                    SrcAccess |= Tracked.WriteAccess;
+                }
+                if( ( Transition || Each.Write ) && Tracked.ReadStages ) Src |= Tracked.ReadStages;
+                if( Used.Transient && Tracked.Fresh )
+                {
+                    Src |= Used.AliasStages;
+                    SrcAccess |= Used.AliasAccess;
+                }
+
+                if( Transition || Src )
+                {
+                    Barrier Single;
+                    Single.Src = Src ? Src : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                    Single.Dst = Each.Access.Stages;
+                    if( Image )
+                    {
+                        Single.Image.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                        Single.Image.srcAccessMask       = SrcAccess;
+                        Single.Image.dstAccessMask       = Each.Access.Access;
+                        Single.Image.oldLayout           = Used.Transient && Tracked.Fresh ? VK_IMAGE_LAYOUT_UNDEFINED : Tracked.Layout;
+                        Single.Image.newLayout           = Each.Access.Layout;
+                        Single.Image.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                        Single.Image.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                        Single.Image.image               = Used.Image;
+                        Single.Image.subresourceRange    = { Used.Aspect, 0, Used.Levels, 0, 1 };
+                        Level.Images.push_back( Single.Image );
+                        Statistics.ImageBarriers++;
+                    }
+                    else
+                    {
+                        Single.Memory.srcAccessMask = SrcAccess;
+                        Single.Memory.dstAccessMask = Each.Access.Access;
+                        Level.Memory.srcAccessMask |= SrcAccess;
+                        Level.Memory.dstAccessMask |= Each.Access.Access;
+                        Statistics.BufferHazards++;
+                    }
+                    Level.Src |= Single.Src;
+                    Level.Dst |= Single.Dst;
+                    Level.Barriers.push_back( Single );
+                }
+                else
+                    Statistics.Elided++;
+
+                if( Each.Write )
+                {
+                    Tracked.WriteStages   = Each.Access.Stages;
+                    Tracked.WriteAccess   = Each.Access.Access & WriteAccess;
+                    Tracked.ReadStages    = 0;
+                    Tracked.VisibleStages = 0;
+                    Tracked.VisibleAccess = 0;
+                }
+                else if( Transition )
+                {
+                    // The transition is a write the reads of this level already see.
+                    Tracked.WriteStages   = Each.Access.Stages;
+                    Tracked.WriteAccess   = 0;
+                    Tracked.ReadStages    = Each.Access.Stages;
+                    Tracked.VisibleStages = Each.Access.Stages;
+                    Tracked.VisibleAccess = Each.Access.Access;
+                }
+                else
+                {
+                    if( Src )
+                    {
+                        Tracked.VisibleStages |= Each.Access.Stages;
+                        Tracked.VisibleAccess |= Each.Access.Access;
+                    }
+                    Tracked.ReadStages |= Each.Access.Stages;
+                }
+                if( Image ) Tracked.Layout = Each.Access.Layout;
+                Tracked.Fresh = false;
+            }
+        }
+
+        // Imported images end the frame in the layout they started it in.
+        Batch Restore;
+        for( GraphResource Index{ 0 }; Index < Resources.size(); Index++ )
+        {
+            const Resource &Used{ Resources[ Index ] };
+            const State &Tracked{ States[ Index ] };
+            if( Used.Transient || !Used.Image || Tracked.Layout == Used.Layout ) continue;
+            Barrier Single;
+            Single.Src                       = Tracked.WriteStages | Tracked.ReadStages ? Tracked.WriteStages | Tracked.ReadStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            Single.Dst                       = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            Single.Image.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            Single.Image.srcAccessMask       = Tracked.WriteAccess;
+            Single.Image.oldLayout           = Tracked.Layout;
+            Single.Image.newLayout           = Used.Layout;
+            Single.Image.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            Single.Image.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            Single.Image.image               = Used.Image;
+            Single.Image.subresourceRange    = { Used.Aspect, 0, Used.Levels, 0, 1 };
+            Restore.Src |= Single.Src;
+            Restore.Dst |= Single.Dst;
+            Restore.Images.push_back( Single.Image );
+            Restore.Barriers.push_back( Single );
+            Statistics.ImageBarriers++;
+        }
+        if( !Restore.Barriers.empty() ) Batches.push_back( std::move( Restore ) );
+
+        for( const Batch &Each : Batches )
+        {
+            Statistics.BarrierCalls += Each.Src ? 1 : 0;
+            Statistics.UnbatchedCalls += static_cast<uint32_t>( Each.Barriers.size() );
+        }
+    }
+
+    // Transient images and their memory; the declarations stay.
+    void Release()
+    {
+        for( auto &Each : Resources )
+        {
+            if( !Each.Transient ) continue;
+            if( Each.View ) vkDestroyImageView( Device, Each.View, nullptr );
+            if( Each.Image ) vkDestroyImage( Device, Each.Image, nullptr );
+            Each.View        = VK_NULL_HANDLE;
+            Each.Image       = VK_NULL_HANDLE;
+            Each.Block       = ~0u;
+            Each.Offset      = 0;
+            Each.AliasStages = 0;
+            Each.AliasAccess = 0;
+        }
+        for( auto &Block : Blocks ) Memory.Free( Block );
+        Blocks.clear();
+        Compiled = false;
+    }
+};
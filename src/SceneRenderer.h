@@ -0,0 +1,561 @@
+#pragma once
+#include "GpuScene.h"
+#include "CommandRecorder.h"
+#include "UniformRing.h"
+#include "VertexLayout.h"
+#include "IndirectCulling.h"
+#include <span>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <optional>
+#include <filesystem>
+
+// What the last Record put into the command buffer.
+struct RenderStatistics
+{
+    uint32_t Draws{ 0 };
+    uint64_t Triangles{ 0 };
+    uint32_t PipelineBinds{ 0 };
+    uint32_t DescriptorBinds{ 0 };
+    uint32_t BufferBinds{ 0 };
+    uint32_t PushConstants{ 0 };
+    uint32_t Instances{ 0 }; // covered by the draws, those the GPU culls from indirect draws included
+    uint32_t Dispatches{ 0 };
+    uint32_t DescriptorUpdates{ 0 }; // vkUpdateDescriptorSets calls, only when the uniform ring grew
+    uint64_t UniformBytes{ 0 };
+    double TransformMs{ 0.0 }; // composing every world matrix into the ring
+};
+
+// Draws every instance of a GpuScene, level 0 of its mesh, with shader.vert and shader.frag,
+// one instanced draw per batch of the grouped scene. Each frame takes a FrameUniformObject and
+// the world matrices of every instance from a UniformRing. Set 0 points at the ring once and is
+// moved by the frame block's dynamic offset, so a frame writes no descriptors unless the ring
+// had to grow; the matrices are composed from the scene's SceneTransforms straight into the
+// ring, which is bound again as the per-instance vertex buffer at binding 1. Set 1 is the
+// scene's BindlessTable, bound once with the texture index pushed per batch, or without
+// descriptor indexing a set per texture switched when the texture changes. With a
+// CommandRecorder the matrices are composed and the batches recorded by several threads, each
+// slice binding its own state. With culling, Cull runs cull.comp over the same matrices before
+// the render pass, and Record then draws each batch from the indirect commands it wrote.
+//
+// With occlusion as well, the frame is drawn in two render passes over the same attachments.
+// Cull runs the early phase of occlusion.comp and the first Record draws what was visible
+// last frame; Occlude, between the passes, builds a HiZPyramid from the depth that left and
+// runs the late phase against it, and the second Record draws what turned visible.
+class SceneRenderer
+{
+  public:
+    // The fragment shader defaults to bindless.frag or shader.frag next to vertexShader, and
+    // cull.comp is looked for there too, or with occlusion given occlusion.comp and hiz.comp.
+    // Culling stays off where the device cannot draw indirect commands from a first instance,
+    // and occlusion needs culling; occlusion is the depth attachment of renderPass. Shaders
+    // packed in pack under their paths are read from there.
+    SceneRenderer( VulkanInstance &vulkan, const GpuScene &scene, VkRenderPass renderPass, uint32_t frames = 1, const char *vertexShader = "bin/shaders/shader.vert.spv",
+                   const char *fragmentShader = nullptr, CullingMode culling = CullingMode::Off, const DepthSource *occlusion = nullptr, const AssetPack *pack = nullptr )
+        : Vulkan{ vulkan }, Scene{ scene }, Pass{ renderPass }, FramesInFlight{ std::max( frames, 1u ) }, Table{ scene.Bindless() }
+    {
+        if( Scene.Textures().empty() ) throw std::runtime_error( "Scene without textures." );
+        VkDevice Device{ Vulkan.Device() };
+        const VkPhysicalDeviceLimits &Limits{ Vulkan.Properties().limits };
+
+        VkSamplerCreateInfo SamplerCreateInfo{};
+        SamplerCreateInfo.sType            = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        SamplerCreateInfo.magFilter        = VK_FILTER_LINEAR;
+        SamplerCreateInfo.minFilter        = VK_FILTER_LINEAR;
+        SamplerCreateInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        SamplerCreateInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        SamplerCreateInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        SamplerCreateInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        SamplerCreateInfo.anisotropyEnable = Vulkan.Features().samplerAnisotropy;
+        SamplerCreateInfo.maxAnisotropy    = std::min( 8.f, Limits.maxSamplerAnisotropy );
+        SamplerCreateInfo.maxLod           = VK_LOD_CLAMP_NONE;
+        VkResult Result{ vkCreateSampler( Device, &SamplerCreateInfo, nullptr, &Sampler ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create sampler, error: {}", string_VkResult( Result ) ) );
+
+        VkDescriptorSetLayoutBinding UniformBinding{};
+        UniformBinding.binding         = 0;
+        UniformBinding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        UniformBinding.descriptorCount = 1;
+        UniformBinding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+        VkDescriptorSetLayoutBinding TextureBinding{};
+        TextureBinding.binding         = 0;
+        TextureBinding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        TextureBinding.descriptorCount = 1;
+        TextureBinding.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+        VkDescriptorSetLayoutCreateInfo DescriptorSetLayoutCreateInfo{};
+        DescriptorSetLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        DescriptorSetLayoutCreateInfo.bindingCount = 1;
+        DescriptorSetLayoutCreateInfo.pBindings    = &UniformBinding;
+        Result                                     = vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayouts[ 0 ] );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create descriptor set layout, error: {}", string_VkResult( Result ) ) );
+        if( !Table )
+        {
+            DescriptorSetLayoutCreateInfo.pBindings = &TextureBinding;
+            Result                                     = vkCreateDescriptorSetLayout( Device, &DescriptorSetLayoutCreateInfo, nullptr, &SetLayouts[ 1 ] );
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create descriptor set layout, error: {}", string_VkResult( Result ) ) );
+        }
+
+        VkDescriptorSetLayout PipelineSetLayouts[ 2 ]{ SetLayouts[ 0 ], Table ? Table->Layout() : SetLayouts[ 1 ] };
+        VkPushConstantRange PushConstantRange{ VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( DrawPushConstants ) };
+        VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo{};
+        PipelineLayoutCreateInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        PipelineLayoutCreateInfo.setLayoutCount         = 2;
+        PipelineLayoutCreateInfo.pSetLayouts            = PipelineSetLayouts;
+        PipelineLayoutCreateInfo.pushConstantRangeCount = Table ? 1 : 0;
+        PipelineLayoutCreateInfo.pPushConstantRanges    = &PushConstantRange;
+        Result                                          = vkCreatePipelineLayout( Device, &PipelineLayoutCreateInfo, nullptr, &Layout );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create pipeline layout, error: {}", string_VkResult( Result ) ) );
+        std::string Fragment{ fragmentShader ? fragmentShader : ( std::filesystem::path{ vertexShader }.parent_path() / ( Table ? "bindless.frag.spv" : "shader.frag.spv" ) ).string() };
+        CreatePipeline( renderPass, vertexShader, Fragment.c_str(), pack );
+
+        uint32_t Textures{ Table ? 0 : static_cast<uint32_t>( Scene.Textures().size() ) };
+        VkDescriptorPoolSize PoolSizes[ 2 ]{ { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Textures } };
+        VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo{};
+        DescriptorPoolCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        DescriptorPoolCreateInfo.maxSets       = Textures + 1;
+        DescriptorPoolCreateInfo.poolSizeCount = Textures ? 2 : 1;
+        DescriptorPoolCreateInfo.pPoolSizes    = PoolSizes;
+        Result                                 = vkCreateDescriptorPool( Device, &DescriptorPoolCreateInfo, nullptr, &DescriptorPool );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create descriptor pool, error: {}", string_VkResult( Result ) ) );
+        std::vector<VkDescriptorSetLayout> Layouts( Textures + 1, SetLayouts[ 1 ] );
+        Layouts[ 0 ] = SetLayouts[ 0 ];
+        std::vector<VkDescriptorSet> Sets( Textures + 1 );
+        VkDescriptorSetAllocateInfo DescriptorSetAllocateInfo{};
+        DescriptorSetAllocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        DescriptorSetAllocateInfo.descriptorPool     = DescriptorPool;
+        DescriptorSetAllocateInfo.descriptorSetCount = Textures + 1;
+        DescriptorSetAllocateInfo.pSetLayouts        = Layouts.data();
+        Result                                       = vkAllocateDescriptorSets( Device, &DescriptorSetAllocateInfo, Sets.data() );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate descriptor sets, error: {}", string_VkResult( Result ) ) );
+        UniformSet = Sets.front();
+        TextureSets.assign( Sets.begin() + 1, Sets.end() );
+
+        std::vector<VkDescriptorImageInfo> ImageInfos;
+        std::vector<VkWriteDescriptorSet> Writes;
+        ImageInfos.reserve( Textures );
+        for( uint32_t Index{ 0 }; Index < Textures; Index++ )
+        {
+            ImageInfos.push_back( { Sampler, Scene.Textures()[ Index ].View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } );
+            VkWriteDescriptorSet Write{};
+            Write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            Write.dstSet          = TextureSets[ Index ];
+            Write.dstBinding      = 0;
+            Write.descriptorCount = 1;
+            Write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            Write.pImageInfo      = &ImageInfos.back();
+            Writes.push_back( Write );
+        }
+        if( !Writes.empty() )
+        {
+            vkUpdateDescriptorSets( Device, static_cast<uint32_t>( Writes.size() ), Writes.data(), 0, nullptr );
+            Updates++;
+        }
+
+        if( culling != CullingMode::Off && IndirectCullingSupported( Vulkan.Features() ) )
+        {
+            std::filesystem::path Shaders{ std::filesystem::path{ vertexShader }.parent_path() };
+            if( occlusion ) DepthPyramid.emplace( Vulkan, *occlusion, ( Shaders / "hiz.comp.spv" ).string().c_str(), pack );
+            GpuCulling.emplace( Vulkan, Scene, culling, FramesInFlight, ( Shaders / ( occlusion ? "occlusion.comp.spv" : "cull.comp.spv" ) ).string().c_str(),
+                                DepthPyramid ? &*DepthPyramid : nullptr, pack );
+        }
+        VkBufferUsageFlags RingUsage{ VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | ( GpuCulling ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0u ) };
+        Ring.emplace( Device, Vulkan.DeviceMemory(), std::max( Limits.minUniformBufferOffsetAlignment, Limits.minStorageBufferOffsetAlignment ), FrameBytes( Scene.Transforms.PaddedSize() ),
+                      FramesInFlight, RingUsage );
+        WriteUniformSet();
+    }
+    SceneRenderer( const SceneRenderer & )            = delete;
+    SceneRenderer &operator=( const SceneRenderer & ) = delete;
+
+    ~SceneRenderer()
+    {
+        VkDevice Device{ Vulkan.Device() };
+        GpuCulling.reset();
+        DepthPyramid.reset();
+        Ring.reset();
+        vkDestroyDescriptorPool( Device, DescriptorPool, nullptr );
+        vkDestroyPipeline( Device, Pipeline, nullptr );
+        vkDestroyPipelineLayout( Device, Layout, nullptr );
+        for( auto SetLayout : SetLayouts ) vkDestroyDescriptorSetLayout( Device, SetLayout, nullptr );
+        vkDestroySampler( Device, Sampler, nullptr );
+    }
+
+    // Inside a render pass instance of the render pass given at construction, subpass 0; frame
+    // is the frame in flight, below the frames given at construction. The scene must have been
+    // grouped since its last instance was added.
+    void Record( VkCommandBuffer commandBuffer, VkExtent2D extent, const glm::mat4 &view, const glm::mat4 &proj, uint32_t frame = 0 )
+    {
+        PROFILE_ZONE( "record scene" );
+        if( !Start( view, proj, frame, nullptr ) ) return;
+        Draw( commandBuffer, extent, 0, Scene.Batches().size(), Statistics );
+    }
+
+    // The same draws cut into slices recorded by the workers of recorder into secondary command
+    // buffers, after the same workers composed the matrices; the render pass instance on
+    // framebuffer must have been begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, after
+    // recorder.Begin for this frame.
+    void Record( CommandRecorder &recorder, VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, VkExtent2D extent, const glm::mat4 &view, const glm::mat4 &proj, uint32_t frame = 0 )
+    {
+        PROFILE_ZONE( "record scene" );
+        if( !Start( view, proj, frame, &recorder.Workers() ) ) return;
+        SliceStatistics.assign( recorder.Threads(), RenderStatistics{} );
+        uint32_t Slices{ recorder.Record( commandBuffer, Pass, 0, framebuffer, Scene.Batches().size(),
+                                          [ & ]( VkCommandBuffer secondary, uint32_t slice, size_t first, size_t last )
+                                          { Draw( secondary, extent, first, last, SliceStatistics[ slice ] ); } ) };
+        for( uint32_t Slice{ 0 }; Slice < Slices; Slice++ )
+        {
+            Statistics.Draws += SliceStatistics[ Slice ].Draws;
+            Statistics.Triangles += SliceStatistics[ Slice ].Triangles;
+            Statistics.PipelineBinds += SliceStatistics[ Slice ].PipelineBinds;
+            Statistics.DescriptorBinds += SliceStatistics[ Slice ].DescriptorBinds;
+            Statistics.BufferBinds += SliceStatistics[ Slice ].BufferBinds;
+            Statistics.PushConstants += SliceStatistics[ Slice ].PushConstants;
+            Statistics.Instances += SliceStatistics[ Slice ].Instances;
+        }
+    }
+
+    // Outside a render pass, before the Record of the same frame, which then draws what survived;
+    // nothing happens with culling off. The matrices are composed on the workers of jobs when given.
+    void Cull( VkCommandBuffer commandBuffer, const glm::mat4 &view, const glm::mat4 &proj, uint32_t frame = 0, JobSystem *jobs = nullptr )
+    {
+        PROFILE_ZONE( "cull scene" );
+        Culled = false;
+        Late   = false;
+        Early  = false;
+        if( !GpuCulling ) return;
+        Statistics = {};
+        if( !Scene.Grouped() ) throw std::runtime_error( "Scene instances added since it was last grouped." );
+        if( Scene.Batches().empty() ) return;
+        Prepare( view, proj, frame, jobs );
+        if( GpuCulling->Models( Ring->Handle(), VkDeviceSize( Scene.Transforms.PaddedSize() ) * sizeof( glm::mat4 ) ) )
+        {
+            Updates++;
+            Statistics.DescriptorUpdates++;
+        }
+        GpuCulling->Dispatch( commandBuffer, view, proj, Objects, frame );
+        Statistics.Dispatches++;
+        Culled = true;
+        Early  = DepthPyramid.has_value();
+        View   = view;
+        Proj   = proj;
+    }
+
+    // Between the render passes of a frame culled with occlusion, after the first Record; the
+    // next Record draws the instances the late phase found visible that the first one did not.
+    // Nothing happens otherwise.
+    void Occlude( VkCommandBuffer commandBuffer )
+    {
+        PROFILE_ZONE( "occlude scene" );
+        if( !Early ) return;
+        Early = false;
+        DepthPyramid->Build( commandBuffer );
+        GpuCulling->Dispatch( commandBuffer, View, Proj, Objects, Frame, true );
+        Statistics.Dispatches++;
+        Culled = true;
+        Late   = true;
+    }
+
+    RenderStatistics Stat() const
+    {
+        return Statistics;
+    }
+
+    // Off when asked for, or when the device cannot cull.
+    CullingMode Culling() const
+    {
+        return GpuCulling ? GpuCulling->Mode() : CullingMode::Off;
+    }
+    // Null with culling off; what the GPU found visible is read back through it.
+    const IndirectCuller *Culler() const
+    {
+        return GpuCulling ? &*GpuCulling : nullptr;
+    }
+
+    // Culled in two phases, so every frame takes Occlude and a second Record.
+    bool Occlusion() const
+    {
+        return DepthPyramid.has_value();
+    }
+    // Null without occlusion.
+    const HiZPyramid *Pyramid() const
+    {
+        return DepthPyramid ? &*DepthPyramid : nullptr;
+    }
+    // Whether the following pyramid builds copy the depth out, for HiZPyramid::Depth.
+    void CaptureDepth( bool capture )
+    {
+        if( DepthPyramid ) DepthPyramid->Capture( capture );
+    }
+
+    // Set 1 is the scene's BindlessTable.
+    bool Bindless() const
+    {
+        return Table;
+    }
+
+    // vkUpdateDescriptorSets calls since construction, the ones at construction included; the
+    // BindlessTable counts its own.
+    uint64_t DescriptorUpdates() const
+    {
+        return Updates;
+    }
+
+  private:
+    VulkanInstance &Vulkan;
+    const GpuScene &Scene;
+    VkRenderPass Pass;
+    uint32_t FramesInFlight;
+    const BindlessTable *Table;
+    VkSampler Sampler{ VK_NULL_HANDLE };
+    VkDescriptorSetLayout SetLayouts[ 2 ]{}; // uniforms, texture
+    VkPipelineLayout Layout{ VK_NULL_HANDLE };
+    VkPipeline Pipeline{ VK_NULL_HANDLE };
+    VkDescriptorPool DescriptorPool{ VK_NULL_HANDLE };
+    VkDescriptorSet UniformSet{ VK_NULL_HANDLE };
+    std::vector<VkDescriptorSet> TextureSets;
+    std::optional<UniformRing> Ring;
+    std::optional<HiZPyramid> DepthPyramid;
+    std::optional<IndirectCuller> GpuCulling;
+    bool Culled{ false };    // Cull ran for the frame being recorded
+    bool Indirect{ false };  // the draws being recorded come from GpuCulling
+    bool Early{ false };     // the early phase ran and the late one has yet to
+    bool Late{ false };      // Occlude ran for the next Record
+    bool LatePhase{ false }; // the draws being recorded are the late phase's
+    glm::mat4 View{ 1.f }, Proj{ 1.f }; // Cull's, for the late phase
+    uint32_t Frame{ 0 };
+    uint32_t FrameOffset{ 0 }; // this frame's FrameUniformObject
+    VkDeviceSize Objects{ 0 }; // this frame's world matrices, the instance vertex buffer
+    uint64_t Updates{ 0 };
+    RenderStatistics Statistics;
+    std::vector<RenderStatistics> SliceStatistics;
+
+    // Ring bytes a frame of count instances takes, count padded as SceneTransforms pads it; 256
+    // is the coarsest offset alignment Vulkan allows.
+    VkDeviceSize FrameBytes( size_t count ) const
+    {
+        return ( sizeof( FrameUniformObject ) + 255 ) / 256 * 256 + ( std::max<size_t>( count, 1 ) * sizeof( glm::mat4 ) + 255 ) / 256 * 256;
+    }
+
+    // Statistics and the ring for a Record, unless Cull already took care of both for this
+    // frame; false when there is nothing to draw. The late Record adds to the early one's.
+    bool Start( const glm::mat4 &view, const glm::mat4 &proj, uint32_t frame, JobSystem *jobs )
+    {
+        Indirect  = Culled;
+        LatePhase = Late;
+        Culled    = false;
+        Late      = false;
+        if( Indirect ) return true;
+        Statistics = {};
+        if( !Scene.Grouped() ) throw std::runtime_error( "Scene instances added since it was last grouped." );
+        if( Scene.Batches().empty() ) return false;
+        Prepare( view, proj, frame, jobs );
+        return true;
+    }
+
+    // Takes this frame's blocks from the ring, growing it first if the scene did, and composes
+    // every world matrix into it, on the workers of jobs when there are any.
+    void Prepare( const glm::mat4 &view, const glm::mat4 &proj, uint32_t frame, JobSystem *jobs )
+    {
+        const SceneTransforms &Transforms{ Scene.Transforms };
+        Frame = frame;
+        Ring->Begin( frame );
+        if( Ring->Reserve( FrameBytes( Transforms.PaddedSize() ) ) )
+        {
+            WriteUniformSet();
+            Statistics.DescriptorUpdates++;
+        }
+        VkDeviceSize Offset{ Ring->Allocate( sizeof( FrameUniformObject ) ) };
+        FrameUniformObject Uniform{ view, proj };
+        memcpy( Ring->Mapped( Offset ), &Uniform, sizeof( Uniform ) );
+        FrameOffset = static_cast<uint32_t>( Offset );
+        Objects     = Ring->Allocate( VkDeviceSize( Transforms.PaddedSize() ) * sizeof( glm::mat4 ) );
+        Statistics.UniformBytes = Ring->Stat().Bytes;
+
+        PROFILE_ZONE( "compose transforms" );
+        auto Start{ std::chrono::steady_clock::now() };
+        std::byte *Matrices{ reinterpret_cast<std::byte *>( Ring->Mapped( Objects ) ) };
+        if( jobs )
+            ComposeTransformsParallel( *jobs, Transforms, Matrices, sizeof( glm::mat4 ) );
+        else
+            ComposeTransforms( Transforms, 0, Transforms.PaddedSize(), Matrices, sizeof( glm::mat4 ) );
+        Statistics.TransformMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count();
+    }
+
+    // Points set 0 at the ring; its dynamic offset does the rest.
+    void WriteUniformSet()
+    {
+        VkDescriptorBufferInfo BufferInfo{ Ring->Handle(), 0, sizeof( FrameUniformObject ) };
+        VkWriteDescriptorSet Write{};
+        Write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Write.dstSet          = UniformSet;
+        Write.dstBinding      = 0;
+        Write.descriptorCount = 1;
+        Write.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        Write.pBufferInfo     = &BufferInfo;
+        vkUpdateDescriptorSets( Vulkan.Device(), 1, &Write, 0, nullptr );
+        Updates++;
+    }
+
+    // Batches first to last, an instanced draw each; a command buffer starts with no state bound,
+    // so every slice binds its own.
+    void Draw( VkCommandBuffer commandBuffer, VkExtent2D extent, size_t first, size_t last, RenderStatistics &statistics )
+    {
+        vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline );
+        statistics.PipelineBinds++;
+        VkViewport Viewport{ 0.f, 0.f, float( extent.width ), float( extent.height ), 0.f, 1.f };
+        VkRect2D Scissor{ { 0, 0 }, extent };
+        vkCmdSetViewport( commandBuffer, 0, 1, &Viewport );
+        vkCmdSetScissor( commandBuffer, 0, 1, &Scissor );
+        vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout, 0, 1, &UniformSet, 1, &FrameOffset );
+        statistics.DescriptorBinds++;
+        if( Table )
+        {
+            VkDescriptorSet Set{ Table->Handle() };
+            vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout, 1, 1, &Set, 0, nullptr );
+            statistics.DescriptorBinds++;
+        }
+        VkBuffer InstanceBuffer{ Ring->Handle() };
+        vkCmdBindVertexBuffers( commandBuffer, 1, 1, &InstanceBuffer, &Objects );
+        statistics.BufferBinds++;
+        uint32_t BoundMesh{ ~0u }, BoundTexture{ ~0u };
+        for( size_t Index{ first }; Index < last; Index++ )
+        {
+            const SceneBatch &Batch{ Scene.Batches()[ Index ] };
+            const SceneMesh &Mesh{ Scene.Meshes()[ Batch.Mesh ] };
+            if( !Mesh.Vertecies || Mesh.Lods.empty() ) continue;
+            if( Batch.Mesh != BoundMesh )
+            {
+                VkDeviceSize Offset{ 0 };
+                vkCmdBindVertexBuffers( commandBuffer, 0, 1, &Mesh.Vertecies, &Offset );
+                vkCmdBindIndexBuffer( commandBuffer, Mesh.Indices, 0, VK_INDEX_TYPE_UINT32 );
+                BoundMesh = Batch.Mesh;
+                statistics.BufferBinds++;
+            }
+            if( Batch.Texture != BoundTexture )
+            {
+                if( Table )
+                {
+                    DrawPushConstants Constants{ Batch.Texture };
+                    vkCmdPushConstants( commandBuffer, Layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( Constants ), &Constants );
+                    statistics.PushConstants++;
+                }
+                else
+                {
+                    vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Layout, 1, 1, &TextureSets[ Batch.Texture ], 0, nullptr );
+                    statistics.DescriptorBinds++;
+                }
+                BoundTexture = Batch.Texture;
+            }
+            if( !LatePhase ) statistics.Instances += Batch.Count;
+            if( Indirect )
+            {
+                statistics.Draws += GpuCulling->Draw( commandBuffer, static_cast<uint32_t>( Index ), Frame, LatePhase );
+                continue;
+            }
+            const MeshLod &Lod{ Mesh.Lods.front() };
+            vkCmdDrawIndexed( commandBuffer, Lod.IndicesCount, Batch.Count, Lod.IndeciesOffset, static_cast<int32_t>( Lod.VerteciesOffset ), Batch.First );
+            statistics.Draws++;
+            statistics.Triangles += uint64_t( Lod.IndicesCount / 3 ) * Batch.Count;
+        }
+    }
+
+    void CreatePipeline( VkRenderPass renderPass, const char *vertexShader, const char *fragmentShader, const AssetPack *pack )
+    {
+        VkDevice Device{ Vulkan.Device() };
+        VkShaderModule Vert{ CreateShaderModule( Device, vertexShader, pack ) };
+        VkShaderModule Frag{ VK_NULL_HANDLE };
+        try
+        {
+            Frag = CreateShaderModule( Device, fragmentShader, pack );
+        }
+        catch( ... )
+        {
+            vkDestroyShaderModule( Device, Vert, nullptr );
+            throw;
+        }
+        VkPipelineShaderStageCreateInfo Stages[ 2 ]{};
+        Stages[ 0 ].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        Stages[ 0 ].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+        Stages[ 0 ].module = Vert;
+        Stages[ 0 ].pName  = "main";
+        Stages[ 1 ].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        Stages[ 1 ].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+        Stages[ 1 ].module = Frag;
+        Stages[ 1 ].pName  = "main";
+
+        // Binding 0 the mesh, binding 1 a world matrix per instance at locations 3 to 6.
+        VkVertexInputBindingDescription Bindings[ 2 ]{ Vertex::InputBindingDescription(), InstanceLayout::BindingDescription( 1, VK_VERTEX_INPUT_RATE_INSTANCE ) };
+        auto VertexAttributes{ Vertex::InputAttributeDescription() };
+        auto InstanceAttributes{ InstanceLayout::AttributeDescriptions( 1, static_cast<uint32_t>( VertexAttributes.size() ) ) };
+        std::vector<VkVertexInputAttributeDescription> Attributes{ VertexAttributes.begin(), VertexAttributes.end() };
+        Attributes.insert( Attributes.end(), InstanceAttributes.begin(), InstanceAttributes.end() );
+        VkPipelineVertexInputStateCreateInfo VertexInputState{};
+        VertexInputState.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        VertexInputState.vertexBindingDescriptionCount   = 2;
+        VertexInputState.pVertexBindingDescriptions      = Bindings;
+        VertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>( Attributes.size() );
+        VertexInputState.pVertexAttributeDescriptions    = Attributes.data();
+        VkPipelineInputAssemblyStateCreateInfo InputAssemblyState{};
+        InputAssemblyState.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        InputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPipelineViewportStateCreateInfo ViewportState{};
+        ViewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        ViewportState.viewportCount = 1;
+        ViewportState.scissorCount  = 1;
+        // The models do not agree on winding, so nothing is culled.
+        VkPipelineRasterizationStateCreateInfo RasterizationState{};
+        RasterizationState.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        RasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+        RasterizationState.cullMode    = VK_CULL_MODE_NONE;
+        RasterizationState.frontFace   = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        RasterizationState.lineWidth   = 1.f;
+        VkPipelineMultisampleStateCreateInfo MultisampleState{};
+        MultisampleState.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        MultisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        VkPipelineDepthStencilStateCreateInfo DepthStencilState{};
+        DepthStencilState.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        DepthStencilState.depthTestEnable  = VK_TRUE;
+        DepthStencilState.depthWriteEnable = VK_TRUE;
+        DepthStencilState.depthCompareOp   = VK_COMPARE_OP_LESS;
+        VkPipelineColorBlendAttachmentState ColorBlendAttachment{};
+        ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        VkPipelineColorBlendStateCreateInfo ColorBlendState{};
+        ColorBlendState.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        ColorBlendState.attachmentCount = 1;
+        ColorBlendState.pAttachments    = &ColorBlendAttachment;
+        VkDynamicState DynamicStates[ 2 ]{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo DynamicState{};
+        DynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        DynamicState.dynamicStateCount = 2;
+        DynamicState.pDynamicStates    = DynamicStates;
+
+        VkGraphicsPipelineCreateInfo GraphicsPipelineCreateInfo{};
+        GraphicsPipelineCreateInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        GraphicsPipelineCreateInfo.stageCount          = 2;
+        GraphicsPipelineCreateInfo.pStages             = Stages;
+        GraphicsPipelineCreateInfo.pVertexInputState   = &VertexInputState;
+        GraphicsPipelineCreateInfo.pInputAssemblyState = &InputAssemblyState;
+        GraphicsPipelineCreateInfo.pViewportState      = &ViewportState;
+        GraphicsPipelineCreateInfo.pRasterizationState = &RasterizationState;
+        GraphicsPipelineCreateInfo.pMultisampleState   = &MultisampleState;
+        GraphicsPipelineCreateInfo.pDepthStencilState  = &DepthStencilState;
+        GraphicsPipelineCreateInfo.pColorBlendState    = &ColorBlendState;
+        GraphicsPipelineCreateInfo.pDynamicState       = &DynamicState;
+        GraphicsPipelineCreateInfo.layout              = Layout;
+        GraphicsPipelineCreateInfo.renderPass          = renderPass;
+        GraphicsPipelineCreateInfo.subpass             = 0;
+        try
+        {
+            Vulkan.PipelineCompiler().CreateGraphicsPipelines( { &GraphicsPipelineCreateInfo, 1 }, &Pipeline );
+        }
+        catch( ... )
+        {
+            vkDestroyShaderModule( Device, Frag, nullptr );
+            vkDestroyShaderModule( Device, Vert, nullptr );
+            throw;
+        }
+        vkDestroyShaderModule( Device, Frag, nullptr );
+        vkDestroyShaderModule( Device, Vert, nullptr );
+    }
+};
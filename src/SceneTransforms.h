@@ -0,0 +1,243 @@
+#pragma once
+#include "JobSystem.h"
+#include <span>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#    include <immintrin.h>
+#endif
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Instance transforms in structure-of-arrays form: translation, rotation quaternion and scale,
+// an array per component, padded to a multiple of Width with identity transforms so the SIMD
+// kernels never deal with a tail. World matrices are translation * rotation * scale.
+class SceneTransforms
+{
+  public:
+    static constexpr uint32_t Width{ 8 };
+
+    uint32_t Add( const glm::vec3 &translation, const glm::quat &rotation = glm::quat{ 1.f, 0.f, 0.f, 0.f }, const glm::vec3 &scale = glm::vec3{ 1.f } )
+    {
+        if( Count == PaddedSize() ) Pad( Count + Width );
+        Set( Count, translation, rotation, scale );
+        return Count++;
+    }
+
+    void Set( uint32_t index, const glm::vec3 &translation, const glm::quat &rotation, const glm::vec3 &scale )
+    {
+        X[ index ]         = translation.x;
+        Y[ index ]         = translation.y;
+        Z[ index ]         = translation.z;
+        RotationX[ index ] = rotation.x;
+        RotationY[ index ] = rotation.y;
+        RotationZ[ index ] = rotation.z;
+        RotationW[ index ] = rotation.w;
+        ScaleX[ index ]    = scale.x;
+        ScaleY[ index ]    = scale.y;
+        ScaleZ[ index ]    = scale.z;
+    }
+
+    void SetTranslation( uint32_t index, const glm::vec3 &translation )
+    {
+        X[ index ] = translation.x;
+        Y[ index ] = translation.y;
+        Z[ index ] = translation.z;
+    }
+
+    glm::vec3 Translation( uint32_t index ) const
+    {
+        return { X[ index ], Y[ index ], Z[ index ] };
+    }
+    glm::quat Rotation( uint32_t index ) const
+    {
+        return { RotationW[ index ], RotationX[ index ], RotationY[ index ], RotationZ[ index ] };
+    }
+    glm::vec3 Scale( uint32_t index ) const
+    {
+        return { ScaleX[ index ], ScaleY[ index ], ScaleZ[ index ] };
+    }
+
+    // One world matrix the slow way, for the odd lookup and as the reference for the kernels.
+    glm::mat4 Matrix( uint32_t index ) const
+    {
+        glm::mat4 Result{ glm::mat4_cast( Rotation( index ) ) };
+        Result[ 0 ] *= ScaleX[ index ];
+        Result[ 1 ] *= ScaleY[ index ];
+        Result[ 2 ] *= ScaleZ[ index ];
+        Result[ 3 ] = glm::vec4{ Translation( index ), 1.f };
+        return Result;
+    }
+
+    // Entry i moves to where order lists it: after the call entry k is the old entry order[ k ].
+    void Reorder( std::span<const uint32_t> order )
+    {
+        for( auto *Lane : Lanes() )
+        {
+            std::vector<float> Sorted( Lane->size() );
+            for( size_t i{ 0 }; i < order.size(); i++ ) Sorted[ i ] = ( *Lane )[ order[ i ] ];
+            std::copy( Lane->begin() + order.size(), Lane->end(), Sorted.begin() + order.size() );
+            Lane->swap( Sorted );
+        }
+    }
+
+    void Clear()
+    {
+        Count = 0;
+        Pad( 0 );
+    }
+
+    uint32_t Size() const
+    {
+        return Count;
+    }
+    uint32_t PaddedSize() const
+    {
+        return static_cast<uint32_t>( X.size() );
+    }
+
+    std::vector<float> X, Y, Z, RotationX, RotationY, RotationZ, RotationW, ScaleX, ScaleY, ScaleZ;
+
+  private:
+    uint32_t Count{ 0 };
+
+    std::array<std::vector<float> *, 10> Lanes()
+    {
+        return { &X, &Y, &Z, &RotationX, &RotationY, &RotationZ, &RotationW, &ScaleX, &ScaleY, &ScaleZ };
+    }
+
+    void Pad( size_t size )
+    {
+        for( auto *Lane : { &X, &Y, &Z, &RotationX, &RotationY, &RotationZ } ) Lane->resize( size, 0.f );
+        for( auto *Lane : { &RotationW, &ScaleX, &ScaleY, &ScaleZ } ) Lane->resize( size, 1.f );
+    }
+};
+
+// Every kernel writes the world matrices of [begin, end) column major to out + i * stride, so
+// they can land straight in a mapped per-instance buffer; begin and end are multiples of
+// SceneTransforms::Width or the padded size, and out must have room for the padding.
+inline void ComposeTransformsScalar( const SceneTransforms &data, uint32_t begin, uint32_t end, std::byte *out, size_t stride )
+{
+    for( uint32_t i{ begin }; i < end; i++ )
+    {
+        float QX{ data.RotationX[ i ] }, QY{ data.RotationY[ i ] }, QZ{ data.RotationZ[ i ] }, QW{ data.RotationW[ i ] };
+        float XX{ QX * QX }, YY{ QY * QY }, ZZ{ QZ * QZ }, XY{ QX * QY }, XZ{ QX * QZ }, YZ{ QY * QZ }, WX{ QW * QX }, WY{ QW * QY }, WZ{ QW * QZ };
+        float SX{ data.ScaleX[ i ] }, SY{ data.ScaleY[ i ] }, SZ{ data.ScaleZ[ i ] };
+        const float Matrix[ 16 ]{ ( 1.f - 2.f * ( YY + ZZ ) ) * SX, 2.f * ( XY + WZ ) * SX, 2.f * ( XZ - WY ) * SX, 0.f,
+                                  2.f * ( XY - WZ ) * SY, ( 1.f - 2.f * ( XX + ZZ ) ) * SY, 2.f * ( YZ + WX ) * SY, 0.f,
+                                  2.f * ( XZ + WY ) * SZ, 2.f * ( YZ - WX ) * SZ, ( 1.f - 2.f * ( XX + YY ) ) * SZ, 0.f,
+                                  data.X[ i ], data.Y[ i ], data.Z[ i ], 1.f };
+        memcpy( out + i * stride, Matrix, sizeof( Matrix ) );
+    }
+}
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+// Columns[ c ][ r ] holds row r of column c for four instances; transposed in place and stored
+// as four matrices starting at out.
+inline void StoreTransforms( __m128 ( &columns )[ 4 ][ 4 ], std::byte *out, size_t stride )
+{
+    for( uint32_t Column{ 0 }; Column < 4; Column++ )
+        _MM_TRANSPOSE4_PS( columns[ Column ][ 0 ], columns[ Column ][ 1 ], columns[ Column ][ 2 ], columns[ Column ][ 3 ] );
+    for( uint32_t Lane{ 0 }; Lane < 4; Lane++ )
+        for( uint32_t Column{ 0 }; Column < 4; Column++ ) _mm_storeu_ps( reinterpret_cast<float *>( out + Lane * stride ) + Column * 4, columns[ Column ][ Lane ] );
+}
+
+inline void ComposeTransformsSse( const SceneTransforms &data, uint32_t begin, uint32_t end, std::byte *out, size_t stride )
+{
+    const __m128 Zero{ _mm_setzero_ps() }, One{ _mm_set1_ps( 1.f ) }, Two{ _mm_set1_ps( 2.f ) };
+    for( uint32_t i{ begin }; i < end; i += 4 )
+    {
+        __m128 QX{ _mm_loadu_ps( &data.RotationX[ i ] ) }, QY{ _mm_loadu_ps( &data.RotationY[ i ] ) }, QZ{ _mm_loadu_ps( &data.RotationZ[ i ] ) }, QW{ _mm_loadu_ps( &data.RotationW[ i ] ) };
+        __m128 X2{ _mm_mul_ps( QX, Two ) }, Y2{ _mm_mul_ps( QY, Two ) }, Z2{ _mm_mul_ps( QZ, Two ) };
+        __m128 XX{ _mm_mul_ps( QX, X2 ) }, YY{ _mm_mul_ps( QY, Y2 ) }, ZZ{ _mm_mul_ps( QZ, Z2 ) };
+        __m128 XY{ _mm_mul_ps( QX, Y2 ) }, XZ{ _mm_mul_ps( QX, Z2 ) }, YZ{ _mm_mul_ps( QY, Z2 ) };
+        __m128 WX{ _mm_mul_ps( QW, X2 ) }, WY{ _mm_mul_ps( QW, Y2 ) }, WZ{ _mm_mul_ps( QW, Z2 ) };
+        __m128 SX{ _mm_loadu_ps( &data.ScaleX[ i ] ) }, SY{ _mm_loadu_ps( &data.ScaleY[ i ] ) }, SZ{ _mm_loadu_ps( &data.ScaleZ[ i ] ) };
+        __m128 Columns[ 4 ][ 4 ]{
+            { _mm_mul_ps( _mm_sub_ps( One, _mm_add_ps( YY, ZZ ) ), SX ), _mm_mul_ps( _mm_add_ps( XY, WZ ), SX ), _mm_mul_ps( _mm_sub_ps( XZ, WY ), SX ), Zero },
+            { _mm_mul_ps( _mm_sub_ps( XY, WZ ), SY ), _mm_mul_ps( _mm_sub_ps( One, _mm_add_ps( XX, ZZ ) ), SY ), _mm_mul_ps( _mm_add_ps( YZ, WX ), SY ), Zero },
+            { _mm_mul_ps( _mm_add_ps( XZ, WY ), SZ ), _mm_mul_ps( _mm_sub_ps( YZ, WX ), SZ ), _mm_mul_ps( _mm_sub_ps( One, _mm_add_ps( XX, YY ) ), SZ ), Zero },
+            { _mm_loadu_ps( &data.X[ i ] ), _mm_loadu_ps( &data.Y[ i ] ), _mm_loadu_ps( &data.Z[ i ] ), One } };
+        StoreTransforms( Columns, out + i * stride, stride );
+    }
+}
+#endif
+
+#if defined( __AVX2__ )
+inline void ComposeTransformsAvx2( const SceneTransforms &data, uint32_t begin, uint32_t end, std::byte *out, size_t stride )
+{
+    const __m256 One{ _mm256_set1_ps( 1.f ) }, Two{ _mm256_set1_ps( 2.f ) };
+    const __m128 Zero{ _mm_setzero_ps() }, Unit{ _mm_set1_ps( 1.f ) };
+    for( uint32_t i{ begin }; i < end; i += 8 )
+    {
+        __m256 QX{ _mm256_loadu_ps( &data.RotationX[ i ] ) }, QY{ _mm256_loadu_ps( &data.RotationY[ i ] ) }, QZ{ _mm256_loadu_ps( &data.RotationZ[ i ] ) };
+        __m256 QW{ _mm256_loadu_ps( &data.RotationW[ i ] ) };
+        __m256 X2{ _mm256_mul_ps( QX, Two ) }, Y2{ _mm256_mul_ps( QY, Two ) }, Z2{ _mm256_mul_ps( QZ, Two ) };
+        __m256 XX{ _mm256_mul_ps( QX, X2 ) }, YY{ _mm256_mul_ps( QY, Y2 ) }, ZZ{ _mm256_mul_ps( QZ, Z2 ) };
+        __m256 XY{ _mm256_mul_ps( QX, Y2 ) }, XZ{ _mm256_mul_ps( QX, Z2 ) }, YZ{ _mm256_mul_ps( QY, Z2 ) };
+        __m256 WX{ _mm256_mul_ps( QW, X2 ) }, WY{ _mm256_mul_ps( QW, Y2 ) }, WZ{ _mm256_mul_ps( QW, Z2 ) };
+        __m256 SX{ _mm256_loadu_ps( &data.ScaleX[ i ] ) }, SY{ _mm256_loadu_ps( &data.ScaleY[ i ] ) }, SZ{ _mm256_loadu_ps( &data.ScaleZ[ i ] ) };
+        __m256 Rotation[ 3 ][ 3 ]{
+            { _mm256_mul_ps( _mm256_sub_ps( One, _mm256_add_ps( YY, ZZ ) ), SX ), _mm256_mul_ps( _mm256_add_ps( XY, WZ ), SX ), _mm256_mul_ps( _mm256_sub_ps( XZ, WY ), SX ) },
+            { _mm256_mul_ps( _mm256_sub_ps( XY, WZ ), SY ), _mm256_mul_ps( _mm256_sub_ps( One, _mm256_add_ps( XX, ZZ ) ), SY ), _mm256_mul_ps( _mm256_add_ps( YZ, WX ), SY ) },
+            { _mm256_mul_ps( _mm256_add_ps( XZ, WY ), SZ ), _mm256_mul_ps( _mm256_sub_ps( YZ, WX ), SZ ), _mm256_mul_ps( _mm256_sub_ps( One, _mm256_add_ps( XX, YY ) ), SZ ) } };
+        __m256 Translation[ 3 ]{ _mm256_loadu_ps( &data.X[ i ] ), _mm256_loadu_ps( &data.Y[ i ] ), _mm256_loadu_ps( &data.Z[ i ] ) };
+        // The transpose is four wide, so each half of the registers is stored on its own.
+        for( uint32_t Half{ 0 }; Half < 2; Half++ )
+        {
+            auto Lanes{ [ Half ]( __m256 value )
+                        { return Half ? _mm256_extractf128_ps( value, 1 ) : _mm256_castps256_ps128( value ); } };
+            __m128 Columns[ 4 ][ 4 ]{ { Lanes( Rotation[ 0 ][ 0 ] ), Lanes( Rotation[ 0 ][ 1 ] ), Lanes( Rotation[ 0 ][ 2 ] ), Zero },
+                                      { Lanes( Rotation[ 1 ][ 0 ] ), Lanes( Rotation[ 1 ][ 1 ] ), Lanes( Rotation[ 1 ][ 2 ] ), Zero },
+                                      { Lanes( Rotation[ 2 ][ 0 ] ), Lanes( Rotation[ 2 ][ 1 ] ), Lanes( Rotation[ 2 ][ 2 ] ), Zero },
+                                      { Lanes( Translation[ 0 ] ), Lanes( Translation[ 1 ] ), Lanes( Translation[ 2 ] ), Unit } };
+            StoreTransforms( Columns, out + ( i + Half * 4 ) * stride, stride );
+        }
+    }
+}
+#endif
+
+// Widest kernel this translation unit was compiled for; AVX2 needs ENABLE_AVX2 in CMake, and
+// targets without SSE run the scalar one.
+inline void ComposeTransforms( const SceneTransforms &data, uint32_t begin, uint32_t end, std::byte *out, size_t stride )
+{
+#if defined( __AVX2__ )
+    ComposeTransformsAvx2( data, begin, end, out, stride );
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    ComposeTransformsSse( data, begin, end, out, stride );
+#else
+    ComposeTransformsScalar( data, begin, end, out, stride );
+#endif
+}
+
+inline const char *ComposeTransformsKernel()
+{
+#if defined( __AVX2__ )
+    return "AVX2";
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+// Batches of batch instances on the workers of jobs, the calling thread helping while it waits.
+inline void ComposeTransformsParallel( JobSystem &jobs, const SceneTransforms &data, std::byte *out, size_t stride, uint32_t batch = 4096 )
+{
+    const uint32_t Padded{ data.PaddedSize() };
+    batch = std::max( batch / SceneTransforms::Width, 1u ) * SceneTransforms::Width;
+    if( Padded <= batch )
+    {
+        ComposeTransforms( data, 0, Padded, out, stride );
+        return;
+    }
+    std::vector<Job> Batches;
+    Batches.reserve( ( Padded + batch - 1 ) / batch );
+    for( uint32_t Begin{ 0 }; Begin < Padded; Begin += batch )
+        Batches.push_back( jobs.Submit( "compose transforms", [ &, Begin ]
+                                        { ComposeTransforms( data, Begin, std::min( Begin + batch, Padded ), out, stride ); } ) );
+    jobs.Wait( Batches );
+}
@@ -0,0 +1,461 @@
+#pragma once
+#include "vulkan.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "UploadQueue.h"
+#include "TextureMips.h"
+#include "BlockCompression.h"
+#include <span>
+#include <chrono>
+#include <format>
+#include <string>
+#include <fstream>
+#include <filesystem>
+
+// Cache files are plain KTX2: identifier, Ktx2Header, Ktx2Index, one Ktx2Level per mip, the
+// data format descriptor, key/value data and the mip levels, smallest first. The source the
+// levels came from is recorded under TextureSourceKey, so any KTX2 tool can open the cache
+// and the loader can still tell when it went stale. Bump TextureCacheVersion whenever the mip
+// or block compression output changes.
+const uint8_t Ktx2Identifier[ 12 ]{ 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+struct Ktx2Header
+{
+    uint32_t VkFormat;
+    uint32_t TypeSize;
+    uint32_t PixelWidth;
+    uint32_t PixelHeight;
+    uint32_t PixelDepth;
+    uint32_t LayerCount;
+    uint32_t FaceCount;
+    uint32_t LevelCount;
+    uint32_t SupercompressionScheme;
+};
+
+struct Ktx2Index
+{
+    uint32_t DfdByteOffset;
+    uint32_t DfdByteLength;
+    uint32_t KvdByteOffset;
+    uint32_t KvdByteLength;
+    uint64_t SgdByteOffset;
+    uint64_t SgdByteLength;
+};
+
+struct Ktx2Level
+{
+    uint64_t ByteOffset;
+    uint64_t ByteLength;
+    uint64_t UncompressedByteLength;
+};
+
+struct TextureSource
+{
+    uint32_t Version;
+    uint32_t Format;
+    uint64_t PathHash;
+    uint64_t Size;
+    int64_t Time;
+    uint64_t Hash;
+};
+
+const char TextureSourceKey[]{ "HelloVulkan.source" };
+const uint32_t TextureCacheVersion{ 1 };
+const uint64_t TextureCacheAlignment{ 16 };
+
+// Basic data format descriptor for the three formats TextureCache writes.
+inline std::vector<uint32_t> Ktx2DataFormatDescriptor( TextureFormat format, bool srgb )
+{
+    const uint32_t Samples{ format == TextureFormat::Rgba8 ? 4u : 1u };
+    const uint32_t BlockSize{ 24 + 16 * Samples };
+    std::vector<uint32_t> Words{ 4 + BlockSize, 0, 2 | BlockSize << 16 };
+    // KHR_DF_MODEL_RGBSDA, BC1A or BC7; BT.709 primaries; sRGB or linear transfer.
+    uint32_t Model{ format == TextureFormat::Bc1 ? 128u : format == TextureFormat::Bc7 ? 135u : 1u };
+    Words.push_back( Model | 1 << 8 | ( srgb ? 2u : 1u ) << 16 );
+    uint32_t Side{ TextureBlockSide( format ) - 1 };
+    Words.push_back( Side | Side << 8 );
+    Words.push_back( TextureBlockBytes( format ) );
+    Words.push_back( 0 );
+    if( format == TextureFormat::Rgba8 )
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+        {
+            // Alpha is channel 15 and stays linear in an sRGB texture.
+            uint32_t Id{ Channel == 3 ? 15u | ( srgb ? 0x10u : 0u ) : Channel };
+            Words.insert( Words.end(), { Channel * 8 | 7 << 16 | Id << 24, 0, 0, 255 } );
+        }
+    else
+        Words.insert( Words.end(), { ( TextureBlockBytes( format ) * 8 - 1 ) << 16, 0, 0, ~0u } );
+    return Words;
+}
+
+// Source pixels with their mip chain, before block compression.
+struct DecodedTexture
+{
+    std::vector<TextureLevel> Levels;
+    TextureSource Source{};
+    bool Srgb{ true };
+    double DecodeMs{ 0.0 };
+};
+
+// Texture ready for upload, backed either by a mapped KTX2 file or by freshly encoded data.
+class CachedTexture
+{
+  public:
+    VkFormat Format() const
+    {
+        return LevelsFormat;
+    }
+    uint32_t Width() const
+    {
+        return Regions().front().Extent.width;
+    }
+    uint32_t Height() const
+    {
+        return Regions().front().Extent.height;
+    }
+    // One region per mip level, level 0 first; offsets are relative to Data().
+    std::span<const ImageUploadRegion> Regions() const
+    {
+        return LevelsRegions;
+    }
+    const uint8_t *Data() const
+    {
+        if( Packed ) return Packed;
+        return !File.Empty() ? File.Data() : Encoded.data();
+    }
+    bool Mapped() const
+    {
+        return !File.Empty() || Packed;
+    }
+
+  private:
+    friend class TextureCache;
+    MappedFile File;
+    const uint8_t *Packed{ nullptr }; // in an AssetPack, which outlives the texture
+    std::vector<uint8_t> Encoded;
+    VkFormat LevelsFormat{ VK_FORMAT_UNDEFINED };
+    std::vector<ImageUploadRegion> LevelsRegions;
+};
+
+// Given a pack, a texture packed under PackPath() is used from it as is, like MeshCache does.
+class TextureCache
+{
+  public:
+    TextureCache( const char *directory, LoggerCallbacks loggers, const AssetPack *pack = nullptr ) : Directory{ directory }, Loggers{ loggers }, Assets{ pack }
+    {
+    }
+
+    // srgb marks colour data; it is filtered in linear light and sampled through an sRGB format.
+    CachedTexture Load( const char *path, TextureFormat format, bool srgb = true )
+    {
+        CachedTexture Texture;
+        if( Find( path, format, srgb, Texture ) ) return Texture;
+        return Encode( path, Decode( path, srgb ), format );
+    }
+
+    // Load split in stages, so decoding can start before the device tells which format to use.
+    bool Find( const char *path, TextureFormat format, bool srgb, CachedTexture &texture )
+    {
+        PROFILE_ZONE( "find texture" );
+        auto Start{ std::chrono::steady_clock::now() };
+        if( FindPacked( path, TextureVkFormat( format, srgb ), texture ) )
+        {
+            Loggers.info( std::format( "Texture {}: packed load in {:.3f} ms.", path, ElapsedMs( Start ) ).c_str() );
+            return true;
+        }
+        if( !TryMap( path, CacheFile( path, format, srgb ), TextureVkFormat( format, srgb ), texture ) ) return false;
+        Loggers.info( std::format( "Texture {}: warm load from cache in {:.3f} ms.", path, ElapsedMs( Start ) ).c_str() );
+        return true;
+    }
+    DecodedTexture Decode( const char *path, bool srgb = true )
+    {
+        PROFILE_ZONE( "decode texture" );
+        auto Start{ std::chrono::steady_clock::now() };
+        DecodedTexture Result;
+        MappedFile Source{ path };
+        int Width, Height, Channels;
+        stbi_uc *Pixels{ stbi_load_from_memory( Source.Data(), static_cast<int>( Source.Size() ), &Width, &Height, &Channels, STBI_rgb_alpha ) };
+        if( !Pixels ) throw std::runtime_error( std::format( "Failed to load texture {}.", path ) );
+        TextureLevel Base{ static_cast<uint32_t>( Width ), static_cast<uint32_t>( Height ), { Pixels, Pixels + size_t( Width ) * Height * 4 } };
+        stbi_image_free( Pixels );
+        Result.Source = MakeSource( path, Source );
+        Source.Close();
+        Result.DecodeMs = ElapsedMs( Start );
+
+        auto MipsStart{ std::chrono::steady_clock::now() };
+        Result.Levels = GenerateMips( Base, srgb );
+        Result.Srgb   = srgb;
+        Loggers.info( std::format( "Texture {}: {}x{} decoded in {:.3f} ms, {} levels, {} mips in {:.3f} ms.", path, Width, Height, Result.DecodeMs, Result.Levels.size(), MipKernel(), ElapsedMs( MipsStart ) ).c_str() );
+        return Result;
+    }
+    // Compresses decoded, writes the cache file and maps it back.
+    CachedTexture Encode( const char *path, const DecodedTexture &decoded, TextureFormat format, uint32_t threads = std::thread::hardware_concurrency() )
+    {
+        PROFILE_ZONE( "encode texture" );
+        auto Start{ std::chrono::steady_clock::now() };
+        const auto &Levels{ decoded.Levels };
+        std::vector<std::vector<uint8_t>> Compressed;
+        Compressed.reserve( Levels.size() );
+        size_t Bytes{ 0 }, Texels{ 0 };
+        for( const auto &Level : Levels )
+        {
+            Compressed.push_back( CompressLevel( Level, format, threads ) );
+            Bytes += Compressed.back().size();
+            Texels += size_t( Level.Width ) * Level.Height;
+        }
+        double CompressMs{ ElapsedMs( Start ) };
+        Loggers.info( std::format( "Texture {}: {} in {:.3f} ms ({:.1f} MPix/s), {:.2f} MB.", path, TextureFormatName( format ), CompressMs, Texels / CompressMs / 1000.0, Bytes / double( 1 << 20 ) ).c_str() );
+
+        CachedTexture Texture;
+        TextureSource Source{ decoded.Source };
+        Source.Format = static_cast<uint32_t>( format );
+        std::filesystem::path CachePath{ CacheFile( path, format, decoded.Srgb ) };
+        if( !Write( CachePath, Source, format, decoded.Srgb, Levels, Compressed ) || !TryMap( path, CachePath, TextureVkFormat( format, decoded.Srgb ), Texture ) )
+            Texture = Pack( Levels, Compressed, format, decoded.Srgb );
+        Loggers.info( std::format( "Texture {}: cold load in {:.3f} ms (decode {:.3f} ms).", path, decoded.DecodeMs + ElapsedMs( Start ), decoded.DecodeMs ).c_str() );
+        return Texture;
+    }
+
+    // In memory only, for generated textures that have no source file to cache against.
+    static CachedTexture Compress( const std::vector<TextureLevel> &levels, TextureFormat format, bool srgb, uint32_t threads = std::thread::hardware_concurrency() )
+    {
+        std::vector<std::vector<uint8_t>> Compressed;
+        Compressed.reserve( levels.size() );
+        for( const auto &Level : levels ) Compressed.push_back( CompressLevel( Level, format, threads ) );
+        return Pack( levels, Compressed, format, srgb );
+    }
+
+    std::filesystem::path CacheFile( const char *path, TextureFormat format, bool srgb ) const
+    {
+        return Directory / std::format( "{:016x}-{}.ktx2", Hash64( path, strlen( path ) ), static_cast<uint32_t>( TextureVkFormat( format, srgb ) ) );
+    }
+
+    // A cache file packed under this path holds the source at path in format.
+    static std::string PackPath( const char *path, VkFormat format )
+    {
+        return std::format( "{}.{}.ktx2", path, static_cast<uint32_t>( format ) );
+    }
+
+  private:
+    std::filesystem::path Directory;
+    LoggerCallbacks Loggers;
+    const AssetPack *Assets;
+
+    static CachedTexture Pack( const std::vector<TextureLevel> &levels, const std::vector<std::vector<uint8_t>> &compressed, TextureFormat format, bool srgb )
+    {
+        CachedTexture Texture;
+        Texture.LevelsFormat = TextureVkFormat( format, srgb );
+        for( size_t Level{ 0 }; Level < levels.size(); Level++ )
+        {
+            Texture.LevelsRegions.push_back( { Texture.Encoded.size(), compressed[ Level ].size(), static_cast<uint32_t>( Level ), { levels[ Level ].Width, levels[ Level ].Height, 1 } } );
+            Texture.Encoded.insert( Texture.Encoded.end(), compressed[ Level ].begin(), compressed[ Level ].end() );
+        }
+        return Texture;
+    }
+
+    static uint64_t AlignUp( uint64_t value )
+    {
+        return ( value + TextureCacheAlignment - 1 ) & ~( TextureCacheAlignment - 1 );
+    }
+
+    static double ElapsedMs( std::chrono::steady_clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    }
+
+    static int64_t SourceTime( const char *path )
+    {
+        std::error_code Error;
+        return std::filesystem::last_write_time( path, Error ).time_since_epoch().count();
+    }
+
+    // Format is filled in by Encode.
+    static TextureSource MakeSource( const char *path, const MappedFile &source )
+    {
+        return { TextureCacheVersion, 0, Hash64( path, strlen( path ) ), source.Size(), SourceTime( path ), Hash64( source.Data(), source.Size() ) };
+    }
+
+    // Offset of TextureSourceKey's value within the file, or 0.
+    static uint64_t FindSource( std::span<const uint8_t> file, const Ktx2Index &index )
+    {
+        uint64_t Offset{ index.KvdByteOffset }, End{ uint64_t( index.KvdByteOffset ) + index.KvdByteLength };
+        while( Offset + 4 <= End )
+        {
+            uint32_t Length;
+            memcpy( &Length, file.data() + Offset, 4 );
+            if( Offset + 4 + Length > End ) return 0;
+            if( Length == sizeof( TextureSourceKey ) + sizeof( TextureSource ) && !memcmp( file.data() + Offset + 4, TextureSourceKey, sizeof( TextureSourceKey ) ) )
+                return Offset + 4 + sizeof( TextureSourceKey );
+            Offset += 4 + ( ( Length + 3 ) & ~3u );
+        }
+        return 0;
+    }
+
+    // Maps the KTX2 file and checks it holds format and still belongs to the source. An mtime
+    // change alone is tolerated when the content hash still matches; the stored mtime is
+    // refreshed then.
+    bool TryMap( const char *path, const std::filesystem::path &cachePath, VkFormat format, CachedTexture &texture )
+    {
+        std::error_code Error;
+        if( !std::filesystem::exists( cachePath, Error ) ) return false;
+        MappedFile File;
+        try
+        {
+            File.Open( cachePath.string().c_str() );
+        }
+        catch( const std::exception & )
+        {
+            return false;
+        }
+        TextureSource Source;
+        uint64_t SourceOffset;
+        std::vector<ImageUploadRegion> Regions;
+        if( !Parse( { File.Data(), File.Size() }, path, format, Source, SourceOffset, Regions ) ) return false;
+
+        uint64_t Size{ std::filesystem::file_size( path, Error ) };
+        if( Error || Size != Source.Size ) return false;
+        int64_t Time{ SourceTime( path ) };
+        if( Time != Source.Time )
+        {
+            MappedFile Original{ path };
+            if( Hash64( Original.Data(), Original.Size() ) != Source.Hash ) return false;
+            Source.Time = Time;
+            File.Close();
+            {
+                std::fstream Patch{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+                Patch.seekp( SourceOffset );
+                Patch.write( reinterpret_cast<const char *>( &Source ), sizeof( Source ) );
+                if( !Patch ) Loggers.warn( std::format( "Failed to refresh the source time in texture cache {}.", cachePath.string() ).c_str() );
+            }
+            // Size and hash matched, so the cache is used whether or not the time was stored.
+            try
+            {
+                File.Open( cachePath.string().c_str() );
+            }
+            catch( const std::exception & )
+            {
+                return false;
+            }
+            if( !Parse( { File.Data(), File.Size() }, path, format, Source, SourceOffset, Regions ) ) return false;
+        }
+
+        texture.LevelsFormat  = format;
+        texture.LevelsRegions = std::move( Regions );
+        texture.File          = std::move( File );
+        return true;
+    }
+
+    bool FindPacked( const char *path, VkFormat format, CachedTexture &texture ) const
+    {
+        const AssetPackEntry *Entry{ Assets ? Assets->Find( PackPath( path, format ) ) : nullptr };
+        TextureSource Source;
+        uint64_t SourceOffset;
+        std::vector<ImageUploadRegion> Regions;
+        if( !Entry || Entry->Compression != AssetCompression::None || !Parse( Assets->View( *Entry ), path, format, Source, SourceOffset, Regions ) ) return false;
+        texture.LevelsFormat  = format;
+        texture.LevelsRegions = std::move( Regions );
+        texture.Packed        = Assets->View( *Entry ).data();
+        return true;
+    }
+
+    // Checks file is a KTX2 cache of path in format and reads its source and level regions.
+    static bool Parse( std::span<const uint8_t> file, const char *path, VkFormat format, TextureSource &source, uint64_t &sourceOffset, std::vector<ImageUploadRegion> &regions )
+    {
+        regions.clear();
+        const uint64_t Prefix{ sizeof( Ktx2Identifier ) + sizeof( Ktx2Header ) + sizeof( Ktx2Index ) };
+        if( file.size() < Prefix || memcmp( file.data(), Ktx2Identifier, sizeof( Ktx2Identifier ) ) ) return false;
+        Ktx2Header Header;
+        Ktx2Index Index;
+        memcpy( &Header, file.data() + sizeof( Ktx2Identifier ), sizeof( Header ) );
+        memcpy( &Index, file.data() + sizeof( Ktx2Identifier ) + sizeof( Header ), sizeof( Index ) );
+        if( Header.VkFormat != static_cast<uint32_t>( format ) || Header.PixelDepth || Header.LayerCount || Header.FaceCount != 1 || Header.SupercompressionScheme ||
+            !Header.LevelCount || Header.LevelCount > MipLevelsCount( Header.PixelWidth, Header.PixelHeight ) ||
+            Prefix + Header.LevelCount * sizeof( Ktx2Level ) > file.size() || uint64_t( Index.KvdByteOffset ) + Index.KvdByteLength > file.size() )
+            return false;
+
+        sourceOffset = FindSource( file, Index );
+        if( !sourceOffset ) return false;
+        memcpy( &source, file.data() + sourceOffset, sizeof( source ) );
+        if( source.Version != TextureCacheVersion || source.PathHash != Hash64( path, strlen( path ) ) || source.Format > static_cast<uint32_t>( TextureFormat::Bc7 ) ) return false;
+        const TextureFormat SourceFormat{ static_cast<TextureFormat>( source.Format ) };
+        if( TextureVkFormat( SourceFormat, true ) != format && TextureVkFormat( SourceFormat, false ) != format ) return false;
+
+        for( uint32_t Level{ 0 }; Level < Header.LevelCount; Level++ )
+        {
+            Ktx2Level Entry;
+            memcpy( &Entry, file.data() + Prefix + Level * sizeof( Ktx2Level ), sizeof( Entry ) );
+            VkExtent3D Extent{ std::max( 1u, Header.PixelWidth >> Level ), std::max( 1u, Header.PixelHeight >> Level ), 1 };
+            if( Entry.ByteLength > file.size() || Entry.ByteOffset > file.size() - Entry.ByteLength || Entry.ByteLength != TextureLevelBytes( SourceFormat, Extent.width, Extent.height ) ) return false;
+            regions.push_back( { Entry.ByteOffset, Entry.ByteLength, Level, Extent } );
+        }
+        return true;
+    }
+
+    // Written to a temporary file first so a crash never leaves a truncated cache behind.
+    bool Write( const std::filesystem::path &cachePath, const TextureSource &source, TextureFormat format, bool srgb, const std::vector<TextureLevel> &levels, const std::vector<std::vector<uint8_t>> &compressed )
+    {
+        const uint32_t LevelCount{ static_cast<uint32_t>( levels.size() ) };
+        std::vector<uint32_t> Dfd{ Ktx2DataFormatDescriptor( format, srgb ) };
+        // One key/value pair: its length, the NUL terminated key, the value, padding to 4 bytes.
+        const uint32_t Length{ static_cast<uint32_t>( sizeof( TextureSourceKey ) + sizeof( TextureSource ) ) };
+        const uint32_t KvdLength{ ( 4 + Length + 3 ) & ~3u };
+
+        Ktx2Header Header{ static_cast<uint32_t>( TextureVkFormat( format, srgb ) ), 1, levels[ 0 ].Width, levels[ 0 ].Height, 0, 0, 1, LevelCount, 0 };
+        Ktx2Index Index{};
+        Index.DfdByteOffset = static_cast<uint32_t>( sizeof( Ktx2Identifier ) + sizeof( Header ) + sizeof( Index ) + LevelCount * sizeof( Ktx2Level ) );
+        Index.DfdByteLength = static_cast<uint32_t>( Dfd.size() * 4 );
+        Index.KvdByteOffset = Index.DfdByteOffset + Index.DfdByteLength;
+        Index.KvdByteLength = KvdLength;
+        std::vector<Ktx2Level> Levels( LevelCount );
+        uint64_t Offset{ Index.KvdByteOffset + KvdLength };
+        for( uint32_t Level{ LevelCount }; Level-- > 0; )
+        {
+            Offset          = AlignUp( Offset );
+            Levels[ Level ] = { Offset, compressed[ Level ].size(), compressed[ Level ].size() };
+            Offset += compressed[ Level ].size();
+        }
+
+        // Created here rather than up front, so a run served by the pack or the cache as it is
+        // creates nothing.
+        std::error_code Error;
+        std::filesystem::create_directories( Directory, Error );
+        if( Error )
+        {
+            Loggers.warn( std::format( "Texture cache directory {} unavailable: {}.", Directory.string(), Error.message() ).c_str() );
+            return false;
+        }
+        std::filesystem::path Temporary{ cachePath };
+        Temporary += ".tmp";
+        {
+            std::ofstream Out{ Temporary, std::ios::binary | std::ios::trunc };
+            if( !Out ) return false;
+            const char Padding[ TextureCacheAlignment ]{};
+            Out.write( reinterpret_cast<const char *>( Ktx2Identifier ), sizeof( Ktx2Identifier ) );
+            Out.write( reinterpret_cast<const char *>( &Header ), sizeof( Header ) );
+            Out.write( reinterpret_cast<const char *>( &Index ), sizeof( Index ) );
+            Out.write( reinterpret_cast<const char *>( Levels.data() ), Levels.size() * sizeof( Ktx2Level ) );
+            Out.write( reinterpret_cast<const char *>( Dfd.data() ), Dfd.size() * 4 );
+            Out.write( reinterpret_cast<const char *>( &Length ), 4 );
+            Out.write( TextureSourceKey, sizeof( TextureSourceKey ) );
+            Out.write( reinterpret_cast<const char *>( &source ), sizeof( source ) );
+            Out.write( Padding, KvdLength - 4 - Length );
+            uint64_t Written{ Index.KvdByteOffset + KvdLength };
+            for( uint32_t Level{ LevelCount }; Level-- > 0; )
+            {
+                Out.write( Padding, Levels[ Level ].ByteOffset - Written );
+                Out.write( reinterpret_cast<const char *>( compressed[ Level ].data() ), compressed[ Level ].size() );
+                Written = Levels[ Level ].ByteOffset + compressed[ Level ].size();
+            }
+            if( !Out ) return false;
+        }
+        std::filesystem::rename( Temporary, cachePath, Error );
+        if( Error )
+        {
+            Loggers.warn( std::format( "Failed to write texture cache {}: {}.", cachePath.string(), Error.message() ).c_str() );
+            std::filesystem::remove( Temporary, Error );
+            return false;
+        }
+        return true;
+    }
+};
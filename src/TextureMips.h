@@ -0,0 +1,199 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#    include <immintrin.h>
+#endif
+
+// Tightly packed RGBA8 pixels, row by row.
+struct TextureLevel
+{
+    uint32_t Width{ 0 };
+    uint32_t Height{ 0 };
+    std::vector<uint8_t> Pixels;
+};
+
+inline uint32_t MipLevelsCount( uint32_t width, uint32_t height )
+{
+    uint32_t Levels{ 1 };
+    while( width > 1 || height > 1 )
+    {
+        width  = std::max( 1u, width / 2 );
+        height = std::max( 1u, height / 2 );
+        Levels++;
+    }
+    return Levels;
+}
+
+inline const std::array<float, 256> &SrgbToLinearTable()
+{
+    static const std::array<float, 256> Table{ []
+                                               {
+                                                   std::array<float, 256> Result;
+                                                   for( uint32_t i{ 0 }; i < 256; i++ )
+                                                   {
+                                                       float Value{ i / 255.f };
+                                                       Result[ i ] = Value <= 0.04045f ? Value / 12.92f : std::pow( ( Value + 0.055f ) / 1.055f, 2.4f );
+                                                   }
+                                                   return Result;
+                                               }() };
+    return Table;
+}
+
+// Indexed by linear * 4095; 12 bits keep every sRGB code reachable in the dark end.
+inline const std::array<uint8_t, 4096> &LinearToSrgbTable()
+{
+    static const std::array<uint8_t, 4096> Table{ []
+                                                  {
+                                                      std::array<uint8_t, 4096> Result;
+                                                      for( uint32_t i{ 0 }; i < 4096; i++ )
+                                                      {
+                                                          float Value{ i / 4095.f };
+                                                          Value       = Value <= 0.0031308f ? Value * 12.92f : 1.055f * std::pow( Value, 1.f / 2.4f ) - 0.055f;
+                                                          Result[ i ] = static_cast<uint8_t>( std::clamp( Value * 255.f + 0.5f, 0.f, 255.f ) );
+                                                      }
+                                                      return Result;
+                                                  }() };
+    return Table;
+}
+
+inline void MipToLinear( const TextureLevel &level, bool srgb, float *out )
+{
+    const auto &Table{ SrgbToLinearTable() };
+    const size_t Count{ size_t( level.Width ) * level.Height * 4 };
+    for( size_t i{ 0 }; i < Count; i++ ) out[ i ] = srgb && ( i & 3 ) != 3 ? Table[ level.Pixels[ i ] ] : level.Pixels[ i ] / 255.f;
+}
+
+inline TextureLevel MipFromLinear( const float *pixels, uint32_t width, uint32_t height, bool srgb )
+{
+    const auto &Table{ LinearToSrgbTable() };
+    TextureLevel Level{ width, height, std::vector<uint8_t>( size_t( width ) * height * 4 ) };
+#if defined( __SSE2__ ) || defined( _M_X64 )
+    const __m128 Scale{ srgb ? _mm_setr_ps( 4095.f, 4095.f, 4095.f, 255.f ) : _mm_set1_ps( 255.f ) };
+    const __m128 Half{ _mm_set1_ps( 0.5f ) }, Zero{ _mm_setzero_ps() };
+    alignas( 16 ) int32_t Codes[ 4 ];
+    for( size_t Pixel{ 0 }; Pixel < size_t( width ) * height; Pixel++ )
+    {
+        __m128 Value{ _mm_min_ps( _mm_max_ps( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( pixels + Pixel * 4 ), Scale ), Half ), Zero ), Scale ) };
+        _mm_store_si128( reinterpret_cast<__m128i *>( Codes ), _mm_cvttps_epi32( Value ) );
+        uint8_t *Out{ Level.Pixels.data() + Pixel * 4 };
+        for( uint32_t Channel{ 0 }; Channel < 3; Channel++ ) Out[ Channel ] = srgb ? Table[ Codes[ Channel ] ] : static_cast<uint8_t>( Codes[ Channel ] );
+        Out[ 3 ] = static_cast<uint8_t>( Codes[ 3 ] );
+    }
+#else
+    const float Scale{ srgb ? 4095.f : 255.f };
+    for( size_t Pixel{ 0 }; Pixel < size_t( width ) * height; Pixel++ )
+    {
+        const float *In{ pixels + Pixel * 4 };
+        uint8_t *Out{ Level.Pixels.data() + Pixel * 4 };
+        for( uint32_t Channel{ 0 }; Channel < 3; Channel++ )
+        {
+            int32_t Code{ static_cast<int32_t>( std::clamp( In[ Channel ] * Scale + 0.5f, 0.f, Scale ) ) };
+            Out[ Channel ] = srgb ? Table[ Code ] : static_cast<uint8_t>( Code );
+        }
+        Out[ 3 ] = static_cast<uint8_t>( std::clamp( In[ 3 ] * 255.f + 0.5f, 0.f, 255.f ) );
+    }
+#endif
+    return Level;
+}
+
+// One output row of a 2x2 box filter over linear RGBA floats. A single-texel wide or tall
+// source repeats its edge instead of reading past it.
+#if defined( __SSE2__ ) || defined( _M_X64 )
+inline void MipDownsampleRowSse( const float *row0, const float *row1, uint32_t width, float *out, uint32_t begin, uint32_t end )
+{
+    const __m128 Quarter{ _mm_set1_ps( 0.25f ) };
+    const uint32_t Step{ width > 1 ? 4u : 0u };
+    for( uint32_t x{ begin }; x < end; x++ )
+    {
+        const float *Top{ row0 + x * 8 }, *Bottom{ row1 + x * 8 };
+        __m128 Sum{ _mm_add_ps( _mm_add_ps( _mm_loadu_ps( Top ), _mm_loadu_ps( Top + Step ) ), _mm_add_ps( _mm_loadu_ps( Bottom ), _mm_loadu_ps( Bottom + Step ) ) ) };
+        _mm_storeu_ps( out + x * 4, _mm_mul_ps( Sum, Quarter ) );
+    }
+}
+#else
+inline void MipDownsampleRowScalar( const float *row0, const float *row1, uint32_t width, float *out, uint32_t begin, uint32_t end )
+{
+    const uint32_t Step{ width > 1 ? 4u : 0u };
+    for( uint32_t x{ begin }; x < end; x++ )
+    {
+        const float *Top{ row0 + x * 8 }, *Bottom{ row1 + x * 8 };
+        for( uint32_t Channel{ 0 }; Channel < 4; Channel++ )
+            out[ x * 4 + Channel ] = ( Top[ Channel ] + Top[ Step + Channel ] + Bottom[ Channel ] + Bottom[ Step + Channel ] ) * 0.25f;
+    }
+}
+#endif
+
+#if defined( __AVX2__ )
+// Two output texels per iteration: the four source texels of each row are split into the
+// even and odd halves with a lane permute and summed.
+inline void MipDownsampleRowAvx2( const float *row0, const float *row1, uint32_t width, float *out, uint32_t outWidth )
+{
+    if( width < 2 ) return MipDownsampleRowSse( row0, row1, width, out, 0, outWidth );
+    const __m256 Quarter{ _mm256_set1_ps( 0.25f ) };
+    uint32_t x{ 0 };
+    for( ; x + 2 <= outWidth; x += 2 )
+    {
+        __m256 Top{ _mm256_add_ps( _mm256_loadu_ps( row0 + x * 8 ), _mm256_loadu_ps( row1 + x * 8 ) ) };
+        __m256 Bottom{ _mm256_add_ps( _mm256_loadu_ps( row0 + x * 8 + 8 ), _mm256_loadu_ps( row1 + x * 8 + 8 ) ) };
+        __m256 Sum{ _mm256_add_ps( _mm256_permute2f128_ps( Top, Bottom, 0x20 ), _mm256_permute2f128_ps( Top, Bottom, 0x31 ) ) };
+        _mm256_storeu_ps( out + x * 4, _mm256_mul_ps( Sum, Quarter ) );
+    }
+    MipDownsampleRowSse( row0, row1, width, out, x, outWidth );
+}
+#endif
+
+inline const char *MipKernel()
+{
+#if defined( __AVX2__ )
+    return "AVX2";
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+inline void MipDownsample( const float *pixels, uint32_t width, uint32_t height, float *out )
+{
+    const uint32_t OutWidth{ std::max( 1u, width / 2 ) }, OutHeight{ std::max( 1u, height / 2 ) };
+    for( uint32_t y{ 0 }; y < OutHeight; y++ )
+    {
+        const float *Row0{ pixels + size_t( std::min( y * 2, height - 1 ) ) * width * 4 };
+        const float *Row1{ pixels + size_t( std::min( y * 2 + 1, height - 1 ) ) * width * 4 };
+#if defined( __AVX2__ )
+        MipDownsampleRowAvx2( Row0, Row1, width, out + size_t( y ) * OutWidth * 4, OutWidth );
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+        MipDownsampleRowSse( Row0, Row1, width, out + size_t( y ) * OutWidth * 4, 0, OutWidth );
+#else
+        MipDownsampleRowScalar( Row0, Row1, width, out + size_t( y ) * OutWidth * 4, 0, OutWidth );
+#endif
+    }
+}
+
+// Full chain down to 1x1, level 0 included. With srgb the colour channels are filtered in
+// linear light, so dark and bright texels average to what the eye sees; alpha is always
+// filtered as is. Odd sizes round down, dropping the last row or column.
+inline std::vector<TextureLevel> GenerateMips( const TextureLevel &base, bool srgb = true )
+{
+    std::vector<TextureLevel> Levels;
+    Levels.reserve( MipLevelsCount( base.Width, base.Height ) );
+    Levels.push_back( base );
+    uint32_t Width{ base.Width }, Height{ base.Height };
+    std::vector<float> Linear( size_t( Width ) * Height * 4 ), Next;
+    MipToLinear( base, srgb, Linear.data() );
+    while( Width > 1 || Height > 1 )
+    {
+        uint32_t NextWidth{ std::max( 1u, Width / 2 ) }, NextHeight{ std::max( 1u, Height / 2 ) };
+        Next.resize( size_t( NextWidth ) * NextHeight * 4 );
+        MipDownsample( Linear.data(), Width, Height, Next.data() );
+        Levels.push_back( MipFromLinear( Next.data(), NextWidth, NextHeight, srgb ) );
+        std::swap( Linear, Next );
+        Width  = NextWidth;
+        Height = NextHeight;
+    }
+    return Levels;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <mutex>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "LoggerCallbacks.h"
+
+// One span of work on a lane; lane 0 is the thread that owns the timeline, worker n is lane n.
+struct TimelineSpan
+{
+    std::string Name;
+    uint32_t Lane;
+    double Begin; // ms since the timeline started
+    double End;
+};
+
+// Collects spans from any thread so a sequence of overlapping work, such as startup, can be
+// read back as a chart.
+class Timeline
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Records the span from construction to destruction.
+    class Scope
+    {
+      public:
+        Scope( Timeline &timeline, std::string name, uint32_t lane = 0 ) : Owner{ timeline }, Name{ std::move( name ) }, Lane{ lane }, Begin{ Clock::now() }
+        {
+        }
+        Scope( const Scope & )            = delete;
+        Scope &operator=( const Scope & ) = delete;
+        ~Scope()
+        {
+            Owner.Record( std::move( Name ), Lane, Begin, Clock::now() );
+        }
+
+      private:
+        Timeline &Owner;
+        std::string Name;
+        uint32_t Lane;
+        Clock::time_point Begin;
+    };
+
+    Timeline() : Start{ Clock::now() }
+    {
+    }
+
+    void Record( std::string name, uint32_t lane, Clock::time_point begin, Clock::time_point end )
+    {
+        std::lock_guard Lock{ SpansLock };
+        Spans.push_back( { std::move( name ), lane, Milliseconds( begin ), Milliseconds( end ) } );
+    }
+
+    double Elapsed() const
+    {
+        return Milliseconds( Clock::now() );
+    }
+
+    std::vector<TimelineSpan> Sorted() const
+    {
+        std::lock_guard Lock{ SpansLock };
+        std::vector<TimelineSpan> Result{ Spans };
+        std::sort( Result.begin(), Result.end(), []( const TimelineSpan &a, const TimelineSpan &b )
+                   { return a.Begin < b.Begin; } );
+        return Result;
+    }
+
+    // One line per span, with a bar placed on a shared time axis so overlap is visible at a glance.
+    void Log( const LoggerCallbacks &loggers, const char *title ) const
+    {
+        const uint32_t Columns{ 48 };
+        std::vector<TimelineSpan> Result{ Sorted() };
+        double Total{ 0.0 };
+        for( const auto &Span : Result ) Total = std::max( Total, Span.End );
+        loggers.info( std::format( "{}: {:.3f} ms, {} spans.", title, Total, Result.size() ).c_str() );
+        for( const auto &Span : Result )
+        {
+            std::string Bar( Columns, ' ' );
+            uint32_t First{ Total > 0.0 ? static_cast<uint32_t>( Span.Begin / Total * Columns ) : 0 };
+            uint32_t Last{ Total > 0.0 ? static_cast<uint32_t>( Span.End / Total * Columns ) : 0 };
+            for( uint32_t Column{ std::min( First, Columns - 1 ) }; Column <= std::min( Last, Columns - 1 ); Column++ ) Bar[ Column ] = '#';
+            loggers.info( std::format( "  |{}| {:>2} {:9.3f} {:9.3f} ms  {}", Bar, Span.Lane, Span.Begin, Span.End, Span.Name ).c_str() );
+        }
+    }
+
+  private:
+    Clock::time_point Start;
+    mutable std::mutex SpansLock;
+    std::vector<TimelineSpan> Spans;
+
+    double Milliseconds( Clock::time_point point ) const
+    {
+        return std::chrono::duration<double, std::milli>( point - Start ).count();
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include "DeviceMemory.h"
+#include <format>
+#include <stdexcept>
+
+// A persistently mapped, host coherent uniform buffer cut into one region per frame in flight.
+// Allocations bump a head through the current frame's region and are reached by dynamic
+// offsets, so descriptors point at the buffer once and never at what is in it. A region is
+// only reused by Begin for the same frame, once the submission that last read it completed.
+// Extra usage lets other per-frame data, such as instance attributes, share the ring.
+
+struct UniformRingStatistics
+{
+    VkDeviceSize Bytes{ 0 }; // allocated since the last Begin
+    uint32_t Allocations{ 0 };
+    uint32_t Grows{ 0 };     // buffer replaced, every descriptor pointing at it must be written again
+};
+
+class UniformRing
+{
+  public:
+    UniformRing( VkDevice device, DeviceMemoryAllocator &memory, VkDeviceSize alignment, VkDeviceSize size, uint32_t frames, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT )
+        : Device{ device }, Memory{ memory }, Alignment{ std::max<VkDeviceSize>( alignment, 1 ) }, Frames{ std::max( frames, 1u ) }, Usage{ usage | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT }
+    {
+        Create( size );
+    }
+    UniformRing( const UniformRing & )            = delete;
+    UniformRing &operator=( const UniformRing & ) = delete;
+
+    ~UniformRing()
+    {
+        if( Buffer ) Memory.DestroyBuffer( Buffer, Allocation );
+    }
+
+    VkBuffer Handle() const
+    {
+        return Buffer;
+    }
+
+    // Bytes per frame.
+    VkDeviceSize Size() const
+    {
+        return Region;
+    }
+
+    VkDeviceSize Align( VkDeviceSize size ) const
+    {
+        return ( size + Alignment - 1 ) / Alignment * Alignment;
+    }
+
+    UniformRingStatistics Stat() const
+    {
+        return Statistics;
+    }
+
+    // The submission that last used frame must have completed.
+    void Begin( uint32_t frame )
+    {
+        Frame                  = std::min( frame, Frames - 1 );
+        Head                   = 0;
+        Statistics.Bytes       = 0;
+        Statistics.Allocations = 0;
+    }
+
+    // Grows every region to at least size, before the frame's first Allocate. Returns true when
+    // the buffer was replaced, which waits for the frames in flight still reading the old one.
+    bool Reserve( VkDeviceSize size )
+    {
+        if( size <= Region ) return false;
+        vkDeviceWaitIdle( Device );
+        Memory.DestroyBuffer( Buffer, Allocation );
+        Buffer = VK_NULL_HANDLE;
+        Create( std::max( size, Region * 2 ) );
+        Head = 0;
+        Statistics.Grows++;
+        return true;
+    }
+
+    // Offset from the start of the buffer, aligned for a dynamic uniform offset.
+    VkDeviceSize Allocate( VkDeviceSize size )
+    {
+        VkDeviceSize Aligned{ Align( size ) };
+        if( Head + Aligned > Region ) throw std::runtime_error( std::format( "Uniform ring overflow: {} of {} bytes in use, {} more asked.", Head, Region, size ) );
+        VkDeviceSize Offset{ Frame * Region + Head };
+        Head += Aligned;
+        Statistics.Bytes += Aligned;
+        Statistics.Allocations++;
+        return Offset;
+    }
+
+    uint8_t *Mapped( VkDeviceSize offset ) const
+    {
+        return static_cast<uint8_t *>( Allocation.Mapped ) + offset;
+    }
+
+  private:
+    VkDevice Device;
+    DeviceMemoryAllocator &Memory;
+    VkDeviceSize Alignment;
+    uint32_t Frames;
+    VkBufferUsageFlags Usage;
+    uint32_t Frame{ 0 };
+    VkBuffer Buffer{ VK_NULL_HANDLE };
+    DeviceAllocation Allocation;
+    VkDeviceSize Region{ 0 };
+    VkDeviceSize Head{ 0 };
+    UniformRingStatistics Statistics;
+
+    void Create( VkDeviceSize size )
+    {
+        Region = Align( std::max<VkDeviceSize>( size, 1 ) );
+        Buffer = Memory.CreateBuffer( Region * Frames, Usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, Allocation );
+        if( !Allocation.Mapped ) throw std::runtime_error( "Uniform ring memory is not mapped." );
+    }
+};
@@ -0,0 +1,344 @@
+#pragma once
+#include "DeviceMemory.h"
+#include "Profiler.h"
+#include <span>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <cstring>
+
+// Copies from the CPU into device local buffers and images through a persistently mapped
+// staging ring on the transfer queue. Copies are batched into few submits, each of which
+// signals the next value of a timeline semaphore; a graphics submit that uses the data waits
+// on the value returned for it, so the graphics queue never waits on the CPU side of an upload.
+
+struct UploadStatistics
+{
+    uint64_t Bytes{ 0 };
+    uint32_t Copies{ 0 };
+    uint32_t Submits{ 0 };
+    uint32_t Stalls{ 0 }; // the ring was full and the CPU had to wait for a submit to finish
+};
+
+// One mip level of an image upload; Offset and Size address the data passed to UploadImage.
+struct ImageUploadRegion
+{
+    VkDeviceSize Offset;
+    VkDeviceSize Size;
+    uint32_t MipLevel;
+    VkExtent3D Extent;
+};
+
+class UploadQueue
+{
+  public:
+    UploadQueue( VkDevice device, DeviceMemoryAllocator &memory, VkQueue queue, uint32_t family, uint32_t graphicFamily, VkDeviceSize stagingSize = 32ull << 20, VkDeviceSize batchSize = 4ull << 20 )
+        : Device{ device }, Memory{ memory }, Queue{ queue }, Family{ family }, GraphicFamily{ graphicFamily }, Ring{ stagingSize }, BatchSize{ batchSize }
+    {
+        StagingBuffer = Memory.CreateBuffer( stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, Staging );
+        if( !Staging.Mapped ) throw std::runtime_error( "Staging memory is not mapped." );
+
+        VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+        CommandPoolCreateInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        CommandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        CommandPoolCreateInfo.queueFamilyIndex = Family;
+        VkResult Result{ vkCreateCommandPool( Device, &CommandPoolCreateInfo, nullptr, &CommandPool ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create upload command pool, error: {}", string_VkResult( Result ) ) );
+
+        VkSemaphoreTypeCreateInfo SemaphoreTypeCreateInfo{};
+        SemaphoreTypeCreateInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        SemaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        VkSemaphoreCreateInfo SemaphoreCreateInfo{};
+        SemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        SemaphoreCreateInfo.pNext = &SemaphoreTypeCreateInfo;
+        Result                    = vkCreateSemaphore( Device, &SemaphoreCreateInfo, nullptr, &Timeline );
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to create upload timeline semaphore, error: {}", string_VkResult( Result ) ) );
+    }
+    UploadQueue( const UploadQueue & )            = delete;
+    UploadQueue &operator=( const UploadQueue & ) = delete;
+
+    ~UploadQueue()
+    {
+        Wait( Flush() );
+        vkDestroySemaphore( Device, Timeline, nullptr );
+        vkDestroyCommandPool( Device, CommandPool, nullptr );
+        Memory.DestroyBuffer( StagingBuffer, Staging );
+    }
+
+    // Returns the timeline value after which the data is in place.
+    uint64_t UploadBuffer( VkBuffer buffer, VkDeviceSize offset, const void *data, VkDeviceSize size )
+    {
+        std::lock_guard Lock{ Mutex };
+        if( !size ) return Open ? Submitted + 1 : Submitted;
+        // Chunked so one large upload cannot hold the whole ring.
+        const VkDeviceSize Chunk{ Ring.Size() / 4 };
+        for( VkDeviceSize Done{ 0 }; Done < size; )
+        {
+            VkDeviceSize Size{ std::min( Chunk, size - Done ) };
+            VkBufferCopy Copy{ Stage( static_cast<const char *>( data ) + Done, Size ), offset + Done, Size };
+            vkCmdCopyBuffer( Batch(), StagingBuffer, buffer, 1, &Copy );
+            Statistics.Copies++;
+            Done += Size;
+        }
+        if( Family != GraphicFamily )
+        {
+            VkBufferMemoryBarrier Barrier{};
+            Barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            Barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+            Barrier.srcQueueFamilyIndex = Family;
+            Barrier.dstQueueFamilyIndex = GraphicFamily;
+            Barrier.buffer              = buffer;
+            Barrier.offset              = offset;
+            Barrier.size                = size;
+            vkCmdPipelineBarrier( Batch(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &Barrier, 0, nullptr );
+            Barrier.srcAccessMask = 0;
+            Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            BufferAcquires.push_back( Barrier );
+        }
+        return Finish();
+    }
+
+    // All mip levels of a color image; every region goes through the ring in one piece. The
+    // image ends in finalLayout and, if the queues differ, owned by the graphics family once
+    // Acquire has been recorded.
+    uint64_t UploadImage( VkImage image, uint32_t mipLevels, std::span<const ImageUploadRegion> regions, const void *data, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL )
+    {
+        std::lock_guard Lock{ Mutex };
+        std::vector<VkBufferImageCopy> Copies( regions.size() );
+        VkDeviceSize Size{ 0 };
+        for( size_t Region{ 0 }; Region < regions.size(); Region++ )
+        {
+            Copies[ Region ].bufferOffset                = AlignUp( Size, Alignment );
+            Copies[ Region ].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            Copies[ Region ].imageSubresource.mipLevel   = regions[ Region ].MipLevel;
+            Copies[ Region ].imageSubresource.layerCount = 1;
+            Copies[ Region ].imageExtent                 = regions[ Region ].Extent;
+            Size                                         = Copies[ Region ].bufferOffset + regions[ Region ].Size;
+        }
+        if( Size > Ring.Size() ) throw std::runtime_error( std::format( "Image upload of {} bytes does not fit the {} byte staging ring.", Size, Ring.Size() ) );
+        VkDeviceSize Base{ Stage( nullptr, Size ) };
+        for( size_t Region{ 0 }; Region < regions.size(); Region++ )
+        {
+            memcpy( static_cast<char *>( Staging.Mapped ) + Base + Copies[ Region ].bufferOffset, static_cast<const char *>( data ) + regions[ Region ].Offset, regions[ Region ].Size );
+            Copies[ Region ].bufferOffset += Base;
+        }
+
+        VkImageMemoryBarrier Barrier{};
+        Barrier.sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        Barrier.dstAccessMask               = VK_ACCESS_TRANSFER_WRITE_BIT;
+        Barrier.oldLayout                   = VK_IMAGE_LAYOUT_UNDEFINED;
+        Barrier.newLayout                   = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        Barrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+        Barrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+        Barrier.image                       = image;
+        Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        Barrier.subresourceRange.levelCount = mipLevels;
+        Barrier.subresourceRange.layerCount = 1;
+        VkCommandBuffer CommandBuffer{ Batch() };
+        vkCmdPipelineBarrier( CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier );
+        vkCmdCopyBufferToImage( CommandBuffer, StagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>( Copies.size() ), Copies.data() );
+        Statistics.Copies += static_cast<uint32_t>( Copies.size() );
+
+        // Release; the semaphore wait makes the writes visible, so the destination side is empty.
+        Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        Barrier.dstAccessMask = 0;
+        Barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        Barrier.newLayout     = finalLayout;
+        if( Family != GraphicFamily )
+        {
+            Barrier.srcQueueFamilyIndex = Family;
+            Barrier.dstQueueFamilyIndex = GraphicFamily;
+        }
+        vkCmdPipelineBarrier( CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &Barrier );
+        if( Family != GraphicFamily )
+        {
+            Barrier.srcAccessMask = 0;
+            Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            ImageAcquires.push_back( Barrier );
+        }
+        return Finish();
+    }
+
+    // Submits the open batch. Returns the value that covers every upload made so far.
+    uint64_t Flush()
+    {
+        PROFILE_ZONE( "flush uploads" );
+        std::lock_guard Lock{ Mutex };
+        Submit();
+        return Submitted;
+    }
+
+    // Records the acquire half of pending ownership transfers into a graphics queue command
+    // buffer. The submit of that command buffer must wait on Semaphore() at the returned value.
+    uint64_t Acquire( VkCommandBuffer commandBuffer )
+    {
+        std::lock_guard Lock{ Mutex };
+        Submit();
+        if( !BufferAcquires.empty() || !ImageAcquires.empty() )
+            vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                                  static_cast<uint32_t>( BufferAcquires.size() ), BufferAcquires.data(), static_cast<uint32_t>( ImageAcquires.size() ), ImageAcquires.data() );
+        BufferAcquires.clear();
+        ImageAcquires.clear();
+        return Submitted;
+    }
+
+    bool Complete( uint64_t value ) const
+    {
+        uint64_t Value{ 0 };
+        vkGetSemaphoreCounterValue( Device, Timeline, &Value );
+        return Value >= value;
+    }
+
+    void Wait( uint64_t value ) const
+    {
+        VkSemaphoreWaitInfo SemaphoreWaitInfo{};
+        SemaphoreWaitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        SemaphoreWaitInfo.semaphoreCount = 1;
+        SemaphoreWaitInfo.pSemaphores    = &Timeline;
+        SemaphoreWaitInfo.pValues        = &value;
+        vkWaitSemaphores( Device, &SemaphoreWaitInfo, ~uint64_t{ 0 } );
+    }
+
+    VkSemaphore Semaphore() const
+    {
+        return Timeline;
+    }
+
+    UploadStatistics Stat() const
+    {
+        std::lock_guard Lock{ Mutex };
+        return Statistics;
+    }
+
+  private:
+    // Staging offsets satisfy every texel block size and the 4 byte copy rule.
+    static constexpr VkDeviceSize Alignment{ 16 };
+
+    struct Submission
+    {
+        VkCommandBuffer CommandBuffer;
+        uint64_t Value;
+    };
+
+    VkDevice Device;
+    DeviceMemoryAllocator &Memory;
+    VkQueue Queue;
+    uint32_t Family;
+    uint32_t GraphicFamily;
+    VkBuffer StagingBuffer;
+    DeviceAllocation Staging;
+    RingAllocator Ring; // one ring frame per submit
+    VkDeviceSize BatchSize;
+    VkDeviceSize BatchBytes{ 0 };
+    VkCommandPool CommandPool;
+    VkCommandBuffer Open{ VK_NULL_HANDLE };
+    std::vector<VkCommandBuffer> Idle;
+    std::deque<Submission> InFlight;
+    VkSemaphore Timeline;
+    uint64_t Submitted{ 0 };
+    std::vector<VkBufferMemoryBarrier> BufferAcquires;
+    std::vector<VkImageMemoryBarrier> ImageAcquires;
+    UploadStatistics Statistics;
+    mutable std::mutex Mutex;
+
+    // Reserves ring space, retiring finished submits and waiting on the oldest when full, and
+    // copies data there unless it is null.
+    VkDeviceSize Stage( const void *data, VkDeviceSize size )
+    {
+        VkDeviceSize Offset{ Ring.Allocate( size, Alignment ) };
+        while( Offset == RingAllocator::Invalid )
+        {
+            // Data already in the ring belongs to the open batch, it has to be in flight
+            // before its space can come back.
+            Submit();
+            if( !Retire() )
+            {
+                if( InFlight.empty() ) throw std::runtime_error( std::format( "Upload of {} bytes does not fit the staging ring.", size ) );
+                Wait( InFlight.front().Value );
+                Statistics.Stalls++;
+                Retire();
+            }
+            Offset = Ring.Allocate( size, Alignment );
+        }
+        if( data ) memcpy( static_cast<char *>( Staging.Mapped ) + Offset, data, size );
+        BatchBytes += size;
+        Statistics.Bytes += size;
+        return Offset;
+    }
+
+    VkCommandBuffer Batch()
+    {
+        if( Open ) return Open;
+        Retire();
+        if( Idle.empty() )
+        {
+            VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+            CommandBufferAllocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            CommandBufferAllocateInfo.commandPool        = CommandPool;
+            CommandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            CommandBufferAllocateInfo.commandBufferCount = 1;
+            VkResult Result{ vkAllocateCommandBuffers( Device, &CommandBufferAllocateInfo, &Open ) };
+            if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to allocate upload command buffer, error: {}", string_VkResult( Result ) ) );
+        }
+        else
+        {
+            Open = Idle.back();
+            Idle.pop_back();
+            vkResetCommandBuffer( Open, 0 );
+        }
+        VkCommandBufferBeginInfo CommandBufferBeginInfo{};
+        CommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        CommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer( Open, &CommandBufferBeginInfo );
+        return Open;
+    }
+
+    uint64_t Finish()
+    {
+        if( BatchBytes >= BatchSize ) Submit();
+        return Open ? Submitted + 1 : Submitted;
+    }
+
+    void Submit()
+    {
+        if( !Open ) return;
+        vkEndCommandBuffer( Open );
+        uint64_t Value{ Submitted + 1 };
+        VkTimelineSemaphoreSubmitInfo TimelineSemaphoreSubmitInfo{};
+        TimelineSemaphoreSubmitInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineSemaphoreSubmitInfo.signalSemaphoreValueCount = 1;
+        TimelineSemaphoreSubmitInfo.pSignalSemaphoreValues    = &Value;
+        VkSubmitInfo SubmitInfo{};
+        SubmitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext                = &TimelineSemaphoreSubmitInfo;
+        SubmitInfo.commandBufferCount   = 1;
+        SubmitInfo.pCommandBuffers      = &Open;
+        SubmitInfo.signalSemaphoreCount = 1;
+        SubmitInfo.pSignalSemaphores    = &Timeline;
+        VkResult Result{ vkQueueSubmit( Queue, 1, &SubmitInfo, VK_NULL_HANDLE ) };
+        if( Result != VK_SUCCESS ) throw std::runtime_error( std::format( "Failed to submit uploads, error: {}", string_VkResult( Result ) ) );
+        Submitted = Value;
+        Ring.FinishFrame();
+        InFlight.push_back( { Open, Value } );
+        Open       = VK_NULL_HANDLE;
+        BatchBytes = 0;
+        Statistics.Submits++;
+    }
+
+    // Hands ring space and command buffers of finished submits back; true if any finished.
+    bool Retire()
+    {
+        if( InFlight.empty() ) return false;
+        uint64_t Value{ 0 };
+        vkGetSemaphoreCounterValue( Device, Timeline, &Value );
+        bool Retired{ false };
+        while( !InFlight.empty() && InFlight.front().Value <= Value )
+        {
+            Idle.push_back( InFlight.front().CommandBuffer );
+            InFlight.pop_front();
+            Ring.ReleaseFrame();
+            Retired = true;
+        }
+        return Retired;
+    }
+};
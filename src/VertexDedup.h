@@ -0,0 +1,203 @@
+#pragma once
+#include "vulkan.h"
+#include <span>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Collapses a triangle-corner stream into unique Vertecies plus indices with open-addressing
+// tables sized up front. Output order is first occurrence, so it matches the unordered_map
+// dedup exactly. With more than one thread the corners are sharded by hash and every shard is
+// deduplicated independently.
+class VertexDedup
+{
+  public:
+    struct Statistics
+    {
+        uint64_t Lookups{ 0 };
+        uint64_t Probes{ 0 };
+        uint64_t TagCollisions{ 0 };
+        uint32_t Shards{ 0 };
+    };
+
+    VertexDedup( uint32_t threads = std::thread::hardware_concurrency() ) : Threads{ threads ? threads : 1 } {}
+
+    void Run( std::span<const Vertex> corners, Model &model )
+    {
+        Stats = {};
+        const size_t Count{ corners.size() };
+        model.ModelVertecies.clear();
+        model.ModelVerteciesIndices.resize( Count );
+        if( !Count ) return;
+
+        uint32_t Workers{ static_cast<uint32_t>( std::min<size_t>( Threads, ( Count + MinCornersPerThread - 1 ) / MinCornersPerThread ) ) };
+        uint32_t ShardBits{ 0 };
+        while( Workers > 1 && ( 1u << ShardBits ) < Workers * 4 ) ShardBits++;
+        const uint32_t ShardsCount{ 1u << ShardBits };
+        Stats.Shards = ShardsCount;
+
+        std::vector<uint64_t> Hashes( Count );
+        std::vector<uint32_t> Representative( Count );
+        std::vector<uint32_t> Order( ShardsCount > 1 ? Count : 0 );
+        std::vector<size_t> ShardBegin( ShardsCount + 1, 0 );
+
+        // Hash and bucket by shard
+        std::vector<std::vector<size_t>> ShardCounts( Workers, std::vector<size_t>( ShardsCount, 0 ) );
+        ParallelRanges( Workers, Count, [ & ]( uint32_t worker, size_t begin, size_t end )
+                        {
+                            for( size_t i{ begin }; i < end; i++ )
+                            {
+                                Hashes[ i ] = VertexHash( corners[ i ] );
+                                if( ShardsCount > 1 ) ShardCounts[ worker ][ Hashes[ i ] >> ( 64 - ShardBits ) ]++;
+                            } } );
+        if( ShardsCount > 1 )
+        {
+            std::vector<std::vector<size_t>> Cursor( Workers, std::vector<size_t>( ShardsCount ) );
+            size_t Offset{ 0 };
+            for( uint32_t Shard{ 0 }; Shard < ShardsCount; Shard++ )
+            {
+                ShardBegin[ Shard ] = Offset;
+                for( uint32_t Worker{ 0 }; Worker < Workers; Worker++ )
+                {
+                    Cursor[ Worker ][ Shard ] = Offset;
+                    Offset += ShardCounts[ Worker ][ Shard ];
+                }
+            }
+            ShardBegin[ ShardsCount ] = Offset;
+            ParallelRanges( Workers, Count, [ & ]( uint32_t worker, size_t begin, size_t end )
+                            {
+                                for( size_t i{ begin }; i < end; i++ )
+                                    Order[ Cursor[ worker ][ Hashes[ i ] >> ( 64 - ShardBits ) ]++ ] = static_cast<uint32_t>( i );
+                            } );
+        }
+        else
+            ShardBegin[ 1 ] = Count;
+        // Hash and bucket by shard end
+
+        // Per shard tables
+        std::atomic<uint32_t> NextShard{ 0 };
+        std::vector<Statistics> WorkerStats( Workers );
+        RunWorkers( Workers, [ & ]( uint32_t worker )
+                    {
+                        std::vector<Slot> Table;
+                        for( uint32_t Shard{ NextShard++ }; Shard < ShardsCount; Shard = NextShard++ )
+                        {
+                            // Indexed meshes average well under one unique vertex per two corners.
+                            size_t Size{ ShardBegin[ Shard + 1 ] - ShardBegin[ Shard ] };
+                            size_t Capacity{ 16 };
+                            while( Capacity < Size / 2 ) Capacity <<= 1;
+                            Table.assign( Capacity, Slot{ 0, Empty } );
+                            size_t Used{ 0 };
+                            for( size_t k{ ShardBegin[ Shard ] }; k < ShardBegin[ Shard + 1 ]; k++ )
+                            {
+                                uint32_t Corner{ ShardsCount > 1 ? Order[ k ] : static_cast<uint32_t>( k ) };
+                                Representative[ Corner ] = Insert( Table, corners, Hashes[ Corner ], Corner, WorkerStats[ worker ] );
+                                if( Representative[ Corner ] == Corner && ++Used * 4 > Table.size() * 3 )
+                                    Grow( Table, Hashes );
+                            }
+                        } } );
+        for( const auto &Worker : WorkerStats )
+        {
+            Stats.Lookups += Worker.Lookups;
+            Stats.Probes += Worker.Probes;
+            Stats.TagCollisions += Worker.TagCollisions;
+        }
+        // Per shard tables end
+
+        // First occurrence order: prefix sum over corners that represent themselves.
+        std::vector<size_t> Firsts( Workers + 1, 0 );
+        ParallelRanges( Workers, Count, [ & ]( uint32_t worker, size_t begin, size_t end )
+                        {
+                            size_t Local{ 0 };
+                            for( size_t i{ begin }; i < end; i++ ) Local += Representative[ i ] == i;
+                            Firsts[ worker + 1 ] = Local; } );
+        for( uint32_t Worker{ 0 }; Worker < Workers; Worker++ ) Firsts[ Worker + 1 ] += Firsts[ Worker ];
+        model.ModelVertecies.resize( Firsts[ Workers ] );
+        uint32_t *Indices{ model.ModelVerteciesIndices.data() };
+        ParallelRanges( Workers, Count, [ & ]( uint32_t worker, size_t begin, size_t end )
+                        {
+                            uint32_t Next{ static_cast<uint32_t>( Firsts[ worker ] ) };
+                            for( size_t i{ begin }; i < end; i++ )
+                                if( Representative[ i ] == i )
+                                {
+                                    model.ModelVertecies[ Next ] = corners[ i ];
+                                    Indices[ i ] = Next++;
+                                } } );
+        ParallelRanges( Workers, Count, [ & ]( uint32_t, size_t begin, size_t end )
+                        {
+                            for( size_t i{ begin }; i < end; i++ )
+                                if( Representative[ i ] != i ) Indices[ i ] = Indices[ Representative[ i ] ]; } );
+    }
+
+    const Statistics &Stat() const
+    {
+        return Stats;
+    }
+
+  private:
+    static constexpr uint32_t Empty{ ~0u };
+    static constexpr size_t MinCornersPerThread{ 64 * 1024 };
+    uint32_t Threads;
+    Statistics Stats;
+
+    struct Slot
+    {
+        uint32_t Tag;
+        uint32_t Corner;
+    };
+
+    // Returns the corner that first carried this vertex.
+    static uint32_t Insert( std::vector<Slot> &table, std::span<const Vertex> corners, uint64_t hash, uint32_t corner, Statistics &stats )
+    {
+        const size_t Mask{ table.size() - 1 };
+        const uint32_t Tag{ static_cast<uint32_t>( hash ) };
+        stats.Lookups++;
+        for( size_t Index{ static_cast<size_t>( hash >> 20 ) & Mask };; Index = ( Index + 1 ) & Mask )
+        {
+            stats.Probes++;
+            Slot &Entry{ table[ Index ] };
+            if( Entry.Corner == Empty )
+            {
+                Entry = { Tag, corner };
+                return corner;
+            }
+            if( Entry.Tag == Tag )
+            {
+                if( corners[ Entry.Corner ] == corners[ corner ] ) return Entry.Corner;
+                stats.TagCollisions++;
+            }
+        }
+    }
+
+    static void Grow( std::vector<Slot> &table, const std::vector<uint64_t> &hashes )
+    {
+        std::vector<Slot> Grown( table.size() * 2, Slot{ 0, Empty } );
+        const size_t Mask{ Grown.size() - 1 };
+        for( const auto &Entry : table )
+        {
+            if( Entry.Corner == Empty ) continue;
+            size_t Index{ static_cast<size_t>( hashes[ Entry.Corner ] >> 20 ) & Mask };
+            while( Grown[ Index ].Corner != Empty ) Index = ( Index + 1 ) & Mask;
+            Grown[ Index ] = Entry;
+        }
+        table.swap( Grown );
+    }
+
+    template <typename F>
+    static void RunWorkers( uint32_t workers, F &&job )
+    {
+        std::vector<std::thread> Pool;
+        Pool.reserve( workers - 1 );
+        for( uint32_t i{ 1 }; i < workers; i++ ) Pool.emplace_back( job, i );
+        job( 0 );
+        for( auto &Thread : Pool ) Thread.join();
+    }
+
+    template <typename F>
+    static void ParallelRanges( uint32_t workers, size_t count, F &&job )
+    {
+        RunWorkers( workers, [ & ]( uint32_t worker )
+                    { job( worker, count * worker / workers, count * ( worker + 1 ) / workers ); } );
+    }
+};
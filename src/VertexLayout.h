@@ -0,0 +1,192 @@
+#pragma once
+#include <array>
+#include <tuple>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+inline uint16_t FloatToHalf( float value )
+{
+    uint32_t Bits;
+    memcpy( &Bits, &value, sizeof( Bits ) );
+    uint32_t Sign{ ( Bits >> 16 ) & 0x8000 };
+    uint32_t Exponent{ ( Bits >> 23 ) & 0xFF };
+    uint32_t Mantissa{ Bits & 0x7FFFFF };
+    if( Exponent == 0xFF ) return static_cast<uint16_t>( Sign | 0x7C00 | ( Mantissa ? 0x200 : 0 ) );
+    int32_t HalfExponent{ static_cast<int32_t>( Exponent ) - 127 + 15 };
+    if( HalfExponent >= 0x1F ) return static_cast<uint16_t>( Sign | 0x7C00 );
+    uint32_t Half, Rest, Middle;
+    if( HalfExponent <= 0 )
+    {
+        if( HalfExponent < -10 ) return static_cast<uint16_t>( Sign );
+        uint32_t Shift{ static_cast<uint32_t>( 14 - HalfExponent ) };
+        Mantissa |= 0x800000;
+        Half   = Mantissa >> Shift;
+        Rest   = Mantissa & ( ( 1u << Shift ) - 1 );
+        Middle = 1u << ( Shift - 1 );
+    }
+    else
+    {
+        Half   = ( static_cast<uint32_t>( HalfExponent ) << 10 ) | ( Mantissa >> 13 );
+        Rest   = Mantissa & 0x1FFF;
+        Middle = 0x1000;
+    }
+    if( Rest > Middle || ( Rest == Middle && ( Half & 1 ) ) ) Half++;
+    return static_cast<uint16_t>( Sign | Half );
+}
+
+inline float HalfToFloat( uint16_t half )
+{
+    uint32_t Sign{ static_cast<uint32_t>( half & 0x8000 ) << 16 };
+    uint32_t Exponent{ ( half >> 10 ) & 0x1Fu };
+    uint32_t Mantissa{ half & 0x3FFu };
+    uint32_t Bits;
+    if( !Exponent )
+    {
+        float Value{ Mantissa * 5.9604645e-8f };
+        return Sign ? -Value : Value;
+    }
+    if( Exponent == 0x1F )
+        Bits = Sign | 0x7F800000 | ( Mantissa << 13 );
+    else
+        Bits = Sign | ( ( Exponent + 112 ) << 23 ) | ( Mantissa << 13 );
+    float Value;
+    memcpy( &Value, &Bits, sizeof( Value ) );
+    return Value;
+}
+
+enum class AttributeEncoding
+{
+    Float,
+    Half,
+    Unorm
+};
+
+// One vertex attribute: its storage, Vulkan format and the CPU-side codec. Values travel as
+// vec4 and the unused components are dropped or filled with 0, 0, 0, 1.
+template <typename Component, uint32_t N, VkFormat F, AttributeEncoding E>
+struct VertexAttribute
+{
+    using Type = std::array<Component, N>;
+    static constexpr VkFormat Format{ F };
+    static constexpr AttributeEncoding Encoding{ E };
+    static constexpr uint32_t Components{ N };
+    static constexpr uint32_t Size{ sizeof( Type ) };
+    static constexpr uint32_t Alignment{ alignof( Component ) };
+    static constexpr bool Normalized{ E == AttributeEncoding::Unorm };
+
+    static Type Encode( const glm::vec4 &value )
+    {
+        Type Result{};
+        for( uint32_t i{ 0 }; i < N; i++ )
+        {
+            if constexpr( E == AttributeEncoding::Float )
+                Result[ i ] = value[ i ];
+            else if constexpr( E == AttributeEncoding::Half )
+                Result[ i ] = FloatToHalf( value[ i ] );
+            else
+                Result[ i ] = static_cast<Component>( std::lround( std::clamp( value[ i ], 0.f, 1.f ) * Max ) );
+        }
+        return Result;
+    }
+
+    static glm::vec4 Decode( const Type &value )
+    {
+        glm::vec4 Result{ 0.f, 0.f, 0.f, 1.f };
+        for( uint32_t i{ 0 }; i < N; i++ )
+        {
+            if constexpr( E == AttributeEncoding::Float )
+                Result[ i ] = value[ i ];
+            else if constexpr( E == AttributeEncoding::Half )
+                Result[ i ] = HalfToFloat( value[ i ] );
+            else
+                Result[ i ] = value[ i ] / Max;
+        }
+        return Result;
+    }
+
+  private:
+    static constexpr float Max{ static_cast<float>( ( 1ull << ( 8 * sizeof( Component ) ) ) - 1 ) };
+};
+
+using Float2    = VertexAttribute<float, 2, VK_FORMAT_R32G32_SFLOAT, AttributeEncoding::Float>;
+using Float3    = VertexAttribute<float, 3, VK_FORMAT_R32G32B32_SFLOAT, AttributeEncoding::Float>;
+using Float4    = VertexAttribute<float, 4, VK_FORMAT_R32G32B32A32_SFLOAT, AttributeEncoding::Float>;
+using Half2     = VertexAttribute<uint16_t, 2, VK_FORMAT_R16G16_SFLOAT, AttributeEncoding::Half>;
+using Half4     = VertexAttribute<uint16_t, 4, VK_FORMAT_R16G16B16A16_SFLOAT, AttributeEncoding::Half>;
+using Unorm8x4  = VertexAttribute<uint8_t, 4, VK_FORMAT_R8G8B8A8_UNORM, AttributeEncoding::Unorm>;
+using Unorm16x2 = VertexAttribute<uint16_t, 2, VK_FORMAT_R16G16_UNORM, AttributeEncoding::Unorm>;
+using Unorm16x4 = VertexAttribute<uint16_t, 4, VK_FORMAT_R16G16B16A16_UNORM, AttributeEncoding::Unorm>;
+
+template <size_t N>
+constexpr std::array<uint32_t, N> AttributeOffsets( const std::array<uint32_t, N> &sizes, const std::array<uint32_t, N> &alignments )
+{
+    std::array<uint32_t, N> Offsets{};
+    uint32_t Offset{ 0 };
+    for( size_t i{ 0 }; i < N; i++ )
+    {
+        Offset       = ( Offset + alignments[ i ] - 1 ) / alignments[ i ] * alignments[ i ];
+        Offsets[ i ] = Offset;
+        Offset += sizes[ i ];
+    }
+    return Offsets;
+}
+
+// Attributes are declared once, in shader location order; everything Vulkan needs is derived
+// at compile time. Stride is rounded to 4 bytes.
+template <typename... Attributes>
+struct VertexLayout
+{
+    static constexpr uint32_t Count{ sizeof...( Attributes ) };
+    template <size_t I>
+    using Attribute = std::tuple_element_t<I, std::tuple<Attributes...>>;
+
+    static constexpr std::array<VkFormat, Count> Formats{ Attributes::Format... };
+    static constexpr std::array<uint32_t, Count> Sizes{ Attributes::Size... };
+    static constexpr std::array<uint32_t, Count> Offsets{ AttributeOffsets<Count>( Sizes, { Attributes::Alignment... } ) };
+    static constexpr uint32_t Stride{ ( Offsets[ Count - 1 ] + Sizes[ Count - 1 ] + 3 ) / 4 * 4 };
+
+    static constexpr VkVertexInputBindingDescription BindingDescription( uint32_t binding = 0, VkVertexInputRate rate = VK_VERTEX_INPUT_RATE_VERTEX )
+    {
+        return { binding, Stride, rate };
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, Count> AttributeDescriptions( uint32_t binding = 0, uint32_t firstLocation = 0 )
+    {
+        std::array<VkVertexInputAttributeDescription, Count> Descriptions{};
+        for( uint32_t i{ 0 }; i < Count; i++ )
+            Descriptions[ i ] = { firstLocation + i, binding, Formats[ i ], Offsets[ i ] };
+        return Descriptions;
+    }
+
+    template <size_t I>
+    static void Write( std::byte *vertex, const glm::vec4 &value )
+    {
+        auto Encoded{ Attribute<I>::Encode( value ) };
+        memcpy( vertex + Offsets[ I ], &Encoded, sizeof( Encoded ) );
+    }
+
+    template <size_t I>
+    static glm::vec4 Read( const std::byte *vertex )
+    {
+        typename Attribute<I>::Type Encoded;
+        memcpy( &Encoded, vertex + Offsets[ I ], sizeof( Encoded ) );
+        return Attribute<I>::Decode( Encoded );
+    }
+};
+
+// Position, color, texture coordinate; the layouts below all feed shader.vert unchanged.
+using FullVertexLayout = VertexLayout<Float3, Float4, Float2>;
+// Half-float position and UV, 8-bit color: 16 bytes.
+using HalfVertexLayout = VertexLayout<Half4, Unorm8x4, Half2>;
+// 16-bit positions relative to the mesh bounds (undone by the model matrix), 16-bit UVs: 16 bytes.
+using PackedVertexLayout = VertexLayout<Unorm16x4, Unorm8x4, Unorm16x2>;
+// A column major world matrix per instance, read by shader.vert as a mat4 from location 3 on.
+using InstanceLayout = VertexLayout<Float4, Float4, Float4, Float4>;
+
+static_assert( FullVertexLayout::Stride == 36 && HalfVertexLayout::Stride == 16 && PackedVertexLayout::Stride == 16 && InstanceLayout::Stride == sizeof( glm::mat4 ) );
+static_assert( HalfVertexLayout::AttributeDescriptions()[ 2 ].offset == 12 && PackedVertexLayout::AttributeDescriptions()[ 1 ].format == VK_FORMAT_R8G8B8A8_UNORM );
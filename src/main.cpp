@@ -6,9 +6,51 @@ int main( int argc, char *argv[] )
     std::vector<std::pair<const char *, const char *>> ModelsPaths{
         { "models/plate.obj", "model" },
         { "models/test.obj", "test" } };
+    std::vector<const char *> TexturesPaths{ "textures/img.png" };
+    // --headless [--frames N] [--capture frame.ppm] renders without a window, e.g. on lavapipe:
+    // VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json
+    // --trace trace.json writes the profiler zones for chrome://tracing or Perfetto on exit.
+    // In a window, --frames-in-flight N and --present vsync|low-latency|uncapped.
+    // --no-bindless binds a descriptor set per texture even where descriptor indexing exists.
+    // --culling off|indirect-count|multi-draw-indirect picks how instances are culled on the GPU.
+    // --occlusion also culls them against a depth pyramid, headless only.
+    // --pack assets.pack reads assets from another pack than bin/assets.pack; --no-pack from loose files.
+    // Built with EMBED_ASSETS, bin/assets.pack is the copy linked into the executable.
+    bool Headless{ false };
+    bool Bindless{ true };
+    bool Occlusion{ false };
+    uint32_t FramesInFlight{ 2 };
+    PresentPolicy Policy{ PresentPolicy::LowLatency };
+    CullingMode Culling{ CullingMode::IndirectCount };
+    uint32_t Frames{ 1 };
+    const char *Capture{ nullptr };
+    const char *Trace{ nullptr };
+    const char *Pack{ "bin/assets.pack" };
+    for( int i{ 1 }; i < argc; i++ )
+    {
+        if( !strcmp( argv[ i ], "--headless" ) ) Headless = true;
+        else if( !strcmp( argv[ i ], "--frames" ) && i + 1 < argc ) Frames = static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) );
+        else if( !strcmp( argv[ i ], "--no-bindless" ) ) Bindless = false;
+        else if( !strcmp( argv[ i ], "--occlusion" ) ) Occlusion = true;
+        else if( !strcmp( argv[ i ], "--capture" ) && i + 1 < argc ) Capture = argv[ ++i ];
+        else if( !strcmp( argv[ i ], "--trace" ) && i + 1 < argc ) Trace = argv[ ++i ];
+        else if( !strcmp( argv[ i ], "--pack" ) && i + 1 < argc ) Pack = argv[ ++i ];
+        else if( !strcmp( argv[ i ], "--no-pack" ) ) Pack = nullptr;
+        else if( !strcmp( argv[ i ], "--frames-in-flight" ) && i + 1 < argc ) FramesInFlight = std::max( static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) ), 1u );
+        else if( !strcmp( argv[ i ], "--present" ) && i + 1 < argc )
+        {
+            if( !ParsePresentPolicy( argv[ ++i ], Policy ) ) std::cerr << "Unknown present policy " << argv[ i ] << ", using " << PresentPolicyName( Policy ) << "." << std::endl;
+        }
+        else if( !strcmp( argv[ i ], "--culling" ) && i + 1 < argc )
+        {
+            if( !ParseCullingMode( argv[ ++i ], Culling ) ) std::cerr << "Unknown culling mode " << argv[ i ] << ", using " << CullingModeName( Culling ) << "." << std::endl;
+        }
+    }
     try
     {
-        App app{ 0, 0, "HV", ModelsPaths };
+        App app{ 0, 0, "HV", ModelsPaths, TexturesPaths, Headless, FramesInFlight, Policy, Bindless, Culling, Occlusion, Pack };
+        if( Headless ) app.RenderOffscreen( Frames, Capture );
+        else app.Run();
     }
     catch( const std::exception &e )
     {
@@ -16,6 +58,12 @@ int main( int argc, char *argv[] )
         SPDLOG_CRITICAL( "{}\n Exit with error code {}.", e.what(), EXIT_FAILURE );
         return EXIT_FAILURE;
     }
+    if( Trace )
+    {
+        if( !ProfilerEnabled ) SPDLOG_WARN( "--trace needs a build with ENABLE_PROFILER, nothing written." );
+        else if( Profiler::Get().WriteChromeTrace( Trace ) ) SPDLOG_INFO( "Trace written to {}.", Trace );
+        else SPDLOG_ERROR( "Failed to write trace to {}.", Trace );
+    }
     // INFO_CALLBACK( "Exit with code {}.", EXIT_SUCCESS );
     SPDLOG_INFO( "Exit with code {}.", EXIT_SUCCESS );
     return EXIT_SUCCESS;
@@ -1,13 +1,14 @@
+#pragma once
 #include <string>
-#define TINYOBJLOADER_IMPLEMENTATION
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define STB_IMAGE_IMPLEMENTATION
 #define GLFW_INCLUDE_VULKAN
 #if defined( _WIN32 )
+#    define NOMINMAX
 #    define VK_USE_PLATFORM_WIN32_KHR
 #    define GLFW_EXPOSE_NATIVE_WIN32
-#elif defined( __LINUX__ )
+#elif defined( __linux__ )
 #    define VK_USE_PLATFORM_X11_KHR
 #    define GLFW_EXPOSE_NATIVE_X11
 #endif
@@ -16,26 +17,24 @@
 #include <GLFW/glfw3.h>
 #include <GLFW/glfw3native.h>
 #include <glm/gtx/hash.hpp>
-#include <tiny_obj_loader.h>
 #include <spdlog/sinks/stdout_sinks.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vk_enum_string_helper.h>
 #include <array>
 #include <vector>
 #include <format>
+#include <optional>
 #include <set>
-
-typedef void ( *LoggerCallback )( const char *data );
-
-struct LoggerCallbacks
-{
-    LoggerCallback trace;
-    LoggerCallback debug;
-    LoggerCallback info;
-    LoggerCallback warn;
-    LoggerCallback error;
-    LoggerCallback critical;
-};
+#include "Hash.h"
+#include "VertexLayout.h"
+#include "DeviceMemory.h"
+#include "UploadQueue.h"
+#include "Profiler.h"
+#include "PipelineCache.h"
+#include "OffscreenTarget.h"
+#include "FrameLoop.h"
+#include "BindlessTable.h"
+#include "LoggerCallbacks.h"
 
 // Structurs
 
@@ -66,33 +65,15 @@ struct Vertex
     glm::vec3 coordinate;
     glm::vec4 color;
     glm::vec2 texture;
+    using Layout = FullVertexLayout;
     static VkVertexInputBindingDescription InputBindingDescription()
     {
-        VkVertexInputBindingDescription VertexInputBindingDescription{};
-        VertexInputBindingDescription.binding   = 0;
-        VertexInputBindingDescription.stride    = sizeof( Vertex );
-        VertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return VertexInputBindingDescription;
+        return Layout::BindingDescription();
     }
 
     static std::array<VkVertexInputAttributeDescription, 3> InputAttributeDescription()
     {
-        std::array<VkVertexInputAttributeDescription, 3> VertexInputAttributeDescription{};
-        VertexInputAttributeDescription[ 0 ].binding  = 0;
-        VertexInputAttributeDescription[ 0 ].location = 0;
-        VertexInputAttributeDescription[ 0 ].format   = VK_FORMAT_R32G32B32_SFLOAT;
-        VertexInputAttributeDescription[ 0 ].offset   = offsetof( Vertex, coordinate );
-
-        VertexInputAttributeDescription[ 1 ].binding  = 0;
-        VertexInputAttributeDescription[ 1 ].location = 1;
-        VertexInputAttributeDescription[ 1 ].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
-        VertexInputAttributeDescription[ 1 ].offset   = offsetof( Vertex, color );
-
-        VertexInputAttributeDescription[ 2 ].binding  = 0;
-        VertexInputAttributeDescription[ 2 ].location = 2;
-        VertexInputAttributeDescription[ 2 ].format   = VK_FORMAT_R32G32_SFLOAT;
-        VertexInputAttributeDescription[ 2 ].offset   = offsetof( Vertex, texture );
-        return VertexInputAttributeDescription;
+        return Layout::AttributeDescriptions();
     }
     bool operator==( const Vertex &other ) const
     {
@@ -115,12 +96,28 @@ struct DemensionsUniformrObject
     alignas( 16 ) glm::mat4 proj;
 };
 
+// shader.vert, set 0 binding 0: written once per frame.
+struct FrameUniformObject
+{
+    alignas( 16 ) glm::mat4 view;
+    alignas( 16 ) glm::mat4 proj;
+};
+
+// bindless.frag push constant: the texture's index in the BindlessTable, the same for every
+// instance of a draw.
+struct DrawPushConstants
+{
+    uint32_t Texture;
+};
+
 struct PhysicalDevice
 {
     VkPhysicalDevice Device;
     SwapChain swapchain;
     VkPhysicalDeviceProperties Properties;
+    VkPhysicalDeviceVulkan12Properties Properties12;
     VkPhysicalDeviceFeatures Features;
+    VkPhysicalDeviceVulkan12Features Features12;
     QueueFamilyIndices Indecies;
     std::vector<VkQueueFamilyProperties> QueueFamilies;
     std::vector<VkExtensionProperties> AviliableExtensions;
@@ -129,6 +126,20 @@ struct PhysicalDevice
 
 // Structurs end
 
+static_assert( sizeof( Vertex ) == 9 * sizeof( float ), "Vertex must stay tightly packed floats." );
+static_assert( Vertex::Layout::Stride == sizeof( Vertex ) && Vertex::Layout::Offsets[ 0 ] == offsetof( Vertex, coordinate ) &&
+                   Vertex::Layout::Offsets[ 1 ] == offsetof( Vertex, color ) && Vertex::Layout::Offsets[ 2 ] == offsetof( Vertex, texture ),
+               "Vertex::Layout must describe struct Vertex." );
+
+// Hash of every Vertex byte, with -0.f folded into 0.f so it agrees with operator==.
+inline uint64_t VertexHash( const Vertex &vertex )
+{
+    float Canonical[ sizeof( Vertex ) / sizeof( float ) ];
+    memcpy( Canonical, &vertex, sizeof( Vertex ) );
+    for( auto &Component : Canonical ) Component += 0.f;
+    return Hash64( Canonical, sizeof( Canonical ) );
+}
+
 namespace std
 {
 template <>
@@ -136,10 +147,7 @@ struct hash<Vertex>
 {
     size_t operator()( Vertex const &vertex ) const
     {
-        return ( ( hash<glm::vec3>()( vertex.coordinate ) ^
-                   ( hash<glm::vec3>()( vertex.color ) << 1 ) ) >>
-                 1 ) ^
-               ( hash<glm::vec2>()( vertex.texture ) << 1 );
+        return static_cast<size_t>( VertexHash( vertex ) );
     }
 };
 } // namespace std
@@ -148,142 +156,423 @@ class VulkanInstance
 {
   public:
 #if defined( _WIN32 )
-    VulkanInstance( const char *AppName, uint32_t AppVersion, HWND hwnd, HINSTANCE instance, LoggerCallbacks LoggerCallback ) : Loggers{ LoggerCallback }
+    // extent is the window's framebuffer size.
+    VulkanInstance( const char *AppName, uint32_t AppVersion, HWND hwnd, HINSTANCE instance, LoggerCallbacks LoggerCallback, VkExtent2D extent, uint32_t framesInFlight = 2,
+                    PresentPolicy policy = PresentPolicy::LowLatency ) : Loggers{ LoggerCallback }
     {
-#endif
-#if defined( __LINUX__ )
-        VulkanInstance( const char *AppName, uint32_t AppVersion, Display dpy, Window window, LoggerCallbacks LoggerCallback ) : Loggers{ LoggerCallback }
+        if( !CreateInstance( AppName, AppVersion, true ) ) return;
+        VkWin32SurfaceCreateInfoKHR Win32SurfaceCreateInfo{
+            VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+            nullptr,
+            0,
+            instance,
+            hwnd };
+        VkResult Result{ vkCreateWin32SurfaceKHR( Instance, &Win32SurfaceCreateInfo, nullptr, &Screen ) };
+        if( Result != VK_SUCCESS )
         {
+            Loggers.critical( std::format( "Failed to Create Surface, error: {}", string_VkResult( Result ) ).c_str() );
+            return;
+        }
+        CreateDevice();
+        CreatePresenter( extent, framesInFlight, policy );
+    }
+#elif defined( __linux__ )
+    // extent is the window's framebuffer size.
+    VulkanInstance( const char *AppName, uint32_t AppVersion, Display *dpy, Window window, LoggerCallbacks LoggerCallback, VkExtent2D extent, uint32_t framesInFlight = 2,
+                    PresentPolicy policy = PresentPolicy::LowLatency ) : Loggers{ LoggerCallback }
+    {
+        if( !CreateInstance( AppName, AppVersion, true ) ) return;
+        VkXlibSurfaceCreateInfoKHR XlibSurfaceCreateInfoKHR{
+            VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR,
+            nullptr,
+            0,
+            dpy,
+            window };
+        VkResult Result{ vkCreateXlibSurfaceKHR( Instance, &XlibSurfaceCreateInfoKHR, nullptr, &Screen ) };
+        if( Result != VK_SUCCESS )
+        {
+            Loggers.critical( std::format( "Failed to Create Surface, error: {}", string_VkResult( Result ) ).c_str() );
+            return;
+        }
+        CreateDevice();
+        CreatePresenter( extent, framesInFlight, policy );
+    }
 #endif
-            // Init surface.
-            Loggers.info( "Initialize Vulkan.h::VulkanInstance class." );
-            VkInstanceCreateInfo InstanceCreateInfo{};
-            InstanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-            uint32_t glfwExtensionsCount{ 0 };
-            const char **glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionsCount );
-            std::vector<const char *> glfwExtensionsVector( glfwExtensions, glfwExtensions + glfwExtensionsCount );
+    // Headless: no window, surface or swapchain, so it runs on display-less machines and on the
+    // lavapipe CPU driver. Frames render into Offscreen() and are read back from there.
+    VulkanInstance( const char *AppName, uint32_t AppVersion, VkExtent2D offscreen, LoggerCallbacks LoggerCallback ) : Loggers{ LoggerCallback }
+    {
+        if( !CreateInstance( AppName, AppVersion, false ) ) return;
+        CreateDevice();
+        if( !LogicalDevice ) return;
+        uint32_t Graphic{ SelectedDevice.Indecies.graphic.value() };
+        float TimestampPeriod{ SelectedDevice.QueueFamilies[ Graphic ].timestampValidBits ? SelectedDevice.Properties.limits.timestampPeriod : 0.f };
+        Target.emplace( LogicalDevice, *Memory, GraphicQueue, Graphic, offscreen, TimestampPeriod, SelectedDevice.QueueFamilies[ Graphic ].timestampValidBits );
+        Loggers.info( std::format( "Headless, rendering offscreen at {}x{}.", offscreen.width, offscreen.height ).c_str() );
+    }
 
-#ifdef _DEBUG
-            uint32_t _c;
-            vkEnumerateInstanceLayerProperties( &_c, nullptr );
-            VkLayerProperties *AviableLayers = new VkLayerProperties[ _c ];
-            vkEnumerateInstanceLayerProperties( &_c, AviableLayers );
-            size_t c{ sizeof( ValidationLayers ) / sizeof( ValidationLayers[ 0 ] ) };
-            std::vector<const char *> NotAvilableLayers{ c };
-            memcpy( &NotAvilableLayers[ 0 ], ValidationLayers, sizeof( ValidationLayers ) );
-            for( size_t i{ 0 }; i < c; i++ )
+    ~VulkanInstance()
+    {
+        if( LogicalDevice ) vkDeviceWaitIdle( LogicalDevice );
+        if( Pipelines )
+        {
+            PipelineCacheStatistics Statistics{ Pipelines->Stat() };
+            Loggers.info( std::format( "{} pipelines compiled in {:.3f} ms with a {} pipeline cache.", Statistics.Pipelines, Statistics.Milliseconds, PipelineCacheStateName( Pipelines->State() ) ).c_str() );
+            try
             {
-                for( uint32_t _i{ 0 }; _i < _c; _i++ )
-                    if( !strcmp( NotAvilableLayers[ c - 1 - i ], AviableLayers[ _i ].layerName ) )
-                    {
-                        NotAvilableLayers.erase( NotAvilableLayers.end() - i - 1 );
-                        break;
-                    }
-                if( NotAvilableLayers.empty() )
-                    break;
+                PROFILE_ZONE( "save pipeline cache" );
+                Pipelines->Save();
+            }
+            catch( const std::exception &Error )
+            {
+                Loggers.warn( std::format( "Failed to save pipeline cache: {}", Error.what() ).c_str() );
             }
-            if( !NotAvilableLayers.empty() )
+            Pipelines.reset();
+        }
+        Target.reset();
+        Presenter.reset();
+        Uploader.reset();
+        Memory.reset();
+        if( LogicalDevice ) vkDestroyDevice( LogicalDevice, nullptr );
+        if( Screen ) vkDestroySurfaceKHR( Instance, Screen, nullptr );
+        if( Instance ) vkDestroyInstance( Instance, nullptr );
+    }
+
+    // Every buffer and image should come from here rather than from its own vkAllocateMemory.
+    DeviceMemoryAllocator &DeviceMemory()
+    {
+        return *Memory;
+    }
+
+    // Graphics submits that use uploaded data wait on Uploads().Semaphore().
+    UploadQueue &Uploads()
+    {
+        return *Uploader;
+    }
+
+    // BC1 and BC7 images can be sampled; textures fall back to RGBA8 otherwise.
+    bool TextureCompression() const
+    {
+        return SelectedDevice.Features.textureCompressionBC;
+    }
+
+    // Every pipeline should be created through here so that it lands in the on-disk cache.
+    PipelineCache &PipelineCompiler()
+    {
+        return *Pipelines;
+    }
+
+    VkDevice Device() const
+    {
+        return LogicalDevice;
+    }
+    const VkPhysicalDeviceProperties &Properties() const
+    {
+        return SelectedDevice.Properties;
+    }
+    const VkPhysicalDeviceVulkan12Properties &Properties12() const
+    {
+        return SelectedDevice.Properties12;
+    }
+    const VkPhysicalDeviceFeatures &Features() const
+    {
+        return SelectedDevice.Features;
+    }
+    const VkPhysicalDeviceVulkan12Features &Features12() const
+    {
+        return SelectedDevice.Features12;
+    }
+    // A BindlessTable can be created; enabled on the device whenever supported.
+    bool DescriptorIndexing() const
+    {
+        return BindlessSupported( SelectedDevice.Features, SelectedDevice.Features12 );
+    }
+    uint32_t GraphicFamily() const
+    {
+        return SelectedDevice.Indecies.graphic.value();
+    }
+
+    bool Headless() const
+    {
+        return !Screen;
+    }
+
+    // Only for headless instances.
+    OffscreenTarget &Offscreen()
+    {
+        return *Target;
+    }
+
+    // Only for windowed instances.
+    FrameLoop &Frames()
+    {
+        return *Presenter;
+    }
+
+  private:
+    // Custom
+    const char *ValidationLayers[ 1 ]{ "VK_LAYER_KHRONOS_validation" };
+    const char *NecessDeviceExtensions[ 2 ]{ VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME };
+    // System
+    LoggerCallbacks Loggers;
+    VkSurfaceKHR Screen{ VK_NULL_HANDLE };
+    VkInstance Instance{ VK_NULL_HANDLE };
+    VkDevice LogicalDevice{ VK_NULL_HANDLE };
+    VkPhysicalDevice PhysicalDevice{ VK_NULL_HANDLE };
+    struct PhysicalDevice SelectedDevice;
+    VkQueue GraphicQueue{ VK_NULL_HANDLE };
+    VkQueue PresentQueue{ VK_NULL_HANDLE };
+    VkQueue TransferQueue{ VK_NULL_HANDLE };
+    std::optional<DeviceMemoryAllocator> Memory;
+    std::optional<UploadQueue> Uploader;
+    std::optional<PipelineCache> Pipelines;
+    std::optional<OffscreenTarget> Target;
+    std::optional<FrameLoop> Presenter;
+
+    // surface adds the extensions GLFW needs to create one; headless instances go without.
+    bool CreateInstance( const char *AppName, uint32_t AppVersion, bool surface )
+    {
+        PROFILE_ZONE( "create instance" );
+        Loggers.info( "Initialize Vulkan.h::VulkanInstance class." );
+        VkInstanceCreateInfo InstanceCreateInfo{};
+        InstanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        std::vector<const char *> glfwExtensionsVector;
+        if( surface )
+        {
+            uint32_t glfwExtensionsCount{ 0 };
+            const char **glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionsCount );
+            glfwExtensionsVector.assign( glfwExtensions, glfwExtensions + glfwExtensionsCount );
+#if defined( __linux__ )
+            // The X11 constructor creates an Xlib surface, while GLFW usually asks for xcb only.
+            if( std::none_of( glfwExtensionsVector.begin(), glfwExtensionsVector.end(), []( const char *name )
+                              { return !strcmp( name, VK_KHR_XLIB_SURFACE_EXTENSION_NAME ); } ) )
             {
-                std::string Err = std::format( "Not finded validation layers: {}:\n", std::to_string( NotAvilableLayers.size() ) );
-                for( const auto VL : NotAvilableLayers )
+                uint32_t Count{ 0 };
+                vkEnumerateInstanceExtensionProperties( nullptr, &Count, nullptr );
+                std::vector<VkExtensionProperties> Available( Count );
+                vkEnumerateInstanceExtensionProperties( nullptr, &Count, Available.data() );
+                if( std::none_of( Available.begin(), Available.end(), []( const VkExtensionProperties &extension )
+                                  { return !strcmp( extension.extensionName, VK_KHR_XLIB_SURFACE_EXTENSION_NAME ); } ) )
                 {
-                    Err += std::format( "\t {}\n", VL );
+                    Loggers.critical( std::format( "{} is not supported, so no X11 surface can be created.", VK_KHR_XLIB_SURFACE_EXTENSION_NAME ).c_str() );
+                    return false;
                 }
-                LoggerCallback.critical( Err.c_str() );
+                glfwExtensionsVector.push_back( VK_KHR_XLIB_SURFACE_EXTENSION_NAME );
             }
+#endif
+        }
 
-            VkValidationFeatureEnableEXT enabled[]{ VK_VALIDATION_FEATURE_ENABLE_DEBUG_PRINTF_EXT };
-            VkValidationFeaturesEXT ValidationFeatures{};
-            ValidationFeatures.sType                         = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
-            ValidationFeatures.enabledValidationFeatureCount = sizeof( enabled ) / sizeof( enabled[ 0 ] );
-            ValidationFeatures.pEnabledValidationFeatures    = enabled;
-
-            VkDebugUtilsMessengerCreateInfoEXT DebugUtilsMessengerCreateInfoEXT{};
-            InstanceCreateInfo.pNext                         = &DebugUtilsMessengerCreateInfoEXT;
-            DebugUtilsMessengerCreateInfoEXT.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-            DebugUtilsMessengerCreateInfoEXT.pNext           = &ValidationFeatures;
-            DebugUtilsMessengerCreateInfoEXT.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-            DebugUtilsMessengerCreateInfoEXT.messageType     = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-            DebugUtilsMessengerCreateInfoEXT.pfnUserCallback = DebugCallback;
-            DebugUtilsMessengerCreateInfoEXT.pUserData       = this;
-            glfwExtensionsVector.push_back( VK_EXT_DEBUG_UTILS_EXTENSION_NAME );
-            InstanceCreateInfo.enabledLayerCount   = sizeof( ValidationLayers ) / sizeof( ValidationLayers[ 0 ] );
-            InstanceCreateInfo.ppEnabledLayerNames = ValidationLayers;
+#ifdef _DEBUG
+        uint32_t _c;
+        vkEnumerateInstanceLayerProperties( &_c, nullptr );
+        VkLayerProperties *AviableLayers = new VkLayerProperties[ _c ];
+        vkEnumerateInstanceLayerProperties( &_c, AviableLayers );
+        size_t c{ sizeof( ValidationLayers ) / sizeof( ValidationLayers[ 0 ] ) };
+        std::vector<const char *> NotAvilableLayers{ c };
+        memcpy( &NotAvilableLayers[ 0 ], ValidationLayers, sizeof( ValidationLayers ) );
+        for( size_t i{ 0 }; i < c; i++ )
+        {
+            for( uint32_t _i{ 0 }; _i < _c; _i++ )
+                if( !strcmp( NotAvilableLayers[ c - 1 - i ], AviableLayers[ _i ].layerName ) )
+                {
+                    NotAvilableLayers.erase( NotAvilableLayers.end() - i - 1 );
+                    break;
+                }
+            if( NotAvilableLayers.empty() )
+                break;
+        }
+        if( !NotAvilableLayers.empty() )
+        {
+            std::string Err = std::format( "Not finded validation layers: {}:\n", std::to_string( NotAvilableLayers.size() ) );
+            for( const auto VL : NotAvilableLayers )
+            {
+                Err += std::format( "\t {}\n", VL );
+            }
+            Loggers.critical( Err.c_str() );
+        }
 
-#endif
-            InstanceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>( glfwExtensionsVector.size() );
-            InstanceCreateInfo.ppEnabledExtensionNames = glfwExtensionsVector.data();
-            VkApplicationInfo ApplicationInfo{};
-            InstanceCreateInfo.pApplicationInfo = &ApplicationInfo;
-            ApplicationInfo.sType               = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-            ApplicationInfo.engineVersion       = 0;
-            ApplicationInfo.apiVersion          = VK_API_VERSION_1_0;
-            ApplicationInfo.pApplicationName    = AppName;
-            ApplicationInfo.applicationVersion  = AppVersion;
-            VkResult Result{ vkCreateInstance( &InstanceCreateInfo, nullptr, &Instance ) };
+        VkValidationFeatureEnableEXT enabled[]{ VK_VALIDATION_FEATURE_ENABLE_DEBUG_PRINTF_EXT };
+        VkValidationFeaturesEXT ValidationFeatures{};
+        ValidationFeatures.sType                         = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+        ValidationFeatures.enabledValidationFeatureCount = sizeof( enabled ) / sizeof( enabled[ 0 ] );
+        ValidationFeatures.pEnabledValidationFeatures    = enabled;
+
+        VkDebugUtilsMessengerCreateInfoEXT DebugUtilsMessengerCreateInfoEXT{};
+        InstanceCreateInfo.pNext                         = &DebugUtilsMessengerCreateInfoEXT;
+        DebugUtilsMessengerCreateInfoEXT.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        DebugUtilsMessengerCreateInfoEXT.pNext           = &ValidationFeatures;
+        DebugUtilsMessengerCreateInfoEXT.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        DebugUtilsMessengerCreateInfoEXT.messageType     = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        DebugUtilsMessengerCreateInfoEXT.pfnUserCallback = DebugCallback;
+        DebugUtilsMessengerCreateInfoEXT.pUserData       = this;
+        glfwExtensionsVector.push_back( VK_EXT_DEBUG_UTILS_EXTENSION_NAME );
+        InstanceCreateInfo.enabledLayerCount   = sizeof( ValidationLayers ) / sizeof( ValidationLayers[ 0 ] );
+        InstanceCreateInfo.ppEnabledLayerNames = ValidationLayers;
 
-#if defined( _WIN32 )
-            VkWin32SurfaceCreateInfoKHR Win32SurfaceCreateInfo{
-                VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
-                nullptr,
-                0,
-                instance,
-                hwnd };
-            Result = vkCreateWin32SurfaceKHR( Instance, &Win32SurfaceCreateInfo, nullptr, &Screen );
-#endif
-#if defined( __LINUX__ )
-
-            VkXlibSurfaceCreateInfoKHR XlibSurfaceCreateInfoKHR{
-                VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR,
-                nullptr,
-                0,
-                &dpy,
-                &window };
-            Result = vkCreateXlibSurfaceKHR( Instance, &XlibSurfaceCreateInfoKHR, nullptr, &Screen )
-        };
 #endif
-
+        InstanceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>( glfwExtensionsVector.size() );
+        InstanceCreateInfo.ppEnabledExtensionNames = glfwExtensionsVector.data();
+        VkApplicationInfo ApplicationInfo{};
+        InstanceCreateInfo.pApplicationInfo = &ApplicationInfo;
+        ApplicationInfo.sType               = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        ApplicationInfo.engineVersion       = 0;
+        ApplicationInfo.apiVersion          = VK_API_VERSION_1_2;
+        ApplicationInfo.pApplicationName    = AppName;
+        ApplicationInfo.applicationVersion  = AppVersion;
+        VkResult Result{ vkCreateInstance( &InstanceCreateInfo, nullptr, &Instance ) };
         if( Result != VK_SUCCESS )
         {
-            Loggers.critical( "Failed to Create Surface, error" );
+            Instance = VK_NULL_HANDLE;
+            Loggers.critical( std::format( "Failed to create instance, error: {}", string_VkResult( Result ) ).c_str() );
+            return false;
         }
+        return true;
+    }
 
-        // init surface end.
-
+    void CreateDevice()
+    {
+        PROFILE_ZONE( "create device" );
         uint32_t PhysicalDevicesCount{ 0 };
         vkEnumeratePhysicalDevices( Instance, &PhysicalDevicesCount, nullptr );
         if( !PhysicalDevicesCount )
             Loggers.critical( "Failed to Find someone GPU/CPU, with supported grapchic card." );
-        VkPhysicalDevice *Devices = new VkPhysicalDevice[ PhysicalDevicesCount ];
-        Result                    = vkEnumeratePhysicalDevices( Instance, &PhysicalDevicesCount, Devices );
+        std::vector<VkPhysicalDevice> Devices( PhysicalDevicesCount );
+        VkResult Result{ vkEnumeratePhysicalDevices( Instance, &PhysicalDevicesCount, Devices.data() ) };
         if( Result != VK_SUCCESS )
             Loggers.critical( std::format( "Failed to write Devices data at memory, Devices count: {}", std::to_string( PhysicalDevicesCount ) ).c_str() );
-        for( uint32_t device{ 0 }; device < PhysicalDevicesCount; device++ )
+        float BestMark{ 0.f };
+        for( auto device : Devices )
+        {
+            struct PhysicalDevice Candidate;
+            float Mark{ SuitableDevice( device, Candidate ) };
+            Loggers.debug( std::format( "Device {}: mark {}.", Candidate.Properties.deviceName, Mark ).c_str() );
+            if( Mark > BestMark )
+            {
+                BestMark       = Mark;
+                SelectedDevice = std::move( Candidate );
+            }
+        }
+        if( !BestMark )
         {
-            printf( "%s\n", std::to_string( SuitableDevice( Devices[ device ] ) ).c_str() );
+            Loggers.critical( "Failed to find suitable GPU/CPU." );
+            return;
         }
-        delete[] Devices;
+        PhysicalDevice = SelectedDevice.Device;
+        Loggers.info( std::format( "Selected device: {}.", SelectedDevice.Properties.deviceName ).c_str() );
+
+        CreateLogicalDevice();
+        if( !LogicalDevice ) return;
+        Memory.emplace( PhysicalDevice, LogicalDevice );
+        Uploader.emplace( LogicalDevice, *Memory, TransferQueue, SelectedDevice.Indecies.transfer.value(), SelectedDevice.Indecies.graphic.value() );
+        if( SelectedDevice.Indecies.transfer != SelectedDevice.Indecies.graphic ) Loggers.debug( std::format( "Uploads use dedicated transfer family {}.", SelectedDevice.Indecies.transfer.value() ).c_str() );
+        Pipelines.emplace( LogicalDevice, SelectedDevice.Properties, "cache/pipelines.bin" );
+        Loggers.info( std::format( "Pipeline cache: {}.", PipelineCacheStateName( Pipelines->State() ) ).c_str() );
     }
 
-  private:
-    // Custom
-    const char *ValidationLayers[ 1 ]{ "VK_LAYER_KHRONOS_validation" };
-    const char *NecessDeviceExtensions[ 2 ]{ VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME };
-    // System
-    LoggerCallbacks Loggers;
-    VkSurfaceKHR Screen;
-    VkInstance Instance;
-    VkDevice LogicalDevice;
-    VkPhysicalDevice PhysicalDevice;
+    void CreatePresenter( VkExtent2D extent, uint32_t framesInFlight, PresentPolicy policy )
+    {
+        if( !LogicalDevice ) return;
+        const QueueFamilyIndices &Indecies{ SelectedDevice.Indecies };
+        uint32_t TimestampBits{ SelectedDevice.QueueFamilies[ Indecies.graphic.value() ].timestampValidBits };
+        Presenter.emplace( PhysicalDevice, LogicalDevice, Screen, *Memory, GraphicQueue, Indecies.graphic.value(), PresentQueue, Indecies.present.value(), extent, framesInFlight, policy,
+                           VK_FORMAT_D32_SFLOAT, TimestampBits ? SelectedDevice.Properties.limits.timestampPeriod : 0.f, TimestampBits );
+        SelectedDevice.swapchain.Format      = Presenter->Format().format;
+        SelectedDevice.swapchain.PresentMode = Presenter->PresentMode();
+        Loggers.info( std::format( "Present mode {} for {}, {} frames in flight, {}.", string_VkPresentModeKHR( Presenter->PresentMode() ), PresentPolicyName( policy ), framesInFlight,
+                                   string_VkFormat( Presenter->Format().format ) )
+                          .c_str() );
+    }
 
-    float SuitableDevice( VkPhysicalDevice device )
+    // The swapchain extension only where there is a surface to present to.
+    std::vector<const char *> DeviceExtensions() const
+    {
+        std::vector<const char *> Extensions{ std::begin( NecessDeviceExtensions ), std::end( NecessDeviceExtensions ) };
+        if( !Screen ) std::erase_if( Extensions, []( const char *name )
+                                     { return !strcmp( name, VK_KHR_SWAPCHAIN_EXTENSION_NAME ); } );
+        return Extensions;
+    }
+
+    void CreateLogicalDevice()
+    {
+        const QueueFamilyIndices &Indecies{ SelectedDevice.Indecies };
+        std::set<uint32_t> Families{ Indecies.graphic.value(), Indecies.present.value(), Indecies.transfer.value() };
+        float QueuePriority{ 1.f };
+        std::vector<VkDeviceQueueCreateInfo> QueueCreateInfos;
+        for( uint32_t Family : Families )
+        {
+            VkDeviceQueueCreateInfo QueueCreateInfo{};
+            QueueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            QueueCreateInfo.queueFamilyIndex = Family;
+            QueueCreateInfo.queueCount       = 1;
+            QueueCreateInfo.pQueuePriorities = &QueuePriority;
+            QueueCreateInfos.push_back( QueueCreateInfo );
+        }
+
+        VkPhysicalDeviceFeatures Features{};
+        Features.geometryShader       = VK_TRUE;
+        Features.samplerAnisotropy    = SelectedDevice.Features.samplerAnisotropy;
+        Features.textureCompressionBC = SelectedDevice.Features.textureCompressionBC;
+        // Indirect draws generated by IndirectCuller, whenever supported.
+        Features.multiDrawIndirect         = SelectedDevice.Features.multiDrawIndirect;
+        Features.drawIndirectFirstInstance = SelectedDevice.Features.drawIndirectFirstInstance;
+
+        VkPhysicalDeviceVulkan12Features Features12{};
+        Features12.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        Features12.timelineSemaphore = VK_TRUE;
+        Features12.drawIndirectCount = SelectedDevice.Features12.drawIndirectCount;
+        if( DescriptorIndexing() )
+        {
+            Features.shaderSampledImageArrayDynamicIndexing          = VK_TRUE;
+            Features.shaderStorageBufferArrayDynamicIndexing         = VK_TRUE;
+            Features12.runtimeDescriptorArray                        = VK_TRUE;
+            Features12.descriptorBindingPartiallyBound               = VK_TRUE;
+            Features12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+            Features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            Features12.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+        }
+
+        VkDeviceCreateInfo DeviceCreateInfo{};
+        DeviceCreateInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        DeviceCreateInfo.pNext                   = &Features12;
+        DeviceCreateInfo.queueCreateInfoCount    = static_cast<uint32_t>( QueueCreateInfos.size() );
+        DeviceCreateInfo.pQueueCreateInfos       = QueueCreateInfos.data();
+        std::vector<const char *> Extensions{ DeviceExtensions() };
+        DeviceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>( Extensions.size() );
+        DeviceCreateInfo.ppEnabledExtensionNames = Extensions.data();
+        DeviceCreateInfo.pEnabledFeatures        = &Features;
+#ifdef _DEBUG
+        DeviceCreateInfo.enabledLayerCount   = sizeof( ValidationLayers ) / sizeof( ValidationLayers[ 0 ] );
+        DeviceCreateInfo.ppEnabledLayerNames = ValidationLayers;
+#endif
+        VkResult Result{ vkCreateDevice( PhysicalDevice, &DeviceCreateInfo, nullptr, &LogicalDevice ) };
+        if( Result != VK_SUCCESS )
+        {
+            LogicalDevice = VK_NULL_HANDLE;
+            Loggers.critical( std::format( "Failed to create logical device, error: {}", string_VkResult( Result ) ).c_str() );
+            return;
+        }
+        vkGetDeviceQueue( LogicalDevice, Indecies.graphic.value(), 0, &GraphicQueue );
+        vkGetDeviceQueue( LogicalDevice, Indecies.present.value(), 0, &PresentQueue );
+        vkGetDeviceQueue( LogicalDevice, Indecies.transfer.value(), 0, &TransferQueue );
+    }
+
+    float SuitableDevice( VkPhysicalDevice device, struct PhysicalDevice &Device )
     {
         std::vector<uint8_t> mark{};
-        struct PhysicalDevice Device;
+        Device.Device = device;
         uint32_t QueueCount{ 0 };
         uint32_t ExtensionsCount{ 0 };
         vkGetPhysicalDeviceProperties( device, &Device.Properties );
-        vkGetPhysicalDeviceFeatures( device, &Device.Features );
+        Device.Properties12 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+        if( Device.Properties.apiVersion >= VK_API_VERSION_1_2 )
+        {
+            VkPhysicalDeviceProperties2 Properties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &Device.Properties12 };
+            vkGetPhysicalDeviceProperties2( device, &Properties2 );
+        }
+        Device.Features12 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+        VkPhysicalDeviceFeatures2 Features2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &Device.Features12 };
+        vkGetPhysicalDeviceFeatures2( device, &Features2 );
+        Device.Features = Features2.features;
         vkEnumerateDeviceExtensionProperties( device, nullptr, &ExtensionsCount, nullptr );
         vkGetPhysicalDeviceQueueFamilyProperties( device, &QueueCount, nullptr );
         Device.QueueFamilies.resize( QueueCount );
@@ -312,6 +601,7 @@ class VulkanInstance
 
         // Necess
         if( !Device.Features.geometryShader ) return 0;
+        if( Device.Properties.apiVersion < VK_API_VERSION_1_2 || !Device.Features12.timelineSemaphore ) return 0;
         // Necess
 
         // Features
@@ -323,8 +613,10 @@ class VulkanInstance
             // Necess
             if( !Device.Indecies.isComplete() )
             {
+                // Headless has nothing to present to; the graphics family stands in.
                 VkBool32 presentSupport{ 0 };
-                vkGetPhysicalDeviceSurfaceSupportKHR( device, index, Screen, &presentSupport );
+                if( Screen ) vkGetPhysicalDeviceSurfaceSupportKHR( device, index, Screen, &presentSupport );
+                else presentSupport = ( Device.QueueFamilies[ index ].queueFlags & VK_QUEUE_GRAPHICS_BIT ) != 0;
                 if( Device.QueueFamilies[ index ].queueFlags & VK_QUEUE_GRAPHICS_BIT ) Device.Indecies.graphic = index;
                 if( Device.QueueFamilies[ index ].queueFlags & VK_QUEUE_TRANSFER_BIT ) Device.Indecies.transfer = index;
                 if( presentSupport ) Device.Indecies.present = index;
@@ -332,9 +624,16 @@ class VulkanInstance
             // Necess
         }
         if( !Device.Indecies.isComplete() ) return 0;
+        // A transfer-only family is the copy engine on discrete GPUs; uploads there run beside rendering.
+        for( uint32_t index{ 0 }; index < QueueCount; index++ )
+            if( ( Device.QueueFamilies[ index ].queueFlags & VK_QUEUE_TRANSFER_BIT ) && !( Device.QueueFamilies[ index ].queueFlags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) )
+            {
+                Device.Indecies.transfer = index;
+                break;
+            }
 
-        size_t necessExts{ sizeof( NecessDeviceExtensions ) / sizeof( NecessDeviceExtensions[ 0 ] ) };
-        std::set<std::string> Ext{ &NecessDeviceExtensions[ 0 ], &NecessDeviceExtensions[ necessExts ] };
+        std::vector<const char *> Necess{ DeviceExtensions() };
+        std::set<std::string> Ext{ Necess.begin(), Necess.end() };
         for( uint32_t i{ 0 }; i < Device.AviliableExtensions.size(); i++ )
         {
             // Necess
@@ -343,6 +642,17 @@ class VulkanInstance
             // Necess
         }
         if( !Ext.empty() ) return 0;
+        if( Screen )
+        {
+            uint32_t Count{ 0 };
+            vkGetPhysicalDeviceSurfaceFormatsKHR( device, Screen, &Count, nullptr );
+            Device.swapchain.AviliableFormat.resize( Count );
+            vkGetPhysicalDeviceSurfaceFormatsKHR( device, Screen, &Count, Device.swapchain.AviliableFormat.data() );
+            vkGetPhysicalDeviceSurfacePresentModesKHR( device, Screen, &Count, nullptr );
+            Device.swapchain.AviliablePresentModes.resize( Count );
+            vkGetPhysicalDeviceSurfacePresentModesKHR( device, Screen, &Count, Device.swapchain.AviliablePresentModes.data() );
+            if( Device.swapchain.AviliableFormat.empty() || Device.swapchain.AviliablePresentModes.empty() ) return 0;
+        }
 
         float ret{ 0.f };
         for( auto i : mark ) ret += i;
@@ -0,0 +1,102 @@
+// Packs the assets the app loads into the one file it maps at startup, bin/assets.pack; the
+// Assets target runs it from the project root, so inputs are named as the app names them:
+// assetpack bin/assets.pack --cache build/pack-cache models/plate.obj textures/img.png ...
+//
+//   --cache path     where meshes and textures are processed first, MeshCache and TextureCache
+//                    style, so unchanged sources are not processed again; pack-cache by default
+//   --no-compress    every entry stored raw
+//
+// *.obj files go in as MeshCache files and *.png / *.jpg as KTX2 in each format the app picks
+// from, both raw so their bytes go from the mapping straight into staging memory. Anything
+// else, the SPIR-V among it, goes in as it is, LZ4 compressed where that saves an eighth.
+#include "vulkan.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "AssetPack.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <spdlog/spdlog.h>
+
+const LoggerCallbacks PackerLoggers{ []( const char *data )
+                                    { spdlog::trace( data ); },
+                                    []( const char *data )
+                                    { spdlog::debug( data ); },
+                                    []( const char *data )
+                                    { spdlog::info( data ); },
+                                    []( const char *data )
+                                    { spdlog::warn( data ); },
+                                    []( const char *data )
+                                    { spdlog::error( data ); },
+                                    []( const char *data )
+                                    { spdlog::critical( data ); throw std::runtime_error( data ); } };
+
+int main( int argc, char *argv[] )
+{
+    const char *Output{ nullptr };
+    std::filesystem::path Cache{ "pack-cache" };
+    bool Compress{ true };
+    std::vector<const char *> Inputs;
+    for( int i{ 1 }; i < argc; i++ )
+    {
+        if( !strcmp( argv[ i ], "--cache" ) && i + 1 < argc ) Cache = argv[ ++i ];
+        else if( !strcmp( argv[ i ], "--no-compress" ) ) Compress = false;
+        else if( !Output ) Output = argv[ i ];
+        else Inputs.push_back( argv[ i ] );
+    }
+    if( !Output )
+    {
+        std::cerr << "Usage: assetpack OUTPUT [--cache DIRECTORY] [--no-compress] INPUT..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto Start{ std::chrono::steady_clock::now() };
+        MeshCache Meshes{ ( Cache / "meshes" ).string().c_str(), PackerLoggers };
+        TextureCache Textures{ ( Cache / "textures" ).string().c_str(), PackerLoggers };
+        AssetPackWriter Writer;
+        for( const char *Input : Inputs )
+        {
+            std::filesystem::path Extension{ std::filesystem::path{ Input }.extension() };
+            if( Extension == ".obj" )
+            {
+                Meshes.Load( Input );
+                MappedFile Processed{ Meshes.CacheFile( Input ).string().c_str() };
+                Writer.Add( MeshCache::PackPath( Input ), { Processed.Data(), Processed.Size() }, false );
+            }
+            else if( Extension == ".png" || Extension == ".jpg" )
+            {
+                DecodedTexture Decoded;
+                for( TextureFormat Format : { TextureFormat::Bc7, TextureFormat::Rgba8 } )
+                {
+                    CachedTexture Texture;
+                    if( !Textures.Find( Input, Format, true, Texture ) )
+                    {
+                        if( Decoded.Levels.empty() ) Decoded = Textures.Decode( Input );
+                        Texture = Textures.Encode( Input, Decoded, Format );
+                    }
+                    VkFormat Encoded{ TextureVkFormat( Format, true ) };
+                    MappedFile Processed{ Textures.CacheFile( Input, Format, true ).string().c_str() };
+                    Writer.Add( TextureCache::PackPath( Input, Encoded ), { Processed.Data(), Processed.Size() }, false );
+                }
+            }
+            else
+            {
+                MappedFile File{ Input };
+                Writer.Add( Input, { File.Data(), File.Size() }, Compress );
+            }
+        }
+        Writer.Write( Output );
+        AssetPackStatistics Statistics{ Writer.Stat() };
+        double Ms{ std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count() };
+        spdlog::info( "{}: {} entries, {:.2f} MB stored for {:.2f} MB, {} LZ4 compressed, packed in {:.1f} ms.", Output, Statistics.Entries, Statistics.StoredBytes / double( 1 << 20 ),
+                      Statistics.RawBytes / double( 1 << 20 ), Statistics.Compressed, Ms );
+    }
+    catch( const std::exception &e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+// Links files into an executable as read-only data, listed at runtime by EmbeddedFiles(); the
+// EMBED_ASSETS build runs it from the project root so paths are named as the app names them:
+// embedfiles build/embedded/EmbeddedFiles.cpp bin/assets.pack
+//
+//   --array    write the bytes out as an initializer list instead of .incbin
+//
+// By default the source it writes has the assembler pull each file in with .incbin, so the
+// compiler never parses the bytes and the object costs about what copying the file does;
+// the source itself stays a few lines whatever the size. --array is for compilers without
+// GNU style inline assembly, MSVC among them; it costs the compiler a few seconds a megabyte.
+// Either way each file is 64-byte aligned, which keeps AssetPack entries aligned, and is
+// followed by a NUL.
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+// For a string literal, C++ or assembler alike.
+static std::string Escaped( std::string_view text )
+{
+    std::string Text;
+    for( char Character : text )
+    {
+        if( Character == '"' || Character == '\\' ) Text += '\\';
+        Text += Character;
+    }
+    return Text;
+}
+
+// The bytes as decimals, 32 to a line; a table keeps it at a copy per byte.
+static void AppendArray( std::string &source, const std::vector<char> &data )
+{
+    static const auto Decimals{ []
+                                {
+                                    std::vector<std::string> Table( 256 );
+                                    for( int Byte{ 0 }; Byte < 256; Byte++ ) Table[ Byte ] = std::to_string( Byte ) + ',';
+                                    return Table;
+                                }() };
+    source.reserve( source.size() + data.size() * 4 + data.size() / 8 );
+    for( size_t Index{ 0 }; Index < data.size(); Index++ )
+    {
+        source += Decimals[ static_cast<uint8_t>( data[ Index ] ) ];
+        if( Index % 32 == 31 ) source += '\n';
+    }
+    source += "0\n";
+}
+
+int main( int argc, char *argv[] )
+{
+    const char *Output{ nullptr };
+    bool Array{ false };
+    std::vector<std::string> Inputs;
+    for( int i{ 1 }; i < argc; i++ )
+    {
+        if( !strcmp( argv[ i ], "--array" ) ) Array = true;
+        else if( !Output ) Output = argv[ i ];
+        else Inputs.push_back( argv[ i ] );
+    }
+    if( !Output )
+    {
+        std::cerr << "Usage: embedfiles OUTPUT [--array] INPUT..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto Start{ std::chrono::steady_clock::now() };
+    std::string Source{ "// Generated by embedfiles; do not edit.\n#include \"EmbeddedFiles.h\"\n\n" };
+    if( !Array )
+        Source += "#if defined( __APPLE__ )\n"
+                  "#    define EMBED_SECTION \".const_data\\n\"\n"
+                  "#    define EMBED_SYMBOL( name ) \"_\" #name\n"
+                  "#elif defined( _WIN32 )\n"
+                  "#    define EMBED_SECTION \".section .rdata,\\\"dr\\\"\\n\"\n"
+                  "#    define EMBED_SYMBOL( name ) #name\n"
+                  "#else\n"
+                  "#    define EMBED_SECTION \".section .rodata\\n\"\n"
+                  "#    define EMBED_SYMBOL( name ) #name\n"
+                  "#endif\n\n";
+    std::string Table;
+    uintmax_t Bytes{ 0 };
+    for( size_t Index{ 0 }; Index < Inputs.size(); Index++ )
+    {
+        std::string Path{ Inputs[ Index ] };
+        std::replace( Path.begin(), Path.end(), '\\', '/' );
+        while( Path.starts_with( "./" ) ) Path.erase( 0, 2 );
+        std::string Name{ std::format( "EmbeddedFile{}", Index ) };
+        std::error_code Error;
+        uintmax_t Size{ std::filesystem::file_size( Inputs[ Index ], Error ) };
+        if( Error )
+        {
+            std::cerr << std::format( "Failed to embed {}: {}.", Inputs[ Index ], Error.message() ) << std::endl;
+            return EXIT_FAILURE;
+        }
+        if( Array )
+        {
+            std::ifstream In{ Inputs[ Index ], std::ios::binary };
+            std::vector<char> Data{ std::istreambuf_iterator<char>{ In }, {} };
+            if( Data.size() != Size )
+            {
+                std::cerr << std::format( "Failed to read {}.", Inputs[ Index ] ) << std::endl;
+                return EXIT_FAILURE;
+            }
+            Source += std::format( "alignas( 64 ) static const uint8_t {}[]{{\n", Name );
+            AppendArray( Source, Data );
+            Source += "};\n";
+        }
+        else
+        {
+            std::string Absolute{ std::filesystem::absolute( Inputs[ Index ] ).lexically_normal().generic_string() };
+            Source += std::format( "__asm__( EMBED_SECTION\n"
+                                   "         \".balign 64\\n\"\n"
+                                   "         EMBED_SYMBOL( {0} ) \":\\n\"\n"
+                                   "         \".incbin \\\"{1}\\\"\\n\"\n"
+                                   "         \".byte 0\\n\"\n"
+                                   "         \".text\\n\" );\n"
+                                   "extern \"C\" const uint8_t {0}[];\n",
+                                   Name, Escaped( Escaped( Absolute ) ) );
+        }
+        Table += std::format( "    {{ \"{}\", {}, {} }},\n", Escaped( Path ), Name, Size );
+        Bytes += Size;
+    }
+    Source += Table.empty() ? "\nstatic const EmbeddedFile *const Files{ nullptr };\n"
+                            : std::format( "\nstatic const EmbeddedFile Files[]{{\n{}}};\n", Table );
+    Source += std::format( "\nstd::span<const EmbeddedFile> EmbeddedFiles()\n{{\n    return {{ Files, {} }};\n}}\n", Inputs.size() );
+
+    // Always written, so the source is compiled again whenever an input changed.
+    std::filesystem::path OutputPath{ Output };
+    std::error_code Error;
+    if( OutputPath.has_parent_path() ) std::filesystem::create_directories( OutputPath.parent_path(), Error );
+    std::ofstream Out{ OutputPath, std::ios::binary | std::ios::trunc };
+    Out.write( Source.data(), Source.size() );
+    if( !Out )
+    {
+        std::cerr << std::format( "Failed to write {}.", Output ) << std::endl;
+        return EXIT_FAILURE;
+    }
+    double Ms{ std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Start ).count() };
+    std::cout << std::format( "{}: {} files, {:.2f} MB embedded {}, {:.1f} KB of source generated in {:.1f} ms.", Output, Inputs.size(), Bytes / double( 1 << 20 ),
+                              Array ? "as arrays" : "by .incbin", Source.size() / 1024.0, Ms )
+              << std::endl;
+    return EXIT_SUCCESS;
+}